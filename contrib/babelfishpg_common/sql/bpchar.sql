@@ -134,6 +134,11 @@ RETURNS INT4
 AS 'bpcharcmp'
 LANGUAGE internal IMMUTABLE STRICT PARALLEL SAFE;
 
+CREATE FUNCTION sys.bpchar_sortsupport(internal)
+RETURNS void
+AS 'bpchar_sortsupport'
+LANGUAGE internal IMMUTABLE STRICT PARALLEL SAFE;
+
 CREATE FUNCTION sys.hashbpchar(sys.BPCHAR)
 RETURNS INT4
 AS 'hashbpchar'
@@ -146,7 +151,8 @@ CREATE OPERATOR CLASS bpchar_ops
     OPERATOR    3   pg_catalog.=  (sys.BPCHAR, sys.BPCHAR),
     OPERATOR    4   pg_catalog.>= (sys.BPCHAR, sys.BPCHAR),
     OPERATOR    5   pg_catalog.>  (sys.BPCHAR, sys.BPCHAR),
-    FUNCTION    1   sys.bpcharcmp(sys.BPCHAR, sys.BPCHAR);
+    FUNCTION    1   sys.bpcharcmp(sys.BPCHAR, sys.BPCHAR),
+    FUNCTION    2   sys.bpchar_sortsupport(internal);
 
 CREATE OPERATOR CLASS bpchar_ops
     DEFAULT FOR TYPE sys.BPCHAR USING hash AS
@@ -244,5 +244,22 @@ LANGUAGE SQL IMMUTABLE STRICT PARALLEL SAFE;
 CREATE CAST (FIXEDDECIMAL AS sys.SMALLDATETIME)
 WITH FUNCTION sys.money2smalldatetime (FIXEDDECIMAL) AS IMPLICIT;
 
+-- SortSupport for the btree string operator classes
+CREATE OR REPLACE FUNCTION sys.varchar_sortsupport(internal)
+RETURNS void
+AS 'babelfishpg_common', 'varchar_sortsupport'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+ALTER OPERATOR FAMILY sys.varchar_ops USING btree ADD
+    FUNCTION    2   (sys.VARCHAR, sys.VARCHAR) sys.varchar_sortsupport(internal);
+
+CREATE OR REPLACE FUNCTION sys.bpchar_sortsupport(internal)
+RETURNS void
+AS 'bpchar_sortsupport'
+LANGUAGE internal IMMUTABLE STRICT PARALLEL SAFE;
+
+ALTER OPERATOR FAMILY sys.bpchar_ops USING btree ADD
+    FUNCTION    2   (sys.BPCHAR, sys.BPCHAR) sys.bpchar_sortsupport(internal);
+
 -- Reset search_path to not affect any subsequent scripts
 SELECT set_config('search_path', trim(leading 'sys, ' from current_setting('search_path')), false);
\ No newline at end of file
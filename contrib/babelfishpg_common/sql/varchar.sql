@@ -134,6 +134,11 @@ RETURNS INT4
 AS 'babelfishpg_common', 'varcharcmp'
 LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
+CREATE FUNCTION sys.varchar_sortsupport(internal)
+RETURNS void
+AS 'babelfishpg_common', 'varchar_sortsupport'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
 CREATE FUNCTION sys.hashvarchar(sys.VARCHAR)
 RETURNS INT4
 AS 'babelfishpg_common', 'hashvarchar'
@@ -146,7 +151,8 @@ CREATE OPERATOR CLASS varchar_ops
     OPERATOR    3   pg_catalog.=  (sys.VARCHAR, sys.VARCHAR),
     OPERATOR    4   pg_catalog.>= (sys.VARCHAR, sys.VARCHAR),
     OPERATOR    5   pg_catalog.>  (sys.VARCHAR, sys.VARCHAR),
-    FUNCTION    1   sys.varcharcmp(sys.VARCHAR, sys.VARCHAR);
+    FUNCTION    1   sys.varcharcmp(sys.VARCHAR, sys.VARCHAR),
+    FUNCTION    2   sys.varchar_sortsupport(internal);
 
 CREATE OPERATOR CLASS varchar_ops
     DEFAULT FOR TYPE sys.VARCHAR USING hash AS
@@ -8,6 +8,8 @@
 
 #include "postgres.h"
 
+#include <math.h>
+
 #include "fmgr.h"
 #include "utils/builtins.h"
 #include "utils/date.h"
@@ -74,10 +76,19 @@ datetime_in_str(char *str)
 		PG_RETURN_TIMESTAMP(result);
 	}
 
-	dterr = ParseDateTime(str, workbuf, sizeof(workbuf),
-						  field, ftype, MAXDATEFIELDS, &nf);
-	if (dterr == 0)
-		dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
+	/* try the common fixed layouts before the general decoder */
+	if (DecodeDatetimeFast(str, tm, &fsec, NULL))
+	{
+		dtype = DTK_DATE;
+		dterr = 0;
+	}
+	else
+	{
+		dterr = ParseDateTime(str, workbuf, sizeof(workbuf),
+							  field, ftype, MAXDATEFIELDS, &nf);
+		if (dterr == 0)
+			dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
+	}
 	// dterr == 1 means that input is TIME format(e.g 12:34:59.123)
 	// initialize other necessary date parts and accept input format
 	if (dterr == 1)
@@ -626,6 +637,193 @@ initializeToDefaultDatetime(void)
 	return result;
 } 
 
+/* true if the n characters at p are all digits */
+static inline bool
+fast_isdigits(const char *p, int n)
+{
+	int			i;
+
+	for (i = 0; i < n; i++)
+	{
+		if (p[i] < '0' || p[i] > '9')
+			return false;
+	}
+	return true;
+}
+
+static inline int
+fast_digitval(const char *p, int n)
+{
+	int			val = 0;
+	int			i;
+
+	for (i = 0; i < n; i++)
+		val = val * 10 + (p[i] - '0');
+	return val;
+}
+
+/*
+ * DecodeDatetimeFast --- decode the common fixed datetime layouts
+ *
+ * Handles
+ *		YYYY-MM-DD[{ |T}HH:MI[:SS[.fffffff]][[ ]{+|-}HH[[:]MI]]]
+ *		YYYYMMDD[ HH:MI[:SS[.fffffff]][[ ]{+|-}HH[[:]MI]]]
+ * optionally followed by blanks, which is what nearly all ETL and bulk
+ * load input looks like, without going through ParseDateTime() and
+ * DecodeDateTime().  Anything else, including out of range fields, returns
+ * false so that the caller falls back to the general decoder, which then
+ * accepts the value or reports the error as before.  On success tm, fsec
+ * and *tzp are set to what DecodeDateTime() would have returned for a
+ * DTK_DATE value.  tzp may be NULL if the caller has no use for the offset.
+ */
+bool
+DecodeDatetimeFast(const char *str, struct pg_tm *tm, fsec_t *fsec, int *tzp)
+{
+	const char *cp = str;
+	bool		have_tz = false;
+	int			tz = 0;
+
+	tm->tm_hour = 0;
+	tm->tm_min = 0;
+	tm->tm_sec = 0;
+	tm->tm_isdst = -1;
+	*fsec = 0;
+
+	/* date */
+	if (fast_isdigits(cp, 4) && cp[4] == '-' && fast_isdigits(cp + 5, 2) &&
+		cp[7] == '-' && fast_isdigits(cp + 8, 2))
+	{
+		tm->tm_year = fast_digitval(cp, 4);
+		tm->tm_mon = fast_digitval(cp + 5, 2);
+		tm->tm_mday = fast_digitval(cp + 8, 2);
+		cp += 10;
+		if (*cp == 'T' && cp[1] >= '0' && cp[1] <= '9')
+			cp++;
+		else if (*cp == ' ' && cp[1] >= '0' && cp[1] <= '9')
+			cp++;
+	}
+	else if (fast_isdigits(cp, 8) && (cp[8] == '\0' || cp[8] == ' '))
+	{
+		tm->tm_year = fast_digitval(cp, 4);
+		tm->tm_mon = fast_digitval(cp + 4, 2);
+		tm->tm_mday = fast_digitval(cp + 6, 2);
+		cp += 8;
+		if (*cp == ' ' && cp[1] >= '0' && cp[1] <= '9')
+			cp++;
+	}
+	else
+		return false;
+
+	if (tm->tm_year < 1 || tm->tm_mon < 1 || tm->tm_mon > MONTHS_PER_YEAR ||
+		tm->tm_mday < 1 ||
+		tm->tm_mday > day_tab[isleap(tm->tm_year)][tm->tm_mon - 1])
+		return false;
+
+	/* time */
+	if (*cp >= '0' && *cp <= '9')
+	{
+		if (!fast_isdigits(cp, 2) || cp[2] != ':' || !fast_isdigits(cp + 3, 2))
+			return false;
+		tm->tm_hour = fast_digitval(cp, 2);
+		tm->tm_min = fast_digitval(cp + 3, 2);
+		cp += 5;
+
+		if (*cp == ':')
+		{
+			if (!fast_isdigits(cp + 1, 2) || (cp[3] >= '0' && cp[3] <= '9'))
+				return false;
+			tm->tm_sec = fast_digitval(cp + 1, 2);
+			cp += 3;
+
+			if (*cp == '.')
+			{
+				const char *frac = cp + 1;
+				int			ndigits = 0;
+
+				while (frac[ndigits] >= '0' && frac[ndigits] <= '9')
+					ndigits++;
+				if (ndigits == 0)
+					return false;
+
+				if (ndigits <= 6)
+				{
+					int			val = fast_digitval(frac, ndigits);
+
+					while (ndigits++ < 6)
+						val *= 10;
+					*fsec = val;
+				}
+				else
+				{
+					/* same rounding as ParseFractionalSecond() */
+					*fsec = rint(strtod(cp, NULL) * 1000000);
+				}
+				cp = frac;
+				while (*cp >= '0' && *cp <= '9')
+					cp++;
+			}
+		}
+
+		/* leave 24:00:00 and leap seconds to DecodeDateTime() */
+		if (tm->tm_hour >= HOURS_PER_DAY || tm->tm_min >= MINS_PER_HOUR ||
+			tm->tm_sec >= SECS_PER_MINUTE)
+			return false;
+
+		/* numeric time zone offset */
+		if (*cp == ' ' && (cp[1] == '+' || cp[1] == '-'))
+			cp++;
+		if (*cp == '+' || *cp == '-')
+		{
+			bool		negative = (*cp == '-');
+			int			hr;
+			int			min = 0;
+
+			if (!fast_isdigits(cp + 1, 2))
+				return false;
+			hr = fast_digitval(cp + 1, 2);
+			if (cp[3] == ':' && fast_isdigits(cp + 4, 2) &&
+				!(cp[6] >= '0' && cp[6] <= '9'))
+			{
+				min = fast_digitval(cp + 4, 2);
+				cp += 6;
+			}
+			else if (fast_isdigits(cp + 3, 2) && !(cp[5] >= '0' && cp[5] <= '9'))
+			{
+				min = fast_digitval(cp + 3, 2);
+				cp += 5;
+			}
+			else if (!(cp[3] >= '0' && cp[3] <= '9') && cp[3] != ':')
+				cp += 3;
+			else
+				return false;
+
+			if (hr > MAX_TZDISP_HOUR || min >= MINS_PER_HOUR)
+				return false;
+
+			/* like DecodeTimezone(), the offset is in seconds west of UTC */
+			tz = (hr * MINS_PER_HOUR + min) * SECS_PER_MINUTE;
+			if (!negative)
+				tz = -tz;
+			have_tz = true;
+		}
+	}
+
+	while (*cp == ' ')
+		cp++;
+	if (*cp != '\0')
+		return false;
+
+	if (tzp != NULL)
+	{
+		if (have_tz)
+			*tzp = tz;
+		else
+			*tzp = DetermineTimeZoneOffset(tm, session_timezone);
+	}
+
+	return true;
+}
+
 Datum
 datetime_pl_datetime(PG_FUNCTION_ARGS)
 {
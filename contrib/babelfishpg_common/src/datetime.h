@@ -26,6 +26,7 @@
 #define END_DATETIME	INT64CONST(252455615999999000)
 
 extern Timestamp initializeToDefaultDatetime(void);
+extern bool DecodeDatetimeFast(const char *str, struct pg_tm *tm, fsec_t *fsec, int *tzp);
 
 /* Range-check a datetime */
 #define IS_VALID_DATETIME(t)  (MIN_DATETIME <= (t) && (t) < END_DATETIME)
@@ -65,10 +65,19 @@ datetime2_in_str(char *str, int32 typmod)
 		PG_RETURN_TIMESTAMP(result);
 	}
 
-	dterr = ParseDateTime(str, workbuf, sizeof(workbuf),
-						  field, ftype, MAXDATEFIELDS, &nf);
-	if (dterr == 0)
-		dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
+	/* try the common fixed layouts before the general decoder */
+	if (DecodeDatetimeFast(str, tm, &fsec, NULL))
+	{
+		dtype = DTK_DATE;
+		dterr = 0;
+	}
+	else
+	{
+		dterr = ParseDateTime(str, workbuf, sizeof(workbuf),
+							  field, ftype, MAXDATEFIELDS, &nf);
+		if (dterr == 0)
+			dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
+	}
 	
 	/* 
 	 * dterr == 1 means that input is TIME format(e.g 12:34:59.123)
@@ -104,11 +104,19 @@ datetimeoffset_in(PG_FUNCTION_ARGS)
 		PG_RETURN_DATETIMEOFFSET(datetimeoffset);
 	}
 
-	dterr = ParseDateTime(str, workbuf, sizeof(workbuf),
-						  field, ftype, MAXDATEFIELDS, &nf);
-
-	if (dterr == 0)
-		dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
+	/* try the common fixed layouts before the general decoder */
+	if (DecodeDatetimeFast(str, tm, &fsec, &tz))
+	{
+		dtype = DTK_DATE;
+		dterr = 0;
+	}
+	else
+	{
+		dterr = ParseDateTime(str, workbuf, sizeof(workbuf),
+							  field, ftype, MAXDATEFIELDS, &nf);
+		if (dterr == 0)
+			dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
+	}
 	// dterr == 1 means that input is TIME format(e.g 12:34:59.123)
 	// initialize other necessary date parts and accept input format
 	if (dterr == 1)
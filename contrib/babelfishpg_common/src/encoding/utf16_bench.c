@@ -0,0 +1,528 @@
+/*-------------------------------------------------------------------------
+ *
+ * utf16_bench.c
+ *	  Stand-alone microbenchmark for the transcoders in utf16_simd.h
+ *
+ * This is not part of the extension.  Build and run it with
+ *
+ *	  cc -O2 -o utf16_bench contrib/babelfishpg_common/src/encoding/utf16_bench.c
+ *	  ./utf16_bench [megabytes]
+ *
+ * For each corpus (pure ASCII, ASCII with some BMP characters, mostly BMP,
+ * and text with astral plane characters) it reports the throughput of the
+ * code point at a time conversion the TDS layer used before, and of the
+ * bulk conversion with the scalar and with the best available kernels.  It
+ * also checks that they all produce the same output.
+ *
+ * IDENTIFICATION
+ *	  contrib/babelfishpg_common/src/encoding/utf16_bench.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utf16_simd.h"
+
+/* A minimal StringInfo, so that the baseline grows its output the same way */
+typedef struct
+{
+	uint8_t    *data;
+	size_t		len;
+	size_t		maxlen;
+} Buf;
+
+static void
+buf_append_byte(Buf *buf, uint8_t c)
+{
+	if (buf->len + 1 >= buf->maxlen)
+	{
+		buf->maxlen *= 2;
+		buf->data = realloc(buf->data, buf->maxlen);
+	}
+	buf->data[buf->len++] = c;
+	buf->data[buf->len] = '\0';
+}
+
+/*
+ * The code point at a time conversions, as in tdsutils.c, except that they
+ * return -1 where those throw an error.
+ */
+static int32_t
+legacy_get_utf8(const uint8_t *in, size_t len, int *consumed)
+{
+	uint32_t	code;
+
+	if ((in[0] & 0x80) == 0)
+	{
+		code = in[0];
+		*consumed = 1;
+	}
+	else if ((in[0] & 0xE0) == 0xC0)
+	{
+		if (len < 2 || (in[1] & 0xC0) != 0x80)
+			return -1;
+		code = ((in[0] & 0x1F) << 6) | (in[1] & 0x3F);
+		*consumed = 2;
+	}
+	else if ((in[0] & 0xF0) == 0xE0)
+	{
+		if (len < 3 || (in[1] & 0xC0) != 0x80 || (in[2] & 0xC0) != 0x80)
+			return -1;
+		code = ((in[0] & 0x0F) << 12) | ((in[1] & 0x3F) << 6) | (in[2] & 0x3F);
+		*consumed = 3;
+	}
+	else if ((in[0] & 0xF8) == 0xF0)
+	{
+		if (len < 4 || (in[1] & 0xC0) != 0x80 || (in[2] & 0xC0) != 0x80 ||
+			(in[3] & 0xC0) != 0x80)
+			return -1;
+		code = ((in[0] & 0x07) << 18) | ((in[1] & 0x3F) << 12) |
+			((in[2] & 0x3F) << 6) | (in[3] & 0x3F);
+		*consumed = 4;
+	}
+	else
+		return -1;
+
+	if (code > 0x10FFFF || (code >= 0xD800 && code < 0xE000) || code == 0)
+		return -1;
+	return code;
+}
+
+static int32_t
+legacy_get_utf16(const uint8_t *in, size_t len, int *consumed)
+{
+	uint16_t	code1 = in[1] << 8 | in[0];
+	uint16_t	code2;
+
+	if (code1 < 0xD800 || code1 >= 0xE000)
+	{
+		if (code1 == 0)
+			return -1;
+		*consumed = 2;
+		return code1;
+	}
+	if (code1 >= 0xDC00 || len < 4)
+		return -1;
+	code2 = in[3] << 8 | in[2];
+	if (code2 < 0xDC00 || code2 > 0xE000)
+		return -1;
+	*consumed = 4;
+	return ((code1 & 0x03FF) << 10 | (code2 & 0x03FF)) + 0x10000;
+}
+
+static void
+legacy_add_utf8(int32_t code, Buf *buf)
+{
+	if (code <= 0x7F)
+		buf_append_byte(buf, code);
+	else if (code <= 0x7FF)
+	{
+		buf_append_byte(buf, 0xC0 | (code >> 6));
+		buf_append_byte(buf, 0x80 | (code & 0x3F));
+	}
+	else if (code <= 0xFFFF)
+	{
+		buf_append_byte(buf, 0xE0 | (code >> 12));
+		buf_append_byte(buf, 0x80 | ((code >> 6) & 0x3F));
+		buf_append_byte(buf, 0x80 | (code & 0x3F));
+	}
+	else
+	{
+		buf_append_byte(buf, 0xF0 | (code >> 18));
+		buf_append_byte(buf, 0x80 | ((code >> 12) & 0x3F));
+		buf_append_byte(buf, 0x80 | ((code >> 6) & 0x3F));
+		buf_append_byte(buf, 0x80 | (code & 0x3F));
+	}
+}
+
+static void
+legacy_add_utf16(int32_t code, Buf *buf)
+{
+	if (code <= 0xFFFF)
+	{
+		buf_append_byte(buf, code & 0xFF);
+		buf_append_byte(buf, (code >> 8) & 0xFF);
+	}
+	else
+	{
+		uint16_t	high = 0xD800 + (((code - 0x10000) >> 10) & 0x3FF);
+		uint16_t	low = 0xDC00 + ((code - 0x10000) & 0x3FF);
+
+		buf_append_byte(buf, high & 0xFF);
+		buf_append_byte(buf, high >> 8);
+		buf_append_byte(buf, low & 0xFF);
+		buf_append_byte(buf, low >> 8);
+	}
+}
+
+/* Returns false where the conversions in tdsutils.c throw an error */
+static int
+legacy_utf8_to_utf16(const uint8_t *in, size_t len, Buf *out)
+{
+	size_t		i;
+	int			consumed;
+
+	for (i = 0; i < len; i += consumed)
+	{
+		int32_t		code = legacy_get_utf8(&in[i], len - i, &consumed);
+
+		if (code < 0)
+			return 0;
+		legacy_add_utf16(code, out);
+	}
+	return 1;
+}
+
+static int
+legacy_utf16_to_utf8(const uint8_t *in, size_t len, Buf *out)
+{
+	size_t		i;
+	int			consumed;
+
+	if (len & 1)
+		return 0;
+	for (i = 0; i < len; i += consumed)
+	{
+		int32_t		code = legacy_get_utf16(&in[i], len - i, &consumed);
+
+		if (code < 0 || (code > 0xD800 && code < 0xE000) || code > 0x10FFFF)
+			return 0;
+		legacy_add_utf8(code, out);
+	}
+	return 1;
+}
+
+/* The bulk conversions, driven the way tdsutils.c drives them */
+#define CHUNK_SIZE	(64 * 1024)
+
+static void
+buf_reserve(Buf *buf, size_t needed)
+{
+	while (buf->len + needed + 1 > buf->maxlen)
+		buf->maxlen *= 2;
+	buf->data = realloc(buf->data, buf->maxlen);
+}
+
+static int
+bulk_utf8_to_utf16(const Utf16Kernels *k, const uint8_t *in, size_t len, Buf *out)
+{
+	size_t		i;
+
+	for (i = 0; i < len;)
+	{
+		size_t		chunk = len - i < CHUNK_SIZE ? len - i : CHUNK_SIZE;
+		size_t		converted;
+		size_t		written;
+
+		buf_reserve(out, chunk * 2);
+		converted = utf8_to_utf16le_with(k, &in[i], chunk, out->data + out->len, &written);
+		out->len += written;
+		out->data[out->len] = '\0';
+		i += converted;
+
+		if (converted < chunk)
+		{
+			int			consumed;
+			int32_t		code = legacy_get_utf8(&in[i], len - i, &consumed);
+
+			if (code < 0)
+				return 0;
+			legacy_add_utf16(code, out);
+			i += consumed;
+		}
+	}
+	return 1;
+}
+
+static int
+bulk_utf16_to_utf8(const Utf16Kernels *k, const uint8_t *in, size_t len, Buf *out)
+{
+	size_t		i;
+
+	if (len & 1)
+		return 0;
+	for (i = 0; i < len;)
+	{
+		size_t		chunk = len - i < CHUNK_SIZE ? len - i : CHUNK_SIZE;
+		size_t		converted;
+		size_t		written;
+
+		buf_reserve(out, chunk / 2 * 3);
+		converted = utf16le_to_utf8_with(k, &in[i], chunk, out->data + out->len, &written);
+		out->len += written;
+		out->data[out->len] = '\0';
+		i += converted;
+
+		if (converted < chunk)
+		{
+			int			consumed;
+			int32_t		code = legacy_get_utf16(&in[i], len - i, &consumed);
+
+			if (code < 0 || (code > 0xD800 && code < 0xE000) || code > 0x10FFFF)
+				return 0;
+			legacy_add_utf8(code, out);
+			i += consumed;
+		}
+	}
+	return 1;
+}
+
+static long
+legacy_length(const uint8_t *in, size_t len)
+{
+	size_t		i;
+	long		result = 0;
+	int			consumed;
+
+	for (i = 0; i < len; i += consumed)
+	{
+		int32_t		code = legacy_get_utf8(&in[i], len - i, &consumed);
+
+		if (code < 0)
+			return -1;
+		result += code <= 0xFFFF ? 1 : 2;
+	}
+	return result;
+}
+
+static long
+bulk_length(const Utf16Kernels *k, const uint8_t *in, size_t len)
+{
+	size_t		i;
+	long		result = 0;
+
+	for (i = 0; i < len;)
+	{
+		size_t		units;
+		int			consumed;
+		int32_t		code;
+
+		i += utf8_length_in_utf16_with(k, &in[i], len - i, &units);
+		result += units;
+		if (i >= len)
+			break;
+		code = legacy_get_utf8(&in[i], len - i, &consumed);
+		if (code < 0)
+			return -1;
+		result += code <= 0xFFFF ? 1 : 2;
+		i += consumed;
+	}
+	return result;
+}
+
+/* Corpora */
+typedef struct
+{
+	const char *name;
+	int			ascii_percent;	/* of characters */
+	int			astral_percent;
+} Corpus;
+
+static const Corpus corpora[] = {
+	{"ascii", 100, 0},
+	{"ascii+bmp", 95, 0},
+	{"bmp", 10, 0},
+	{"ascii+astral", 80, 10},
+};
+
+static uint32_t rng_state = 12345;
+
+static uint32_t
+rng(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+static size_t
+encode_utf8(uint32_t code, uint8_t *out)
+{
+	if (code <= 0x7F)
+	{
+		out[0] = code;
+		return 1;
+	}
+	if (code <= 0x7FF)
+	{
+		out[0] = 0xC0 | (code >> 6);
+		out[1] = 0x80 | (code & 0x3F);
+		return 2;
+	}
+	if (code <= 0xFFFF)
+	{
+		out[0] = 0xE0 | (code >> 12);
+		out[1] = 0x80 | ((code >> 6) & 0x3F);
+		out[2] = 0x80 | (code & 0x3F);
+		return 3;
+	}
+	out[0] = 0xF0 | (code >> 18);
+	out[1] = 0x80 | ((code >> 12) & 0x3F);
+	out[2] = 0x80 | ((code >> 6) & 0x3F);
+	out[3] = 0x80 | (code & 0x3F);
+	return 4;
+}
+
+/* Words of ASCII text interspersed with Cyrillic, CJK and emoji */
+static size_t
+make_corpus(const Corpus *c, uint8_t *out, size_t size)
+{
+	size_t		len = 0;
+
+	while (len + 4 <= size)
+	{
+		uint32_t	pick = rng() % 100;
+		uint32_t	code;
+
+		if (pick < (uint32_t) c->ascii_percent)
+			code = (rng() % 8 == 0) ? ' ' : 'a' + rng() % 26;
+		else if (pick < (uint32_t) (c->ascii_percent + c->astral_percent))
+			code = 0x1F600 + rng() % 0x50;
+		else if (rng() % 2)
+			code = 0x0410 + rng() % 0x40;
+		else
+			code = 0x4E00 + rng() % 0x5000;
+		len += encode_utf8(code, out + len);
+	}
+	return len;
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+buf_reset(Buf *buf)
+{
+	buf->len = 0;
+}
+
+static int
+check_same(const char *what, const Buf *a, const Buf *b)
+{
+	if (a->len != b->len || memcmp(a->data, b->data, a->len) != 0)
+	{
+		printf("MISMATCH in %s\n", what);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Random mutations of a valid text, so that the bulk conversions meet
+ * invalid sequences at every offset, including across chunk boundaries.
+ */
+static int
+fuzz(const Utf16Kernels *k)
+{
+	static uint8_t in[3 * CHUNK_SIZE];
+	Buf			a = {malloc(16), 0, 16};
+	Buf			b = {malloc(16), 0, 16};
+	int			ok = 1;
+	int			round;
+
+	for (round = 0; round < 2000 && ok; round++)
+	{
+		size_t		len = make_corpus(&corpora[round % 4], in, 32 + rng() % (sizeof(in) - 32));
+		int			flips = rng() % 3;
+
+		while (flips-- > 0)
+			in[rng() % len] = rng();
+
+		buf_reset(&a);
+		buf_reset(&b);
+		if (legacy_utf8_to_utf16(in, len, &a) != bulk_utf8_to_utf16(k, in, len, &b) ||
+			!check_same("fuzzed utf8 -> utf16", &a, &b) ||
+			legacy_length(in, len) != bulk_length(k, in, len))
+			ok = 0;
+
+		buf_reset(&a);
+		buf_reset(&b);
+		if (legacy_utf16_to_utf8(in, len & ~1, &a) != bulk_utf16_to_utf8(k, in, len & ~1, &b) ||
+			!check_same("fuzzed utf16 -> utf8", &a, &b))
+			ok = 0;
+	}
+
+	free(a.data);
+	free(b.data);
+	return ok;
+}
+
+int
+main(int argc, char **argv)
+{
+	size_t		size = (argc > 1 ? atoi(argv[1]) : 16) * 1024 * 1024;
+	const Utf16Kernels *best = utf16_kernels();
+	const Utf16Kernels *kernels[] = {&utf16_scalar_kernels, best};
+	uint8_t    *utf8 = malloc(size);
+	Buf			utf16 = {malloc(16), 0, 16};
+	Buf			out = {malloc(16), 0, 16};
+	int			ok = 1;
+	size_t		c;
+
+	printf("kernels: %s, corpus size: %zu MB\n", best->name, size / (1024 * 1024));
+	printf("%-14s %-10s %12s %12s %12s\n", "corpus", "", "to utf16", "to utf8", "length");
+
+	for (c = 0; c < sizeof(corpora) / sizeof(corpora[0]); c++)
+	{
+		size_t		len = make_corpus(&corpora[c], utf8, size);
+		double		mb = len / (1024.0 * 1024.0);
+		double		t0, t1, t2, t3;
+		long		units;
+		int			j;
+
+		/* The baseline, which also gives the reference output */
+		buf_reset(&utf16);
+		t0 = now();
+		legacy_utf8_to_utf16(utf8, len, &utf16);
+		t1 = now();
+		buf_reset(&out);
+		legacy_utf16_to_utf8(utf16.data, utf16.len, &out);
+		t2 = now();
+		units = legacy_length(utf8, len);
+		t3 = now();
+		ok &= out.len == len && memcmp(out.data, utf8, len) == 0;
+		printf("%-14s %-10s %9.0f MB/s %7.0f MB/s %7.0f MB/s\n", corpora[c].name, "legacy",
+			   mb / (t1 - t0), mb / (t2 - t1), mb / (t3 - t2));
+
+		for (j = 0; j < 2; j++)
+		{
+			const Utf16Kernels *k = kernels[j];
+
+			buf_reset(&out);
+			t0 = now();
+			bulk_utf8_to_utf16(k, utf8, len, &out);
+			t1 = now();
+			ok &= check_same("utf8 -> utf16", &utf16, &out);
+
+			buf_reset(&out);
+			t1 = now();
+			bulk_utf16_to_utf8(k, utf16.data, utf16.len, &out);
+			t2 = now();
+			ok &= out.len == len && memcmp(out.data, utf8, len) == 0;
+
+			ok &= bulk_length(k, utf8, len) == units;
+			t3 = now();
+
+			printf("%-14s %-10s %9.0f MB/s %7.0f MB/s %7.0f MB/s\n", "", k->name,
+				   mb / (t1 - t0), mb / (t2 - t1), mb / (t3 - t2));
+		}
+	}
+
+	ok &= fuzz(&utf16_scalar_kernels) && fuzz(best);
+	printf("%s\n", ok ? "all outputs match" : "OUTPUTS DIFFER");
+
+	free(utf8);
+	free(utf16.data);
+	free(out.data);
+	return ok ? 0 : 1;
+}
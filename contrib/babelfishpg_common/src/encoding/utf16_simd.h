@@ -0,0 +1,557 @@
+/*-------------------------------------------------------------------------
+ *
+ * utf16_simd.h
+ *	  Bulk UTF-8 <-> UTF-16LE transcoding kernels
+ *
+ * The functions here convert the well-formed prefix of their input and stop
+ * at the first sequence they do not handle themselves: invalid or truncated
+ * UTF-8, code point 0, unpaired UTF-16 surrogates and the like.  The caller
+ * then takes a single step with its code point at a time conversion, which
+ * either copes with the odd case or raises the appropriate error, and calls
+ * back in here for the rest.  This way the results are exactly those of the
+ * code point at a time conversion, only much faster for the common cases.
+ *
+ * Runs of ASCII are converted 16 or 32 bytes at a time with SSE2 or AVX2 on
+ * x86-64 (AVX2 is chosen at runtime, if the CPU has it) and with NEON on
+ * AArch64.  Other characters go through a scalar loop writing straight into
+ * the output buffer.
+ *
+ * This file is included by both babelfishpg_common and babelfishpg_tds, and
+ * by the stand-alone benchmark in utf16_bench.c, so it must not depend on
+ * anything from PostgreSQL.
+ *
+ * Portions Copyright (c) 2022, AWS
+ *
+ * IDENTIFICATION
+ *	  contrib/babelfishpg_common/src/encoding/utf16_simd.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef UTF16_SIMD_H
+#define UTF16_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define UTF16_USE_SSE2
+#define UTF16_USE_AVX2_WITH_RUNTIME_CHECK
+#elif defined(__aarch64__) && defined(__ARM_NEON) && \
+	defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#define UTF16_USE_NEON
+#endif
+
+/*
+ * The ASCII kernels.  They only take characters 0x01..0x7F, NUL is left to
+ * the caller since it is not allowed in character data.
+ *
+ * widen_ascii converts the leading ASCII run of UTF-8 'in' to UTF-16LE
+ * 'out' (two bytes per character) and returns its length in bytes of 'in'.
+ *
+ * narrow_ascii converts the leading ASCII run of UTF-16LE 'in' to UTF-8
+ * 'out' (one byte per character) and returns its length in bytes of 'in'.
+ *
+ * ascii_prefix returns the length of the leading ASCII run of UTF-8 'in'.
+ */
+typedef struct Utf16Kernels
+{
+	const char *name;
+	size_t		(*widen_ascii) (const uint8_t *in, size_t len, uint8_t *out);
+	size_t		(*narrow_ascii) (const uint8_t *in, size_t len, uint8_t *out);
+	size_t		(*ascii_prefix) (const uint8_t *in, size_t len);
+} Utf16Kernels;
+
+static inline size_t
+utf16_widen_ascii_scalar(const uint8_t *in, size_t len, uint8_t *out)
+{
+	size_t		i;
+
+	for (i = 0; i < len && (unsigned) in[i] - 1 < 0x7F; i++)
+	{
+		out[2 * i] = in[i];
+		out[2 * i + 1] = 0;
+	}
+	return i;
+}
+
+static inline size_t
+utf16_narrow_ascii_scalar(const uint8_t *in, size_t len, uint8_t *out)
+{
+	size_t		i;
+
+	for (i = 0; i + 2 <= len && in[i + 1] == 0 && (unsigned) in[i] - 1 < 0x7F; i += 2)
+		out[i / 2] = in[i];
+	return i;
+}
+
+static inline size_t
+utf16_ascii_prefix_scalar(const uint8_t *in, size_t len)
+{
+	size_t		i;
+
+	for (i = 0; i < len && (unsigned) in[i] - 1 < 0x7F; i++)
+		;
+	return i;
+}
+
+static const Utf16Kernels utf16_scalar_kernels = {
+	"scalar",
+	utf16_widen_ascii_scalar,
+	utf16_narrow_ascii_scalar,
+	utf16_ascii_prefix_scalar
+};
+
+#ifdef UTF16_USE_SSE2
+
+/* Bytes 0x01..0x7F are exactly those greater than zero as signed chars. */
+static inline size_t
+utf16_widen_ascii_sse2(const uint8_t *in, size_t len, uint8_t *out)
+{
+	const __m128i zero = _mm_setzero_si128();
+	size_t		i;
+
+	for (i = 0; i + 16 <= len; i += 16)
+	{
+		__m128i		v = _mm_loadu_si128((const __m128i *) (in + i));
+
+		if (_mm_movemask_epi8(_mm_cmpgt_epi8(v, zero)) != 0xFFFF)
+			break;
+		_mm_storeu_si128((__m128i *) (out + 2 * i), _mm_unpacklo_epi8(v, zero));
+		_mm_storeu_si128((__m128i *) (out + 2 * i + 16), _mm_unpackhi_epi8(v, zero));
+	}
+	return i + utf16_widen_ascii_scalar(in + i, len - i, out + 2 * i);
+}
+
+/* Likewise units 0x0001..0x007F are those between 0 and 0x80 as signed. */
+static inline size_t
+utf16_narrow_ascii_sse2(const uint8_t *in, size_t len, uint8_t *out)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i limit = _mm_set1_epi16(0x80);
+	size_t		i;
+
+	for (i = 0; i + 32 <= len; i += 32)
+	{
+		__m128i		a = _mm_loadu_si128((const __m128i *) (in + i));
+		__m128i		b = _mm_loadu_si128((const __m128i *) (in + i + 16));
+		__m128i		ok;
+
+		ok = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi16(a, zero), _mm_cmplt_epi16(a, limit)),
+						   _mm_and_si128(_mm_cmpgt_epi16(b, zero), _mm_cmplt_epi16(b, limit)));
+		if (_mm_movemask_epi8(ok) != 0xFFFF)
+			break;
+		_mm_storeu_si128((__m128i *) (out + i / 2), _mm_packus_epi16(a, b));
+	}
+	return i + utf16_narrow_ascii_scalar(in + i, len - i, out + i / 2);
+}
+
+static inline size_t
+utf16_ascii_prefix_sse2(const uint8_t *in, size_t len)
+{
+	const __m128i zero = _mm_setzero_si128();
+	size_t		i;
+
+	for (i = 0; i + 16 <= len; i += 16)
+	{
+		__m128i		v = _mm_loadu_si128((const __m128i *) (in + i));
+
+		if (_mm_movemask_epi8(_mm_cmpgt_epi8(v, zero)) != 0xFFFF)
+			break;
+	}
+	return i + utf16_ascii_prefix_scalar(in + i, len - i);
+}
+
+static const Utf16Kernels utf16_sse2_kernels = {
+	"sse2",
+	utf16_widen_ascii_sse2,
+	utf16_narrow_ascii_sse2,
+	utf16_ascii_prefix_sse2
+};
+
+#endif							/* UTF16_USE_SSE2 */
+
+#ifdef UTF16_USE_AVX2_WITH_RUNTIME_CHECK
+
+__attribute__((target("avx2")))
+static inline size_t
+utf16_widen_ascii_avx2(const uint8_t *in, size_t len, uint8_t *out)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	size_t		i;
+
+	for (i = 0; i + 32 <= len; i += 32)
+	{
+		__m256i		v = _mm256_loadu_si256((const __m256i *) (in + i));
+
+		if ((uint32_t) _mm256_movemask_epi8(_mm256_cmpgt_epi8(v, zero)) != 0xFFFFFFFF)
+			break;
+		_mm256_storeu_si256((__m256i *) (out + 2 * i),
+							_mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+		_mm256_storeu_si256((__m256i *) (out + 2 * i + 32),
+							_mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+	}
+	return i + utf16_widen_ascii_sse2(in + i, len - i, out + 2 * i);
+}
+
+__attribute__((target("avx2")))
+static inline size_t
+utf16_narrow_ascii_avx2(const uint8_t *in, size_t len, uint8_t *out)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i limit = _mm256_set1_epi16(0x80);
+	size_t		i;
+
+	for (i = 0; i + 64 <= len; i += 64)
+	{
+		__m256i		a = _mm256_loadu_si256((const __m256i *) (in + i));
+		__m256i		b = _mm256_loadu_si256((const __m256i *) (in + i + 32));
+		__m256i		ok;
+
+		ok = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi16(a, zero),
+											   _mm256_cmpgt_epi16(limit, a)),
+							  _mm256_and_si256(_mm256_cmpgt_epi16(b, zero),
+											   _mm256_cmpgt_epi16(limit, b)));
+		if ((uint32_t) _mm256_movemask_epi8(ok) != 0xFFFFFFFF)
+			break;
+
+		/* packus works within 128-bit lanes, put the quarters back in order */
+		_mm256_storeu_si256((__m256i *) (out + i / 2),
+							_mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8));
+	}
+	return i + utf16_narrow_ascii_sse2(in + i, len - i, out + i / 2);
+}
+
+__attribute__((target("avx2")))
+static inline size_t
+utf16_ascii_prefix_avx2(const uint8_t *in, size_t len)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	size_t		i;
+
+	for (i = 0; i + 32 <= len; i += 32)
+	{
+		__m256i		v = _mm256_loadu_si256((const __m256i *) (in + i));
+
+		if ((uint32_t) _mm256_movemask_epi8(_mm256_cmpgt_epi8(v, zero)) != 0xFFFFFFFF)
+			break;
+	}
+	return i + utf16_ascii_prefix_sse2(in + i, len - i);
+}
+
+static const Utf16Kernels utf16_avx2_kernels = {
+	"avx2",
+	utf16_widen_ascii_avx2,
+	utf16_narrow_ascii_avx2,
+	utf16_ascii_prefix_avx2
+};
+
+#endif							/* UTF16_USE_AVX2_WITH_RUNTIME_CHECK */
+
+#ifdef UTF16_USE_NEON
+
+static inline size_t
+utf16_widen_ascii_neon(const uint8_t *in, size_t len, uint8_t *out)
+{
+	size_t		i;
+
+	for (i = 0; i + 16 <= len; i += 16)
+	{
+		uint8x16x2_t pair;
+
+		pair.val[0] = vld1q_u8(in + i);
+		if (vminvq_u8(pair.val[0]) == 0 || vmaxvq_u8(pair.val[0]) > 0x7F)
+			break;
+		pair.val[1] = vdupq_n_u8(0);
+		vst2q_u8(out + 2 * i, pair);
+	}
+	return i + utf16_widen_ascii_scalar(in + i, len - i, out + 2 * i);
+}
+
+static inline size_t
+utf16_narrow_ascii_neon(const uint8_t *in, size_t len, uint8_t *out)
+{
+	size_t		i;
+
+	for (i = 0; i + 32 <= len; i += 32)
+	{
+		uint16x8_t	a = vreinterpretq_u16_u8(vld1q_u8(in + i));
+		uint16x8_t	b = vreinterpretq_u16_u8(vld1q_u8(in + i + 16));
+
+		if (vminvq_u16(vminq_u16(a, b)) == 0 || vmaxvq_u16(vmaxq_u16(a, b)) > 0x7F)
+			break;
+		vst1q_u8(out + i / 2, vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+	}
+	return i + utf16_narrow_ascii_scalar(in + i, len - i, out + i / 2);
+}
+
+static inline size_t
+utf16_ascii_prefix_neon(const uint8_t *in, size_t len)
+{
+	size_t		i;
+
+	for (i = 0; i + 16 <= len; i += 16)
+	{
+		uint8x16_t	v = vld1q_u8(in + i);
+
+		if (vminvq_u8(v) == 0 || vmaxvq_u8(v) > 0x7F)
+			break;
+	}
+	return i + utf16_ascii_prefix_scalar(in + i, len - i);
+}
+
+static const Utf16Kernels utf16_neon_kernels = {
+	"neon",
+	utf16_widen_ascii_neon,
+	utf16_narrow_ascii_neon,
+	utf16_ascii_prefix_neon
+};
+
+#endif							/* UTF16_USE_NEON */
+
+/*
+ * utf16_kernels - the best kernels for this CPU, chosen on first use
+ */
+static inline const Utf16Kernels *
+utf16_kernels(void)
+{
+	static const Utf16Kernels *chosen = NULL;
+
+	if (chosen == NULL)
+	{
+#if defined(UTF16_USE_AVX2_WITH_RUNTIME_CHECK)
+		__builtin_cpu_init();
+		chosen = __builtin_cpu_supports("avx2") ? &utf16_avx2_kernels : &utf16_sse2_kernels;
+#elif defined(UTF16_USE_NEON)
+		chosen = &utf16_neon_kernels;
+#else
+		chosen = &utf16_scalar_kernels;
+#endif
+	}
+	return chosen;
+}
+
+/*
+ * utf16_decode_utf8 - decode one multi-byte UTF-8 sequence
+ *
+ * Returns its length and sets *code, or returns 0 if the sequence is not one
+ * the kernels take.  The checks and the arithmetic are those of the code
+ * point at a time decoders, so that both agree on everything accepted here.
+ */
+static inline int
+utf16_decode_utf8(const uint8_t *in, size_t len, uint32_t *code)
+{
+	uint32_t	c;
+	int			n;
+
+	if ((in[0] & 0xE0) == 0xC0)
+	{
+		if (len < 2 || (in[1] & 0xC0) != 0x80)
+			return 0;
+		c = ((in[0] & 0x1F) << 6) | (in[1] & 0x3F);
+		n = 2;
+	}
+	else if ((in[0] & 0xF0) == 0xE0)
+	{
+		if (len < 3 || (in[1] & 0xC0) != 0x80 || (in[2] & 0xC0) != 0x80)
+			return 0;
+		c = ((in[0] & 0x0F) << 12) | ((in[1] & 0x3F) << 6) | (in[2] & 0x3F);
+		n = 3;
+	}
+	else if ((in[0] & 0xF8) == 0xF0)
+	{
+		if (len < 4 || (in[1] & 0xC0) != 0x80 || (in[2] & 0xC0) != 0x80 ||
+			(in[3] & 0xC0) != 0x80)
+			return 0;
+		c = ((in[0] & 0x07) << 18) | ((in[1] & 0x3F) << 12) |
+			((in[2] & 0x3F) << 6) | (in[3] & 0x3F);
+		n = 4;
+	}
+	else
+		return 0;
+
+	if (c == 0 || c > 0x10FFFF || (c >= 0xD800 && c < 0xE000))
+		return 0;
+
+	*code = c;
+	return n;
+}
+
+/*
+ * utf8_to_utf16le_with - convert UTF-8 to UTF-16LE
+ *
+ * 'out' must have room for 2 * len bytes.  Returns the number of bytes of
+ * 'in' converted and sets *outlen to the number of bytes written.
+ */
+static inline size_t
+utf8_to_utf16le_with(const Utf16Kernels *k, const uint8_t *in, size_t len,
+					 uint8_t *out, size_t *outlen)
+{
+	size_t		i = 0;
+	size_t		o = 0;
+
+	while (i < len)
+	{
+		uint32_t	code;
+		int			n;
+
+		if (in[i] < 0x80)
+		{
+			size_t		ascii = k->widen_ascii(in + i, len - i, out + o);
+
+			if (ascii == 0)
+				break;
+			i += ascii;
+			o += 2 * ascii;
+			continue;
+		}
+
+		n = utf16_decode_utf8(in + i, len - i, &code);
+		if (n == 0)
+			break;
+
+		if (code <= 0xFFFF)
+		{
+			out[o++] = code & 0xFF;
+			out[o++] = code >> 8;
+		}
+		else
+		{
+			uint32_t	high = 0xD800 + ((code - 0x10000) >> 10);
+			uint32_t	low = 0xDC00 + ((code - 0x10000) & 0x3FF);
+
+			out[o++] = high & 0xFF;
+			out[o++] = high >> 8;
+			out[o++] = low & 0xFF;
+			out[o++] = low >> 8;
+		}
+		i += n;
+	}
+
+	*outlen = o;
+	return i;
+}
+
+/*
+ * utf16le_to_utf8_with - convert UTF-16LE to UTF-8
+ *
+ * 'out' must have room for 3 * len / 2 bytes.  Returns the number of bytes
+ * of 'in' converted and sets *outlen to the number of bytes written.
+ */
+static inline size_t
+utf16le_to_utf8_with(const Utf16Kernels *k, const uint8_t *in, size_t len,
+					 uint8_t *out, size_t *outlen)
+{
+	size_t		i = 0;
+	size_t		o = 0;
+
+	while (i + 2 <= len)
+	{
+		uint32_t	code = in[i] | (in[i + 1] << 8);
+
+		if (code < 0x80)
+		{
+			size_t		ascii = k->narrow_ascii(in + i, len - i, out + o);
+
+			if (ascii == 0)
+				break;
+			i += ascii;
+			o += ascii / 2;
+			continue;
+		}
+
+		if (code < 0x800)
+		{
+			out[o++] = 0xC0 | (code >> 6);
+			out[o++] = 0x80 | (code & 0x3F);
+			i += 2;
+		}
+		else if (code < 0xD800 || code >= 0xE000)
+		{
+			out[o++] = 0xE0 | (code >> 12);
+			out[o++] = 0x80 | ((code >> 6) & 0x3F);
+			out[o++] = 0x80 | (code & 0x3F);
+			i += 2;
+		}
+		else
+		{
+			uint32_t	low;
+
+			/* Only take a high surrogate followed by a low one. */
+			if (code >= 0xDC00 || len - i < 4)
+				break;
+			low = in[i + 2] | (in[i + 3] << 8);
+			if (low < 0xDC00 || low >= 0xE000)
+				break;
+
+			code = (((code & 0x3FF) << 10) | (low & 0x3FF)) + 0x10000;
+			out[o++] = 0xF0 | (code >> 18);
+			out[o++] = 0x80 | ((code >> 12) & 0x3F);
+			out[o++] = 0x80 | ((code >> 6) & 0x3F);
+			out[o++] = 0x80 | (code & 0x3F);
+			i += 4;
+		}
+	}
+
+	*outlen = o;
+	return i;
+}
+
+/*
+ * utf8_length_in_utf16_with - count the UTF-16 code units UTF-8 'in' would
+ * convert to.  Returns the number of bytes of 'in' counted and sets *units.
+ */
+static inline size_t
+utf8_length_in_utf16_with(const Utf16Kernels *k, const uint8_t *in, size_t len,
+						  size_t *units)
+{
+	size_t		i = 0;
+	size_t		count = 0;
+
+	while (i < len)
+	{
+		uint32_t	code;
+		int			n;
+
+		if (in[i] < 0x80)
+		{
+			size_t		ascii = k->ascii_prefix(in + i, len - i);
+
+			if (ascii == 0)
+				break;
+			i += ascii;
+			count += ascii;
+			continue;
+		}
+
+		n = utf16_decode_utf8(in + i, len - i, &code);
+		if (n == 0)
+			break;
+		count += code <= 0xFFFF ? 1 : 2;
+		i += n;
+	}
+
+	*units = count;
+	return i;
+}
+
+static inline size_t
+utf8_to_utf16le(const uint8_t *in, size_t len, uint8_t *out, size_t *outlen)
+{
+	return utf8_to_utf16le_with(utf16_kernels(), in, len, out, outlen);
+}
+
+static inline size_t
+utf16le_to_utf8(const uint8_t *in, size_t len, uint8_t *out, size_t *outlen)
+{
+	return utf16le_to_utf8_with(utf16_kernels(), in, len, out, outlen);
+}
+
+static inline size_t
+utf8_length_in_utf16(const uint8_t *in, size_t len, size_t *units)
+{
+	return utf8_length_in_utf16_with(utf16_kernels(), in, len, units);
+}
+
+#endif							/* UTF16_SIMD_H */
@@ -35,6 +35,170 @@ typedef enum PgTsqlInstrMetricType {
 	INSTR_UNSUPPORTED_TSQL_TOP_PERCENT_IN_STMT,
 	INSTR_UNSUPPORTED_TSQL_XML_OPTION_AUTO,
 	INSTR_UNSUPPORTED_TSQL_XML_OPTION_EXPLICIT,
+	INSTR_UNSUPPORTED_TSQL_MERGE,
+	INSTR_UNSUPPORTED_TSQL_BULK_INSERT,
+	INSTR_UNSUPPORTED_TSQL_WAIT_FOR,
+	INSTR_UNSUPPORTED_TSQL_WITH_XMLNAMESPACES,
+	INSTR_UNSUPPORTED_TSQL_CREATE_CONTRACT,
+	INSTR_UNSUPPORTED_TSQL_CREATE_QUEUE,
+	INSTR_UNSUPPORTED_TSQL_ALTER_QUEUE,
+	INSTR_UNSUPPORTED_TSQL_KILL,
+	INSTR_UNSUPPORTED_TSQL_CREATE_MESSAGE,
+	INSTR_UNSUPPORTED_TSQL_RECONFIGURE,
+	INSTR_UNSUPPORTED_TSQL_SHUTDOWN,
+	INSTR_UNSUPPORTED_TSQL_DBCC,
+	INSTR_UNSUPPORTED_TSQL_BACKUP,
+	INSTR_UNSUPPORTED_TSQL_RESTORE,
+	INSTR_UNSUPPORTED_TSQL_CHECKPOINT,
+	INSTR_UNSUPPORTED_TSQL_READTEXT,
+	INSTR_UNSUPPORTED_TSQL_WRITETEXT,
+	INSTR_UNSUPPORTED_TSQL_UPDATETEXT,
+	INSTR_UNSUPPORTED_TSQL_FREETEXT,
+	INSTR_UNSUPPORTED_TSQL_NEXT_VALUE_FOR,
+	INSTR_UNSUPPORTED_TSQL_XML_NODES,
+	INSTR_UNSUPPORTED_TSQL_XML_VALUE,
+	INSTR_UNSUPPORTED_TSQL_XML_QUERY,
+	INSTR_UNSUPPORTED_TSQL_XML_EXIST,
+	INSTR_UNSUPPORTED_TSQL_XML_MODIFY,
+	INSTR_UNSUPPORTED_TSQL_ALTER_FUNCTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_FUNCTION_ENCRYPTION_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_FUNCTION_NATIVE_COMPILATION_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_FUNCTION_EXTERNAL_NAME_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_PROCEDURE,
+	INSTR_UNSUPPORTED_TSQL_ALTER_PROCEDURE_ENCRYPTION_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_PROCEDURE_NATIVE_COMPILATION_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_PROCEDURE_RECOMPILE_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_PROCEDURE_ATOMIC_WITH_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_PROCEDURE_EXTERNAL_NAME_OPTION,
+	INSTR_UNSUPPORTED_TSQL_DDL_TRIGGER,
+	INSTR_UNSUPPORTED_TSQL_DML_ALTER_TRIGGER,
+	INSTR_UNSUPPORTED_TSQL_DML_INSTEAD_OF_TRIGGER,
+	INSTR_UNSUPPORTED_TSQL_DML_WITH_APPEND_TRIGGER,
+	INSTR_UNSUPPORTED_TSQL_DML_TRIGGER_ENCRYPTION_OPTION,
+	INSTR_UNSUPPORTED_TSQL_DML_TRIGGER_NATIVE_COMPILATION_OPTION,
+	INSTR_UNSUPPORTED_TSQL_DML_TRIGGER_EXTERNAL_NAME_OPTION,
+	INSTR_UNSUPPORTED_TSQL_DDL_TRIGGER_ENCRYPTION_OPTION,
+	INSTR_UNSUPPORTED_TSQL_DDL_TRIGGER_NATIVE_COMPILATION_OPTION,
+	INSTR_UNSUPPORTED_TSQL_DDL_TRIGGER_EXTERNAL_NAME_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_VIEW,
+	INSTR_UNSUPPORTED_TSQL_ALTER_VIEW_ENCRYPTION_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_VIEW_VIEW_METADATA_OPTION,
+	INSTR_UNSUPPORTED_TSQL_FILEGROUP,
+	INSTR_UNSUPPORTED_TSQL_PARTITION_SCHEME,
+	INSTR_UNSUPPORTED_TSQL_NOT_FOR_REPLICATION,
+	INSTR_UNSUPPORTED_TSQL_FOR_REPLICATION,
+	INSTR_UNSUPPORTED_TSQL_COLUMN_OPTION_CLUSTERED,
+	INSTR_UNSUPPORTED_TSQL_COLUMN_OPTION_VALUES,
+	INSTR_UNSUPPORTED_TSQL_COLUMN_OPTION_CONNECTION,
+	INSTR_UNSUPPORTED_TSQL_COLUMN_OPTION_SPARSE,
+	INSTR_UNSUPPORTED_TSQL_COLUMN_OPTION_FILESTREAM,
+	INSTR_UNSUPPORTED_TSQL_COLUMN_OPTION_ROWGUIDCOL,
+	INSTR_UNSUPPORTED_TSQL_COLUMN_OPTION_HIDDEN_RENAMED,
+	INSTR_UNSUPPORTED_TSQL_COLUMN_OPTION_PERSISTED,
+	INSTR_UNSUPPORTED_TSQL_COLUMN_OPTION_MASKED,
+	INSTR_UNSUPPORTED_TSQL_INDEX_OPTION_FILLFACTOR,
+	INSTR_UNSUPPORTED_TSQL_CONSTRAINT_DEFAULT,
+	INSTR_UNSUPPORTED_TSQL_GLOBAL_TEMPORARY_TABLE,
+	INSTR_UNSUPPORTED_TSQL_ALTER_TABLE_CONSTRAINT_NO_CHECK_ADD,
+	INSTR_UNSUPPORTED_TSQL_ALTER_TABLE_CONSTRAINT_NO_CHECK,
+	INSTR_UNSUPPORTED_TSQL_ALTER_TABLE_CHANGE_TRACKING_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_TABLE_SWITCH_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_TABLE_SYSTEM_VERSIONING_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_TABLE_LOCK_ESCALATION_OPTION,
+	INSTR_UNSUPPORTED_TSQL_ALTER_TABLE_REBUILD_OPTION,
+	INSTR_UNSUPPORTED_TSQL_INDEX_OPTION_COLUMNSTORE,
+	INSTR_UNSUPPORTED_TSQL_INDEX_OPTION_MISC,
+	INSTR_UNSUPPORTED_TSQL_INDEX_OPTION_UNKNOWN,
+	INSTR_UNSUPPORTED_TSQL_UNIQUE_CONSTRAINT,
+	INSTR_UNSUPPORTED_TSQL_ALTER_INDEX,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_CONTAINMENT,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_ON,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_COLLATE,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_WITH_FILESTREAM,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_WITH_DEFAULT_LANGUAGE,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_WITH_DEFAULT_FULLTEXT_LANGUAGE,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_WITH_NESTED_TRIGGERS,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_WITH_TRANSFORM_NOISE_WORDS,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_WITH_TWO_DIGIT_YEAR_CUTOFF,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_WITH_DB_CHAINING,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_WITH_TRUSTWORTHY,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_WITH_CATALOG_COLLATION,
+	INSTR_UNSUPPORTED_TSQL_CREATE_DATABASE_WITH_PERSISTENT_LOG_BUFFER,
+	INSTR_UNSUPPORTED_TSQL_LOGIN_HASHED_PASSWORD,
+	INSTR_UNSUPPORTED_TSQL_LOGIN_OLD_PASSWORD,
+	INSTR_UNSUPPORTED_TSQL_LOGIN_PASSWORD_MUST_CHANGE,
+	INSTR_UNSUPPORTED_TSQL_LOGIN_PASSWORD_UNLOCK,
+	INSTR_UNSUPPORTED_TSQL_CREATE_LOGIN_MISC_OPTIONS,
+	INSTR_UNSUPPORTED_TSQL_ALTER_LOGIN_MISC_OPTIONS,
+	INSTR_UNSUPPORTED_TSQL_CREATE_LOGIN_WITH_DEFAULT_LANGUAGE,
+	INSTR_UNSUPPORTED_TSQL_ALTER_LOGIN_WITH_DEFAULT_LANGUAGE,
+	INSTR_UNSUPPORTED_TSQL_CREATE_FULLTEXT_INDEX,
+	INSTR_UNSUPPORTED_TSQL_ALTER_FULLTEXT_INDEX,
+	INSTR_UNSUPPORTED_TSQL_DROP_FULLTEXT_INDEX,
+	INSTR_UNSUPPORTED_TSQL_SELECT_DOLLAR_IDENTITY,
+	INSTR_UNSUPPORTED_TSQL_SELECT_DOLLAR_ROWGUID,
+	INSTR_UNSUPPORTED_TSQL_UPDATE_WHERE_CURRENT_OF,
+	INSTR_UNSUPPORTED_TSQL_UPDATE_WITH_METHOD_NAME,
+	INSTR_UNSUPPORTED_TSQL_DELETE_WHERE_CURRENT_OF,
+	INSTR_UNSUPPORTED_TSQL_GLOBAL_CURSOR,
+	INSTR_UNSUPPORTED_TSQL_KEYSET_CURSOR,
+	INSTR_UNSUPPORTED_TSQL_DYNAMIC_CURSOR,
+	INSTR_UNSUPPORTED_TSQL_CURSOR_SCROLL_LOCKS_OPTION,
+	INSTR_UNSUPPORTED_TSQL_CURSOR_OPTIMISTIC_OPTION,
+	INSTR_UNSUPPORTED_TSQL_CURSOR_TYPE_WARNING_OPTION,
+	INSTR_UNSUPPORTED_TSQL_EXECUTE_AS_STMT,
+	INSTR_UNSUPPORTED_TSQL_REVERT_STMT,
+	INSTR_UNSUPPORTED_TSQL_DENY_STMT,
+	INSTR_UNSUPPORTED_TSQL_OPEN_KEY,
+	INSTR_UNSUPPORTED_TSQL_CLOSE_KEY,
+	INSTR_UNSUPPORTED_TSQL_CREATE_KEY,
+	INSTR_UNSUPPORTED_TSQL_CREATE_CERTIFICATE,
+	INSTR_UNSUPPORTED_TSQL_APPLY,
+	INSTR_UNSUPPORTED_TSQL_PIVOT,
+	INSTR_UNSUPPORTED_TSQL_UNPIVOT,
+	INSTR_UNSUPPORTED_TSQL_FOR_BROWSE_CLAUSE,
+	INSTR_UNSUPPORTED_TSQL_XMLDATA,
+	INSTR_UNSUPPORTED_TSQL_FOR_JSON_CLAUSE,
+	INSTR_UNSUPPORTED_TSQL_TABLE_HINTS,
+	INSTR_UNSUPPORTED_TSQL_QUERY_HINTS,
+	INSTR_UNSUPPORTED_TSQL_JOIN_HINTS,
+	INSTR_UNSUPPORTED_TSQL_WITH_DISTRIBUTED_AGG,
+	INSTR_UNSUPPORTED_TSQL_STDEV_FUNCTION,
+	INSTR_UNSUPPORTED_TSQL_STDEVP_FUNCTION,
+	INSTR_UNSUPPORTED_TSQL_VAR_FUNCTION,
+	INSTR_UNSUPPORTED_TSQL_VARP_FUNCTION,
+	INSTR_UNSUPPORTED_TSQL_CHECKSUM_AGG_FUNCTION,
+	INSTR_UNSUPPORTED_TSQL_GROUPING_FUNCTION,
+	INSTR_UNSUPPORTED_TSQL_UPDATE_FUNC_IN_TRIGGER,
+	INSTR_UNSUPPORTED_TSQL_CREATE_CONVERSATION_STMT,
+	INSTR_UNSUPPORTED_TSQL_SET_USER,
+	INSTR_UNSUPPORTED_TSQL_ROWSET_FUNCTION,
+	INSTR_UNSUPPORTED_TSQL_ODBC_SCALAR_FUNCTION,
+	INSTR_UNSUPPORTED_TSQL_PARTITION_FUNCTION,
+	INSTR_UNSUPPORTED_TSQL_HIERARCHYID_METHOD,
+	INSTR_UNSUPPORTED_TSQL_SPATIAL_METHOD,
+	INSTR_UNSUPPORTED_TSQL_PROCEDURE_VARYING_CLAUSE,
+	INSTR_UNSUPPORTED_TSQL_PERIOD_FOR_SYSTEM_TIME,
+	INSTR_UNSUPPORTED_TSQL_ALTER_TABLE_ALTER_COLUMN_COLLATE,
+	INSTR_UNSUPPORTED_TSQL_ALTER_TABLE_ALTER_COLUMN_NOT_NULL,
+	INSTR_UNSUPPORTED_TSQL_ALTER_TABLE_ALTER_COLUMN_NULL,
+	INSTR_UNSUPPORTED_TSQL_CREATE_TYPE_TABLE_OPTION,
+	INSTR_UNSUPPORTED_TSQL_INSERT_STMT_DEFAULT_VALUE,
+	INSTR_UNSUPPORTED_TSQL_EXPRESSION_DEFAULT,
+	INSTR_UNSUPPORTED_TSQL_EXPRESSION_HIERARCHID,
+	INSTR_UNSUPPORTED_TSQL_EXPRESSION_ODBC_LITERAL,
+	INSTR_UNSUPPORTED_TSQL_EXPRESSION_DOLLAR_ACTION,
+	INSTR_UNSUPPORTED_TSQL_EXECUTE_PARAMETER_DEFAULT,
+	INSTR_UNSUPPORTED_TSQL_COLUMNS_UPDATED_FUNC,
+	INSTR_UNSUPPORTED_TSQL_NATIONAL,
+	INSTR_UNSUPPORTED_TSQL_VARYING,
+	INSTR_UNSUPPORTED_TSQL_UNKNOWN_DDL,
+	INSTR_UNSUPPORTED_TSQL_NOT_IMPLEMENTED_SYSTEM_PROCEDURE,
+	INSTR_TSQL_TIMESTAMP_DATATYPE,
+	INSTR_TSQL_ROWVERSION_DATATYPE,
+	INSTR_TSQL_HIERARCHYID_DATATYPE,
+	INSTR_TSQL_GEOGRAPHY_DATATYPE,
+	INSTR_TSQL_GEOMETRY_DATATYPE,
 	INSTR_TSQL_OPTION_CLUSTERED,
 	INSTR_TSQL_OPTION_NON_CLUSTERED,
 	INSTR_TSQL_DATEADD,
@@ -80,7 +244,24 @@ typedef enum PgTsqlInstrMetricType {
 	INSTR_UNSUPPORTED_TSQL_OPTION_ALLOW_SNAPSHOT_ISOLATION,
 	INSTR_UNSUPPORTED_TSQL_OPTION_ARITHABORT,
 	INSTR_UNSUPPORTED_TSQL_OPTION_ARITHIGNORE,
+	INSTR_UNSUPPORTED_TSQL_OPTION_CURSOR_CLOSE_ON_COMMIT,
 	INSTR_UNSUPPORTED_TSQL_OPTION_NUMERIC_ROUNDABORT,
+	INSTR_UNSUPPORTED_TSQL_OPTION_NOEXEC,
+	INSTR_UNSUPPORTED_TSQL_OPTION_FMTONLY,
+	INSTR_UNSUPPORTED_TSQL_OPTION_SHOWPLAN_ALL,
+	INSTR_UNSUPPORTED_TSQL_OPTION_SHOWPLAN_TEXT,
+	INSTR_UNSUPPORTED_TSQL_OPTION_SHOWPLAN_XML,
+	INSTR_UNSUPPORTED_TSQL_OPTION_FIPS_FLAGGER,
+	INSTR_UNSUPPORTED_TSQL_OPTION_FORCEPLAN,
+	INSTR_UNSUPPORTED_TSQL_OPTION_OFFSETS,
+	INSTR_UNSUPPORTED_TSQL_OPTION_PARSEONLY,
+	INSTR_UNSUPPORTED_TSQL_OPTION_REMOTE_PROC_TRANSACTIONS,
+	INSTR_UNSUPPORTED_TSQL_OPTION_STATISTICS,
+	INSTR_UNSUPPORTED_TSQL_OPTION_DATEFORMAT,
+	INSTR_UNSUPPORTED_TSQL_OPTION_DEADLOCK_PRIORITY,
+	INSTR_UNSUPPORTED_TSQL_OPTION_CONTEXT_INFO,
+	INSTR_UNSUPPORTED_TSQL_OPTION_QUERY_GOVERNOR_COST_LIMIT,
+	INSTR_UNSUPPORTED_TSQL_OPTION_XML_METHOD,
 
 	INSTR_TSQL_INSERT_STMT,
 	INSTR_TSQL_DELETE_STMT,
@@ -171,10 +352,10 @@ typedef enum PgTsqlInstrMetricType {
 	INSTR_TSQL_ALTER_FUNCTION,
 	INSTR_TSQL_ALTER_PROCEDURE,
 	INSTR_TSQL_ALTER_ROUTINE,
-	INSTR_TSQL_GRANT_STMT,
-	INSTR_TSQL_REVOKE_STMT,
-	INSTR_TSQL_GRANT_ROLE,
-	INSTR_TSQL_REVOKE_ROLE,
+	INSTR_UNSUPPORTED_TSQL_GRANT_STMT,
+	INSTR_UNSUPPORTED_TSQL_REVOKE_STMT,
+	INSTR_UNSUPPORTED_TSQL_GRANT_ROLE,
+	INSTR_UNSUPPORTED_TSQL_REVOKE_ROLE,
 	INSTR_TSQL_ALTER_DEFAULT_PRIVILEGES,
 	INSTR_TSQL_CREATE_AGGREGATE,
 	INSTR_TSQL_CREATE_OPERATOR,
@@ -198,7 +379,7 @@ typedef enum PgTsqlInstrMetricType {
 	INSTR_TSQL_ALTER_SEQUENCE,
 	INSTR_TSQL_DO_STMT,
 	INSTR_TSQL_CREATE_DATABASE,
-	INSTR_TSQL_ALTER_DATABASE,
+	INSTR_UNSUPPORTED_TSQL_ALTER_DATABASE,
 	INSTR_TSQL_DROP_DATABASE,
 	INSTR_TSQL_NOTIFY_STMT,
 	INSTR_TSQL_LISTEN_STMT,
@@ -378,8 +559,8 @@ typedef enum PgTsqlInstrMetricType {
 	INSTR_TSQL_NVARCHAR_SQLVARIANT,
 	INSTR_TSQL_CHAR_SQLVARIANT,
 	INSTR_TSQL_NCHAR_SQLVARIANT,
-	INSTR_TSQL_BBFVARBINARY_SQLVARIANT,
-	INSTR_TSQL_BBFBINARY_SQLVARIANT,
+	INSTR_TSQL_APGVARBINARY_SQLVARIANT,
+	INSTR_TSQL_APGBINARY_SQLVARIANT,
 	INSTR_TSQL_UNIQUEIDENTIFIER_SQLVARIANT,
 	INSTR_TSQL_SQLVARIANT_TIMESTAMP,
 	INSTR_TSQL_SQLVARIANT_DATETIMEOFFSET,
@@ -395,8 +576,8 @@ typedef enum PgTsqlInstrMetricType {
 	INSTR_TSQL_SQLVARIANT_BIT,
 	INSTR_TSQL_SQLVARIANT_VARCHAR,
 	INSTR_TSQL_SQLVARIANT_CHAR,
-	INSTR_TSQL_SQLVARIANT_BBFVARBINARY,
-	INSTR_TSQL_SQLVARIANT_BBFBINARY,
+	INSTR_TSQL_SQLVARIANT_APGVARBINARY,
+	INSTR_TSQL_SQLVARIANT_APGBINARY,
 	INSTR_TSQL_SQLVARIANT_UNIQUEINDETIFIER,
 	INSTR_TSQL_SQLVARIANTLT,
 	INSTR_TSQL_SQLVARIANTLE,
@@ -467,6 +648,13 @@ typedef enum PgTsqlInstrMetricType {
 	INSTR_TSQL_ISOLATION_LEVEL_SNAPSHOT,
 	INSTR_UNSUPPORTED_TSQL_ISOLATION_LEVEL_SERIALIZABLE,
 
+	INSTR_UNSUPPORTED_TSQL_SELECT_COL_ALIAS,
+	INSTR_UNSUPPORTED_TSQL_SERVERNAME_IN_NAME,
+	INSTR_UNSUPPORTED_TSQL_OPTION_NO_BROWSETABLE,
+
+	INSTR_TSQL_SORTKEY_CACHE_HIT,
+	INSTR_TSQL_SORTKEY_CACHE_MISS,
+	
 	INSTR_TSQL_COUNT
 } PgTsqlInstrMetricType;
 
@@ -20,6 +20,7 @@
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
 #include "encoding/encoding.h"
+#include "encoding/utf16_simd.h"
 #include "fmgr.h"
 #include "libpq/pqformat.h"
 #include "nodes/nodeFuncs.h"
@@ -28,7 +29,9 @@
 #include "utils/builtins.h"
 #include "utils/float.h"
 #include "utils/int8.h"
+#include "utils/memutils.h"
 #include "utils/pg_locale.h"
+#include "utils/sortsupport.h"
 #include "utils/varlena.h"
 #include "mb/pg_wchar.h"
 #include "utils/xml.h"
@@ -41,6 +44,11 @@
 #include "utils/timestamp.h"
 #include "utils/numeric.h"
 #include "typecode.h"
+#include "instr.h"
+
+#ifdef USE_ICU
+#include <unicode/ustring.h>
+#endif
 
 int  TsqlUTF8LengthInUTF16(const void *vin, int len);
 void TsqlCheckUTF16Length_varchar(const char *s_data, int32 len, int32 maxlen, bool isExplicit);
@@ -194,6 +202,15 @@ TsqlUTF8LengthInUTF16(const void *vin, int len)
 
 	for (i = 0; i < len;)
 	{
+		size_t		units;
+
+		/* Count as much as the kernels take in one go */
+		i += utf8_length_in_utf16(&in[i], len - i, &units);
+		result += units;
+		if (i >= len)
+			break;
+
+		/* And take one step the slow way over what stopped them */
 		code = GetUTF8CodePoint(&in[i], len - i, &consumed);
 
 		/* Check that this is a valid code point */
@@ -368,6 +385,7 @@ PG_FUNCTION_INFO_V1(varcharle);
 PG_FUNCTION_INFO_V1(varchargt);
 PG_FUNCTION_INFO_V1(varcharge);
 PG_FUNCTION_INFO_V1(varcharcmp);
+PG_FUNCTION_INFO_V1(varchar_sortsupport);
 PG_FUNCTION_INFO_V1(hashvarchar);
 
 PG_FUNCTION_INFO_V1(varchar2int2);
@@ -1352,6 +1370,184 @@ check_collation_set(Oid collid)
 	}
 }
 
+#ifdef USE_ICU
+/*
+ * Per-backend cache of ICU sort keys for nondeterministic collations.
+ *
+ * Hash joins and GROUP BY on case-insensitive keys hash and compare the same
+ * few values over and over, and building a sort key is by far the most
+ * expensive part of either. The cache is a direct-mapped table keyed on
+ * (collation, bytes); a colliding entry simply replaces the old one, which
+ * keeps both the lookup and the memory bound trivial.
+ */
+#define SORTKEY_CACHE_SIZE		1024	/* must be a power of 2 */
+#define SORTKEY_CACHE_MAX_INPUT	256		/* longer inputs are not cached */
+#define SORTKEY_BUFSIZE			1024	/* nor are longer sort keys */
+
+typedef struct SortKeyCacheEntry
+{
+	Oid			collid;			/* InvalidOid if the slot is unused */
+	uint32		hash;
+	int			len;			/* length of the input */
+	int32_t		keylen;			/* length of the sort key */
+	char	   *data;			/* input bytes followed by the sort key */
+	int			alloc;			/* allocated size of data */
+} SortKeyCacheEntry;
+
+static MemoryContext sortkey_cache_context = NULL;
+static SortKeyCacheEntry *sortkey_cache = NULL;
+
+/* conversion buffer reused across calls, grown as needed */
+static UChar *sortkey_ubuf = NULL;
+static int32_t sortkey_ubuf_size = 0;
+
+static void
+sortkey_cache_init(void)
+{
+	sortkey_cache_context = AllocSetContextCreate(TopMemoryContext,
+												  "Babelfish sort key cache",
+												  ALLOCSET_SMALL_SIZES);
+	sortkey_cache = MemoryContextAllocZero(sortkey_cache_context,
+										   SORTKEY_CACHE_SIZE * sizeof(SortKeyCacheEntry));
+}
+
+/*
+ * Convert the string to UTF-16. With a UTF-8 database we can do that straight
+ * into the reusable buffer; otherwise use the server-encoding converter.
+ */
+static int32_t
+sortkey_to_uchar(const char *data, int len, UChar **result)
+{
+	UErrorCode	status = U_ZERO_ERROR;
+	int32_t		ulen;
+
+	if (GetDatabaseEncoding() != PG_UTF8)
+		return icu_to_uchar(result, data, len);
+
+	/* a UTF-8 string never has more UTF-16 code units than bytes */
+	if (sortkey_ubuf_size < len + 1)
+	{
+		if (sortkey_ubuf)
+			pfree(sortkey_ubuf);
+		sortkey_ubuf_size = Max(len + 1, 256);
+		sortkey_ubuf = MemoryContextAlloc(sortkey_cache_context,
+										  sortkey_ubuf_size * sizeof(UChar));
+	}
+
+	u_strFromUTF8(sortkey_ubuf, sortkey_ubuf_size, &ulen, data, len, &status);
+	if (U_FAILURE(status))
+		ereport(ERROR,
+				(errmsg("%s failed: %s", "u_strFromUTF8", u_errorName(status))));
+
+	*result = sortkey_ubuf;
+	return ulen;
+}
+
+/*
+ * Get the ICU sort key of a string, including its terminating zero byte.
+ *
+ * The key is written to buf, which must hold SORTKEY_BUFSIZE bytes, unless it
+ * does not fit there, in which case it is palloc'd. Either way the caller
+ * owns the result.
+ */
+static uint8_t *
+varchar_icu_sortkey(pg_locale_t mylocale, Oid collid, const char *data, int len,
+					uint8_t *buf, int32_t *keylen)
+{
+	SortKeyCacheEntry *entry = NULL;
+	UChar	   *uchar;
+	int32_t		ulen;
+	uint8_t    *key = buf;
+	uint32		hash = 0;
+
+	if (!sortkey_cache)
+		sortkey_cache_init();
+
+	if (len <= SORTKEY_CACHE_MAX_INPUT)
+	{
+		hash = hash_combine(DatumGetUInt32(hash_any((const unsigned char *) data, len)),
+							DatumGetUInt32(hash_uint32(collid)));
+		entry = &sortkey_cache[hash & (SORTKEY_CACHE_SIZE - 1)];
+
+		if (entry->collid == collid && entry->hash == hash &&
+			entry->len == len && memcmp(entry->data, data, len) == 0)
+		{
+			INSTR_METRIC_INC(INSTR_TSQL_SORTKEY_CACHE_HIT);
+			memcpy(buf, entry->data + len, entry->keylen);
+			*keylen = entry->keylen;
+			return buf;
+		}
+		INSTR_METRIC_INC(INSTR_TSQL_SORTKEY_CACHE_MISS);
+	}
+
+	ulen = sortkey_to_uchar(data, len, &uchar);
+
+	/* one pass for the common case, a second only for oversized keys */
+	*keylen = ucol_getSortKey(mylocale->info.icu.ucol, uchar, ulen,
+							  buf, SORTKEY_BUFSIZE);
+	if (*keylen > SORTKEY_BUFSIZE)
+	{
+		key = palloc(*keylen);
+		ucol_getSortKey(mylocale->info.icu.ucol, uchar, ulen, key, *keylen);
+	}
+
+	if (uchar != sortkey_ubuf)
+		pfree(uchar);
+
+	if (entry && key == buf)
+	{
+		if (entry->alloc < len + *keylen)
+		{
+			if (entry->data)
+				pfree(entry->data);
+			entry->alloc = len + *keylen;
+			entry->data = MemoryContextAlloc(sortkey_cache_context, entry->alloc);
+		}
+		entry->collid = collid;
+		entry->hash = hash;
+		entry->len = len;
+		entry->keylen = *keylen;
+		memcpy(entry->data, data, len);
+		memcpy(entry->data + len, key, *keylen);
+	}
+
+	return key;
+}
+
+/*
+ * Equality under a nondeterministic ICU collation: two strings are equal
+ * exactly when their sort keys are.
+ */
+static bool
+varchar_icu_equal(pg_locale_t mylocale, Oid collid,
+				  const char *arg1, int len1, const char *arg2, int len2)
+{
+	uint8_t		buf1[SORTKEY_BUFSIZE];
+	uint8_t		buf2[SORTKEY_BUFSIZE];
+	uint8_t    *key1;
+	uint8_t    *key2;
+	int32_t		keylen1;
+	int32_t		keylen2;
+	bool		result;
+
+	/* identical bytes are equal under any collation */
+	if (len1 == len2 && memcmp(arg1, arg2, len1) == 0)
+		return true;
+
+	key1 = varchar_icu_sortkey(mylocale, collid, arg1, len1, buf1, &keylen1);
+	key2 = varchar_icu_sortkey(mylocale, collid, arg2, len2, buf2, &keylen2);
+
+	result = (keylen1 == keylen2 && memcmp(key1, key2, keylen1) == 0);
+
+	if (key1 != buf1)
+		pfree(key1);
+	if (key2 != buf2)
+		pfree(key2);
+
+	return result;
+}
+#endif							/* USE_ICU */
+
 Datum
 varchareq(PG_FUNCTION_ARGS)
 {
@@ -1361,15 +1557,17 @@ varchareq(PG_FUNCTION_ARGS)
 				len2;
 	bool		result;
 	Oid			collid = PG_GET_COLLATION();
+	pg_locale_t mylocale = 0;
 
 	check_collation_set(collid);
 
 	len1 = varcharTruelen(arg1);
 	len2 = varcharTruelen(arg2);
 
-	if (lc_collate_is_c(collid) ||
-		collid == DEFAULT_COLLATION_OID ||
-		pg_newlocale_from_collation(collid)->deterministic)
+	if (!lc_collate_is_c(collid) && collid != DEFAULT_COLLATION_OID)
+		mylocale = pg_newlocale_from_collation(collid);
+
+	if (!mylocale || mylocale->deterministic)
 	{
 		/*
 		 * Since we only care about equality or not-equality, we can avoid all
@@ -1380,6 +1578,14 @@ varchareq(PG_FUNCTION_ARGS)
 		else
 			result = (memcmp(VARDATA_ANY(arg1), VARDATA_ANY(arg2), len1) == 0);
 	}
+#ifdef USE_ICU
+	else if (mylocale->provider == COLLPROVIDER_ICU)
+	{
+		result = varchar_icu_equal(mylocale, collid,
+								   VARDATA_ANY(arg1), len1,
+								   VARDATA_ANY(arg2), len2);
+	}
+#endif
 	else
 	{
 		result = (varstr_cmp(VARDATA_ANY(arg1), len1, VARDATA_ANY(arg2), len2,
@@ -1401,15 +1607,17 @@ varcharne(PG_FUNCTION_ARGS)
 				len2;
 	bool		result;
 	Oid			collid = PG_GET_COLLATION();
+	pg_locale_t mylocale = 0;
 
 	check_collation_set(collid);
 
 	len1 = varcharTruelen(arg1);
 	len2 = varcharTruelen(arg2);
 
-	if (lc_collate_is_c(collid) ||
-		collid == DEFAULT_COLLATION_OID ||
-		pg_newlocale_from_collation(collid)->deterministic)
+	if (!lc_collate_is_c(collid) && collid != DEFAULT_COLLATION_OID)
+		mylocale = pg_newlocale_from_collation(collid);
+
+	if (!mylocale || mylocale->deterministic)
 	{
 		/*
 		 * Since we only care about equality or not-equality, we can avoid all
@@ -1420,6 +1628,14 @@ varcharne(PG_FUNCTION_ARGS)
 		else
 			result = (memcmp(VARDATA_ANY(arg1), VARDATA_ANY(arg2), len1) != 0);
 	}
+#ifdef USE_ICU
+	else if (mylocale->provider == COLLPROVIDER_ICU)
+	{
+		result = !varchar_icu_equal(mylocale, collid,
+									VARDATA_ANY(arg1), len1,
+									VARDATA_ANY(arg2), len2);
+	}
+#endif
 	else
 	{
 		result = (varstr_cmp(VARDATA_ANY(arg1), len1, VARDATA_ANY(arg2), len2,
@@ -1537,6 +1753,32 @@ varcharcmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(cmp);
 }
 
+/*
+ * SortSupport for sys.varchar.
+ *
+ * varcharcmp ignores trailing blanks, which is exactly how the core sort
+ * support treats bpchar, so we borrow it under BPCHAROID. That gives us the
+ * memcmp comparator for C collations and, for ICU collations (including the
+ * nondeterministic CI/AI ones), abbreviated keys built from the ICU sort key
+ * with a full collation-aware comparison only to break ties.
+ */
+Datum
+varchar_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+	Oid			collid = ssup->ssup_collation;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(ssup->ssup_cxt);
+
+	/* Use generic string SortSupport, with bpchar's trailing blank rules */
+	varstr_sortsupport(ssup, BPCHAROID, collid);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	PG_RETURN_VOID();
+}
+
 /*
  * varchar needs a specialized hash function because we want to ignore
  * trailing blanks in comparisons.
@@ -1572,22 +1814,17 @@ hashvarchar(PG_FUNCTION_ARGS)
 #ifdef USE_ICU
 		if (mylocale->provider == COLLPROVIDER_ICU)
 		{
-			int32_t		ulen = -1;
-			UChar	   *uchar = NULL;
-			Size		bsize;
-			uint8_t    *buf;
-
-			ulen = icu_to_uchar(&uchar, keydata, keylen);
+			uint8_t		buf[SORTKEY_BUFSIZE];
+			uint8_t    *sortkey;
+			int32_t		bsize;
 
-			bsize = ucol_getSortKey(mylocale->info.icu.ucol,
-									uchar, ulen, NULL, 0);
-			buf = palloc(bsize);
-			ucol_getSortKey(mylocale->info.icu.ucol,
-							uchar, ulen, buf, bsize);
+			sortkey = varchar_icu_sortkey(mylocale, collid, keydata, keylen,
+										  buf, &bsize);
 
-			result = hash_any(buf, bsize);
+			result = hash_any(sortkey, bsize);
 
-			pfree(buf);
+			if (sortkey != buf)
+				pfree(sortkey);
 		}
 		else
 #endif
@@ -39,6 +39,8 @@ bool	tds_ssl_encrypt = false;
 int 	tds_default_protocol_version = 0;
 int32_t tds_default_packet_size = 4096;
 int	tds_debug_log_level = 1;
+int	tds_zero_copy_threshold = 16384;
+int	tds_read_ahead_size = 65536;
 #ifdef FAULT_INJECTOR
 static bool TdsFaultInjectionEnabled = false;
 #endif
@@ -262,6 +264,33 @@ TdsDefineGucs(void)
 		NULL,
 		NULL);
 
+	DefineCustomIntVariable(
+		"babelfishpg_tds.tds_zero_copy_threshold",
+		gettext_noop("Sets the minimum size of a value that is sent without"
+			" copying it into the send buffer on non-TLS connections"),
+		gettext_noop("0 turns this off."),
+		&tds_zero_copy_threshold,
+		16384, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_NOT_IN_SAMPLE | GUC_UNIT_BYTE,
+		NULL,
+		NULL,
+		NULL);
+
+	DefineCustomIntVariable(
+		"babelfishpg_tds.tds_read_ahead_size",
+		gettext_noop("Sets how much data a TDS connection reads ahead"
+			" of the packet being processed"),
+		gettext_noop("Values smaller than the packet size turn read-ahead off."
+			" Takes effect for new connections."),
+		&tds_read_ahead_size,
+		65536, 0, 64 * 1024 * 1024,
+		PGC_SIGHUP,
+		GUC_NOT_IN_SAMPLE | GUC_UNIT_BYTE,
+		NULL,
+		NULL,
+		NULL);
+
 	DefineCustomIntVariable(
 		"babelfishpg_tds.tds_debug_log_level",
 		gettext_noop("Sets the tds debug log level"),
@@ -42,6 +42,11 @@ uint64_t offset = 0;
 #define BINARY_COLUMNMETADATA_LEN			sizeof(uint16)
 #define SQL_VARIANT_COLUMNMETADATA_LEN		sizeof(uint32_t)
 
+/* Are rows inserted one at a time as they are decoded? */
+#define TdsBulkLoadStreaming() \
+	(pltsql_plugin_handler_ptr->bulk_load_row_callback != NULL && \
+	 pltsql_plugin_handler_ptr->get_insert_bulk_streaming != NULL && \
+	 pltsql_plugin_handler_ptr->get_insert_bulk_streaming())
 
 /* Check if retStatus Not OK. */
 #define CheckPLPStatusNotOK(temp, retStatus, colNum) \
@@ -90,6 +95,7 @@ static void
 FetchMoreBcpData(StringInfo *message, int dataLenToRead)
 {
 	StringInfo temp;
+	MemoryContext oldcontext;
 	int ret;
 
 	/* Unlikely that message will be NULL. */
@@ -107,7 +113,13 @@ FetchMoreBcpData(StringInfo *message, int dataLenToRead)
 				(errcode(ERRCODE_PROTOCOL_VIOLATION),
 					errmsg("Trying to read more data than available in BCP request.")));
 
+	/*
+	 * Rows may be decoded in a short-lived context while streaming, the
+	 * message has to stay in the context it was created in.
+	 */
+	oldcontext = MemoryContextSwitchTo(GetMemoryChunkContext(*message));
 	temp = makeStringInfo();
+	MemoryContextSwitchTo(oldcontext);
 	appendBinaryStringInfo(temp, (*message)->data + offset, (*message)->len - offset);
 
 	if ((*message)->data)
@@ -458,6 +470,10 @@ GetBulkLoadRequest(StringInfo message)
 /*
  * SetBulkLoadRowData - Builds the row data structure associated
  * with Bulk Load.
+ *
+ * When streaming, every row is handed to the bulk_load_row_callback as soon
+ * as it has been decoded, and its values are freed right after, instead of
+ * collecting the whole batch in request->rowData first.
  * TODO: Reuse for TVP.
  */
 static StringInfo
@@ -467,10 +483,23 @@ SetBulkLoadRowData(TDSRequestBulkLoad request, StringInfo message)
 	int retStatus = 0;
 	uint32_t len;
 	StringInfo temp = palloc0(sizeof(StringInfoData));
+	BulkLoadRowData *rowData = NULL;
+	MemoryContext rowContext = NULL;
+	MemoryContext oldcontext = CurrentMemoryContext;
 	request->rowCount = 0;
 	request->rowData = NIL;
 	request->currentBatchSize = 0;
 
+	if (TdsBulkLoadStreaming())
+	{
+		rowContext = AllocSetContextCreate(CurrentMemoryContext,
+										   "Bulk Load Row",
+										   ALLOCSET_DEFAULT_SIZES);
+		rowData = palloc0(sizeof(BulkLoadRowData));
+		rowData->columnValues = palloc0(request->colCount * sizeof(Datum));
+		rowData->isNull 	  = palloc0(request->colCount * sizeof(bool));
+	}
+
 	CheckMessageHasEnoughBytesToRead(&message, 1);
 
 	/* Loop over each row. */
@@ -479,11 +508,19 @@ SetBulkLoadRowData(TDSRequestBulkLoad request, StringInfo message)
 			&& request->rowCount < pltsql_plugin_handler_ptr->get_insert_bulk_rows_per_batch())
 	{
 		int i = 0; /* Current Column Number. */
-		BulkLoadRowData *rowData = palloc0(sizeof(BulkLoadRowData));
 		request->rowCount++;
 
-		rowData->columnValues = palloc0(request->colCount * sizeof(Datum));
-		rowData->isNull 	  = palloc0(request->colCount * sizeof(bool));
+		if (rowContext)
+		{
+			MemSet(rowData->isNull, false, request->colCount * sizeof(bool));
+			MemoryContextSwitchTo(rowContext);
+		}
+		else
+		{
+			rowData = palloc0(sizeof(BulkLoadRowData));
+			rowData->columnValues = palloc0(request->colCount * sizeof(Datum));
+			rowData->isNull 	  = palloc0(request->colCount * sizeof(bool));
+		}
 
 		offset++;
 		request->currentBatchSize++;
@@ -815,10 +852,32 @@ SetBulkLoadRowData(TDSRequestBulkLoad request, StringInfo message)
 			}
 			i++;
 		}
-		request->rowData = lappend(request->rowData, rowData);
+
+		if (rowContext)
+		{
+			MemoryContextSwitchTo(oldcontext);
+
+			/* temp may have been replaced by a PLP buffer of this row. */
+			if (GetMemoryChunkContext(temp) == rowContext)
+				temp = palloc0(sizeof(StringInfoData));
+
+			pltsql_plugin_handler_ptr->bulk_load_row_callback(request->colCount,
+												rowData->columnValues, rowData->isNull);
+			MemoryContextReset(rowContext);
+		}
+		else
+			request->rowData = lappend(request->rowData, rowData);
 		CheckMessageHasEnoughBytesToRead(&message, 1);
 	}
 
+	if (rowContext)
+	{
+		MemoryContextDelete(rowContext);
+		pfree(rowData->columnValues);
+		pfree(rowData->isNull);
+		pfree(rowData);
+	}
+
 	/*
 	 * If row count is less than the default batch size then this is the last packet,
 	 * the next byte should be the done token.
@@ -879,6 +938,10 @@ ProcessBCPRequest(TDSRequest request)
 
 			RESUME_CANCEL_INTERRUPTS();
 
+			/* Rows may have been inserted already, so clean-up as for an insert error. */
+			if (TdsBulkLoadStreaming())
+				pltsql_plugin_handler_ptr->bulk_load_callback(0, 0, NULL, NULL);
+
 			if (ret < 0)
 				TdsErrorContext->err_text = "EOF on TDS socket while fetching For Bulk Load Request";
 
@@ -896,6 +959,36 @@ ProcessBCPRequest(TDSRequest request)
 			break;
 		}
 
+		/* The rows are in already, finish the batch. */
+		if (TdsBulkLoadStreaming())
+		{
+			PG_TRY();
+			{
+				retValue += pltsql_plugin_handler_ptr->bulk_load_callback(req->colCount,
+											req->rowCount, NULL, NULL);
+			}
+			PG_CATCH();
+			{
+				int ret = 0;
+				HOLD_CANCEL_INTERRUPTS();
+
+				if (!TdsGetRecvPacketEomStatus())
+					ret = TdsDiscardAllPendingBcpRequest();
+
+				RESUME_CANCEL_INTERRUPTS();
+
+				/* Using Same callback function to do the clean-up. */
+				pltsql_plugin_handler_ptr->bulk_load_callback(0, 0, NULL, NULL);
+
+				if (ret < 0)
+					TdsErrorContext->err_text = "EOF on TDS socket while fetching For Bulk Load Request";
+
+				PG_RE_THROW();
+			}
+			PG_END_TRY();
+			continue;
+		}
+
 		nargs = req->colCount * req->rowCount;
 		values = palloc0(nargs * sizeof(Datum));
 		nulls = palloc0(nargs * sizeof(bool));
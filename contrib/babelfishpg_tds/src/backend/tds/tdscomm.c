@@ -28,7 +28,9 @@
 
 #include "src/include/tds_debug.h"
 #include "src/include/tds_int.h"
+#include "src/include/tds_secure.h"
 #include "src/include/faultinjection.h"
+#include "src/include/guc.h"
 
 /* Globals */
 MemoryContext	TdsMemoryContext = NULL;
@@ -42,20 +44,36 @@ static uint8_t	TdsSendMessageType; /* Current TDS message in progress */
 
 static bool		TdsDoProcessHeader;	/* Header is processed or not. */
 static char		*TdsRecvBuffer;
+static int		TdsRecvBufferSize;	/* Size of TdsRecvBuffer, at least TdsBufferSize */
 static int		TdsRecvStart;		/* Next index to read a byte from TdsRecvBuffer */
 static int		TdsRecvEnd;			/* End of data available in TdsRecvBuffer */
 static uint8_t	TdsRecvMessageType; /* Current TDS message in progress */
 static uint8_t	TdsRecvPacketStatus;
 static int		TdsLeftInPacket;
 
+/* Receive statistics for the request being read, see TdsReadNextRequest */
+static int		TdsRecvSocketReads;
+static int		TdsRecvPackets;
+static uint64	TdsRecvBytesMoved;
+static uint64	TdsRecvBytesCopied;
+
 static TdsSecureSocketApi tds_secure_read;
 static TdsSecureSocketApi tds_secure_write;
 
 
+/*
+ * Maximum number of packets sent by a single writev() in the zero-copy
+ * send path.  Each packet takes two iovecs, so keep this well below IOV_MAX.
+ */
+#define TDS_ZERO_COPY_MAX_PACKETS	64
+
 /* Internal functions */
 static void		SocketSetNonblocking(bool nonblocking);
 static int		InternalFlush(bool);
+static int		InternalWritev(struct iovec *iov, int iovcnt);
 static void		TdsConsumedBytes(int bytes);
+static int		TdsBufferedMessageSize(void);
+static void		TdsLogRecvStats(StringInfo message);
 
 /* Inline functions */
 
@@ -132,6 +150,11 @@ SocketSetNonblocking(bool nonblocking)
  *
  *	Data is read in a fix size buffer. Read socket will
  *	issue network read for left capacity in receive buffer
+ *
+ *	After login the receive buffer is larger than a packet (see
+ *	babelfishpg_tds.tds_read_ahead_size), so a single read picks up as many
+ *	packets as the socket has available, and unread data only needs to be
+ *	left-justified once the room behind it gets smaller than a packet.
  * --------------------------------
  */
 static int
@@ -140,16 +163,17 @@ TdsReadsocket(void)
       TdsErrorContext->err_text = "Reading data from socket";
 	if (TdsRecvStart > 0)
 	{
-		if (TdsRecvEnd > TdsRecvStart)
+		if (TdsRecvEnd == TdsRecvStart)
+			TdsRecvStart = TdsRecvEnd = 0;
+		else if (TdsRecvBufferSize - TdsRecvEnd < TdsBufferSize)
 		{
 			/* still some unread data, left-justify it in the buffer */
 			memmove(TdsRecvBuffer, TdsRecvBuffer + TdsRecvStart,
 					TdsRecvEnd - TdsRecvStart);
+			TdsRecvBytesMoved += TdsRecvEnd - TdsRecvStart;
 			TdsRecvEnd -= TdsRecvStart;
 			TdsRecvStart = 0;
 		}
-		else
-			TdsRecvStart = TdsRecvEnd = 0;
 	}
 
 	/* Ensure that we're in blocking mode */
@@ -161,7 +185,7 @@ TdsReadsocket(void)
 		int			r;
 
 		r = tds_secure_read(MyProcPort, TdsRecvBuffer + TdsRecvEnd,
-							TdsBufferSize - TdsRecvEnd);
+							TdsRecvBufferSize - TdsRecvEnd);
 
 		if (r < 0)
 		{
@@ -188,6 +212,7 @@ TdsReadsocket(void)
 		}
 		/* r contains number of bytes read, so just incr length */
 		TdsRecvEnd += r;
+		TdsRecvSocketReads++;
 		return 0;
 	}
 
@@ -235,6 +260,7 @@ TdsProcessHeader(void)
 
 	TdsLeftInPacket = data16 - TDS_PACKET_HEADER_SIZE;
 	TdsRecvStart += TDS_PACKET_HEADER_SIZE;
+	TdsRecvPackets++;
 
 	/* [BABEL-648] TDS packet with no TDS data is valid packet.*/
 	if (TdsLeftInPacket < 0)
@@ -322,20 +348,20 @@ TdsGetbyte(void)
  * --------------------------------
  */
 static void
-TdsFillHeader(bool lastPacket)
+TdsFillHeader(char *header, bool lastPacket, int packetLen)
 {
 	uint16_t net16;
 	/* Message type */
-	TdsSendBuffer[0] = TdsSendMessageType;
+	header[0] = TdsSendMessageType;
 	/* Packet status */
-	TdsSendBuffer[1] = (lastPacket) ? 0x1 : 0x0;
+	header[1] = (lastPacket) ? 0x1 : 0x0;
 	/* Packet length including header */
-	net16 = pg_hton16(TdsSendCur - TdsSendStart);
-	memcpy(TdsSendBuffer + 2, &net16, sizeof(net16));
+	net16 = pg_hton16(packetLen);
+	memcpy(header + 2, &net16, sizeof(net16));
 	net16 = 0;
-	memcpy(TdsSendBuffer + 4, &net16, sizeof(net16)); /* TODO  get server pid */
-	TdsSendBuffer[6] = 0; /* TODO  generate packet id */
-	TdsSendBuffer[7] = 0; /* unused */
+	memcpy(header + 4, &net16, sizeof(net16)); /* TODO  get server pid */
+	header[6] = 0; /* TODO  generate packet id */
+	header[7] = 0; /* unused */
 }
 
 /* --------------------------------
@@ -357,7 +383,7 @@ InternalFlush(bool lastPacket)
 	/* Writing the packet for the first time */
 	if (TdsSendStart == 0)
 	{
-		TdsFillHeader(lastPacket);
+		TdsFillHeader(TdsSendBuffer, lastPacket, TdsSendCur);
 	}
 
 	if (lastPacket)
@@ -425,6 +451,67 @@ InternalFlush(bool lastPacket)
 	return 0;
 }
 
+/* --------------------------------
+ *	InternalWritev - send a gather list of complete packets
+ *
+ * Unlike InternalFlush, this always waits until everything is sent, since
+ * the iovecs point into memory the caller is about to release.  Returns 0 if
+ * OK, or EOF if trouble.
+ * --------------------------------
+ */
+static int
+InternalWritev(struct iovec *iov, int iovcnt)
+{
+	static int	lastReportedSendErrno = 0;
+
+	TdsErrorContext->err_text = "TDS InternalWritev - Sending data to the client";
+
+	while (iovcnt > 0)
+	{
+		ssize_t		r;
+
+		r = tds_secure_writev(MyProcPort, iov, iovcnt);
+
+		if (r <= 0)
+		{
+			if (errno == EINTR)
+				continue;		/* Ok if we were interrupted */
+
+			/* See comments in InternalFlush */
+			if (errno != lastReportedSendErrno)
+			{
+				lastReportedSendErrno = errno;
+				ereport(COMMERROR,
+						(errcode_for_socket_access(),
+						 errmsg("could not send data to client: %m")));
+			}
+
+			TdsSendStart = 0;
+			TdsSendCur = TDS_PACKET_HEADER_SIZE;
+			ClientConnectionLost = 1;
+			InterruptPending = 1;
+			return EOF;
+		}
+
+		lastReportedSendErrno = 0;	/* reset after any successful send */
+
+		/* Skip over whatever got sent */
+		while (iovcnt > 0 && r >= iov->iov_len)
+		{
+			r -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (r > 0)
+		{
+			iov->iov_base = (char *) iov->iov_base + r;
+			iov->iov_len -= r;
+		}
+	}
+
+	return 0;
+}
+
 /* --------------------------------
  * TdsCommInit - Setup TDS comm context
  * --------------------------------
@@ -448,6 +535,8 @@ TdsCommInit(uint32_t bufferSize,
 											 ALLOCSET_DEFAULT_SIZES);
 
 	TdsBufferSize = bufferSize;
+	/* No read-ahead until login is done, see TdsSetBufferSize */
+	TdsRecvBufferSize = bufferSize;
 
 	TdsCommReset();
 }
@@ -468,7 +557,7 @@ TdsCommReset(void)
 	TdsSendCur = TDS_PACKET_HEADER_SIZE;
 
 	oldContext = MemoryContextSwitchTo(TdsMemoryContext);
-	TdsRecvBuffer = palloc(TdsBufferSize);
+	TdsRecvBuffer = palloc(TdsRecvBufferSize);
 	TdsSendBuffer = palloc(TdsBufferSize);
 	MemoryContextSwitchTo(oldContext);
 }
@@ -502,15 +591,21 @@ TdsCommShutdown(void)
  *
  *	During login handshake, client might ask for different
  *	packet size. Adjust buffer size accordingly
+ *
+ *	This is also where the receive buffer grows to the read-ahead size.
+ *	We don't read ahead before that, since the TLS handshake reads from
+ *	the socket behind our back during login.
  *	--------------------------------
  */
 void
 TdsSetBufferSize(uint32_t newSize)
 {
+	int		newRecvSize = Max((int) newSize, tds_read_ahead_size);
+
 	TDS_DEBUG(TDS_DEBUG3, "TdsSetBufferSize current size %u new size %u",
 			TdsBufferSize, newSize);
 
-	if (newSize == TdsBufferSize)
+	if (newSize == TdsBufferSize && newRecvSize == TdsRecvBufferSize)
 		return;
 	/*
 	 * Both send and receive buffers should not have any
@@ -532,9 +627,10 @@ TdsSetBufferSize(uint32_t newSize)
 	}
 
 	TdsSendBuffer = repalloc(TdsSendBuffer, newSize);
-	TdsRecvBuffer = repalloc(TdsRecvBuffer, newSize);
+	TdsRecvBuffer = repalloc(TdsRecvBuffer, newRecvSize);
 
 	TdsBufferSize = newSize;
+	TdsRecvBufferSize = newRecvSize;
 	TdsRecvStart = TdsRecvEnd = TdsLeftInPacket = 0;
 }
 
@@ -620,6 +716,7 @@ TdsGetbytes(char *s, size_t len)
 		if (amount > len)
 			amount = len;
 		memcpy(s, TdsRecvBuffer + TdsRecvStart, amount);
+		TdsRecvBytesCopied += amount;
 		TdsRecvStart += amount;
 		TdsConsumedBytes(amount);
 		s += amount;
@@ -675,6 +772,123 @@ TdsPutbytes(void *s, size_t len)
 	return res;
 }
 
+/* --------------------------------
+ *	TdsPutbytesZeroCopy - send a large value without copying it into the
+ *		send buffer
+ *
+ *	The value is cut into full packets right where it lies, and every packet
+ *	goes out as a generated header followed by a pointer into the caller's
+ *	memory, TDS_ZERO_COPY_MAX_PACKETS packets per writev().  The packet
+ *	pending in the send buffer is completed by the first chunk.  The tail
+ *	that doesn't fill a whole packet is copied into the send buffer as usual,
+ *	so the caller may free the value as soon as we return.
+ *
+ *	TLS connections need to encrypt every byte anyway, so they keep using
+ *	the copying path, as do values below babelfishpg_tds.tds_zero_copy_threshold.
+ *
+ *	returns 0 if OK, EOF if trouble
+ * --------------------------------
+ */
+int
+TdsPutbytesZeroCopy(void *s, size_t len)
+{
+	struct iovec	iov[2 * TDS_ZERO_COPY_MAX_PACKETS];
+	char			headers[TDS_ZERO_COPY_MAX_PACKETS][TDS_PACKET_HEADER_SIZE];
+	char		   *data = s;
+	size_t			payload = TdsBufferSize - TDS_PACKET_HEADER_SIZE;
+
+	if (tds_zero_copy_threshold <= 0 ||
+		len < (size_t) tds_zero_copy_threshold ||
+		len < payload ||
+		MyProcPort == NULL ||
+		MyProcPort->ssl_in_use ||
+		TdsSendStart != 0)
+		return InternalPutbytes(s, len);
+
+	SocketSetNonblocking(false);
+
+	for (;;)
+	{
+		int		npackets = 0;
+		int		niov = 0;
+
+		while (npackets < TDS_ZERO_COPY_MAX_PACKETS)
+		{
+			size_t	chunk;
+
+			if (npackets == 0 && TdsSendCur > TDS_PACKET_HEADER_SIZE)
+			{
+				/* Complete the packet pending in the send buffer */
+				chunk = TdsBufferSize - TdsSendCur;
+				if (len < chunk)
+					break;
+				TdsFillHeader(TdsSendBuffer, false, TdsBufferSize);
+				iov[niov].iov_base = TdsSendBuffer;
+				iov[niov++].iov_len = TdsSendCur;
+			}
+			else
+			{
+				chunk = payload;
+				if (len < chunk)
+					break;
+				TdsFillHeader(headers[npackets], false, TdsBufferSize);
+				iov[niov].iov_base = headers[npackets];
+				iov[niov++].iov_len = TDS_PACKET_HEADER_SIZE;
+			}
+
+			if (chunk > 0)
+			{
+				iov[niov].iov_base = data;
+				iov[niov++].iov_len = chunk;
+			}
+			data += chunk;
+			len -= chunk;
+			npackets++;
+		}
+
+		if (npackets == 0)
+			break;
+
+		if (InternalWritev(iov, niov))
+			return EOF;
+
+		/* The pending packet, if any, went out with the first batch */
+		TdsSendStart = 0;
+		TdsSendCur = TDS_PACKET_HEADER_SIZE;
+	}
+
+	return InternalPutbytes(data, len);
+}
+
+/* --------------------------------
+ *	TdsGetSendBufferSpace - get room for in-place writes in the current packet
+ *
+ *	Returns a pointer into the send buffer at which len bytes can be written
+ *	contiguously, or NULL if the current packet doesn't have that much room
+ *	left.  Callers that get a pointer must account for the bytes actually
+ *	written with TdsAdvanceSendBuffer() before calling any other TdsPut*
+ *	function.
+ * --------------------------------
+ */
+char *
+TdsGetSendBufferSpace(size_t len)
+{
+	if (TdsSendCur + len > TdsBufferSize)
+		return NULL;
+	return TdsSendBuffer + TdsSendCur;
+}
+
+/* --------------------------------
+ *	TdsAdvanceSendBuffer - commit bytes written via TdsGetSendBufferSpace
+ * --------------------------------
+ */
+void
+TdsAdvanceSendBuffer(size_t len)
+{
+	Assert(TdsSendCur + len <= TdsBufferSize);
+	TdsSendCur += len;
+}
+
 /* --------------------------------
  *      TdsPutDate - send one 24-bit unsigned integer
  *      		in LITTLE_ENDIAN
@@ -895,6 +1109,56 @@ TdsDiscardAllPendingBcpRequest()
 	return 0;
 }
 
+/* --------------------------------
+ * TdsBufferedMessageSize - Size of the message payload already buffered
+ *
+ * Walks the packet headers sitting in the receive buffer in place, starting
+ * with the rest of the current packet, and adds up their payloads until the
+ * end of the message or of the buffered data.  Used to size the request
+ * buffer once instead of growing it packet by packet.
+ * --------------------------------
+ */
+static int
+TdsBufferedMessageSize(void)
+{
+	int		size = TdsLeftInPacket;
+	int		pos = TdsRecvStart + TdsLeftInPacket;
+	uint8_t	status = TdsRecvPacketStatus;
+
+	while (!(status & TDS_PACKET_HEADER_STATUS_EOM) &&
+		   TdsRecvMessageType != TDS_BULK_LOAD &&
+		   pos + TDS_PACKET_HEADER_SIZE <= TdsRecvEnd)
+	{
+		uint16_t	data16;
+
+		status = TdsRecvBuffer[pos + 1];
+		memcpy(&data16, TdsRecvBuffer + pos + 2, sizeof(data16));
+		data16 = pg_ntoh16(data16);
+
+		/* Leave bogus headers to TdsProcessHeader */
+		if (data16 < TDS_PACKET_HEADER_SIZE || data16 > TdsBufferSize)
+			break;
+
+		size += data16 - TDS_PACKET_HEADER_SIZE;
+		pos += data16;
+	}
+
+	return size;
+}
+
+/* --------------------------------
+ * TdsLogRecvStats - Report how much work it took to read a request
+ * --------------------------------
+ */
+static void
+TdsLogRecvStats(StringInfo message)
+{
+	TDS_DEBUG(TDS_DEBUG2, "TDS request of %d bytes read in %d packets with %d socket reads, "
+			  UINT64_FORMAT " bytes copied, " UINT64_FORMAT " bytes moved",
+			  message->len, TdsRecvPackets, TdsRecvSocketReads,
+			  TdsRecvBytesCopied, TdsRecvBytesMoved);
+}
+
 /* --------------------------------
  * TdsReadNextRequest - Read new request
  *
@@ -909,6 +1173,12 @@ TdsReadNextRequest(StringInfo message, uint8_t *status, uint8_t *messageType)
 {
 	int		readBytes = 0;
 	bool	isFirst = true;
+
+	TdsRecvSocketReads = 0;
+	TdsRecvPackets = 0;
+	TdsRecvBytesMoved = 0;
+	TdsRecvBytesCopied = 0;
+
 	while(1)
 	{
 		if (TdsReadNextBuffer() == EOF)
@@ -926,7 +1196,7 @@ TdsReadNextRequest(StringInfo message, uint8_t *status, uint8_t *messageType)
 			isFirst = false;
 		}
 		readBytes = TdsLeftInPacket;
-		enlargeStringInfo(message, readBytes);
+		enlargeStringInfo(message, TdsBufferedMessageSize());
 		if (TdsGetbytes(message->data + message->len, readBytes))
 			return EOF;
 		message->len += readBytes;
@@ -936,6 +1206,7 @@ TdsReadNextRequest(StringInfo message, uint8_t *status, uint8_t *messageType)
 		{
 			if (TdsLeftInPacket == 0 && TdsRecvStart == TdsRecvEnd)
 				TdsDoProcessHeader = true;
+			TdsLogRecvStats(message);
 			return 0;
 		}
 
@@ -946,6 +1217,7 @@ TdsReadNextRequest(StringInfo message, uint8_t *status, uint8_t *messageType)
 		if (TdsRecvMessageType == TDS_BULK_LOAD)
 		{
 			TdsDoProcessHeader = true;
+			TdsLogRecvStats(message);
 			return 0;
 		}
 	}
@@ -105,6 +105,58 @@ typedef struct TdsExecutionStateData
 
 typedef TdsExecutionStateData *TdsExecutionState;
 
+/*
+ * Specialized row encoders used by the send plan.  Columns that get
+ * TDS_ROW_ENCODER_GENERIC go through their type specific sendFunc, the others
+ * are fixed-width values that are written straight into the send buffer.
+ */
+typedef enum TdsRowEncoder
+{
+	TDS_ROW_ENCODER_GENERIC = 0,
+	TDS_ROW_ENCODER_BIT,
+	TDS_ROW_ENCODER_TINYINT,
+	TDS_ROW_ENCODER_SMALLINT,
+	TDS_ROW_ENCODER_INTEGER,
+	TDS_ROW_ENCODER_BIGINT,
+	TDS_ROW_ENCODER_FLOAT4,
+	TDS_ROW_ENCODER_FLOAT8,
+	TDS_ROW_ENCODER_DATE
+} TdsRowEncoder;
+
+typedef struct TdsColumnSendPlan
+{
+	TdsRowEncoder	encoder;
+	bool			nullable;	/* column is marked nullable in COLMETADATA */
+	bool			sendLength;	/* value is prefixed by a one byte length */
+	uint8			valueLen;	/* on-wire size of a fixed-width value */
+	uint8			nullLen;	/* on-wire size of NULL inside a ROW token */
+
+	/*
+	 * For the first column of a group of consecutive fixed-width columns,
+	 * runEnd is the attno just past the group and runLen is the maximum
+	 * number of bytes the group can take on the wire.  Zero otherwise.
+	 */
+	int				runEnd;
+	int				runLen;
+} TdsColumnSendPlan;
+
+/*
+ * TdsSendPlan - per result set information used by TdsPrintTup()
+ *
+ * It is built once by PrepareRowDescription() so that the per-row path
+ * doesn't have to re-interpret the column metadata or allocate memory.
+ */
+typedef struct TdsSendPlan
+{
+	int					natts;
+	bool				nbcRowAllowed;	/* client understands NBCROW */
+	int					nullMapSize;
+	uint8_t			   *nullMap;		/* NBCROW null bitmap, reused per row */
+	char			   *stage;			/* fallback buffer for fixed-width groups
+										 * that don't fit in the current packet */
+	TdsColumnSendPlan  *cols;
+} TdsSendPlan;
+
 /* Local variables */
 static bool		TdsHavePendingDone = false;
 static bool		TdsPendingDoneNocount;
@@ -122,12 +174,18 @@ static bool		markErrorFlag = false;
 
 static TdsColumnMetaData *colMetaData = NULL;
 static List	*relMetaDataInfoList = NULL;
+static TdsSendPlan *sendPlan = NULL;
 
 static void FillTabNameWithNumParts(StringInfo buf, uint8 numParts, TdsRelationMetaDataInfo relMetaDataInfo);
 static void FillTabNameWithoutNumParts(StringInfo buf, uint8 numParts, TdsRelationMetaDataInfo relMetaDataInfo);
 static void SetTdsEstateErrorData(void);
 static void ResetTdsEstateErrorData(void);
 static void SetAttributesForColmetada(TdsColumnMetaData *col);
+static uint8 GetNullLenForColumn(TdsColumnMetaData *col);
+static void SendNullForColumn(TdsColumnMetaData *col);
+static void BuildSendPlan(int natts);
+static int EncodeFixedWidthRun(TdsSendPlan *plan, TupleTableSlot *slot,
+							   int attno, bool nbcRow);
 
 static inline void
 SendPendingDone(bool more)
@@ -1728,6 +1786,8 @@ PrepareRowDescription(TupleDesc typeinfo, List *targetlist, int16 *formats,
 		}
 	}
 
+	BuildSendPlan(natts);
+
 	MemoryContextSwitchTo(oldContext);
 
 	if (extendedInfo || sendTableName)
@@ -2364,6 +2424,307 @@ TdsSendRowDescription(TupleDesc typeinfo,
 	SendColumnMetadataToken(typeinfo->natts, false);
 }
 
+/*
+ * GetNullLenForColumn - number of bytes used to send a NULL value for the
+ * given column inside a ROW token
+ */
+static uint8
+GetNullLenForColumn(TdsColumnMetaData *col)
+{
+	switch (col->metaEntry.type1.tdsTypeId)
+	{
+		case TDS_TYPE_VARCHAR:
+		case TDS_TYPE_NVARCHAR:
+			/*
+			 * To send NULL for VARCHAR(max) or NVARCHAR(max), we have to
+			 * indicate it using 0xffffffffffffffff (PLP_NULL).  For the
+			 * regular case we have to send 0xffff (CHARBIN_NULL).
+			 */
+			return (col->metaEntry.type2.maxSize == 0xffff) ? 8 : 2;
+		case TDS_TYPE_VARBINARY:
+			/* Same as above, PLP_NULL for VARBINARY(max), CHARBIN_NULL otherwise */
+			return (col->metaEntry.type7.maxSize == 0xffff) ? 8 : 2;
+		case TDS_TYPE_CHAR:
+		case TDS_TYPE_NCHAR:
+		case TDS_TYPE_XML:
+		case TDS_TYPE_BINARY:
+			/* For these datatypes, we need to send 0xffff (CHARBIN_NULL) to indicate NULL */
+			return 2;
+		case TDS_TYPE_SQLVARIANT:
+			/* For sql_variant, we need to send 0x00000000 to indicate NULL */
+			return 4;
+		default:
+			/* for other datatypes, we need to send 0x00 (1 byte) only */
+			return 1;
+	}
+}
+
+/*
+ * SendNullForColumn - send a NULL value for the given column inside a ROW
+ * token.  When NBCROW token is used, NULL values are sent using the NULL
+ * bitmap only.
+ */
+static void
+SendNullForColumn(TdsColumnMetaData *col)
+{
+	switch (GetNullLenForColumn(col))
+	{
+		case 8:
+			TdsPutUInt64LE(0xffffffffffffffff);
+			break;
+		case 4:
+			TdsPutInt32LE(0);
+			break;
+		case 2:
+			TdsPutInt16LE(0xffff);
+			break;
+		default:
+			TdsPutUInt8(0);
+			break;
+	}
+}
+
+/*
+ * BuildSendPlan - precompute everything TdsPrintTup() needs for the result
+ * set described by colMetaData.
+ *
+ * This is called by PrepareRowDescription() in the same memory context as
+ * colMetaData, so it has the same lifetime.
+ */
+static void
+BuildSendPlan(int natts)
+{
+	TdsSendPlan	   *plan;
+	uint32_t		tdsVersion = GetClientTDSVersion();
+	int				attno;
+	int				maxRunLen = 0;
+
+	plan = palloc0(sizeof(TdsSendPlan));
+	plan->natts = natts;
+
+	/* NBCROW token was introduced in TDS version 7.3B */
+	plan->nbcRowAllowed = (tdsVersion >= TDS_VERSION_7_3_B);
+	plan->nullMapSize = (natts + 7) / 8;
+	if (plan->nbcRowAllowed && plan->nullMapSize > 0)
+		plan->nullMap = palloc0(plan->nullMapSize);
+
+	if (natts > 0)
+		plan->cols = palloc0(sizeof(TdsColumnSendPlan) * natts);
+
+	for (attno = 0; attno < natts; attno++)
+	{
+		TdsColumnMetaData  *col = &colMetaData[attno];
+		TdsColumnSendPlan  *cp = &plan->cols[attno];
+
+		cp->nullable = (col->metaEntry.type1.flags & TDS_COLMETA_NULLABLE) != 0;
+		cp->nullLen = GetNullLenForColumn(col);
+		cp->sendLength = !col->attNotNull;
+
+		/*
+		 * Pick a specialized encoder for fixed-width types.  These must
+		 * produce exactly what the corresponding TdsSendType* function
+		 * would have sent.
+		 */
+		if (col->sendFunc == TdsSendTypeBit)
+		{
+			cp->encoder = TDS_ROW_ENCODER_BIT;
+			cp->valueLen = TDS_MAXLEN_BIT;
+		}
+		else if (col->sendFunc == TdsSendTypeTinyint)
+		{
+			cp->encoder = TDS_ROW_ENCODER_TINYINT;
+			cp->valueLen = TDS_MAXLEN_TINYINT;
+		}
+		else if (col->sendFunc == TdsSendTypeSmallint)
+		{
+			cp->encoder = TDS_ROW_ENCODER_SMALLINT;
+			cp->valueLen = TDS_MAXLEN_SMALLINT;
+		}
+		else if (col->sendFunc == TdsSendTypeInteger)
+		{
+			cp->encoder = TDS_ROW_ENCODER_INTEGER;
+			cp->valueLen = TDS_MAXLEN_INT;
+		}
+		else if (col->sendFunc == TdsSendTypeBigint)
+		{
+			cp->encoder = TDS_ROW_ENCODER_BIGINT;
+			cp->valueLen = TDS_MAXLEN_BIGINT;
+		}
+		else if (col->sendFunc == TdsSendTypeFloat4)
+		{
+			cp->encoder = TDS_ROW_ENCODER_FLOAT4;
+			cp->valueLen = TDS_MAXLEN_FLOAT4;
+		}
+		else if (col->sendFunc == TdsSendTypeFloat8)
+		{
+			cp->encoder = TDS_ROW_ENCODER_FLOAT8;
+			cp->valueLen = TDS_MAXLEN_FLOAT8;
+		}
+		else if (col->sendFunc == TdsSendTypeDate &&
+				 tdsVersion >= TDS_VERSION_7_3_A)
+		{
+			/* DATE is always sent with its length */
+			cp->encoder = TDS_ROW_ENCODER_DATE;
+			cp->valueLen = 3;
+			cp->sendLength = true;
+		}
+		else
+			cp->encoder = TDS_ROW_ENCODER_GENERIC;
+	}
+
+	/* Group consecutive fixed-width columns into runs */
+	attno = 0;
+	while (attno < natts)
+	{
+		TdsColumnSendPlan  *start = &plan->cols[attno];
+		int					runLen = 0;
+		int					next;
+
+		if (start->encoder == TDS_ROW_ENCODER_GENERIC)
+		{
+			attno++;
+			continue;
+		}
+
+		for (next = attno; next < natts; next++)
+		{
+			TdsColumnSendPlan  *cp = &plan->cols[next];
+
+			if (cp->encoder == TDS_ROW_ENCODER_GENERIC)
+				break;
+			runLen += Max(cp->valueLen + (cp->sendLength ? 1 : 0), cp->nullLen);
+		}
+
+		start->runEnd = next;
+		start->runLen = runLen;
+		maxRunLen = Max(maxRunLen, runLen);
+		attno = next;
+	}
+
+	if (maxRunLen > 0)
+		plan->stage = palloc(maxRunLen);
+
+	sendPlan = plan;
+}
+
+/*
+ * EncodeFixedWidthRun - send the group of fixed-width columns starting at
+ * attno.  Returns the attno just past the group.
+ *
+ * The values are written in place into the send buffer if the current packet
+ * has enough room for the whole group, otherwise they are staged and copied
+ * with a single TdsPutbytes() call.
+ */
+static int
+EncodeFixedWidthRun(TdsSendPlan *plan, TupleTableSlot *slot, int attno, bool nbcRow)
+{
+	TdsColumnSendPlan  *start = &plan->cols[attno];
+	char			   *buf;
+	char			   *ptr;
+	bool				inPlace;
+
+	buf = TdsGetSendBufferSpace(start->runLen);
+	inPlace = (buf != NULL);
+	if (!inPlace)
+		buf = plan->stage;
+	ptr = buf;
+
+	for (; attno < start->runEnd; attno++)
+	{
+		TdsColumnSendPlan  *cp = &plan->cols[attno];
+		Datum				value = slot->tts_values[attno];
+
+		if (slot->tts_isnull[attno])
+		{
+			/* NULLs are sent using the NULL bitmap only for NBCROW */
+			if (!nbcRow)
+			{
+				Assert(cp->nullLen == 1);
+				*ptr++ = 0;
+			}
+			continue;
+		}
+
+		if (cp->sendLength)
+			*ptr++ = (char) cp->valueLen;
+
+		switch (cp->encoder)
+		{
+			case TDS_ROW_ENCODER_BIT:
+				*ptr = (char) DatumGetBool(value);
+				break;
+			case TDS_ROW_ENCODER_TINYINT:
+				*ptr = (char) DatumGetUInt8(value);
+				break;
+			case TDS_ROW_ENCODER_SMALLINT:
+				{
+					int16_t		tmp = htoLE16(DatumGetInt16(value));
+
+					memcpy(ptr, &tmp, sizeof(tmp));
+				}
+				break;
+			case TDS_ROW_ENCODER_INTEGER:
+				{
+					int32_t		tmp = htoLE32(DatumGetInt32(value));
+
+					memcpy(ptr, &tmp, sizeof(tmp));
+				}
+				break;
+			case TDS_ROW_ENCODER_BIGINT:
+				{
+					int64_t		tmp = htoLE64(DatumGetInt64(value));
+
+					memcpy(ptr, &tmp, sizeof(tmp));
+				}
+				break;
+			case TDS_ROW_ENCODER_FLOAT4:
+				{
+					union
+					{
+						float4		f;
+						int32		i;
+					}			swap;
+
+					swap.f = DatumGetFloat4(value);
+					swap.i = htoLE32(swap.i);
+					memcpy(ptr, &swap.i, sizeof(swap.i));
+				}
+				break;
+			case TDS_ROW_ENCODER_FLOAT8:
+				{
+					union
+					{
+						float8		f;
+						int64		i;
+					}			swap;
+
+					swap.f = DatumGetFloat8(value);
+					swap.i = htoLE64(swap.i);
+					memcpy(ptr, &swap.i, sizeof(swap.i));
+				}
+				break;
+			case TDS_ROW_ENCODER_DATE:
+				{
+					/* DATE is a 24-bit unsigned integer in LITTLE_ENDIAN */
+					uint32_t	tmp = htoLE32(TdsDayDifference(value));
+
+					memcpy(ptr, &tmp, 3);
+				}
+				break;
+			default:
+				elog(ERROR, "unexpected row encoder %d", cp->encoder);
+		}
+		ptr += cp->valueLen;
+	}
+
+	if (inPlace)
+		TdsAdvanceSendBuffer(ptr - buf);
+	else
+		TdsPutbytes(buf, ptr - buf);
+
+	return attno;
+}
+
 bool
 TdsPrintTup(TupleTableSlot *slot, DestReceiver *self)
 {
@@ -2375,10 +2736,7 @@ TdsPrintTup(TupleTableSlot *slot, DestReceiver *self)
 	uint8_t			rowToken;
 	TDSRequest              request = TdsRequestCtrl->request;
 	bool			sendRowStat = false;
-	int 			nullMapSize = 0;
-	int 			simpleRowSize = 0;
-	uint32_t		tdsVersion = GetClientTDSVersion();
-	uint8_t		   *nullMap = NULL;
+	TdsSendPlan	   *plan = sendPlan;
 
 	TdsErrorContext->err_text = "Writing the Tds response to the socket";
 	if (request->reqType == TDS_REQUEST_SP_NUMBER)
@@ -2390,6 +2748,8 @@ TdsPrintTup(TupleTableSlot *slot, DestReceiver *self)
 			sendRowStat = true;
 	}
 
+	Assert(plan != NULL && plan->natts == natts);
+
 	/* Set or update my derived attribute info, if needed */
 	if (myState->attrinfo != typeinfo || myState->nattrs != natts)
 		PrintTupPrepareInfo(myState, typeinfo, natts);
@@ -2400,82 +2760,32 @@ TdsPrintTup(TupleTableSlot *slot, DestReceiver *self)
 	/* Switch into per-row context so we can recover memory below */
 	oldContext = MemoryContextSwitchTo(myState->tmpcontext);
 
-	if (tdsVersion >= TDS_VERSION_7_3_B)
+	if (plan->nbcRowAllowed)
 	{
+		int		simpleRowSize = 0;
+
 		/*
-		 * NBCROW token was introduced in TDS version 7.3B.
 		 * Determine the row type we send. For rows that don't contain any
 		 * NULL values in variable size columns (like NVARCHAR) we can send
 		 * the simple ROW (0xD1) format. Rows that do (specifically
 		 * NVARCHAR/VARCHAR/CHAR/NCHAR/BINARY datatypes) need to be sent as
-		 * NBCROW (0xD2). Count the number of nullable columns and build the
-		 * null bitmap just in case while we are at it.
+		 * NBCROW (0xD2). Count the bytes the NULLs would take in a ROW token
+		 * and build the null bitmap just in case while we are at it.
 		 */
-		nullMapSize = (natts + 7) / 8;
-		nullMap = palloc0(nullMapSize);
-		MemSet(nullMap, 0, nullMapSize * sizeof(int8_t));
+		MemSet(plan->nullMap, 0, plan->nullMapSize);
 		for (attno = 0; attno < natts; attno++)
 		{
-			TdsColumnMetaData  *col = &colMetaData[attno];
-
-			if (col->metaEntry.type1.flags & TDS_COLMETA_NULLABLE)
+			if (plan->cols[attno].nullable && slot->tts_isnull[attno])
 			{
-				if (slot->tts_isnull[attno])
-				{
-					nullMap[attno / 8] |= (0x01 << (attno & 0x07));
-					switch (col->metaEntry.type1.tdsTypeId)
-					{
-						case TDS_TYPE_VARCHAR:
-						case TDS_TYPE_NVARCHAR:
-							if (col->metaEntry.type2.maxSize == 0xffff)
-								/* 
-								 * To send NULL for VARCHAR(max) or NVARCHAR(max),
-								 * we have to indicate it using 0xffffffffffffffff (PLP_NULL)
-								 */
-								simpleRowSize += 8;
-							else
-								/* 
-								 * For regular case of VARCHAR/NVARCHAR, 
-								 * we have to send 0xffff (CHARBIN_NULL) to indicate NULL
-								 */
-								simpleRowSize += 2;
-							break;
-						case TDS_TYPE_VARBINARY:
-							if (col->metaEntry.type7.maxSize == 0xffff)
-								/* To send NULL for VARBINARY(max),we have to indicate it using 0xffffffffffffffff (PLP_NULL) */
-								simpleRowSize += 8;
-							else
-								/* For regular case of VARBINARY,we have to send 0xffff (CHARBIN_NULL) to indicate NULL */
-								simpleRowSize += 2;
-							break;
-						case TDS_TYPE_CHAR:
-						case TDS_TYPE_NCHAR:
-						case TDS_TYPE_XML:
-						case TDS_TYPE_BINARY:
-							/* For these datatypes, we need to send 0xffff (CHARBIN_NULL) to indicate NULL */
-							simpleRowSize += 2;
-							break;
-						case TDS_TYPE_SQLVARIANT:
-							/* For sql_variant, we need to send 0x00000000 to indicate NULL */
-							simpleRowSize += 4;
-							break;
-						default:
-							/* for other datatypes, we need to send 0x00 (1 byte) only */
-							simpleRowSize += 1;
-							break;
-					}
-				}
+				plan->nullMap[attno / 8] |= (0x01 << (attno & 0x07));
+				simpleRowSize += plan->cols[attno].nullLen;
 			}
 		}
 
-		if (nullMapSize < simpleRowSize)
-		{
+		if (plan->nullMapSize < simpleRowSize)
 			rowToken = TDS_TOKEN_NBCROW;
-		}
 		else
-		{
 			rowToken = TDS_TOKEN_ROW;
-		}
 	}
 	else
 		/* ROW is only token to send data for TDS version lower or equal to 7.3A. */
@@ -2486,70 +2796,35 @@ TdsPrintTup(TupleTableSlot *slot, DestReceiver *self)
 
 	if (rowToken == TDS_TOKEN_NBCROW)
 	{
-		TdsPutbytes(nullMap, nullMapSize);
+		TdsPutbytes(plan->nullMap, plan->nullMapSize);
 		TDSInstrumentation(INSTR_TDS_TOKEN_NBCROW);
 	}
 
-	if (nullMap != NULL)
-		pfree(nullMap);
-
 	/* And finally send the actual column values */
-	for (attno = 0; attno < natts; attno++)
+	attno = 0;
+	while (attno < natts)
 	{
 		PrinttupAttrInfo   *thisState;
 		Datum				attr;
 		TdsColumnMetaData  *col = &colMetaData[attno];
 
+		/* Fixed-width groups are encoded in one go */
+		if (plan->cols[attno].runLen > 0)
+		{
+			attno = EncodeFixedWidthRun(plan, slot, attno,
+										rowToken == TDS_TOKEN_NBCROW);
+			continue;
+		}
+
 		if (slot->tts_isnull[attno])
 		{
-			/* Handle NULL values */
-			/* when NBCROW token is used, all NULL values are
-			 * sent using NULL bitmap only
+			/*
+			 * Handle NULL values.  When NBCROW token is used, all NULL values
+			 * are sent using NULL bitmap only.
 			 */
 			if (rowToken == TDS_TOKEN_ROW)
-			{
-				switch (col->metaEntry.type1.tdsTypeId)
-				{
-					case TDS_TYPE_VARCHAR:
-					case TDS_TYPE_NVARCHAR:
-						if (col->metaEntry.type2.maxSize == 0xffff)
-							/* 
-							 * To send NULL for VARCHAR(max) or NVARCHAR(max),
-							 * we have to indicate it using 0xffffffffffffffff (PLP_NULL)
-							 */
-							TdsPutUInt64LE(0xffffffffffffffff);
-						else
-							/* 
-							 * For regular case of VARCHAR/NVARCHAR, 
-							 * we have to send 0xffff (CHARBIN_NULL) to indicate NULL
-							 */
-							TdsPutInt16LE(0xffff);
-						break;
-					case TDS_TYPE_VARBINARY:
-						if (col->metaEntry.type7.maxSize == 0xffff)
-							/* To send NULL for VARBINARY(max),we have to indicate it using 0xffffffffffffffff (PLP_NULL) */
-							TdsPutUInt64LE(0xffffffffffffffff);
-						else
-							/* For regular case of VARBINARY,we have to send 0xffff (CHARBIN_NULL) to indicate NULL */
-							TdsPutInt16LE(0xffff);
-						break;
-					case TDS_TYPE_CHAR:
-					case TDS_TYPE_NCHAR:
-					case TDS_TYPE_XML:
-					case TDS_TYPE_BINARY:
-						/* In case of TDS version lower than or equal to 7.3A, we need to send 0xffff (CHARBIN_NULL)*/
-						TdsPutInt16LE(0xffff);
-						break;
-					case TDS_TYPE_SQLVARIANT:
-						/* For sql_variant, we need to send 0x00000000 to indicate NULL */
-						TdsPutInt32LE(0);
-						break;
-					default:
-						/* for these datatypes, we need to send 0x00 (1 byte) only */
-						TdsPutUInt8(0);
-						break;
-				}
-			}
+				SendNullForColumn(col);
+			attno++;
 			continue;
 		}
 
@@ -2569,6 +2844,7 @@ TdsPrintTup(TupleTableSlot *slot, DestReceiver *self)
 
 		/* Call the type specific output function */
 		(col->sendFunc)(&thisState->finfo, attr, (void *)col);
+		attno++;
 	}
 
 	/*
@@ -2600,6 +2876,18 @@ TdsPrintTupShutdown(void)
 {
 	pfree(colMetaData);
 	colMetaData = NULL;
+
+	if (sendPlan != NULL)
+	{
+		if (sendPlan->nullMap)
+			pfree(sendPlan->nullMap);
+		if (sendPlan->stage)
+			pfree(sendPlan->stage);
+		if (sendPlan->cols)
+			pfree(sendPlan->cols);
+		pfree(sendPlan);
+		sendPlan = NULL;
+	}
 }
 
 /* --------------------------------
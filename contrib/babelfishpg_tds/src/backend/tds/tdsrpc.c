@@ -514,9 +514,12 @@ SPExecuteSQL(TDSRequestSP req)
 	fcinfo->args[0].value = PointerGetDatum(codeblock);
 	fcinfo->args[0].isnull = false;
 
-	/* declare variables if there is any */
-	if (req->nTotalParams > 0)
-		DeclareVariables(req, &fcinfo, 0);
+	/*
+	 * Declare variables if there is any.  The args are passed even without
+	 * parameters so that the compiled batch can be reused by the next
+	 * sp_executesql with the same text.
+	 */
+	DeclareVariables(req, &fcinfo, BATCH_OPTION_REUSE_BATCH);
 
 	TDSStatementBeginCallback(NULL, NULL);
 
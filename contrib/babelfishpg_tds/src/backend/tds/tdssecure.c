@@ -431,3 +431,51 @@ retry:
 
 	return n;
 }
+
+/*
+ *	Write a gather list to a plain connection.
+ *
+ *	Only used for non-TLS connections, TLS has to go through
+ *	tds_secure_write() to get the data encrypted.
+ */
+ssize_t
+tds_secure_writev(Port *port, struct iovec *iov, int iovcnt)
+{
+	ssize_t		n;
+
+	Assert(!port->ssl_in_use);
+
+	/* Deal with any already-pending interrupt condition. */
+	ProcessClientWriteInterrupt(false);
+
+retry:
+	n = writev(port->sock, iov, iovcnt);
+
+	if (n < 0 && !port->noblock && (errno == EWOULDBLOCK || errno == EAGAIN))
+	{
+		WaitEvent	event;
+
+		ModifyWaitEvent(FeBeWaitSet, 0, WL_SOCKET_WRITEABLE, NULL);
+
+		WaitEventSetWait(FeBeWaitSet, -1 /* no timeout */ , &event, 1,
+						 WAIT_EVENT_CLIENT_WRITE);
+
+		/* See comments in secure_read. */
+		if (event.events & WL_POSTMASTER_DEATH)
+			ereport(FATAL,
+					(errcode(ERRCODE_ADMIN_SHUTDOWN),
+					 errmsg("terminating connection due to unexpected postmaster exit")));
+
+		/* Handle interrupt. */
+		if (event.events & WL_LATCH_SET)
+		{
+			ResetLatch(MyLatch);
+			ProcessClientWriteInterrupt(true);
+		}
+		goto retry;
+	}
+
+	ProcessClientWriteInterrupt(false);
+
+	return n;
+}
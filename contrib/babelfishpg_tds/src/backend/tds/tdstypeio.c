@@ -2347,7 +2347,7 @@ TdsSendPlpDataHelper(char *data, int len)
 			// need testing for "0" len
 			if ((rc = TdsPutUInt32LE(plpChunckLen)) == 0)
 			{
-				TdsPutbytes(&(data[tempOffset]), plpChunckLen);
+				rc = TdsPutbytesZeroCopy(&(data[tempOffset]), plpChunckLen);
 			}
 			if (rc != 0)
 				return rc;
@@ -35,6 +35,15 @@
 #include "miscadmin.h"
 #include "utils/builtins.h"
 
+#include "../babelfishpg_common/src/encoding/utf16_simd.h"
+
+/*
+ * The bulk transcoders work through their input in chunks of this size, so
+ * that converting a large value does not need an output buffer sized for the
+ * worst case all at once.
+ */
+#define TDS_TRANSCODE_CHUNK_SIZE	(64 * 1024)
+
 static int FindMatchingParam(List *params, const char *name);
 static Node * TransformParamRef(ParseState *pstate, ParamRef *pref);
 Node * TdsFindParam(ParseState *pstate, ColumnRef *cref);
@@ -326,9 +335,28 @@ TdsUTF16toUTF8StringInfo(StringInfo out, void *vin, int len)
 
 	for (i = 0; i < len;)
 	{
-		code = GetUTF16CodePoint(&in[i], len - i, &consumed);
-		AddUTF8ToStringInfo(code, out);
-		i += consumed;
+		int		chunk = Min(len - i, TDS_TRANSCODE_CHUNK_SIZE);
+		size_t	converted;
+		size_t	written;
+
+		/* Convert as much as the kernels take straight into the buffer */
+		enlargeStringInfo(out, chunk / 2 * 3);
+		converted = utf16le_to_utf8(&in[i], chunk, (uint8_t *) out->data + out->len,
+									&written);
+		out->len += written;
+		out->data[out->len] = '\0';
+		i += converted;
+
+		/*
+		 * If they stopped short, take one step the slow way.  This either
+		 * copes with what stopped them or throws the error.
+		 */
+		if (converted < chunk)
+		{
+			code = GetUTF16CodePoint(&in[i], len - i, &consumed);
+			AddUTF8ToStringInfo(code, out);
+			i += consumed;
+		}
 	}
 }
 
@@ -346,9 +374,28 @@ TdsUTF8toUTF16StringInfo(StringInfo out, const void *vin, size_t len)
 
 	for (i = 0; i < len;)
 	{
-		code = GetUTF8CodePoint(&in[i], len - i, &consumed);
-		AddUTF16ToStringInfo(code, out);
-		i += consumed;
+		size_t	chunk = Min(len - i, TDS_TRANSCODE_CHUNK_SIZE);
+		size_t	converted;
+		size_t	written;
+
+		/* Convert as much as the kernels take straight into the buffer */
+		enlargeStringInfo(out, chunk * 2);
+		converted = utf8_to_utf16le(&in[i], chunk, (uint8_t *) out->data + out->len,
+									&written);
+		out->len += written;
+		out->data[out->len] = '\0';
+		i += converted;
+
+		/*
+		 * If they stopped short, take one step the slow way.  This either
+		 * copes with what stopped them or throws the error.
+		 */
+		if (converted < chunk)
+		{
+			code = GetUTF8CodePoint(&in[i], len - i, &consumed);
+			AddUTF16ToStringInfo(code, out);
+			i += consumed;
+		}
 	}
 }
 
@@ -368,6 +415,15 @@ TdsUTF8LengthInUTF16(const void *vin, int len)
 
 	for (i = 0; i < len;)
 	{
+		size_t		units;
+
+		/* Count as much as the kernels take in one go */
+		i += utf8_length_in_utf16(&in[i], len - i, &units);
+		result += units;
+		if (i >= len)
+			break;
+
+		/* And take one step the slow way over what stopped them */
 		code = GetUTF8CodePoint(&in[i], len - i, &consumed);
 
 		/* Check that this is a valid code point */
@@ -24,5 +24,7 @@ extern int tds_default_numeric_scale;
 extern int32_t tds_default_protocol_version;
 extern int32_t tds_default_packet_size;
 extern int tds_debug_log_level;
+extern int tds_zero_copy_threshold;
+extern int tds_read_ahead_size;
 extern char *default_server_name;
 extern bool enable_drop_babelfish_role;
\ No newline at end of file
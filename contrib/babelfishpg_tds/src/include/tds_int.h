@@ -259,6 +259,7 @@ extern int TdsSocketFlush(void);
 extern int TdsGetbytes(char *s, size_t len);
 extern int TdsDiscardbytes(size_t len);
 extern int TdsPutbytes(void *s, size_t len);
+extern int TdsPutbytesZeroCopy(void *s, size_t len);
 extern int TdsPutInt8(int8_t value);
 extern int TdsPutUInt8(uint8_t value);
 extern int TdsPutInt16LE(int16_t value);
@@ -279,6 +280,8 @@ extern int TdsTestProtocol(void);
 extern int TdsPutUInt16LE(uint16_t value);
 extern int TdsPutUInt64LE(uint64_t value);
 extern int TdsPutDate(uint32_t value);
+extern char *TdsGetSendBufferSpace(size_t len);
+extern void TdsAdvanceSendBuffer(size_t len);
 extern bool TdsGetRecvPacketEomStatus(void);
 
 /* Functions in backend/tds/tdslogin.c */
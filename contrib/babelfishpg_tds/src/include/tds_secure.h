@@ -14,6 +14,8 @@
  */
 #include "postgres.h"
 
+#include <sys/uio.h>
+
 #ifdef HAVE_NETINET_TCP_H
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
@@ -56,6 +58,8 @@ ssize_t
 tds_secure_read(Port *port, void *ptr, size_t len);
 ssize_t
 tds_secure_write(Port *port, void *ptr, size_t len);
+ssize_t
+tds_secure_writev(Port *port, struct iovec *iov, int iovcnt);
 
 /* function defined in tdssecure.c and called from tdslogin.c */
 void TdsFreeSslStruct(Port *port);
@@ -11,6 +11,38 @@ RETURNS ntext
 AS 'babelfishpg_tsql', 'tsql_query_to_xml_text'
 LANGUAGE C IMMUTABLE STRICT COST 100;
 
+CREATE OR REPLACE FUNCTION sys.tsql_select_for_xml_sfunc(state internal, rowval anyelement, mode int,
+           element_name text, binary_base64 boolean, root_name text)
+RETURNS internal
+AS 'babelfishpg_tsql', 'tsql_select_for_xml_sfunc'
+LANGUAGE C IMMUTABLE COST 100;
+
+CREATE OR REPLACE FUNCTION sys.tsql_select_for_xml_finalfunc(state internal)
+RETURNS xml
+AS 'babelfishpg_tsql', 'tsql_select_for_xml_finalfunc'
+LANGUAGE C IMMUTABLE COST 100;
+
+CREATE OR REPLACE FUNCTION sys.tsql_select_for_xml_text_finalfunc(state internal)
+RETURNS ntext
+AS 'babelfishpg_tsql', 'tsql_select_for_xml_text_finalfunc'
+LANGUAGE C IMMUTABLE COST 100;
+
+CREATE OR REPLACE AGGREGATE sys.tsql_select_for_xml_agg(rowval anyelement, mode int,
+           element_name text, binary_base64 boolean, root_name text)
+(
+	sfunc = sys.tsql_select_for_xml_sfunc,
+	stype = internal,
+	finalfunc = sys.tsql_select_for_xml_finalfunc
+);
+
+CREATE OR REPLACE AGGREGATE sys.tsql_select_for_xml_text_agg(rowval anyelement, mode int,
+           element_name text, binary_base64 boolean, root_name text)
+(
+	sfunc = sys.tsql_select_for_xml_sfunc,
+	stype = internal,
+	finalfunc = sys.tsql_select_for_xml_text_finalfunc
+);
+
 -- Helper function to support the FOR JSON clause
 CREATE OR REPLACE FUNCTION sys.tsql_query_to_json_text(query text, mode int, include_null_value boolean,
            without_array_wrappers boolean, root_name text)
@@ -18,6 +50,26 @@ RETURNS sys.NVARCHAR(4000)
 AS 'babelfishpg_tsql', 'tsql_query_to_json_text'
 LANGUAGE C IMMUTABLE COST 100;
 
+CREATE OR REPLACE FUNCTION sys.tsql_select_for_json_sfunc(state internal, rowval anyelement, mode int,
+           include_null_value boolean, without_array_wrappers boolean, root_name text)
+RETURNS internal
+AS 'babelfishpg_tsql', 'tsql_select_for_json_sfunc'
+LANGUAGE C IMMUTABLE COST 100;
+
+CREATE OR REPLACE FUNCTION sys.tsql_select_for_json_finalfunc(state internal)
+RETURNS sys.NVARCHAR
+AS 'babelfishpg_tsql', 'tsql_select_for_json_finalfunc'
+LANGUAGE C IMMUTABLE COST 100;
+
+CREATE OR REPLACE AGGREGATE sys.tsql_select_for_json_agg(rowval anyelement, mode int,
+           include_null_value boolean, without_array_wrappers boolean, root_name text)
+(
+	sfunc = sys.tsql_select_for_json_sfunc,
+	stype = internal,
+	finalfunc = sys.tsql_select_for_json_finalfunc,
+	finalfunc_modify = read_write
+);
+
 -- User and Login Functions
 CREATE OR REPLACE FUNCTION sys.user_name(IN id OID DEFAULT NULL)
 RETURNS sys.NVARCHAR(128)
@@ -3297,3 +3349,49 @@ END;
 $BODY$
 LANGUAGE plpgsql;
 GRANT EXECUTE ON FUNCTION sys.INDEXPROPERTY(IN object_id INT, IN index_or_statistics_name sys.nvarchar(128),  IN property sys.varchar(128)) TO PUBLIC;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_batch_cache_stats(OUT hits BIGINT, OUT misses BIGINT, OUT evictions BIGINT,
+														   OUT invalidations BIGINT, OUT entries INT, OUT bytes BIGINT)
+RETURNS RECORD
+AS 'babelfishpg_tsql', 'babelfish_batch_cache_stats' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_prepared_batch_stats(OUT handles INT, OUT compiled INT, OUT bytes BIGINT,
+															  OUT evictions BIGINT, OUT reprepares BIGINT)
+RETURNS RECORD
+AS 'babelfishpg_tsql', 'babelfish_prepared_batch_stats' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_prepared_statements(OUT dbid SMALLINT, OUT userid OID, OUT query_hash BIGINT,
+															 OUT query_text TEXT, OUT parameters TEXT, OUT prepares BIGINT,
+															 OUT executions BIGINT, OUT total_elapsed_ms FLOAT8,
+															 OUT min_elapsed_ms FLOAT8, OUT max_elapsed_ms FLOAT8)
+RETURNS SETOF RECORD
+AS 'babelfishpg_tsql', 'babelfish_prepared_statements' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_prepared_statements_prewarm(IN max_statements INT DEFAULT NULL)
+RETURNS INT
+AS 'babelfishpg_tsql', 'babelfish_prepared_statements_prewarm' LANGUAGE C VOLATILE;
+GRANT EXECUTE ON FUNCTION sys.babelfish_prepared_statements_prewarm(INT) TO PUBLIC;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_expression_stats(OUT object_id OID, OUT simple_evals BIGINT, OUT spi_evals BIGINT)
+RETURNS SETOF RECORD
+AS 'babelfishpg_tsql', 'babelfish_expression_stats' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_applock_partition_stats(OUT partition_id INT, OUT entries INT, OUT acquisitions BIGINT, OUT contended BIGINT)
+RETURNS SETOF RECORD
+AS 'babelfishpg_tsql', 'babelfish_applock_partition_stats' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_statement_stats(OUT object_id OID, OUT line_number INT, OUT execution_count BIGINT,
+														 OUT total_elapsed_us BIGINT, OUT min_elapsed_us BIGINT, OUT max_elapsed_us BIGINT,
+														 OUT total_rows BIGINT)
+RETURNS SETOF RECORD
+AS 'babelfishpg_tsql', 'babelfish_statement_stats' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_statement_stats_reset()
+RETURNS VOID
+AS 'babelfishpg_tsql', 'babelfish_statement_stats_reset' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_parser_stats(OUT warmup_batches BIGINT, OUT warmup_ms FLOAT8, OUT batches BIGINT,
+													  OUT first_batch_ms FLOAT8, OUT last_batch_ms FLOAT8, OUT max_batch_ms FLOAT8,
+													  OUT avg_warm_batch_ms FLOAT8, OUT sll_batches BIGINT, OUT ll_fallbacks BIGINT)
+RETURNS RECORD
+AS 'babelfishpg_tsql', 'babelfish_parser_stats' LANGUAGE C VOLATILE;
@@ -2828,3 +2828,98 @@ SELECT
 FROM sys.events e
 WHERE e.is_trigger_event = 1;
 GRANT SELECT ON sys.trigger_events TO PUBLIC;
+
+CREATE OR REPLACE VIEW sys.dm_exec_batch_cache_stats
+AS
+SELECT
+  CAST(s.hits AS BIGINT) AS hits,
+  CAST(s.misses AS BIGINT) AS misses,
+  CAST(s.evictions AS BIGINT) AS evictions,
+  CAST(s.invalidations AS BIGINT) AS invalidations,
+  CAST(s.entries AS INT) AS entries,
+  CAST(s.bytes AS BIGINT) AS bytes
+FROM sys.babelfish_batch_cache_stats() s;
+GRANT SELECT ON sys.dm_exec_batch_cache_stats TO PUBLIC;
+
+CREATE OR REPLACE VIEW sys.dm_exec_prepared_batch_stats
+AS
+SELECT
+  CAST(s.handles AS INT) AS handles,
+  CAST(s.compiled AS INT) AS compiled,
+  CAST(s.bytes AS BIGINT) AS bytes,
+  CAST(s.evictions AS BIGINT) AS evictions,
+  CAST(s.reprepares AS BIGINT) AS reprepares
+FROM sys.babelfish_prepared_batch_stats() s;
+GRANT SELECT ON sys.dm_exec_prepared_batch_stats TO PUBLIC;
+
+CREATE OR REPLACE VIEW sys.dm_exec_prepared_statements
+AS
+SELECT
+  CAST(s.dbid AS INT) AS database_id,
+  CAST(r.rolname AS sys.sysname) AS user_name,
+  CAST(s.query_hash AS BIGINT) AS query_hash,
+  CAST(s.query_text AS sys.nvarchar(4000)) AS query_text,
+  CAST(s.parameters AS sys.nvarchar(4000)) AS parameters,
+  CAST(s.prepares AS BIGINT) AS prepares,
+  CAST(s.executions AS BIGINT) AS executions,
+  CAST(s.total_elapsed_ms AS FLOAT) AS total_elapsed_ms,
+  CAST(s.min_elapsed_ms AS FLOAT) AS min_elapsed_ms,
+  CAST(s.max_elapsed_ms AS FLOAT) AS max_elapsed_ms
+FROM sys.babelfish_prepared_statements() s
+LEFT JOIN pg_catalog.pg_roles r ON r.oid = s.userid;
+GRANT SELECT ON sys.dm_exec_prepared_statements TO PUBLIC;
+
+CREATE OR REPLACE VIEW sys.dm_exec_expression_stats
+AS
+SELECT
+  CAST(NULLIF(s.object_id, 0) AS INT) AS object_id,
+  CAST(p.proname AS sys.sysname) AS object_name,
+  CAST(s.simple_evals AS BIGINT) AS simple_evals,
+  CAST(s.spi_evals AS BIGINT) AS spi_evals,
+  CAST(CASE WHEN s.simple_evals + s.spi_evals = 0 THEN 0
+       ELSE CAST(s.simple_evals AS FLOAT8) / (s.simple_evals + s.spi_evals) END AS FLOAT) AS simple_ratio
+FROM sys.babelfish_expression_stats() s
+LEFT JOIN pg_catalog.pg_proc p ON p.oid = s.object_id;
+GRANT SELECT ON sys.dm_exec_expression_stats TO PUBLIC;
+
+CREATE OR REPLACE VIEW sys.dm_os_applock_partition_stats
+AS
+SELECT
+  CAST(s.partition_id AS INT) AS partition_id,
+  CAST(s.entries AS INT) AS resource_count,
+  CAST(s.acquisitions AS BIGINT) AS acquisitions,
+  CAST(s.contended AS BIGINT) AS contended,
+  CAST(CASE WHEN s.acquisitions = 0 THEN 0
+       ELSE CAST(s.contended AS FLOAT8) / s.acquisitions END AS FLOAT) AS contended_ratio
+FROM sys.babelfish_applock_partition_stats() s;
+GRANT SELECT ON sys.dm_os_applock_partition_stats TO PUBLIC;
+
+CREATE OR REPLACE VIEW sys.dm_exec_statement_stats
+AS
+SELECT
+  CAST(s.object_id AS INT) AS object_id,
+  CAST(p.proname AS sys.sysname) AS object_name,
+  CAST(s.line_number AS INT) AS line_number,
+  CAST(s.execution_count AS BIGINT) AS execution_count,
+  CAST(s.total_elapsed_us AS BIGINT) AS total_elapsed_time,
+  CAST(s.min_elapsed_us AS BIGINT) AS min_elapsed_time,
+  CAST(s.max_elapsed_us AS BIGINT) AS max_elapsed_time,
+  CAST(s.total_rows AS BIGINT) AS total_rows
+FROM sys.babelfish_statement_stats() s
+LEFT JOIN pg_catalog.pg_proc p ON p.oid = s.object_id;
+GRANT SELECT ON sys.dm_exec_statement_stats TO PUBLIC;
+
+CREATE OR REPLACE VIEW sys.dm_exec_parser_stats
+AS
+SELECT
+  CAST(s.warmup_batches AS BIGINT) AS warmup_batches,
+  CAST(s.warmup_ms AS FLOAT) AS warmup_ms,
+  CAST(s.batches AS BIGINT) AS batches,
+  CAST(s.first_batch_ms AS FLOAT) AS first_batch_ms,
+  CAST(s.last_batch_ms AS FLOAT) AS last_batch_ms,
+  CAST(s.max_batch_ms AS FLOAT) AS max_batch_ms,
+  CAST(s.avg_warm_batch_ms AS FLOAT) AS avg_warm_batch_ms,
+  CAST(s.sll_batches AS BIGINT) AS sll_batches,
+  CAST(s.ll_fallbacks AS BIGINT) AS ll_fallbacks
+FROM sys.babelfish_parser_stats() s;
+GRANT SELECT ON sys.dm_exec_parser_stats TO PUBLIC;
@@ -3672,6 +3672,59 @@ RETURNS sys.NVARCHAR(4000)
 AS 'babelfishpg_tsql', 'tsql_query_to_json_text'
 LANGUAGE C IMMUTABLE COST 100;
 
+CREATE OR REPLACE FUNCTION sys.tsql_select_for_json_sfunc(state internal, rowval anyelement, mode int,
+           include_null_value boolean, without_array_wrappers boolean, root_name text)
+RETURNS internal
+AS 'babelfishpg_tsql', 'tsql_select_for_json_sfunc'
+LANGUAGE C IMMUTABLE COST 100;
+
+CREATE OR REPLACE FUNCTION sys.tsql_select_for_json_finalfunc(state internal)
+RETURNS sys.NVARCHAR
+AS 'babelfishpg_tsql', 'tsql_select_for_json_finalfunc'
+LANGUAGE C IMMUTABLE COST 100;
+
+CREATE OR REPLACE AGGREGATE sys.tsql_select_for_json_agg(rowval anyelement, mode int,
+           include_null_value boolean, without_array_wrappers boolean, root_name text)
+(
+	sfunc = sys.tsql_select_for_json_sfunc,
+	stype = internal,
+	finalfunc = sys.tsql_select_for_json_finalfunc,
+	finalfunc_modify = read_write
+);
+
+-- Helper aggregates to support the FOR XML clause
+CREATE OR REPLACE FUNCTION sys.tsql_select_for_xml_sfunc(state internal, rowval anyelement, mode int,
+           element_name text, binary_base64 boolean, root_name text)
+RETURNS internal
+AS 'babelfishpg_tsql', 'tsql_select_for_xml_sfunc'
+LANGUAGE C IMMUTABLE COST 100;
+
+CREATE OR REPLACE FUNCTION sys.tsql_select_for_xml_finalfunc(state internal)
+RETURNS xml
+AS 'babelfishpg_tsql', 'tsql_select_for_xml_finalfunc'
+LANGUAGE C IMMUTABLE COST 100;
+
+CREATE OR REPLACE FUNCTION sys.tsql_select_for_xml_text_finalfunc(state internal)
+RETURNS ntext
+AS 'babelfishpg_tsql', 'tsql_select_for_xml_text_finalfunc'
+LANGUAGE C IMMUTABLE COST 100;
+
+CREATE OR REPLACE AGGREGATE sys.tsql_select_for_xml_agg(rowval anyelement, mode int,
+           element_name text, binary_base64 boolean, root_name text)
+(
+	sfunc = sys.tsql_select_for_xml_sfunc,
+	stype = internal,
+	finalfunc = sys.tsql_select_for_xml_finalfunc
+);
+
+CREATE OR REPLACE AGGREGATE sys.tsql_select_for_xml_text_agg(rowval anyelement, mode int,
+           element_name text, binary_base64 boolean, root_name text)
+(
+	sfunc = sys.tsql_select_for_xml_sfunc,
+	stype = internal,
+	finalfunc = sys.tsql_select_for_xml_text_finalfunc
+);
+
 CREATE OR REPLACE FUNCTION sys.babelfish_conv_string_to_time(IN p_datatype TEXT,
                                                                  IN p_timestring TEXT,
                                                                  IN p_style NUMERIC DEFAULT 0)
@@ -4173,6 +4226,147 @@ BEGIN
 END;
 $$ LANGUAGE plpgsql IMMUTABLE STRICT;
 
+CREATE OR REPLACE FUNCTION sys.babelfish_batch_cache_stats(OUT hits BIGINT, OUT misses BIGINT, OUT evictions BIGINT,
+														   OUT invalidations BIGINT, OUT entries INT, OUT bytes BIGINT)
+RETURNS RECORD
+AS 'babelfishpg_tsql', 'babelfish_batch_cache_stats' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE VIEW sys.dm_exec_batch_cache_stats
+AS
+SELECT
+  CAST(s.hits AS BIGINT) AS hits,
+  CAST(s.misses AS BIGINT) AS misses,
+  CAST(s.evictions AS BIGINT) AS evictions,
+  CAST(s.invalidations AS BIGINT) AS invalidations,
+  CAST(s.entries AS INT) AS entries,
+  CAST(s.bytes AS BIGINT) AS bytes
+FROM sys.babelfish_batch_cache_stats() s;
+GRANT SELECT ON sys.dm_exec_batch_cache_stats TO PUBLIC;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_prepared_batch_stats(OUT handles INT, OUT compiled INT, OUT bytes BIGINT,
+															  OUT evictions BIGINT, OUT reprepares BIGINT)
+RETURNS RECORD
+AS 'babelfishpg_tsql', 'babelfish_prepared_batch_stats' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE VIEW sys.dm_exec_prepared_batch_stats
+AS
+SELECT
+  CAST(s.handles AS INT) AS handles,
+  CAST(s.compiled AS INT) AS compiled,
+  CAST(s.bytes AS BIGINT) AS bytes,
+  CAST(s.evictions AS BIGINT) AS evictions,
+  CAST(s.reprepares AS BIGINT) AS reprepares
+FROM sys.babelfish_prepared_batch_stats() s;
+GRANT SELECT ON sys.dm_exec_prepared_batch_stats TO PUBLIC;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_prepared_statements(OUT dbid SMALLINT, OUT userid OID, OUT query_hash BIGINT,
+															 OUT query_text TEXT, OUT parameters TEXT, OUT prepares BIGINT,
+															 OUT executions BIGINT, OUT total_elapsed_ms FLOAT8,
+															 OUT min_elapsed_ms FLOAT8, OUT max_elapsed_ms FLOAT8)
+RETURNS SETOF RECORD
+AS 'babelfishpg_tsql', 'babelfish_prepared_statements' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_prepared_statements_prewarm(IN max_statements INT DEFAULT NULL)
+RETURNS INT
+AS 'babelfishpg_tsql', 'babelfish_prepared_statements_prewarm' LANGUAGE C VOLATILE;
+GRANT EXECUTE ON FUNCTION sys.babelfish_prepared_statements_prewarm(INT) TO PUBLIC;
+
+CREATE OR REPLACE VIEW sys.dm_exec_prepared_statements
+AS
+SELECT
+  CAST(s.dbid AS INT) AS database_id,
+  CAST(r.rolname AS sys.sysname) AS user_name,
+  CAST(s.query_hash AS BIGINT) AS query_hash,
+  CAST(s.query_text AS sys.nvarchar(4000)) AS query_text,
+  CAST(s.parameters AS sys.nvarchar(4000)) AS parameters,
+  CAST(s.prepares AS BIGINT) AS prepares,
+  CAST(s.executions AS BIGINT) AS executions,
+  CAST(s.total_elapsed_ms AS FLOAT) AS total_elapsed_ms,
+  CAST(s.min_elapsed_ms AS FLOAT) AS min_elapsed_ms,
+  CAST(s.max_elapsed_ms AS FLOAT) AS max_elapsed_ms
+FROM sys.babelfish_prepared_statements() s
+LEFT JOIN pg_catalog.pg_roles r ON r.oid = s.userid;
+GRANT SELECT ON sys.dm_exec_prepared_statements TO PUBLIC;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_expression_stats(OUT object_id OID, OUT simple_evals BIGINT, OUT spi_evals BIGINT)
+RETURNS SETOF RECORD
+AS 'babelfishpg_tsql', 'babelfish_expression_stats' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE VIEW sys.dm_exec_expression_stats
+AS
+SELECT
+  CAST(NULLIF(s.object_id, 0) AS INT) AS object_id,
+  CAST(p.proname AS sys.sysname) AS object_name,
+  CAST(s.simple_evals AS BIGINT) AS simple_evals,
+  CAST(s.spi_evals AS BIGINT) AS spi_evals,
+  CAST(CASE WHEN s.simple_evals + s.spi_evals = 0 THEN 0
+       ELSE CAST(s.simple_evals AS FLOAT8) / (s.simple_evals + s.spi_evals) END AS FLOAT) AS simple_ratio
+FROM sys.babelfish_expression_stats() s
+LEFT JOIN pg_catalog.pg_proc p ON p.oid = s.object_id;
+GRANT SELECT ON sys.dm_exec_expression_stats TO PUBLIC;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_applock_partition_stats(OUT partition_id INT, OUT entries INT, OUT acquisitions BIGINT, OUT contended BIGINT)
+RETURNS SETOF RECORD
+AS 'babelfishpg_tsql', 'babelfish_applock_partition_stats' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE VIEW sys.dm_os_applock_partition_stats
+AS
+SELECT
+  CAST(s.partition_id AS INT) AS partition_id,
+  CAST(s.entries AS INT) AS resource_count,
+  CAST(s.acquisitions AS BIGINT) AS acquisitions,
+  CAST(s.contended AS BIGINT) AS contended,
+  CAST(CASE WHEN s.acquisitions = 0 THEN 0
+       ELSE CAST(s.contended AS FLOAT8) / s.acquisitions END AS FLOAT) AS contended_ratio
+FROM sys.babelfish_applock_partition_stats() s;
+GRANT SELECT ON sys.dm_os_applock_partition_stats TO PUBLIC;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_statement_stats(OUT object_id OID, OUT line_number INT, OUT execution_count BIGINT,
+														 OUT total_elapsed_us BIGINT, OUT min_elapsed_us BIGINT, OUT max_elapsed_us BIGINT,
+														 OUT total_rows BIGINT)
+RETURNS SETOF RECORD
+AS 'babelfishpg_tsql', 'babelfish_statement_stats' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_statement_stats_reset()
+RETURNS VOID
+AS 'babelfishpg_tsql', 'babelfish_statement_stats_reset' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE VIEW sys.dm_exec_statement_stats
+AS
+SELECT
+  CAST(s.object_id AS INT) AS object_id,
+  CAST(p.proname AS sys.sysname) AS object_name,
+  CAST(s.line_number AS INT) AS line_number,
+  CAST(s.execution_count AS BIGINT) AS execution_count,
+  CAST(s.total_elapsed_us AS BIGINT) AS total_elapsed_time,
+  CAST(s.min_elapsed_us AS BIGINT) AS min_elapsed_time,
+  CAST(s.max_elapsed_us AS BIGINT) AS max_elapsed_time,
+  CAST(s.total_rows AS BIGINT) AS total_rows
+FROM sys.babelfish_statement_stats() s
+LEFT JOIN pg_catalog.pg_proc p ON p.oid = s.object_id;
+GRANT SELECT ON sys.dm_exec_statement_stats TO PUBLIC;
+
+CREATE OR REPLACE FUNCTION sys.babelfish_parser_stats(OUT warmup_batches BIGINT, OUT warmup_ms FLOAT8, OUT batches BIGINT,
+													  OUT first_batch_ms FLOAT8, OUT last_batch_ms FLOAT8, OUT max_batch_ms FLOAT8,
+													  OUT avg_warm_batch_ms FLOAT8, OUT sll_batches BIGINT, OUT ll_fallbacks BIGINT)
+RETURNS RECORD
+AS 'babelfishpg_tsql', 'babelfish_parser_stats' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE VIEW sys.dm_exec_parser_stats
+AS
+SELECT
+  CAST(s.warmup_batches AS BIGINT) AS warmup_batches,
+  CAST(s.warmup_ms AS FLOAT) AS warmup_ms,
+  CAST(s.batches AS BIGINT) AS batches,
+  CAST(s.first_batch_ms AS FLOAT) AS first_batch_ms,
+  CAST(s.last_batch_ms AS FLOAT) AS last_batch_ms,
+  CAST(s.max_batch_ms AS FLOAT) AS max_batch_ms,
+  CAST(s.avg_warm_batch_ms AS FLOAT) AS avg_warm_batch_ms,
+  CAST(s.sll_batches AS BIGINT) AS sll_batches,
+  CAST(s.ll_fallbacks AS BIGINT) AS ll_fallbacks
+FROM sys.babelfish_parser_stats() s;
+GRANT SELECT ON sys.dm_exec_parser_stats TO PUBLIC;
+
 -- Drop the deprecated function
 CALL sys.babelfish_drop_deprecated_object('function', 'sys', 'get_tds_id_deprecated_2_3_0');
 
@@ -9,15 +9,20 @@
 #include "postgres.h"
 
 #include "access/xact.h"
+#include "common/hashfn.h"
 #include "executor/spi.h"
 #include "fmgr.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 #include "parser/parser.h"
 #include "pltsql.h"
 #include "storage/lmgr.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
 #include "utils/timeout.h"
+#include "utils/tuplestore.h"
 #include "datatypes.h"
 
 
@@ -25,6 +30,7 @@ PG_FUNCTION_INFO_V1(sp_getapplock_function);
 PG_FUNCTION_INFO_V1(sp_releaseapplock_function);
 PG_FUNCTION_INFO_V1(APPLOCK_MODE);
 PG_FUNCTION_INFO_V1(APPLOCK_TEST);
+PG_FUNCTION_INFO_V1(babelfish_applock_partition_stats);
 
 /* 
  * Applock local and global hashmaps. The local one keeps track of applock 
@@ -35,6 +41,45 @@ PG_FUNCTION_INFO_V1(APPLOCK_TEST);
 static HTAB * appLockCacheLocal = NULL;
 static HTAB * appLockCacheGlobal = NULL;
 
+/*
+ * The global hashmap is partitioned the same way as the PG lock manager's
+ * lock table: the low bits of a key select one of APPLOCK_NUM_PARTITIONS
+ * partitions, each with its own LWLock, and applock_key_hash() keeps those
+ * bits in the hash code so that every bucket belongs to a single partition.
+ * Sessions working on resources in different partitions don't wait for each
+ * other.  APPLOCK_NUM_PARTITIONS must be a power of 2.
+ */
+#define LOG2_APPLOCK_NUM_PARTITIONS 4
+#define APPLOCK_NUM_PARTITIONS (1 << LOG2_APPLOCK_NUM_PARTITIONS)
+
+#define ApplockKeyPartition(key) ((int) ((key) & (APPLOCK_NUM_PARTITIONS - 1)))
+
+/* Initial number of entries in the global hashmap, for all partitions */
+#define APPLOCK_GLOBAL_HASH_SIZE 64
+
+typedef struct ApplockPartition
+{
+	LWLock		lock;			/* protects this partition of the hashmap */
+	int			entries;		/* number of resources in this partition */
+	uint64		acquisitions;	/* times the lock was taken */
+	uint64		contended;		/* ... of which had to wait for it */
+} ApplockPartition;
+
+/* Keep each partition on its own cache line */
+typedef union ApplockPartitionPadded
+{
+	ApplockPartition partition;
+	char		pad[PG_CACHE_LINE_SIZE];
+} ApplockPartitionPadded;
+
+typedef struct ApplockShared
+{
+	int			tranche_id;
+	ApplockPartitionPadded partitions[APPLOCK_NUM_PARTITIONS];
+} ApplockShared;
+
+static ApplockShared *applockShared = NULL;
+
 /* Max length of applock resource name string (including the ending '\0') */
 #define APPLOCK_MAX_RESOURCE_LENGTH 256
 
@@ -54,6 +99,15 @@ static HTAB * appLockCacheGlobal = NULL;
  */
 #define APPLOCK_MAX_TRY_SEARCH_KEY 5
 
+/*
+ * Next candidate key after a collision. It steps over whole partitions, so
+ * all the candidates of a resource are in the same partition.
+ */
+#define ApplockNextKey(key) \
+	((key) > INT64_MAX - APPLOCK_NUM_PARTITIONS ? \
+	 (key) & (APPLOCK_NUM_PARTITIONS - 1) : \
+	 (key) + APPLOCK_NUM_PARTITIONS)
+
 typedef struct applockcacheent
 {
     int64       key;			/* (hashed) key integer of the lock */
@@ -282,6 +336,8 @@ static pg_attribute_printf(1, 2) void ApplockPrintMessage(const char *fmt, ...)
     } while (0);
 
 static void ApplockRemoveCache(bool release_session);
+static void ApplockPartitionLock(int64 key);
+static void ApplockPartitionUnlock(int64 key);
 
 /* 
  * Simple consistent hashing function to convert a string to an int.
@@ -331,10 +387,25 @@ static short getPGLockMode(short applockmode)
 	return mode;
 }
 
+/*
+ * Hash function for the global hashmap. The low bits of the hash code are
+ * the key's partition number; see ApplockKeyPartition().
+ */
+static uint32
+applock_key_hash(const void *key, Size keysize)
+{
+	int64		k = *((const int64 *) key);
+	uint32		h = hash_bytes_uint32((uint32) k ^ (uint32) (k >> 32));
+
+	return (h & ~((uint32) APPLOCK_NUM_PARTITIONS - 1)) | (uint32) ApplockKeyPartition(k);
+}
+
 /* Initialize both local and global hashmaps */
 static void initApplockCache()
 {
 	HASHCTL         ctl;
+	bool			found;
+	int				i;
 
 	/* Local cache */
 	MemSet(&ctl, 0, sizeof(ctl));
@@ -343,18 +414,39 @@ static void initApplockCache()
 	appLockCacheLocal = hash_create("Applock Cache", 16, 
 				&ctl, HASH_ELEM | HASH_BLOBS);
 
-	/* Global cache */
+	/* Global cache and its partition locks */
 	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	applockShared = (ApplockShared *) ShmemInitStruct("Applock partitions",
+													  sizeof(ApplockShared),
+													  &found);
+	if (!found)
+	{
+		applockShared->tranche_id = LWLockNewTrancheId();
+		for (i = 0; i < APPLOCK_NUM_PARTITIONS; i++)
+		{
+			ApplockPartition *part = &applockShared->partitions[i].partition;
+
+			LWLockInitialize(&part->lock, applockShared->tranche_id);
+			part->entries = 0;
+			part->acquisitions = 0;
+			part->contended = 0;
+		}
+	}
+
 	MemSet(&ctl, 0, sizeof(ctl));
 	ctl.keysize = sizeof(int64);
 	ctl.entrysize = sizeof(AppLockCacheEnt);
-	appLockCacheGlobal = (HTAB*)ShmemInitHash("Applock",
-										/*table size*/ 32,
-										/*max table size*/ 32,
+	ctl.hash = applock_key_hash;
+	ctl.num_partitions = APPLOCK_NUM_PARTITIONS;
+	appLockCacheGlobal = (HTAB*)ShmemInitHash("Applock partitioned",
+										/*table size*/ APPLOCK_GLOBAL_HASH_SIZE,
+										/*max table size*/ APPLOCK_GLOBAL_HASH_SIZE,
 										&ctl,
-										HASH_ELEM | HASH_BLOBS);
+										HASH_ELEM | HASH_FUNCTION | HASH_PARTITION);
 	LWLockRelease(AddinShmemInitLock);
 
+	LWLockRegisterTranche(applockShared->tranche_id, "babelfish_applock");
+
 	/* 
 	 * Init this function handler to be called when PG implicitly
 	 * release locks at the end of transaction/session. 
@@ -376,58 +468,56 @@ static int64 AppLockSearchKeyLocal(char *resource)
                                                     HASH_FIND, NULL);
 		if (entry && strcmp(entry->resource, resource) == 0)
 			return key;
-		/* be mindful of overflow */
-		key = (key % INT64_MAX) + 1;
+		key = ApplockNextKey(key);
 	}
 
 	return -1;
 }
 
-/* Search a key corresponding to a resource name in global hashmap. */
-static int64 AppLockSearchKeyGlobal(char *resource)
+/*
+ * Lock the global hashmap partition of a key, counting the times somebody
+ * else held it already.
+ */
+static void ApplockPartitionLock(int64 key)
 {
-	AppLockCacheEnt *entry;
-	int64 key;
-	int try_search = 0;
+	ApplockPartition *part = &applockShared->partitions[ApplockKeyPartition(key)].partition;
 
-	LWLockAcquire(TsqlApplockSyncLock, LW_SHARED);
-
-	key = applock_simple_hash(resource);
-	while (try_search++ < APPLOCK_MAX_TRY_SEARCH_KEY) {
-		entry = (AppLockCacheEnt*) hash_search(appLockCacheGlobal,
-                                                    (void *) &key,
-                                                    HASH_FIND, NULL);
-		if (entry && strcmp(entry->resource, resource) == 0) {
-			LWLockRelease(TsqlApplockSyncLock);
-			return key;
-		}
-		/* be mindful of overflow */
-		key = (key % INT64_MAX) + 1;
+	if (!LWLockConditionalAcquire(&part->lock, LW_EXCLUSIVE))
+	{
+		LWLockAcquire(&part->lock, LW_EXCLUSIVE);
+		part->contended++;
 	}
+	part->acquisitions++;
+}
 
-	LWLockRelease(TsqlApplockSyncLock);
-	return -1;
+static void ApplockPartitionUnlock(int64 key)
+{
+	LWLockRelease(&applockShared->partitions[ApplockKeyPartition(key)].partition.lock);
 }
 
 /* 
- * Un-reference an entry in the appLockCacheGlobal. 
+ * Un-reference an entry in the appLockCacheGlobal nrefs times.
  * Delete it if its refcount is reduced to 0.
  */
-static void ApplockUnrefGlobalCache(int64 key)
+static void ApplockUnrefGlobalCache(int64 key, uint32_t nrefs)
 {
 	AppLockCacheEnt *entry;
 
-	LWLockAcquire(TsqlApplockSyncLock, LW_EXCLUSIVE);
+	ApplockPartitionLock(key);
     entry = (AppLockCacheEnt *) hash_search(appLockCacheGlobal,
                                                 (void *) &key,
                                                 HASH_FIND, NULL);
-	if (entry && --entry->refcount == 0) {
-		hash_search(appLockCacheGlobal,
-											(void *) &key,
-											HASH_REMOVE, NULL);
-		entry->resource[0] = '\0';
+	if (entry) {
+		entry->refcount -= Min(nrefs, entry->refcount);
+		if (entry->refcount == 0) {
+			hash_search(appLockCacheGlobal,
+												(void *) &key,
+												HASH_REMOVE, NULL);
+			entry->resource[0] = '\0';
+			applockShared->partitions[ApplockKeyPartition(key)].partition.entries--;
+		}
 	}
-	LWLockRelease(TsqlApplockSyncLock);
+	ApplockPartitionUnlock(key);
 }
 
 /* 
@@ -442,32 +532,21 @@ static int64 ApplockGetUsableKey(char *resource)
 	AppLockCacheEnt *entry;
 	int				try_search = 0;
 
-	/* Firstly, try search in the global cache to see if it's available already*/
-	if ((key = AppLockSearchKeyGlobal(resource)) != -1) {
-		LWLockAcquire(TsqlApplockSyncLock, LW_EXCLUSIVE);
-		entry = (AppLockCacheEnt*) hash_search(appLockCacheGlobal,
-													(void *) &key,
-													HASH_ENTER, &found);
-		/* Someone might've just deleted it. So check it before modify.*/
-		if (found) {
-			++entry->refcount;
-			LWLockRelease(TsqlApplockSyncLock);
-			return key;
-		}
-		LWLockRelease(TsqlApplockSyncLock);
-	}
-
-	/* Otherwise, try generating a new key for this resource */
-
 	/* convert resource string to key integer */
 	key = applock_simple_hash(resource);
 	usable_key = -1;
 
-	LWLockAcquire(TsqlApplockSyncLock, LW_EXCLUSIVE);
+	/*
+	 * All candidate keys of the resource are in the same partition, so one
+	 * lock covers both finding an existing entry and inserting a new one.
+	 */
+	ApplockPartitionLock(key);
 
 	/* 
-	 * Some different resource name may have been hashed to the same key. 
-	 * In that case, we keep incrementing key until we find a usable one. 
+	 * The resource may be in the global cache already, under this key or a
+	 * later candidate. Otherwise, note that
+	 * some different resource name may have been hashed to the same key. 
+	 * In that case, we keep trying the next candidate key until we find a usable one.
 	 *
 	 * NB: it's not very meaningful to try too many times because if it
 	 * turns out that a couple of random keys have somehow all been used,
@@ -480,18 +559,17 @@ static int64 ApplockGetUsableKey(char *resource)
 		entry = (AppLockCacheEnt*) hash_search(appLockCacheGlobal,
                                                     (void *) &key,
                                                     HASH_FIND, NULL);
-		/* Someone might've just inserted an entry for this resource. */
 		if (entry && strcmp(entry->resource, resource) == 0) {
 			entry->refcount++;
-			LWLockRelease(TsqlApplockSyncLock);
+			ApplockPartitionUnlock(key);
 			return key;
 		}
 		/* Key usable, record it if not done so. */
 		if (!entry && usable_key == -1)
 			usable_key = key;
 
-		/* Keep searching, be mindful of overflow */
-		key = (key % INT64_MAX) + 1;
+		/* Keep searching */
+		key = ApplockNextKey(key);
 	}
 
 	if (usable_key != -1) {
@@ -505,9 +583,10 @@ static int64 ApplockGetUsableKey(char *resource)
 		entry->refcount = 1;
 		entry->resource[0] = '\0';
 		strncat(entry->resource, resource, strlen(resource));
+		applockShared->partitions[ApplockKeyPartition(usable_key)].partition.entries++;
 	}
 
-	LWLockRelease(TsqlApplockSyncLock);
+	ApplockPartitionUnlock(key);
 	return usable_key;
 }
 
@@ -592,7 +671,7 @@ static int _sp_getapplock_internal (char *resource, char *lockmode,
 		 */
 
 		/* Un-referencing the global cache entry associated with this key. */
-		ApplockUnrefGlobalCache(key);
+		ApplockUnrefGlobalCache(key, 1);
 
 		/*
 		 * Did timeout occur?
@@ -681,21 +760,19 @@ static int _sp_releaseapplock_internal(char *resource, char *lockowner,
 	ApplockCheckLockowner(lockowner, is_session, suppress_warning);
 	ApplockCheckDbPrincipal(dbprincipal);
 
-	/* Search in the global cache for the key. */
-	if ((key = AppLockSearchKeyGlobal(resource)) == -1) {
+	/*
+	 * Search in the local cache for the key. A lock we hold is always in
+	 * the global cache as well, under the same key, so there is no need
+	 * to lock and search the latter.
+	 */
+	if ((key = AppLockSearchKeyLocal(resource)) == -1) {
 		if (!suppress_warning)
 			ApplockPrintMessage("No lock resource \'%s\' acquired before.", resource);
-		LWLockRelease(TsqlApplockSyncLock);
 		return -999;
 	}
 
-	/* verify the key in the local cache, and if the lock owner matches */
+	/* verify if the lock owner matches */
 	AppLockCacheLookup(key, entry);
-	if (entry == NULL) {
-		if (!suppress_warning)
-			ApplockPrintMessage("No lock resource \'%s\' acquired before.", resource);
-		return -999;
-	}
 	if (is_session != entry->is_session) {
 		if (!suppress_warning)
 			ApplockPrintMessage("Wrong LockOwner for lock resource \'%s\', it is a %s lock.", 
@@ -719,7 +796,7 @@ static int _sp_releaseapplock_internal(char *resource, char *lockowner,
 		AppLockCacheDelete(key);
 
 	/* Un-referencing the global cache entry associated with this key. */
-	ApplockUnrefGlobalCache(key);
+	ApplockUnrefGlobalCache(key, 1);
 
 	return 0;
 }
@@ -914,13 +991,11 @@ ApplockRemoveCache(bool release_session)
   
 	while ((entry = hash_seq_search(&hash_seq)) != NULL)
 	{
-		int i;
 		if (!release_session && entry->is_session)
 			continue;
 
 		/* unreferencing my entries in global hashmap */
-		for (i = 0; i < entry->refcount; i++) 
-			ApplockUnrefGlobalCache(entry->key);
+		ApplockUnrefGlobalCache(entry->key, entry->refcount);
 
 		/* free allocated space, and the entry itself. */
 		hash_search(appLockCacheLocal, (void *) &entry->key, HASH_REMOVE, NULL);
@@ -929,3 +1004,62 @@ ApplockRemoveCache(bool release_session)
 	/* Release all applocks too. */
 	LockReleaseAll(APPLOCK_LOCKMETHOD, release_session);
 }
+
+/*
+ * Per-partition counters of the global applock hashmap, for
+ * sys.dm_os_applock_partition_stats.
+ */
+Datum
+babelfish_applock_partition_stats(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	MemoryContext oldcontext;
+	int			i;
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (!appLockCacheLocal)
+		initApplockCache();
+
+	for (i = 0; i < APPLOCK_NUM_PARTITIONS; i++)
+	{
+		ApplockPartition *part = &applockShared->partitions[i].partition;
+		Datum		values[4];
+		bool		nulls[4];
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = Int32GetDatum(i);
+
+		LWLockAcquire(&part->lock, LW_SHARED);
+		values[1] = Int32GetDatum(part->entries);
+		values[2] = Int64GetDatum((int64) part->acquisitions);
+		values[3] = Int64GetDatum((int64) part->contended);
+		LWLockRelease(&part->lock);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
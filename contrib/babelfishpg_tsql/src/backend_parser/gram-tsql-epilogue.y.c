@@ -367,6 +367,100 @@ tsql_check_param_readonly(const char *paramname, TypeName *typename, bool readon
 	}
 }
 
+/*
+ * Resolve the FOR XML common directive list into its options.
+ */
+static void
+tsql_for_xml_directives(TSQL_ForClause *forclause, bool *binary_base64,
+						bool *return_xml_type, char **root_name)
+{
+	/* Resolve the XML common directive list if provided */
+	if (forclause->commonDirectives != NIL)
+	{
+		ListCell *lc;
+		foreach (lc, forclause->commonDirectives)
+		{
+			Node *myNode = lfirst(lc);
+			A_Const *myConst;
+
+			/* commonDirective is either integer const or string const */
+			Assert(IsA(myNode, A_Const));
+			myConst = (A_Const *)myNode;
+			Assert(myConst->val.type == T_Integer || myConst->val.type == T_String);
+			if (myConst->val.type == T_Integer)
+			{
+				if (myConst->val.val.ival == TSQL_XML_DIRECTIVE_BINARY_BASE64)
+					*binary_base64 = true;
+				else if (myConst->val.val.ival == TSQL_XML_DIRECTIVE_TYPE)
+					*return_xml_type = true;
+			}
+			else if (myConst->val.type == T_String)
+			{
+				*root_name = myConst->val.val.str;
+			}
+		}
+	}
+}
+
+/*
+ * Turn a FOR XML RAW or PATH query into an aggregate over the rows of the
+ * original query, the same way TsqlForJSONMakeSelect does for FOR JSON PATH:
+ * select a from t order by a for xml raw =>
+ * select sys.tsql_select_for_xml_text_agg(tsql_for_xml_rows.*, ...)
+ *   from (select a from t order by a) tsql_for_xml_rows
+ * The TYPE directive selects sys.tsql_select_for_xml_agg, which returns xml.
+ *
+ * AUTO and EXPLICIT modes are not supported, and still go through
+ * TsqlForXMLMakeFuncCall so that they fail the same way at execution time.
+ */
+static Node *
+TsqlForXMLMakeSelect(TSQL_ForClause *forclause, SelectStmt *select, char *src_query, size_t start_location, core_yyscan_t yyscanner)
+{
+	SelectStmt *n = makeNode(SelectStmt);
+	ResTarget  *rt;
+	RangeSubselect *rows;
+	List	   *func_name;
+	List	   *func_args;
+	bool		binary_base64 = false;
+	bool		return_xml_type = false;
+	char	   *root_name = NULL;
+
+	if (forclause->mode != TSQL_FORXML_RAW && forclause->mode != TSQL_FORXML_PATH)
+	{
+		n->targetList = list_make1(TsqlForXMLMakeFuncCall(forclause, src_query, start_location, yyscanner));
+		return (Node *) n;
+	}
+
+	tsql_for_xml_directives(forclause, &binary_base64, &return_xml_type, &root_name);
+
+	rows = makeNode(RangeSubselect);
+	rows->subquery = (Node *) select;
+	rows->alias = makeAlias("tsql_for_xml_rows", NIL);
+
+	if (return_xml_type)
+		func_name = list_make2(makeString("sys"), makeString("tsql_select_for_xml_agg"));
+	else
+		func_name = list_make2(makeString("sys"), makeString("tsql_select_for_xml_text_agg"));
+	func_args = list_make4(makeColumnRef(pstrdup("tsql_for_xml_rows"),
+										 list_make1(makeNode(A_Star)), -1, yyscanner),
+						   makeIntConst(forclause->mode, -1),
+						   forclause->elementName ? makeStringConst(forclause->elementName, -1) :
+						   makeStringConst("row", -1),
+						   makeBoolAConst(binary_base64, -1));
+	func_args = lappend(func_args, root_name ? makeStringConst(root_name, -1) : makeStringConst("", -1));
+
+	/* Keep the column name that TsqlForXMLMakeFuncCall gives the result */
+	rt = makeNode(ResTarget);
+	rt->name = pstrdup(return_xml_type ? "tsql_query_to_xml" : "tsql_query_to_xml_text");
+	rt->indirection = NIL;
+	rt->val = (Node *) makeFuncCall(func_name, func_args, COERCE_EXPLICIT_CALL, -1);
+	rt->location = -1;
+
+	n->targetList = list_make1(rt);
+	n->fromClause = list_make1(rows);
+	return (Node *) n;
+}
+
 /*
  * Make a function call to tsql_query_to_xml for FOR XML clause.
  * For example, it does the following transformation:
@@ -402,32 +496,7 @@ TsqlForXMLMakeFuncCall(TSQL_ForClause* forclause, char* src_query, size_t start_
 	char* root_name = NULL;
 	Node* arg1;
 
-	/* Resolve the XML common directive list if provided */
-	if (forclause->commonDirectives != NIL)
-	{
-		ListCell *lc;
-		foreach (lc, forclause->commonDirectives)
-		{
-			Node *myNode = lfirst(lc);
-			A_Const *myConst;
-
-			/* commonDirective is either integer const or string const */
-			Assert(IsA(myNode, A_Const));
-			myConst = (A_Const *)myNode;
-			Assert(myConst->val.type == T_Integer || myConst->val.type == T_String);
-			if (myConst->val.type == T_Integer)
-			{
-				if (myConst->val.val.ival == TSQL_XML_DIRECTIVE_BINARY_BASE64)
-					binary_base64 = true;
-				else if (myConst->val.val.ival == TSQL_XML_DIRECTIVE_TYPE)
-					return_xml_type = true;
-			}
-			else if (myConst->val.type == T_String)
-			{
-				root_name = myConst->val.val.str;
-			}
-		}
-	}
+	tsql_for_xml_directives(forclause, &binary_base64, &return_xml_type, &root_name);
 
 	query = memcpy(query,
 				   src_query + start_location,
@@ -1361,6 +1430,106 @@ returning_list_has_column_name(List *existing_colnames, char *current_colname)
 	return is_duplicate;
 }
 
+/*
+ * Resolve the FOR JSON common directive list into its options.
+ */
+static void
+tsql_for_json_directives(TSQL_ForClause *forclause, bool *include_null_values,
+						 bool *without_array_wrapper, char **root_name)
+{
+	/* Resolve the JSON common directive list if provided */
+	if (forclause->commonDirectives != NIL)
+	{
+		ListCell *lc;
+		foreach (lc, forclause->commonDirectives)
+		{
+			Node *myNode = lfirst(lc);
+			A_Const *myConst;
+
+			/* commonDirective is either integer const or string const */
+			Assert(IsA(myNode, A_Const));
+			myConst = (A_Const *)myNode;
+			Assert(myConst->val.type == T_Integer || myConst->val.type == T_String);
+			if (myConst->val.type == T_Integer)
+			{
+				if (myConst->val.val.ival == TSQL_JSON_DIRECTIVE_INCLUDE_NULL_VALUES)
+					*include_null_values = true;
+				if (myConst->val.val.ival == TSQL_JSON_DIRECTIVE_WITHOUT_ARRAY_WRAPPER)
+					*without_array_wrapper = true;
+			}
+			else if (myConst->val.type == T_String)
+			{
+				*root_name = myConst->val.val.str;
+			}
+		}
+	}
+
+	/* ROOT option and WITHOUT_ARRAY_WRAPPER option cannot be used together in FOR JSON */
+	if (*root_name && *without_array_wrapper)
+	{
+		ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("ROOT option and WITHOUT_ARRAY_WRAPPER option cannot be used together in FOR JSON. Remove one of these options")));
+	}
+}
+
+/*
+ * Turn a FOR JSON PATH query into an aggregate over the rows of the original
+ * query. For example:
+ * select a from t where id = @pid order by a for json path =>
+ * select sys.tsql_select_for_json_agg(tsql_for_json_rows.*, ...)
+ *   from (select a from t where id = @pid order by a) tsql_for_json_rows
+ * Unlike TsqlForJSONMakeFuncCall, the query is analyzed and planned along with
+ * the enclosing statement, so variables need no special handling and the rows
+ * are streamed into the document instead of being re-executed through SPI.
+ *
+ * FOR JSON AUTO is not supported, and still goes through
+ * TsqlForJSONMakeFuncCall so that it fails the same way at execution time.
+ */
+static Node *
+TsqlForJSONMakeSelect(TSQL_ForClause *forclause, SelectStmt *select, char *src_query, size_t start_location, core_yyscan_t yyscanner)
+{
+	SelectStmt *n = makeNode(SelectStmt);
+	ResTarget  *rt;
+	RangeSubselect *rows;
+	List	   *func_args;
+	bool		include_null_values = false;
+	bool		without_array_wrapper = false;
+	char	   *root_name = NULL;
+
+	if (forclause->mode != TSQL_FORJSON_PATH)
+	{
+		n->targetList = list_make1(TsqlForJSONMakeFuncCall(forclause, src_query, start_location, yyscanner));
+		return (Node *) n;
+	}
+
+	tsql_for_json_directives(forclause, &include_null_values,
+							 &without_array_wrapper, &root_name);
+
+	rows = makeNode(RangeSubselect);
+	rows->subquery = (Node *) select;
+	rows->alias = makeAlias("tsql_for_json_rows", NIL);
+
+	func_args = list_make4(makeColumnRef(pstrdup("tsql_for_json_rows"),
+										 list_make1(makeNode(A_Star)), -1, yyscanner),
+						   makeIntConst(forclause->mode, -1),
+						   makeBoolAConst(include_null_values, -1),
+						   makeBoolAConst(without_array_wrapper, -1));
+	func_args = lappend(func_args, root_name ? makeStringConst(root_name, -1) : makeNullAConst(-1));
+
+	/* Keep the column name that TsqlForJSONMakeFuncCall gives the result */
+	rt = makeNode(ResTarget);
+	rt->name = pstrdup("tsql_query_to_json_text");
+	rt->indirection = NIL;
+	rt->val = (Node *) makeFuncCall(list_make2(makeString("sys"), makeString("tsql_select_for_json_agg")),
+									func_args, COERCE_EXPLICIT_CALL, -1);
+	rt->location = -1;
+
+	n->targetList = list_make1(rt);
+	n->fromClause = list_make1(rows);
+	return (Node *) n;
+}
+
 /*
  * Make a function call to tsql_query_to_json_text for FOR JSON clause.
  * For example, it does the following transformation:
@@ -1397,40 +1566,8 @@ TsqlForJSONMakeFuncCall(TSQL_ForClause* forclause, char* src_query, size_t start
 	char* root_name = NULL;
 	Node* arg1;
 
-	/* Resolve the JSON common directive list if provided */
-	if (forclause->commonDirectives != NIL)
-	{
-		ListCell *lc;
-		foreach (lc, forclause->commonDirectives)
-		{
-			Node *myNode = lfirst(lc);
-			A_Const *myConst;
-
-			/* commonDirective is either integer const or string const */
-			Assert(IsA(myNode, A_Const));
-			myConst = (A_Const *)myNode;
-			Assert(myConst->val.type == T_Integer || myConst->val.type == T_String);
-			if (myConst->val.type == T_Integer)
-			{
-				if (myConst->val.val.ival == TSQL_JSON_DIRECTIVE_INCLUDE_NULL_VALUES)
-					include_null_values = true;
-				if (myConst->val.val.ival == TSQL_JSON_DIRECTIVE_WITHOUT_ARRAY_WRAPPER)
-					without_array_wrapper = true;
-			}
-			else if (myConst->val.type == T_String)
-			{
-				root_name = myConst->val.val.str;
-			}
-		}
-	}
-
-	/* ROOT option and WITHOUT_ARRAY_WRAPPER option cannot be used together in FOR JSON */
-	if (root_name && without_array_wrapper)
-	{
-		ereport(ERROR,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("ROOT option and WITHOUT_ARRAY_WRAPPER option cannot be used together in FOR JSON. Remove one of these options")));
-	}
+	tsql_for_json_directives(forclause, &include_null_values,
+							 &without_array_wrapper, &root_name);
 
 	
 	query = memcpy(query,
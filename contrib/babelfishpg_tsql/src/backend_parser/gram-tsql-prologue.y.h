@@ -47,7 +47,11 @@ static Node *TsqlFunctionIIF(Node *bool_expr, Node *arg1, Node *arg2, int locati
 static Node *TsqlFunctionChoose(Node *int_expr, List *choosable, int location);
 static void tsql_check_param_readonly(const char* paramname, TypeName *typename, bool readonly);
 static ResTarget *TsqlForXMLMakeFuncCall(TSQL_ForClause *forclause, char *src_query, size_t start_location, core_yyscan_t yyscanner);
+static Node *TsqlForXMLMakeSelect(TSQL_ForClause *forclause, SelectStmt *select, char *src_query, size_t start_location, core_yyscan_t yyscanner);
+static void tsql_for_xml_directives(TSQL_ForClause *forclause, bool *binary_base64, bool *return_xml_type, char **root_name);
 static ResTarget *TsqlForJSONMakeFuncCall(TSQL_ForClause *forclause, char *src_query, size_t start_location, core_yyscan_t yyscanner);
+static Node *TsqlForJSONMakeSelect(TSQL_ForClause *forclause, SelectStmt *select, char *src_query, size_t start_location, core_yyscan_t yyscanner);
+static void tsql_for_json_directives(TSQL_ForClause *forclause, bool *include_null_values, bool *without_array_wrapper, char **root_name);
 static Node* tsql_get_transformed_query(StringInfo format_query, char *end_param, char *query, List *params);
 
 char * construct_unique_index_name(char *index_name, char *relation_name);
@@ -1366,13 +1366,10 @@ select_no_parens:
 					base_yy_extra_type *yyextra = pg_yyget_extra(yyscanner);
 					char *src_query = yyextra->core_yy_extra.scanbuf;
 					/*
-					 * We can free the SelectStmt because we will process the transformed
-					 * FOR XML query by calling function tsql_query_to_xml().
+					 * The SelectStmt becomes the input of the FOR XML aggregate,
+					 * see TsqlForXMLMakeSelect().
 					 */
-					pfree($1);
-					$1 = (Node *) makeNode(SelectStmt);
-					((SelectStmt *)$1)->targetList = list_make1(TsqlForXMLMakeFuncCall((TSQL_ForClause *) $2, src_query, @1, yyscanner));
-					$$ = $1;
+					$$ = TsqlForXMLMakeSelect((TSQL_ForClause *) $2, (SelectStmt *) $1, src_query, @1, yyscanner);
 				}
 			| select_clause sort_clause tsql_for_clause
 				{
@@ -1385,12 +1382,13 @@ select_no_parens:
 						base_yy_extra_type *yyextra = pg_yyget_extra(yyscanner);
 						char *src_query = yyextra->core_yy_extra.scanbuf;
 						/*
-						 * We can free the SelectStmt because we will process the transformed
-						 * FOR XML query by calling function tsql_query_to_xml().
+						 * The SelectStmt becomes the input of the FOR XML aggregate,
+						 * see TsqlForXMLMakeSelect().
 						 */
-						pfree($1);
-						$1 = (Node *) makeNode(SelectStmt);
-						((SelectStmt *)$1)->targetList = list_make1(TsqlForXMLMakeFuncCall((TSQL_ForClause *) $3, src_query, @1, yyscanner));
+						insertSelectOptions((SelectStmt *) $1, $2, NIL,
+											NULL, NULL,
+											yyscanner);
+						$1 = TsqlForXMLMakeSelect((TSQL_ForClause *) $3, (SelectStmt *) $1, src_query, @1, yyscanner);
 					}
 					$$ = $1;
 				}
@@ -1406,12 +1404,14 @@ select_no_parens:
 						base_yy_extra_type *yyextra = pg_yyget_extra(yyscanner);
 						char *src_query = yyextra->core_yy_extra.scanbuf;
 						/*
-						 * We can free the SelectStmt because we will process the transformed
-						 * FOR XML query by calling function tsql_query_to_xml().
+						 * The SelectStmt becomes the input of the FOR XML aggregate,
+						 * see TsqlForXMLMakeSelect().
 						 */
-						pfree($2);
-						$2 = (Node *) makeNode(SelectStmt);
-						((SelectStmt *)$2)->targetList = list_make1(TsqlForXMLMakeFuncCall((TSQL_ForClause *) $3, src_query, @1, yyscanner));
+						insertSelectOptions((SelectStmt *) $2, NULL, NIL,
+											NULL,
+											$1,
+											yyscanner);
+						$2 = TsqlForXMLMakeSelect((TSQL_ForClause *) $3, (SelectStmt *) $2, src_query, @1, yyscanner);
 					}
 					$$ = $2;
 				}
@@ -1427,12 +1427,14 @@ select_no_parens:
 						base_yy_extra_type *yyextra = pg_yyget_extra(yyscanner);
 						char *src_query = yyextra->core_yy_extra.scanbuf;
 						/*
-						 * We can free the SelectStmt because we will process the transformed
-						 * FOR XML query by calling function tsql_query_to_xml().
+						 * The SelectStmt becomes the input of the FOR XML aggregate,
+						 * see TsqlForXMLMakeSelect().
 						 */
-						pfree($2);
-						$2 = (Node *) makeNode(SelectStmt);
-						((SelectStmt *)$2)->targetList = list_make1(TsqlForXMLMakeFuncCall((TSQL_ForClause *) $4, src_query, @1, yyscanner));
+						insertSelectOptions((SelectStmt *) $2, $3, NIL,
+											NULL,
+											$1,
+											yyscanner);
+						$2 = TsqlForXMLMakeSelect((TSQL_ForClause *) $4, (SelectStmt *) $2, src_query, @1, yyscanner);
 					}
 					$$ = $2;
 				}
@@ -1441,13 +1443,10 @@ select_no_parens:
 					base_yy_extra_type *yyextra = pg_yyget_extra(yyscanner);
 					char *src_query = yyextra->core_yy_extra.scanbuf;
 					/*
-					 * We can free the SelectStmt because we will process the transformed
-					 * FOR JSON query by calling function tsql_query_to_json().
+					 * The SelectStmt becomes the input of the FOR JSON aggregate,
+					 * see TsqlForJSONMakeSelect().
 					 */
-					pfree($1);
-					$1 = (Node *) makeNode(SelectStmt);
-					((SelectStmt *)$1)->targetList = list_make1(TsqlForJSONMakeFuncCall((TSQL_ForClause *) $2, src_query, @1, yyscanner));
-					$$ = $1;
+					$$ = TsqlForJSONMakeSelect((TSQL_ForClause *) $2, (SelectStmt *) $1, src_query, @1, yyscanner);
 				}
 			| select_clause sort_clause tsql_for_json_clause
 				{
@@ -1460,12 +1459,13 @@ select_no_parens:
 						base_yy_extra_type *yyextra = pg_yyget_extra(yyscanner);
 						char *src_query = yyextra->core_yy_extra.scanbuf;
 						/*
-						 * We can free the SelectStmt because we will process the transformed
-						 * FOR JSON query by calling function tsql_query_to_json().
+						 * The SelectStmt becomes the input of the FOR JSON aggregate,
+						 * see TsqlForJSONMakeSelect().
 						 */
-						pfree($1);
-						$1 = (Node *) makeNode(SelectStmt);
-						((SelectStmt *)$1)->targetList = list_make1(TsqlForJSONMakeFuncCall((TSQL_ForClause *) $3, src_query, @1, yyscanner));
+						insertSelectOptions((SelectStmt *) $1, $2, NIL,
+											NULL, NULL,
+											yyscanner);
+						$1 = TsqlForJSONMakeSelect((TSQL_ForClause *) $3, (SelectStmt *) $1, src_query, @1, yyscanner);
 					}
 					$$ = $1;
 				}
@@ -1481,12 +1481,14 @@ select_no_parens:
 						base_yy_extra_type *yyextra = pg_yyget_extra(yyscanner);
 						char *src_query = yyextra->core_yy_extra.scanbuf;
 						/*
-						 * We can free the SelectStmt because we will process the transformed
-						 * FOR JSON query by calling function tsql_query_to_json().
+						 * The SelectStmt becomes the input of the FOR JSON aggregate,
+						 * see TsqlForJSONMakeSelect().
 						 */
-						pfree($2);
-						$2 = (Node *) makeNode(SelectStmt);
-						((SelectStmt *)$2)->targetList = list_make1(TsqlForJSONMakeFuncCall((TSQL_ForClause *) $3, src_query, @1, yyscanner));
+						insertSelectOptions((SelectStmt *) $2, NULL, NIL,
+											NULL,
+											$1,
+											yyscanner);
+						$2 = TsqlForJSONMakeSelect((TSQL_ForClause *) $3, (SelectStmt *) $2, src_query, @1, yyscanner);
 					}
 					$$ = $2;
 				}
@@ -1502,12 +1504,14 @@ select_no_parens:
 						base_yy_extra_type *yyextra = pg_yyget_extra(yyscanner);
 						char *src_query = yyextra->core_yy_extra.scanbuf;
 						/*
-						 * We can free the SelectStmt because we will process the transformed
-						 * FOR JSON query by calling function tsql_query_to_json().
+						 * The SelectStmt becomes the input of the FOR JSON aggregate,
+						 * see TsqlForJSONMakeSelect().
 						 */
-						pfree($2);
-						$2 = (Node *) makeNode(SelectStmt);
-						((SelectStmt *)$2)->targetList = list_make1(TsqlForJSONMakeFuncCall((TSQL_ForClause *) $4, src_query, @1, yyscanner));
+						insertSelectOptions((SelectStmt *) $2, $3, NIL,
+											NULL,
+											$1,
+											yyscanner);
+						$2 = TsqlForJSONMakeSelect((TSQL_ForClause *) $4, (SelectStmt *) $2, src_query, @1, yyscanner);
 					}
 					$$ = $2;
 				}
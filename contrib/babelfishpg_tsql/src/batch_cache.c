@@ -0,0 +1,522 @@
+/*-------------------------------------------------------------------------
+ *
+ * batch_cache.c	- Per-backend cache of compiled sp_executesql batches
+ *
+ * Drivers and ORMs send the same parameterized sp_executesql text over and
+ * over again.  Instead of running the ANTLR parser and the PL/tsql compiler
+ * for every RPC, we keep the compiled PLtsql_function around, keyed on the
+ * statement text, the parameter signature, the current database and user,
+ * and the session settings that influence how the text is parsed.
+ *
+ * The cache is bounded both by number of entries and by memory, and the
+ * least recently used entries are evicted first.  Cached SPI plans inside the
+ * functions keep being revalidated by the plancache (and plan_inval.c).
+ * What the compiler itself binds are the types of the batch's variables and
+ * parameters, so an entry remembers the TYPEOID syscache hash values of
+ * those and is dropped when one of them is invalidated.  Everything goes on
+ * connection reset.
+ *
+ * IDENTIFICATION
+ *	  contrib/babelfishpg_tsql/src/batch_cache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "common/hashfn.h"
+#include "funcapi.h"
+#include "lib/ilist.h"
+#include "miscadmin.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/syscache.h"
+
+#include "pltsql.h"
+#include "session.h"
+
+extern bool pltsql_quoted_identifier;
+extern bool pltsql_ansi_nulls;
+extern bool pltsql_ansi_padding;
+extern bool pltsql_concat_null_yields_null;
+
+int			pltsql_batch_cache_size = DEFAULT_BATCH_CACHE_SIZE;
+int			pltsql_batch_cache_memory_kb = DEFAULT_BATCH_CACHE_MEMORY_KB;
+
+/*
+ * Fixed part of the cache key.  It is followed by the parameter signature and
+ * the statement text in the serialized key.
+ */
+typedef struct BatchCacheKeyHeader
+{
+	Oid			userid;
+	int16		dbid;
+	uint16		settings;		/* BATCH_CACHE_SETTING_* bits */
+	int			numargs;
+	int			textlen;
+} BatchCacheKeyHeader;
+
+#define BATCH_CACHE_SETTING_QUOTED_IDENTIFIER	0x01
+#define BATCH_CACHE_SETTING_ANSI_NULLS			0x02
+#define BATCH_CACHE_SETTING_ANSI_PADDING		0x04
+#define BATCH_CACHE_SETTING_CONCAT_NULL			0x08
+
+typedef struct BatchCacheEntry
+{
+	uint32		hashvalue;		/* hash of keydata; hash table key */
+	char	   *keydata;		/* serialized key, compared on lookup */
+	int			keylen;
+	PLtsql_function *func;
+	Size		bytes;			/* memory held by the compiled function */
+	dlist_node	lru_node;		/* most recently used entries at the head */
+	uint32	   *type_hashes;	/* TYPEOID hash values of the types it uses */
+	int			ntype_hashes;
+} BatchCacheEntry;
+
+static HTAB *batch_cache_htab = NULL;
+static MemoryContext BatchCacheContext = NULL;
+static dlist_head batch_cache_lru = DLIST_STATIC_INIT(batch_cache_lru);
+static int	batch_cache_entries = 0;
+static Size batch_cache_bytes = 0;
+
+/*
+ * Functions that were evicted while they were still executing.  They are
+ * freed by batch_cache_release() once their use count drops to zero.
+ */
+static List *batch_cache_orphans = NIL;
+
+/* Counters reported by sys.babelfish_batch_cache_stats() */
+static uint64 batch_cache_hits = 0;
+static uint64 batch_cache_misses = 0;
+static uint64 batch_cache_evictions = 0;
+static uint64 batch_cache_invalidations = 0;
+
+static void batch_cache_init(void);
+static char *batch_cache_make_key(const char *source_text, InlineCodeBlockArgs *args,
+								  int *keylen);
+static BatchCacheEntry *batch_cache_find(const char *source_text, InlineCodeBlockArgs *args);
+static void batch_cache_collect_types(BatchCacheEntry *entry, PLtsql_function *func);
+static void batch_cache_unlink_entry(BatchCacheEntry *entry);
+static void batch_cache_remove_entry(BatchCacheEntry *entry);
+static void batch_cache_enforce_limits(void);
+static void batch_cache_inval_callback(Datum arg, int cacheid, uint32 hashvalue);
+
+PG_FUNCTION_INFO_V1(babelfish_batch_cache_stats);
+
+bool
+batch_cache_enabled(void)
+{
+	return pltsql_batch_cache_size > 0 && pltsql_batch_cache_memory_kb > 0;
+}
+
+static void
+batch_cache_init(void)
+{
+	HASHCTL		ctl;
+
+	if (batch_cache_htab)
+		return;
+
+	BatchCacheContext = AllocSetContextCreate(TopMemoryContext,
+											  "PL/tsql batch cache",
+											  ALLOCSET_DEFAULT_SIZES);
+
+	MemSet(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(uint32);
+	ctl.entrysize = sizeof(BatchCacheEntry);
+	ctl.hcxt = BatchCacheContext;
+	batch_cache_htab = hash_create("PL/tsql batch cache", 128, &ctl,
+								   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	/*
+	 * A compiled batch bakes in the types of its variables.  Functions are
+	 * only looked up by the SPI plans, which the plancache revalidates.
+	 */
+	CacheRegisterSyscacheCallback(TYPEOID, batch_cache_inval_callback, (Datum) 0);
+}
+
+/*
+ * Remember the types the compiled function declared its variables with.
+ */
+static void
+batch_cache_collect_types(BatchCacheEntry *entry, PLtsql_function *func)
+{
+	int			i;
+
+	entry->type_hashes = (uint32 *) MemoryContextAlloc(BatchCacheContext,
+													   Max(func->ndatums, 1) * sizeof(uint32));
+	entry->ntype_hashes = 0;
+
+	for (i = 0; i < func->ndatums; i++)
+	{
+		PLtsql_datum *datum = func->datums[i];
+		Oid			typoid;
+		uint32		hashvalue;
+		int			j;
+
+		switch (datum->dtype)
+		{
+			case PLTSQL_DTYPE_VAR:
+			case PLTSQL_DTYPE_PROMISE:
+				typoid = ((PLtsql_var *) datum)->datatype->typoid;
+				break;
+			case PLTSQL_DTYPE_REC:
+				typoid = ((PLtsql_rec *) datum)->rectypeid;
+				break;
+			case PLTSQL_DTYPE_TBL:
+				typoid = ((PLtsql_tbl *) datum)->tbltypeid;
+				break;
+			default:
+				continue;
+		}
+		if (!OidIsValid(typoid) || typoid == RECORDOID)
+			continue;
+
+		hashvalue = GetSysCacheHashValue1(TYPEOID, ObjectIdGetDatum(typoid));
+		for (j = 0; j < entry->ntype_hashes; j++)
+		{
+			if (entry->type_hashes[j] == hashvalue)
+				break;
+		}
+		if (j == entry->ntype_hashes)
+			entry->type_hashes[entry->ntype_hashes++] = hashvalue;
+	}
+}
+
+/*
+ * Serialize everything that decides whether a compiled batch can be reused.
+ */
+static char *
+batch_cache_make_key(const char *source_text, InlineCodeBlockArgs *args, int *keylen)
+{
+	StringInfoData	buf;
+	BatchCacheKeyHeader hdr;
+	int				i;
+
+	MemSet(&hdr, 0, sizeof(hdr));
+	hdr.userid = GetUserId();
+	hdr.dbid = get_cur_db_id();
+	if (pltsql_quoted_identifier)
+		hdr.settings |= BATCH_CACHE_SETTING_QUOTED_IDENTIFIER;
+	if (pltsql_ansi_nulls)
+		hdr.settings |= BATCH_CACHE_SETTING_ANSI_NULLS;
+	if (pltsql_ansi_padding)
+		hdr.settings |= BATCH_CACHE_SETTING_ANSI_PADDING;
+	if (pltsql_concat_null_yields_null)
+		hdr.settings |= BATCH_CACHE_SETTING_CONCAT_NULL;
+	hdr.numargs = args ? args->numargs : 0;
+	hdr.textlen = strlen(source_text);
+
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf, (char *) &hdr, sizeof(hdr));
+
+	for (i = 0; i < hdr.numargs; i++)
+	{
+		appendBinaryStringInfo(&buf, (char *) &args->argtypes[i], sizeof(Oid));
+		appendBinaryStringInfo(&buf, (char *) &args->argtypmods[i], sizeof(int32));
+		appendBinaryStringInfo(&buf, &args->argmodes[i], sizeof(char));
+		/* include the terminating zero so that names can't run together */
+		if (args->argnames && args->argnames[i])
+			appendBinaryStringInfo(&buf, args->argnames[i], strlen(args->argnames[i]) + 1);
+		else
+			appendStringInfoChar(&buf, '\0');
+	}
+
+	appendBinaryStringInfo(&buf, source_text, hdr.textlen);
+
+	*keylen = buf.len;
+	return buf.data;
+}
+
+/*
+ * Find the entry for the given text and arguments, if any.
+ */
+static BatchCacheEntry *
+batch_cache_find(const char *source_text, InlineCodeBlockArgs *args)
+{
+	BatchCacheEntry *entry;
+	char	   *keydata;
+	int			keylen;
+	uint32		hashvalue;
+
+	if (!batch_cache_enabled())
+		return NULL;
+
+	batch_cache_init();
+
+	keydata = batch_cache_make_key(source_text, args, &keylen);
+	hashvalue = hash_bytes((unsigned char *) keydata, keylen);
+
+	entry = (BatchCacheEntry *) hash_search(batch_cache_htab, &hashvalue,
+											HASH_FIND, NULL);
+	if (entry &&
+		(entry->keylen != keylen ||
+		 memcmp(entry->keydata, keydata, keylen) != 0))
+		entry = NULL;
+
+	pfree(keydata);
+	return entry;
+}
+
+/*
+ * batch_cache_lookup - find a compiled batch for the given text and arguments
+ *
+ * Returns NULL on a miss.  The caller is responsible for bumping use_count.
+ */
+PLtsql_function *
+batch_cache_lookup(const char *source_text, InlineCodeBlockArgs *args)
+{
+	BatchCacheEntry *entry;
+
+	if (!batch_cache_enabled())
+		return NULL;
+
+	entry = batch_cache_find(source_text, args);
+	if (entry == NULL)
+	{
+		batch_cache_misses++;
+		return NULL;
+	}
+
+	batch_cache_hits++;
+	dlist_move_head(&batch_cache_lru, &entry->lru_node);
+	return entry->func;
+}
+
+/*
+ * batch_cache_contains - is the batch cached?  Doesn't count as a hit.
+ */
+bool
+batch_cache_contains(const char *source_text, InlineCodeBlockArgs *args)
+{
+	return batch_cache_find(source_text, args) != NULL;
+}
+
+/*
+ * batch_cache_take - remove a compiled batch from the cache and hand it over
+ *
+ * Used when a statement is prepared that the cache already holds.  Returns
+ * NULL on a miss or if the cached copy is executing; otherwise the caller
+ * owns the function.
+ */
+PLtsql_function *
+batch_cache_take(const char *source_text, InlineCodeBlockArgs *args)
+{
+	BatchCacheEntry *entry;
+	PLtsql_function *func;
+
+	entry = batch_cache_find(source_text, args);
+	if (entry == NULL || entry->func->use_count > 0)
+		return NULL;
+
+	func = entry->func;
+	batch_cache_unlink_entry(entry);
+	batch_cache_hits++;
+
+	return func;
+}
+
+/*
+ * batch_cache_insert - remember a freshly compiled batch
+ *
+ * The function's memory context is moved under the cache so that it outlives
+ * the current message.  Returns false if the function was not cached, in
+ * which case the caller still owns it.
+ */
+bool
+batch_cache_insert(const char *source_text, InlineCodeBlockArgs *args,
+				   PLtsql_function *func)
+{
+	BatchCacheEntry *entry;
+	char	   *keydata;
+	int			keylen;
+	uint32		hashvalue;
+	bool		found;
+	Size		bytes;
+	MemoryContext oldcontext;
+
+	if (!batch_cache_enabled())
+		return false;
+
+	batch_cache_init();
+
+	/* Don't bother with batches that alone exceed the memory budget */
+	bytes = MemoryContextMemAllocated(func->fn_cxt, true);
+	if (bytes > (Size) pltsql_batch_cache_memory_kb * 1024)
+		return false;
+
+	keydata = batch_cache_make_key(source_text, args, &keylen);
+	hashvalue = hash_bytes((unsigned char *) keydata, keylen);
+
+	entry = (BatchCacheEntry *) hash_search(batch_cache_htab, &hashvalue,
+											HASH_FIND, NULL);
+	/* On a hash collision the newer batch wins */
+	if (entry)
+		batch_cache_remove_entry(entry);
+
+	entry = (BatchCacheEntry *) hash_search(batch_cache_htab, &hashvalue,
+											HASH_ENTER, &found);
+	Assert(!found);
+
+	oldcontext = MemoryContextSwitchTo(BatchCacheContext);
+	entry->keydata = palloc(keylen);
+	MemoryContextSwitchTo(oldcontext);
+	memcpy(entry->keydata, keydata, keylen);
+	entry->keylen = keylen;
+	entry->func = func;
+	entry->bytes = bytes;
+	batch_cache_collect_types(entry, func);
+	pfree(keydata);
+
+	MemoryContextSetParent(func->fn_cxt, BatchCacheContext);
+
+	dlist_push_head(&batch_cache_lru, &entry->lru_node);
+	batch_cache_entries++;
+	batch_cache_bytes += bytes;
+
+	batch_cache_enforce_limits();
+
+	return true;
+}
+
+/*
+ * batch_cache_release - called when the caller is done executing a function
+ * obtained from the cache.  Frees it if it got evicted in the meantime.
+ */
+void
+batch_cache_release(PLtsql_function *func)
+{
+	if (func->use_count == 0 && list_member_ptr(batch_cache_orphans, func))
+	{
+		batch_cache_orphans = list_delete_ptr(batch_cache_orphans, func);
+		pltsql_free_function_memory(func);
+	}
+}
+
+static void
+batch_cache_unlink_entry(BatchCacheEntry *entry)
+{
+	dlist_delete(&entry->lru_node);
+	batch_cache_entries--;
+	batch_cache_bytes -= entry->bytes;
+	pfree(entry->keydata);
+	pfree(entry->type_hashes);
+
+	hash_search(batch_cache_htab, &entry->hashvalue, HASH_REMOVE, NULL);
+}
+
+static void
+batch_cache_remove_entry(BatchCacheEntry *entry)
+{
+	PLtsql_function *func = entry->func;
+
+	batch_cache_unlink_entry(entry);
+
+	/* Don't pull the rug out from under a running batch */
+	if (func->use_count == 0)
+		pltsql_free_function_memory(func);
+	else
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(BatchCacheContext);
+
+		batch_cache_orphans = lappend(batch_cache_orphans, func);
+		MemoryContextSwitchTo(oldcontext);
+	}
+}
+
+static void
+batch_cache_enforce_limits(void)
+{
+	Size		max_bytes = (Size) pltsql_batch_cache_memory_kb * 1024;
+
+	while (batch_cache_entries > 0 &&
+		   (batch_cache_entries > pltsql_batch_cache_size ||
+			batch_cache_bytes > max_bytes))
+	{
+		BatchCacheEntry *victim;
+
+		victim = dlist_tail_element(BatchCacheEntry, lru_node, &batch_cache_lru);
+		batch_cache_remove_entry(victim);
+		batch_cache_evictions++;
+	}
+}
+
+/*
+ * batch_cache_reset - drop every cached batch, e.g. on sp_reset_connection
+ */
+void
+batch_cache_reset(void)
+{
+	if (batch_cache_htab == NULL)
+		return;
+
+	while (!dlist_is_empty(&batch_cache_lru))
+	{
+		BatchCacheEntry *entry;
+
+		entry = dlist_head_element(BatchCacheEntry, lru_node, &batch_cache_lru);
+		batch_cache_remove_entry(entry);
+	}
+}
+
+/*
+ * Drop the entries that use the invalidated type.  Creating a table, a
+ * #temp table included, invalidates only its own row type, so it leaves the
+ * cache alone.  A zero hash value means the whole syscache was reset.
+ */
+static void
+batch_cache_inval_callback(Datum arg, int cacheid, uint32 hashvalue)
+{
+	dlist_mutable_iter iter;
+
+	if (batch_cache_entries == 0)
+		return;
+
+	if (hashvalue == 0)
+	{
+		batch_cache_invalidations += batch_cache_entries;
+		batch_cache_reset();
+		return;
+	}
+
+	dlist_foreach_modify(iter, &batch_cache_lru)
+	{
+		BatchCacheEntry *entry = dlist_container(BatchCacheEntry, lru_node, iter.cur);
+		int			i;
+
+		for (i = 0; i < entry->ntype_hashes; i++)
+		{
+			if (entry->type_hashes[i] == hashvalue)
+			{
+				batch_cache_remove_entry(entry);
+				batch_cache_invalidations++;
+				break;
+			}
+		}
+	}
+}
+
+Datum
+babelfish_batch_cache_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[6];
+	bool		nulls[6];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum((int64) batch_cache_hits);
+	values[1] = Int64GetDatum((int64) batch_cache_misses);
+	values[2] = Int64GetDatum((int64) batch_cache_evictions);
+	values[3] = Int64GetDatum((int64) batch_cache_invalidations);
+	values[4] = Int32GetDatum(batch_cache_entries);
+	values[5] = Int64GetDatum((int64) batch_cache_bytes);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
@@ -70,6 +70,7 @@ static Walker_context *make_codegen_context(CompileContext *cmpl_ctx)
     generator->exec_codes->codes = create_vector(sizeof(PLtsql_stmt *));
     generator->exec_codes->proc_namespace = NULL;
     generator->exec_codes->proc_name = NULL;
+    generator->exec_codes->profile = NULL;
     MemSet(&hashCtl, 0, sizeof(hashCtl));
     hashCtl.keysize = LABEL_LEN;
     hashCtl.entrysize = sizeof(LabelIndexEntry);
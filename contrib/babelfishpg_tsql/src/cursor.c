@@ -956,6 +956,25 @@ init_tsql_cursor_hash_tab(PG_FUNCTION_ARGS)
 #define SP_CURSOR_OPTION_CODE_CCOPT        0x5
 #define SP_CURSOR_OPTION_CODE_ROWCOUNT     0x6
 
+/*
+ * DestReceiver used by sp_cursorfetch.  Rows are sent straight to the client
+ * through the DestRemote receiver instead of being collected in an SPI
+ * tuptable first.  Scrollable cursors also keep a copy of the last fetched
+ * block in the cursor's fetch buffer so that sp_cursor REFRESH can resend it.
+ */
+typedef struct
+{
+	DestReceiver pub;
+	DestReceiver *remote;
+	Tuplestorestate *fetch_buffer; /* NULL if the block is not kept */
+} CursorFetchDestReceiver;
+
+static DestReceiver *create_cursor_fetch_receiver(Portal portal, Tuplestorestate *fetch_buffer);
+static void cursor_fetch_startup(DestReceiver *self, int operation, TupleDesc typeinfo);
+static bool cursor_fetch_receive(TupleTableSlot *slot, DestReceiver *self);
+static void cursor_fetch_shutdown(DestReceiver *self);
+static void cursor_fetch_destroy(DestReceiver *self);
+
 
 int execute_sp_cursor(int cursor_handle, int opttype, int rownum, const char *tablename, List* values)
 {
@@ -985,7 +1004,11 @@ int execute_sp_cursor(int cursor_handle, int opttype, int rownum, const char *ta
 	if (opttype & SP_CURSOR_OPTTYPE_REFRESH)
 	{
 		if (hentry->fetch_buffer == NULL)
+		{
+			if (hentry->cursor_options & CURSOR_OPT_NO_SCROLL)
+				elog(ERROR, "cursor \"%s\" is forward-only and cannot be refreshed", curname);
 			elog(ERROR, "cursor \"%s\" has no fetch buffer", curname);
+		}
 
 		portal = SPI_cursor_find(hentry->curname);
 
@@ -1076,9 +1099,6 @@ int execute_sp_cursorfetch(int cursor_handle, int *pfetchtype, int *prownum, int
 	int fetchtype;
 	int rownum;
 	int nrows;
-	DestReceiver *receiver;
-	TupleTableSlot *slot;
-	int rno;
 	MemoryContext oldcontext;
 	MemoryContext savedPortalCxt;
 
@@ -1098,8 +1118,12 @@ int execute_sp_cursorfetch(int cursor_handle, int *pfetchtype, int *prownum, int
 
 	validate_and_get_sp_cursorfetch_params(pfetchtype, prownum, pnrows, &fetchtype, &rownum, &nrows);
 
-	/* prepare fetch buffer if not exists */
-	if (hentry->fetch_buffer == NULL)
+	/*
+	 * Prepare fetch buffer if not exists.  Forward-only cursors can't be
+	 * refreshed, so they don't need one.
+	 */
+	if (hentry->fetch_buffer == NULL &&
+	    !(hentry->cursor_options & CURSOR_OPT_NO_SCROLL))
 	{
 		oldcontext = MemoryContextSwitchTo(CursorHashtabContext);
 		hentry->fetch_buffer = tuplestore_begin_heap(true, true, 1024);
@@ -1118,31 +1142,31 @@ int execute_sp_cursorfetch(int cursor_handle, int *pfetchtype, int *prownum, int
 			SPI_scroll_cursor_move(portal, FETCH_ABSOLUTE, 0);
 			/* if needed, return some rows */
 			if (nrows > 0)
-				SPI_scroll_cursor_fetch_dest(portal, FETCH_FORWARD, nrows, CreateDestReceiver(DestSPI));
+				SPI_scroll_cursor_fetch_dest(portal, FETCH_FORWARD, nrows, create_cursor_fetch_receiver(portal, hentry->fetch_buffer));
 			break;
 		case SP_CURSOR_FETCH_NEXT:
 			Assert(nrows > 0);
 			/* fetch in forward direction */
-			SPI_scroll_cursor_fetch_dest(portal, FETCH_FORWARD, nrows, CreateDestReceiver(DestSPI));
+			SPI_scroll_cursor_fetch_dest(portal, FETCH_FORWARD, nrows, create_cursor_fetch_receiver(portal, hentry->fetch_buffer));
 			break;
 		case SP_CURSOR_FETCH_PREV:
 			Assert(nrows > 0);
 			/* fetch in backward direction */
-			SPI_scroll_cursor_fetch_dest(portal, FETCH_BACKWARD, nrows, CreateDestReceiver(DestSPI));
+			SPI_scroll_cursor_fetch_dest(portal, FETCH_BACKWARD, nrows, create_cursor_fetch_receiver(portal, hentry->fetch_buffer));
 			break;
 		case SP_CURSOR_FETCH_LAST:
 			/* advance to end, back up abs(nrows)-1 rows */
 			SPI_scroll_cursor_move(portal, FETCH_ABSOLUTE, -nrows - 1);
 			/* if needed, return some rows */
 			if (nrows > 0)
-				SPI_scroll_cursor_fetch_dest(portal, FETCH_FORWARD, nrows, CreateDestReceiver(DestSPI));
+				SPI_scroll_cursor_fetch_dest(portal, FETCH_FORWARD, nrows, create_cursor_fetch_receiver(portal, hentry->fetch_buffer));
 			break;
 		case SP_CURSOR_FETCH_ABSOLUTE:
 			/* rewind to start, advance count-1 rows */
 			SPI_scroll_cursor_move(portal, FETCH_ABSOLUTE, rownum - 1);
 			Assert(nrows > 0);
 			/* fetch in forward direction */
-			SPI_scroll_cursor_fetch_dest(portal, FETCH_FORWARD, nrows, CreateDestReceiver(DestSPI));
+			SPI_scroll_cursor_fetch_dest(portal, FETCH_FORWARD, nrows, create_cursor_fetch_receiver(portal, hentry->fetch_buffer));
 			break;
 		case SP_CURSOR_FETCH_RELATIVE:
 		case SP_CURSOR_FETCH_REFRESH:
@@ -1156,30 +1180,6 @@ int execute_sp_cursorfetch(int cursor_handle, int *pfetchtype, int *prownum, int
 	if (SPI_result != 0)
 		elog(ERROR, "error in SPI_scroll_cursor_fetch: %d", SPI_result);
 
-	/* In case of FETCH_FIRST/FETCH_LAST with 0 nrows, we just moved cursor and no actual fetch is called. SPI_tuptable can be NULL. skip storing the result */
-	if (SPI_tuptable)
-	{
-		/* store result in fetch buffer */
-		tuplestore_clear(hentry->fetch_buffer);
-
-		oldcontext = MemoryContextSwitchTo(CursorHashtabContext);
-		for (rno = 0; rno < SPI_processed; ++rno)
-			tuplestore_puttuple(hentry->fetch_buffer, SPI_tuptable->vals[rno]);
-		MemoryContextSwitchTo(oldcontext);
-
-		tuplestore_rescan(hentry->fetch_buffer);
-
-		/* send result to DestRemote */
-		receiver = CreateDestReceiver(DestRemote);
-		SetRemoteDestReceiverParams(receiver, portal);
-
-		slot = MakeSingleTupleTableSlot(hentry->tupdesc, &TTSOpsMinimalTuple);
-		receiver->rStartup(receiver, (int) CMD_SELECT, hentry->tupdesc);
-		while (tuplestore_gettupleslot(hentry->fetch_buffer, true, false, slot))
-			receiver->receiveSlot(slot, receiver);
-		receiver->rShutdown(receiver);
-	}
-
 	/* update cursor status */
 	pltsql_update_cursor_fetch_status(curname, SPI_processed == 0 ? -1 : 0);
 	pltsql_update_cursor_row_count(curname, SPI_processed);
@@ -1198,6 +1198,65 @@ int execute_sp_cursorfetch(int cursor_handle, int *pfetchtype, int *prownum, int
 	return 0;
 }
 
+static DestReceiver *
+create_cursor_fetch_receiver(Portal portal, Tuplestorestate *fetch_buffer)
+{
+	CursorFetchDestReceiver *self = (CursorFetchDestReceiver *) palloc0(sizeof(CursorFetchDestReceiver));
+
+	self->pub.receiveSlot = cursor_fetch_receive;
+	self->pub.rStartup = cursor_fetch_startup;
+	self->pub.rShutdown = cursor_fetch_shutdown;
+	self->pub.rDestroy = cursor_fetch_destroy;
+	self->pub.mydest = DestRemote;
+
+	self->remote = CreateDestReceiver(DestRemote);
+	SetRemoteDestReceiverParams(self->remote, portal);
+	self->fetch_buffer = fetch_buffer;
+
+	return (DestReceiver *) self;
+}
+
+static void
+cursor_fetch_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	CursorFetchDestReceiver *myState = (CursorFetchDestReceiver *) self;
+
+	/* the buffer only ever holds the most recently fetched block */
+	if (myState->fetch_buffer)
+		tuplestore_clear(myState->fetch_buffer);
+
+	myState->remote->rStartup(myState->remote, operation, typeinfo);
+}
+
+static bool
+cursor_fetch_receive(TupleTableSlot *slot, DestReceiver *self)
+{
+	CursorFetchDestReceiver *myState = (CursorFetchDestReceiver *) self;
+
+	/* tuplestore copies the tuple into its own memory context */
+	if (myState->fetch_buffer)
+		tuplestore_puttupleslot(myState->fetch_buffer, slot);
+
+	return myState->remote->receiveSlot(slot, myState->remote);
+}
+
+static void
+cursor_fetch_shutdown(DestReceiver *self)
+{
+	CursorFetchDestReceiver *myState = (CursorFetchDestReceiver *) self;
+
+	myState->remote->rShutdown(myState->remote);
+}
+
+static void
+cursor_fetch_destroy(DestReceiver *self)
+{
+	CursorFetchDestReceiver *myState = (CursorFetchDestReceiver *) self;
+
+	myState->remote->rDestroy(myState->remote);
+	pfree(self);
+}
+
 #define BITMAPSIZE(natts) (((natts-1)/8)+1)
 
 int execute_sp_cursoroption(int cursor_handle, int code, int value)
@@ -0,0 +1,137 @@
+/*-------------------------------------------------------------------------
+ *
+ * expr_stats.c	- Per-procedure counts of simple and SPI expression evaluations
+ *
+ * Every expression and SELECT assignment that PL/tsql evaluates either takes
+ * the simple-expression fast path, which calls the executor on the expression
+ * tree directly, or goes through a full SPI plan execution.  The counters
+ * below tell which procedures still spend their time in the latter.
+ *
+ * Counters are kept per backend, keyed by the procedure's OID; batches,
+ * which have no OID, share the entry for InvalidOid.  Entries are never
+ * removed, so a compiled function keeps a pointer to its own.
+ *
+ * IDENTIFICATION
+ *	  contrib/babelfishpg_tsql/src/expr_stats.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/tuplestore.h"
+
+#include "pltsql.h"
+
+typedef struct ExprStatsEntry
+{
+	Oid			fn_oid;			/* hash key */
+	uint64		simple_evals;	/* evaluated by ExecEvalExpr() */
+	uint64		spi_evals;		/* evaluated through SPI */
+} ExprStatsEntry;
+
+static HTAB *expr_stats_htab = NULL;
+
+PG_FUNCTION_INFO_V1(babelfish_expression_stats);
+
+static ExprStatsEntry *
+expr_stats_lookup(Oid fn_oid)
+{
+	ExprStatsEntry *entry;
+	bool		found;
+
+	if (expr_stats_htab == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(ExprStatsEntry);
+		ctl.hcxt = TopMemoryContext;
+		expr_stats_htab = hash_create("PL/tsql expression stats", 64, &ctl,
+									  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = (ExprStatsEntry *) hash_search(expr_stats_htab, &fn_oid,
+										   HASH_ENTER, &found);
+	if (!found)
+	{
+		entry->simple_evals = 0;
+		entry->spi_evals = 0;
+	}
+
+	return entry;
+}
+
+/*
+ * expr_stats_count - account one evaluation in the given function
+ */
+void
+expr_stats_count(PLtsql_function *func, bool simple)
+{
+	ExprStatsEntry *entry = func->expr_stats;
+
+	if (entry == NULL)
+		entry = func->expr_stats = expr_stats_lookup(func->fn_oid);
+
+	if (simple)
+		entry->simple_evals++;
+	else
+		entry->spi_evals++;
+}
+
+Datum
+babelfish_expression_stats(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	MemoryContext oldcontext;
+	HASH_SEQ_STATUS status;
+	ExprStatsEntry *entry;
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (expr_stats_htab == NULL)
+		return (Datum) 0;
+
+	hash_seq_init(&status, expr_stats_htab);
+	while ((entry = (ExprStatsEntry *) hash_seq_search(&status)) != NULL)
+	{
+		Datum		values[3];
+		bool		nulls[3];
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = ObjectIdGetDatum(entry->fn_oid);
+		values[1] = Int64GetDatum((int64) entry->simple_evals);
+		values[2] = Int64GetDatum((int64) entry->spi_evals);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
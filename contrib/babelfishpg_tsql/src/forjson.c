@@ -7,20 +7,57 @@
  */
 #include "postgres.h"
 
+#include "access/htup_details.h"
 #include "executor/spi.h"
 #include "fmgr.h"
+#include "funcapi.h"
+#include "nodes/primnodes.h"
 #include "utils/guc.h"
 #include "lib/stringinfo.h"
 #include "miscadmin.h"
 #include "parser/parser.h"
 #include "utils/builtins.h"
 #include "utils/json.h"
+#include "utils/typcache.h"
+
+#include "pltsql.h"
+
+/*
+ * Transition state of sys.tsql_select_for_json_agg. The document is built
+ * directly in the aggregate context as the rows arrive; the per-column
+ * information is looked up once, on the first row.
+ */
+typedef struct ForJsonAggState
+{
+	StringInfoData result;
+	uint64		rows;
+	bool		include_null_value;
+	bool		without_array_wrapper;
+	char	   *root_name;
+
+	Oid			tupType;
+	int32		tupTypmod;
+	TupleDesc	tupdesc;
+	int			natts;
+	Datum	   *colnames;		/* column names, as cstring datums */
+	Oid		   *coltypes;
+	Datum	   *values;			/* workspace for deforming rows */
+	bool	   *nulls;
+} ForJsonAggState;
 
 static StringInfo tsql_query_to_json_internal(const char *query, int mode, bool include_null_value,
 								bool without_array_wrapper, const char *root_name);
 static void SPI_sql_row_to_json_path(uint64 rownum, StringInfo result, bool include_null_value);
+static void tsql_json_check_column_name(const char *colname);
+static void tsql_json_begin(StringInfo result, bool without_array_wrapper, const char *root_name);
+static void tsql_json_end(StringInfo result, bool without_array_wrapper, const char *root_name);
+static void for_json_agg_setup_columns(ForJsonAggState *state, MemoryContext aggcontext,
+									   HeapTupleHeader td);
+static Datum for_json_agg_option(FunctionCallInfo fcinfo, int argno, bool *isnull);
 
 PG_FUNCTION_INFO_V1(tsql_query_to_json_text);
+PG_FUNCTION_INFO_V1(tsql_select_for_json_sfunc);
+PG_FUNCTION_INFO_V1(tsql_select_for_json_finalfunc);
 
 
 Datum 
@@ -62,13 +99,7 @@ SPI_sql_row_to_json_path(uint64 rownum, StringInfo result, bool include_null_val
 		Datum		colval;
 		
 		colname = SPI_fname(SPI_tuptable->tupdesc, i);
-		
-		if (!strcmp(colname,"\?column\?")) /* When column name or alias is not provided */
-		{
-			ereport(ERROR,
-							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-							 errmsg("Column expressions and data sources without names or aliases cannot be formatted as JSON text using FOR JSON clause. Add alias to the unnamed column or table")));
-		}
+		tsql_json_check_column_name(colname);
 		
 		colval = SPI_getbinval(SPI_tuptable->vals[rownum],
 							   SPI_tuptable->tupdesc,
@@ -102,22 +133,31 @@ tsql_query_to_json_internal(const char *query, int mode, bool include_null_value
 	StringInfo	result;
 	uint64		i;
 
-	set_config_option("babelfishpg_tsql.sql_dialect", "tsql",
-					  (superuser() ? PGC_SUSET : PGC_USERSET),
-					  PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
+	int			saved_dialect;
+	int			rc;
+
 	result = makeStringInfo();
 
 	SPI_connect();
-	if (SPI_execute(query, true, 0) != SPI_OK_SELECT)
+
+	/* The query text is T-SQL, whatever the caller's dialect */
+	saved_dialect = pltsql_enter_dialect(SQL_DIALECT_TSQL);
+	PG_TRY();
+	{
+		rc = SPI_execute(query, true, 0);
+	}
+	PG_FINALLY();
+	{
+		pltsql_leave_dialect(saved_dialect);
+	}
+	PG_END_TRY();
+
+	if (rc != SPI_OK_SELECT)
 		ereport(ERROR,
 				(errcode(ERRCODE_DATA_EXCEPTION),
 				 errmsg("invalid query")));
 
-	/* If root_name is present then WITHOUT_ARRAY_WRAPPER will be FALSE */
-	if(root_name)
-		appendStringInfo(result, "{\"%s\":[",root_name);
-	else if (!without_array_wrapper)
-		appendStringInfoChar(result,'[');
+	tsql_json_begin(result, without_array_wrapper, root_name);
 
 	/* Format the query result according to the mode specified by the query */
 	switch (mode)
@@ -141,10 +181,217 @@ tsql_query_to_json_internal(const char *query, int mode, bool include_null_value
 	SPI_finish();
 
 
+	tsql_json_end(result, without_array_wrapper, root_name);
+
+	return result;
+}
+
+static void
+tsql_json_check_column_name(const char *colname)
+{
+	if (!strcmp(colname,"\?column\?")) /* When column name or alias is not provided */
+	{
+		ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("Column expressions and data sources without names or aliases cannot be formatted as JSON text using FOR JSON clause. Add alias to the unnamed column or table")));
+	}
+}
+
+static void
+tsql_json_begin(StringInfo result, bool without_array_wrapper, const char *root_name)
+{
+	/* If root_name is present then WITHOUT_ARRAY_WRAPPER will be FALSE */
+	if(root_name)
+		appendStringInfo(result, "{\"%s\":[",root_name);
+	else if (!without_array_wrapper)
+		appendStringInfoChar(result,'[');
+}
+
+static void
+tsql_json_end(StringInfo result, bool without_array_wrapper, const char *root_name)
+{
 	if(root_name)
 		appendStringInfoString(result, "]}");
 	else if (!without_array_wrapper)
 		appendStringInfoChar(result,']');
+}
 
-	return result;
+/*
+ * FOR JSON PATH as an aggregate.
+ *
+ * The grammar turns
+ *     select a from t order by a for json path
+ * into
+ *     select sys.tsql_select_for_json_agg(rows.*, ...) from (select a from t order by a) rows
+ * so the query is planned and run once as part of the enclosing statement,
+ * variables bind as in any other query, and each row is appended to the
+ * document as it arrives instead of the whole result being materialized
+ * through SPI first.
+ */
+Datum
+tsql_select_for_json_sfunc(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	MemoryContext oldcontext;
+	ForJsonAggState *state;
+	HeapTupleHeader td;
+	HeapTupleData tuple;
+	const char *sep = "";
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "tsql_select_for_json_sfunc called in non-aggregate context");
+
+	if (PG_ARGISNULL(0))
+	{
+		if (PG_ARGISNULL(2) || PG_GETARG_INT32(2) != TSQL_FORJSON_PATH)
+			ereport(ERROR,
+						(errcode(ERRCODE_INTERNAL_ERROR),
+							errmsg("invalid FOR JSON mode")));
+
+		oldcontext = MemoryContextSwitchTo(aggcontext);
+		state = (ForJsonAggState *) palloc0(sizeof(ForJsonAggState));
+		initStringInfo(&state->result);
+		state->include_null_value = !PG_ARGISNULL(3) && PG_GETARG_BOOL(3);
+		state->without_array_wrapper = !PG_ARGISNULL(4) && PG_GETARG_BOOL(4);
+		state->root_name = PG_ARGISNULL(5) ? NULL : text_to_cstring(PG_GETARG_TEXT_PP(5));
+		tsql_json_begin(&state->result, state->without_array_wrapper, state->root_name);
+		MemoryContextSwitchTo(oldcontext);
+	}
+	else
+		state = (ForJsonAggState *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+		PG_RETURN_POINTER(state);
+
+	td = PG_GETARG_HEAPTUPLEHEADER(1);
+	if (state->tupdesc == NULL ||
+		HeapTupleHeaderGetTypeId(td) != state->tupType ||
+		HeapTupleHeaderGetTypMod(td) != state->tupTypmod)
+		for_json_agg_setup_columns(state, aggcontext, td);
+
+	tuple.t_len = HeapTupleHeaderGetDatumLength(td);
+	ItemPointerSetInvalid(&(tuple.t_self));
+	tuple.t_tableOid = InvalidOid;
+	tuple.t_data = td;
+
+	heap_deform_tuple(&tuple, state->tupdesc, state->values, state->nulls);
+
+	/*
+	 * Anything the per-column conversions allocate goes into the per-row
+	 * context and is released before the next row.
+	 */
+	if (state->rows++ > 0)
+		appendStringInfoChar(&state->result, ',');
+	appendStringInfoChar(&state->result, '{');
+	for (int i = 0; i < state->natts; i++)
+	{
+		if (state->nulls[i] && !state->include_null_value)
+			continue;
+
+		appendStringInfoString(&state->result, sep);
+		sep = ",";
+		tsql_json_build_object(&state->result, state->colnames[i],
+							   state->values[i], state->coltypes[i],
+							   state->nulls[i]);
+	}
+	appendStringInfoChar(&state->result, '}');
+
+	PG_RETURN_POINTER(state);
+}
+
+Datum
+tsql_select_for_json_finalfunc(PG_FUNCTION_ARGS)
+{
+	ForJsonAggState *state;
+	StringInfoData result;
+	Datum		value;
+	bool		isnull;
+	bool		without_array_wrapper;
+	char	   *root_name;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "tsql_select_for_json_finalfunc called in non-aggregate context");
+
+	if (!PG_ARGISNULL(0))
+	{
+		state = (ForJsonAggState *) PG_GETARG_POINTER(0);
+		tsql_json_end(&state->result, state->without_array_wrapper, state->root_name);
+
+		PG_RETURN_TEXT_P(cstring_to_text_with_len(state->result.data, state->result.len));
+	}
+
+	/*
+	 * No rows, so the transition function never ran. We still need the
+	 * directives to produce the empty document, and they are constants in the
+	 * aggregate call itself.
+	 */
+	without_array_wrapper = DatumGetBool(for_json_agg_option(fcinfo, 3, &isnull));
+	if (isnull)
+		without_array_wrapper = false;
+	root_name = NULL;
+	value = for_json_agg_option(fcinfo, 4, &isnull);
+	if (!isnull)
+		root_name = TextDatumGetCString(value);
+
+	initStringInfo(&result);
+	tsql_json_begin(&result, without_array_wrapper, root_name);
+	tsql_json_end(&result, without_array_wrapper, root_name);
+
+	PG_RETURN_TEXT_P(cstring_to_text_with_len(result.data, result.len));
+}
+
+/*
+ * Look up the column names and types of the rows being aggregated. This is
+ * done once per query rather than once per row.
+ */
+static void
+for_json_agg_setup_columns(ForJsonAggState *state, MemoryContext aggcontext,
+						   HeapTupleHeader td)
+{
+	MemoryContext oldcontext;
+	TupleDesc	tupdesc;
+
+	state->tupType = HeapTupleHeaderGetTypeId(td);
+	state->tupTypmod = HeapTupleHeaderGetTypMod(td);
+
+	tupdesc = lookup_rowtype_tupdesc(state->tupType, state->tupTypmod);
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	state->tupdesc = CreateTupleDescCopy(tupdesc);
+	state->natts = tupdesc->natts;
+	state->colnames = (Datum *) palloc(state->natts * sizeof(Datum));
+	state->coltypes = (Oid *) palloc(state->natts * sizeof(Oid));
+	state->values = (Datum *) palloc(state->natts * sizeof(Datum));
+	state->nulls = (bool *) palloc(state->natts * sizeof(bool));
+	for (int i = 0; i < state->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+		tsql_json_check_column_name(NameStr(attr->attname));
+		state->colnames[i] = CStringGetDatum(pstrdup(NameStr(attr->attname)));
+		state->coltypes[i] = attr->atttypid;
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	ReleaseTupleDesc(tupdesc);
+}
+
+/*
+ * Fetch one of the constant directive arguments of the aggregate call.
+ */
+static Datum
+for_json_agg_option(FunctionCallInfo fcinfo, int argno, bool *isnull)
+{
+	Aggref	   *aggref = AggGetAggref(fcinfo);
+	TargetEntry *tle;
+
+	if (aggref == NULL || list_length(aggref->args) <= argno)
+		elog(ERROR, "could not find FOR JSON directives");
+
+	tle = list_nth_node(TargetEntry, aggref->args, argno);
+	if (!IsA(tle->expr, Const))
+		elog(ERROR, "FOR JSON directives must be constants");
+
+	*isnull = ((Const *) tle->expr)->constisnull;
+	return ((Const *) tle->expr)->constvalue;
 }
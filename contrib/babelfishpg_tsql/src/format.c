@@ -9,7 +9,11 @@
 #include "parser/parse_coerce.h"
 #include "utils/builtins.h"
 #include "utils/elog.h"
+#include "utils/float.h"
+#include "utils/hsearch.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/pg_locale.h"
 #include "utils/varlena.h"
 #include "regex/regex.h"
 
@@ -45,12 +49,11 @@ format_datetime(PG_FUNCTION_ARGS)
 {
 	Datum 	arg_value;
 	Oid 	arg_type_oid;
-	const char 	*format_pattern;
-	const char	*culture;
+	char 	*format_pattern;
+	char	*culture;
 	const char 	*data_type;
-	int 	fmt_res = 0;
 	const char 	*data_str;
-	const char 	*valid_culture;
+	FormatProgram *program;
 	StringInfo 	buf;
 	VarChar *result;
 
@@ -59,14 +62,12 @@ format_datetime(PG_FUNCTION_ARGS)
 
 	culture = text_to_cstring(PG_GETARG_TEXT_P(2));
 
-	valid_culture = format_validate_and_culture(culture, "LC_TIME");
-
-	buf = makeStringInfo();
-
 	arg_type_oid = get_fn_expr_argtype(fcinfo->flinfo, 0);
 
 	if (PG_ARGISNULL(1))
 	{
+		/* still complain about an invalid culture */
+		format_validate_and_culture(culture);
 		PG_RETURN_NULL();
 	}
 	else
@@ -83,34 +84,26 @@ format_datetime(PG_FUNCTION_ARGS)
 		data_type = "";
 	}
 
-	if (strlen(format_pattern) <= 1)
-	{
-		if (arg_type_oid == TIMEOID)
-		{
-			data_str = DatumGetCString(DirectFunctionCall1(time_out, PG_GETARG_DATUM(0)));
-		}
-		else
-		{
-			data_str = "";
-		}
-
-		fmt_res = format_datetimeformats(buf, format_pattern, culture, data_type, data_str);
-	}
-	else
+	/*
+	 * The standard time formats depend on whether the value has fractional
+	 * seconds, so that is part of what the program is compiled for.
+	 */
+	data_str = "";
+	if (strlen(format_pattern) <= 1 && arg_type_oid == TIMEOID)
 	{
-		fmt_res = process_format_pattern(buf, format_pattern, data_type);
+		data_str = DatumGetCString(DirectFunctionCall1(time_out, PG_GETARG_DATUM(0)));
+		data_str = strchr(data_str, '.') ? "00:00:00.0" : "00:00:00";
 	}
 
-	if (fmt_res <= 0)
-	{
-		pfree(buf->data);
-		pfree(buf);
+	program = get_format_program('D', arg_type_oid, culture, format_pattern, data_type, data_str);
 
-		if (fmt_res == 0)
+	if (program->status <= 0)
+	{
+		if (program->status == 0)
 		{
 			PG_RETURN_NULL();
 		}
-		else if (fmt_res == -1)
+		else if (program->status == -1)
 		{
 			ereport(ERROR,
 					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
@@ -126,15 +119,19 @@ format_datetime(PG_FUNCTION_ARGS)
 		}
 	}
 
+	if (program->needs_locale)
+		set_culture(program->locale, "LC_TIME", locale_time);
+
+	buf = makeStringInfo();
 	arg_value = PG_GETARG_DATUM(0);
 
 	switch (arg_type_oid)
 	{
 	case TIMEOID:
-		data_to_char(DirectFunctionCall1(time_interval, arg_value), TIMEOID, buf);
+		data_to_char(DirectFunctionCall1(time_interval, arg_value), TIMEOID, program->to_char_fmt, buf);
 		break;
 	case TIMESTAMPOID:
-		data_to_char(arg_value, TIMESTAMPOID, buf);
+		data_to_char(arg_value, TIMESTAMPOID, program->to_char_fmt, buf);
 		break;
 	default:
 		pfree(buf);
@@ -165,14 +162,12 @@ format_numeric(PG_FUNCTION_ARGS)
 	Numeric numeric_val;
 	Oid 	arg_type_oid;
 	char 	*culture;
-	char 	*valid_culture;
+	FormatProgram *program;
 	char 	pattern;
-	char 	*precision_string;
 	int 	sig_len;
 	char 	*temp_pattern;
 	char	real_pattern[120];
 	char 	upper_pattern;
-	const 	char *format_re = "^[cdefgnprxCDEFGNPRX]{1}[0-9]*$";
 	VarChar *result;
 
 	if (PG_ARGISNULL(0))
@@ -180,26 +175,19 @@ format_numeric(PG_FUNCTION_ARGS)
 
 	culture = text_to_cstring(PG_GETARG_TEXT_P(2));
 
-	valid_culture = format_validate_and_culture(culture, "LC_NUMERIC");
-
 	format_pattern = text_to_cstring(PG_GETARG_TEXT_P(1));
 
-	if (match(format_pattern, format_re) == 0)
-	{
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-				 errmsg("%s is not supported/invalid format when converting from NUMERIC to a character string.", format_pattern),
-				 errdetail("Use of incorrect \"format\" parameter value during conversion process."),
-				 errhint("Change \"format\" parameter value and try again.")));
-	}
-
-	pattern = format_pattern[0];
-	upper_pattern = toupper(pattern);
-	precision_string = TextDatumGetCString(DirectFunctionCall2(text_substr_no_len, PG_GETARG_DATUM(1), Int32GetDatum((int32)2)));
-
 	data_type = text_to_cstring(PG_GETARG_TEXT_P(3));
 	arg_type_oid = get_fn_expr_argtype(fcinfo->flinfo, 0);
 
+	program = get_format_program('N', arg_type_oid, culture, format_pattern, "", "");
+
+	if (program->needs_locale)
+		set_culture(program->locale, "LC_NUMERIC", locale_numeric);
+
+	pattern = program->pattern;
+	upper_pattern = toupper(pattern);
+
 	switch (arg_type_oid)
 	{
 	case INT2OID:
@@ -211,7 +199,8 @@ format_numeric(PG_FUNCTION_ARGS)
 		numeric_val = PG_GETARG_NUMERIC(0);
 		break;
 	case FLOAT4OID:
-		set_config_option("extra_float_digits", "1", PGC_USERSET, PGC_S_SESSION, GUC_ACTION_LOCAL, true, 0, false);
+		if (extra_float_digits != 1)
+			set_config_option("extra_float_digits", "1", PGC_USERSET, PGC_S_SESSION, GUC_ACTION_LOCAL, true, 0, false);
 
 		if (upper_pattern == 'R')
 		{
@@ -242,7 +231,7 @@ format_numeric(PG_FUNCTION_ARGS)
 				{
 					if (isupper(pattern))
 					{
-						regexp_replace(format_res->data, "[.]{0,1}0*[eE]", "E", "i");
+						trim_exponent_mantissa(format_res->data);
 					}
 
 					result = tsql_varchar_input(format_res->data, format_res->len, -1);
@@ -274,7 +263,8 @@ format_numeric(PG_FUNCTION_ARGS)
 		}
 		break;
 	case FLOAT8OID:
-		set_config_option("extra_float_digits", "1", PGC_USERSET, PGC_S_SESSION, GUC_ACTION_LOCAL, true, 0, false);
+		if (extra_float_digits != 1)
+			set_config_option("extra_float_digits", "1", PGC_USERSET, PGC_S_SESSION, GUC_ACTION_LOCAL, true, 0, false);
 
 		if (upper_pattern == 'R')
 		{
@@ -307,7 +297,7 @@ format_numeric(PG_FUNCTION_ARGS)
 		break;
 	}
 
-	format_numeric_handler(datum_val, numeric_val, format_res, pattern, precision_string, arg_type_oid, culture, valid_culture, data_type);
+	format_numeric_handler(datum_val, numeric_val, format_res, pattern, program->precision_string, arg_type_oid, culture, program->locale, data_type);
 
 	if (format_res->len > 0)
 	{
@@ -324,7 +314,7 @@ format_numeric(PG_FUNCTION_ARGS)
 
 static void
 format_numeric_handler(Datum value, Numeric numeric_val, StringInfo format_res, char pattern, char *precision_string,
-					 Oid arg_type_oid, char *culture, char *valid_culture, char *data_type)
+					 Oid arg_type_oid, char *culture, const char *locale, char *data_type)
 {
 	char upper_pattern = toupper(pattern);
 	resetStringInfo(format_res);
@@ -332,8 +322,8 @@ format_numeric_handler(Datum value, Numeric numeric_val, StringInfo format_res,
 	switch (upper_pattern)
 	{
 	case 'C':
-		if (set_culture(valid_culture, "LC_MONETARY", culture) == 1)
-			format_currency(numeric_val, format_res, upper_pattern, precision_string, culture);
+		set_culture(locale, "LC_MONETARY", locale_monetary);
+		format_currency(numeric_val, format_res, upper_pattern, precision_string, culture);
 		break;
 	case 'D':
 		format_decimal(numeric_val, format_res, upper_pattern, precision_string, arg_type_oid);
@@ -366,34 +356,172 @@ format_numeric_handler(Datum value, Numeric numeric_val, StringInfo format_res,
 
 
 /*
- * Function for setting validated input locales for LC_TIME, LC_NUMERIC, LC_MONETARY
+ * Function for setting validated input locales for LC_TIME, LC_NUMERIC, LC_MONETARY.
+ * The setting lasts until the end of the transaction, so the GUC is only
+ * touched when the culture changes, and the locale data that pg_locale.c
+ * caches for to_char() stays valid from one call to the next.
+ *
+ * The locale can't be kept with the compiled program instead: to_char()
+ * takes it from these GUCs and nowhere else.  Programs whose output doesn't
+ * depend on the locale skip this altogether, so that only the calls that
+ * need another culture's names or separators switch it.
  */
-static int
-set_culture(char *valid_culture, const char *config_name, char *culture)
+static void
+set_culture(const char *locale, const char *config_name, const char *current)
+{
+	if (current == NULL || strcmp(current, locale) != 0)
+		set_config_option(config_name, locale,
+						  PGC_USERSET, PGC_S_SESSION,
+						  GUC_ACTION_LOCAL, true, 0, false);
+}
+
+/*
+ * Whether a to_char() mask has fields that are spelled out in the language
+ * of LC_TIME, i.e. TM-prefixed day and month names.  Quoted text is copied
+ * as it is, so a "TM" inside it doesn't count.
+ */
+static bool
+format_mask_uses_locale(const char *mask)
 {
-	if (valid_culture != NULL && strlen(valid_culture) > 0)
+	bool		quoted = false;
+
+	for (const char *cp = mask; *cp; cp++)
 	{
-		if (pg_strcasecmp(config_name, "LC_MONETARY") != 0)
+		if (*cp == '\\' && cp[1] != '\0')
+			cp++;
+		else if (*cp == '"')
+			quoted = !quoted;
+		else if (!quoted && pg_strncasecmp(cp, "TM", 2) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Per-backend cache of compiled FORMAT() programs, keyed on the kind of
+ * FORMAT() call, the argument type, the culture and the pattern.  Reports
+ * call FORMAT() with the same few patterns over many rows, so this saves
+ * validating the culture and parsing the pattern on every call.
+ */
+#define FORMAT_PROGRAM_CACHE_SIZE 1024
+
+static HTAB *FormatProgramCache = NULL;
+static MemoryContext FormatProgramContext = NULL;
+
+static FormatProgram *
+get_format_program(char kind, Oid arg_type_oid, char *culture, char *format_pattern, const char *data_type, const char *data_val)
+{
+	char		key[FORMAT_PROGRAM_KEYSIZE];
+	FormatProgram *program;
+	FormatProgram compiled;
+	StringInfoData buf;
+	bool		found;
+	int			len;
+	const char	*format_re = "^[cdefgnprxCDEFGNPRX]{1}[0-9]*$";
+
+	len = snprintf(key, sizeof(key), "%c%u:%zu:%s:%zu:%s:%s:%s",
+				   kind, arg_type_oid, strlen(culture), culture,
+				   strlen(format_pattern), format_pattern, data_type, data_val);
+
+	if (FormatProgramCache != NULL && len < sizeof(key))
+	{
+		program = (FormatProgram *) hash_search(FormatProgramCache, key, HASH_FIND, NULL);
+		if (program != NULL)
+			return program;
+	}
+
+	/* compile it; errors are raised here and never cached */
+	memset(&compiled, 0, sizeof(compiled));
+	compiled.locale = format_validate_and_culture(culture);
+
+	if (kind == 'D')
+	{
+		initStringInfo(&buf);
+		if (strlen(format_pattern) <= 1)
+			compiled.status = format_datetimeformats(&buf, format_pattern, culture, data_type, data_val);
+		else
+			compiled.status = process_format_pattern(&buf, format_pattern, (char *) data_type);
+		if (compiled.status > 0)
 		{
-			strncat(valid_culture, ".UTF-8", 7);
+			compiled.to_char_fmt = cstring_to_text(buf.data);
+			compiled.needs_locale = format_mask_uses_locale(buf.data);
 		}
-
-		set_config_option(config_name, valid_culture,
-						  PGC_USERSET, PGC_S_SESSION,
-						  GUC_ACTION_LOCAL, true, 0, false);
 	}
 	else
 	{
-		return 0;
+		if (match(format_pattern, format_re) == 0)
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("%s is not supported/invalid format when converting from NUMERIC to a character string.", format_pattern),
+					 errdetail("Use of incorrect \"format\" parameter value during conversion process."),
+					 errhint("Change \"format\" parameter value and try again.")));
+		}
+
+		compiled.pattern = format_pattern[0];
+		compiled.precision_string = format_pattern + 1;
+
+		/*
+		 * Only hexadecimal output has no separators or currency symbol, but
+		 * floating point values still go through to_char() on the way there.
+		 */
+		compiled.needs_locale = (toupper(compiled.pattern) != 'X' ||
+								 arg_type_oid == FLOAT4OID ||
+								 arg_type_oid == FLOAT8OID);
 	}
-	return 1;
+
+	/* patterns too long for the key are used once and not cached */
+	if (len >= sizeof(key))
+	{
+		program = palloc(sizeof(FormatProgram));
+		*program = compiled;
+		return program;
+	}
+
+	if (FormatProgramCache == NULL ||
+		hash_get_num_entries(FormatProgramCache) >= FORMAT_PROGRAM_CACHE_SIZE)
+	{
+		HASHCTL		ctl;
+
+		if (FormatProgramContext == NULL)
+			FormatProgramContext = AllocSetContextCreate(TopMemoryContext,
+														 "FORMAT() program cache",
+														 ALLOCSET_DEFAULT_SIZES);
+		else
+			MemoryContextReset(FormatProgramContext);
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = FORMAT_PROGRAM_KEYSIZE;
+		ctl.entrysize = sizeof(FormatProgram);
+		ctl.hcxt = FormatProgramContext;
+		FormatProgramCache = hash_create("FORMAT() program cache", 64, &ctl,
+										 HASH_ELEM | HASH_STRINGS | HASH_CONTEXT);
+	}
+
+	program = (FormatProgram *) hash_search(FormatProgramCache, key, HASH_ENTER, &found);
+	program->status = compiled.status;
+	program->locale = MemoryContextStrdup(FormatProgramContext, compiled.locale);
+	program->needs_locale = compiled.needs_locale;
+	program->to_char_fmt = NULL;
+	if (compiled.to_char_fmt != NULL)
+	{
+		program->to_char_fmt = MemoryContextAlloc(FormatProgramContext, VARSIZE(compiled.to_char_fmt));
+		memcpy(program->to_char_fmt, compiled.to_char_fmt, VARSIZE(compiled.to_char_fmt));
+	}
+	program->pattern = compiled.pattern;
+	program->precision_string = compiled.precision_string ?
+		MemoryContextStrdup(FormatProgramContext, compiled.precision_string) : NULL;
+
+	return program;
 }
 
 /*
- * format the given input locale to supported locale format and set it accordingly
+ * format the given input locale to supported locale format, e.g. "en-us" to
+ * "en_US.UTF-8", and check that it is supported
  */
 static char *
-format_validate_and_culture(char *culture, const char *config_name)
+format_validate_and_culture(char *culture)
 {
 	int 	culture_len = 0;
 	char 	*token;
@@ -448,8 +576,9 @@ format_validate_and_culture(char *culture, const char *config_name)
 
 		locale_pos = find_locale((const char *)temp_res);
 
-		if (locale_pos >= 0 && set_culture(temp_res, config_name, culture) == 1)
+		if (locale_pos >= 0)
 		{
+			strncat(temp_res, ".UTF-8", 7);
 			return temp_res;
 		}
 
@@ -1212,7 +1341,7 @@ process_format_pattern(StringInfo buf, char *msg_string, char *data_type)
  *	Converting the date, time values to char
  */
 static void
-data_to_char(Datum data, Oid data_type, StringInfo buf)
+data_to_char(Datum data, Oid data_type, text *fmt, StringInfo buf)
 {
 	char	*result;
 
@@ -1220,11 +1349,11 @@ data_to_char(Datum data, Oid data_type, StringInfo buf)
 	{
 	case TIMEOID:
 		result = TextDatumGetCString(DirectFunctionCall2Coll(interval_to_char, C_COLLATION_OID, data,
-															 PointerGetDatum(cstring_to_text((const char *)buf->data))));
+															 PointerGetDatum(fmt)));
 		break;
 	case TIMESTAMPOID:
 		result = TextDatumGetCString(DirectFunctionCall2Coll(timestamp_to_char, C_COLLATION_OID, data,
-															 PointerGetDatum(cstring_to_text((const char *)buf->data))));
+															 PointerGetDatum(fmt)));
 		break;
 	default:
 		break;
@@ -1500,23 +1629,29 @@ float8_data_to_char(StringInfo format_res, Datum num)
 }
 
 /*
- * Replace the string matched by regular expression "match_with"
- * with "replace_with" and set it to the format result
+ * Replace the first match of "[.]{0,1}0*[eE]" in the format result with "E",
+ * i.e. drop the trailing zeros of the mantissa of a number in scientific
+ * notation.  This is done in place, the result is never longer.
  */
 static void
-regexp_replace(char *format_res, char *match_with, const char *replace_with, char *flag)
+trim_exponent_mantissa(char *format_res)
 {
-	text	   *s = cstring_to_text(format_res);
-	text	   *p = cstring_to_text(match_with);
-	text	   *r = cstring_to_text(replace_with);
-	regex_t    *re;
-	char 	   *result;
-
-	re = RE_compile_and_cache(p, REG_ADVANCED, C_COLLATION_OID);
+	for (char *start = format_res; *start; start++)
+	{
+		char *end = start;
 
-	result = text_to_cstring(replace_text_regexp(s, (void *) re, r, false));
+		if (*end == '.')
+			end++;
+		while (*end == '0')
+			end++;
 
-	strncpy(format_res, result, strlen(result) + 1);
+		if (*end == 'e' || *end == 'E')
+		{
+			*start = 'E';
+			memmove(start + 1, end + 1, strlen(end + 1) + 1);
+			return;
+		}
+	}
 }
 
 /*
@@ -1972,7 +2107,7 @@ format_compact(Numeric numeric_val, StringInfo format_res, char pattern, char *p
 
 		if (isupper(pattern))
 		{
-			regexp_replace(format_res->data, "[.]{0,1}0*[eE]", "E", "i");
+			trim_exponent_mantissa(format_res->data);
 		}
 	}
 }
@@ -2036,7 +2171,7 @@ format_roundtrip(Datum value, Numeric numeric_val, StringInfo format_res, char p
 
 			if (isupper(pattern))
 			{
-				regexp_replace(format_res->data, "[.]{0,1}0*[eE]", "E", "i");
+				trim_exponent_mantissa(format_res->data);
 			}
 		}
 		break;
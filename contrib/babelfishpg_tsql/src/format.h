@@ -1726,14 +1726,33 @@ static const struct currencyformat
 	{841, "zh-CHS", "Ln", "L-n", 2},
 	{842, "zh-CHT", "Ln", "(Ln)", 2}};
 
+/*
+ * A FORMAT() pattern compiled for one culture and argument type, cached per
+ * backend so that repeated calls skip parsing and validation.
+ */
+#define FORMAT_PROGRAM_KEYSIZE 256
+
+typedef struct FormatProgram
+{
+	char	key[FORMAT_PROGRAM_KEYSIZE];	/* hash key, must be first */
+	int		status;				/* datetime: result of compiling the pattern */
+	char   *locale;				/* validated culture, e.g. "en_US.UTF-8" */
+	bool	needs_locale;		/* output depends on the culture's locale */
+	text   *to_char_fmt;		/* datetime: to_char() format mask */
+	char	pattern;			/* numeric: format specifier */
+	char   *precision_string;	/* numeric: precision following the specifier */
+} FormatProgram;
+
 /*
  * Functions related to FORMAT() function in string.c
  */
-static int set_culture(char *valid_culture, const char *config_name, char *culture);
-static char *format_validate_and_culture(char *culture, const char *config_name);
+static void set_culture(const char *locale, const char *config_name, const char *current);
+static char *format_validate_and_culture(char *culture);
+static bool format_mask_uses_locale(const char *mask);
+static FormatProgram *get_format_program(char kind, Oid arg_type_oid, char *culture, char *format_pattern, const char *data_type, const char *data_val);
 static int format_datetimeformats(StringInfo buf, const char *format_pattern, const char *culture, const char *data_type, const char *data_val);
 static int process_format_pattern(StringInfo buf, char *msg_string, char *data_type);
-static void data_to_char(Datum data, Oid data_type, StringInfo buf);
+static void data_to_char(Datum data, Oid data_type, text *fmt, StringInfo buf);
 
 static char *get_currency_sign_format(const char *culture, int positive);
 static int get_currency_decimal_digits(const char *culture);
@@ -1761,7 +1780,7 @@ static void float4_data_to_char(StringInfo format_res, Datum num);
 static void float8_data_to_char(StringInfo format_res, Datum num);
 
 static char* repeat_string(char *val, int count);
-static void regexp_replace(char *format_res, char *match_with, const char *replace_with, char *flag);
+static void trim_exponent_mantissa(char *format_res);
 static int match(const char *string, const char *pattern);
 
 static void format_currency(Numeric numeric_val, StringInfo format_res, char pattern, char *precision_string, char* culture);
@@ -1774,6 +1793,6 @@ static void format_exponential(Numeric numeric_val, StringInfo format_res, char
 static void format_compact(Numeric numeric_val, StringInfo format_res, char pattern, char *precision_string, char *data_type, Oid arg_type_oid);
 static void format_roundtrip(Datum value, Numeric numeric_val, StringInfo format_res, char pattern, char *data_type, Oid arg_type_oid);
 static void format_numeric_handler(Datum value, Numeric numeric_val, StringInfo format_res, char pattern, char *precision_string,
-												Oid arg_type_oid, char *culture, char *valid_culture, char *data_type);
+												Oid arg_type_oid, char *culture, const char *locale, char *data_type);
 
 #endif
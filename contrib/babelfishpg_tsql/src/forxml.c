@@ -7,15 +7,69 @@
  */
 #include "postgres.h"
 
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
 #include "executor/spi.h"
 #include "fmgr.h"
+#include "funcapi.h"
+#include "nodes/primnodes.h"
 #include "utils/guc.h"
 #include "lib/stringinfo.h"
 #include "miscadmin.h"
 #include "parser/parser.h"
 #include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/typcache.h"
 #include "utils/xml.h"
 
+#include "pltsql.h"
+
+/*
+ * The FOR XML aggregates collect the document in a list of fixed-size
+ * chunks, so that a large document is never copied around while it grows
+ * and is assembled only once, in the final function.
+ */
+#define FOR_XML_CHUNK_SIZE	(64 * 1024)
+
+typedef struct ForXmlChunk
+{
+	struct ForXmlChunk *next;
+	int			len;
+	char		data[FOR_XML_CHUNK_SIZE];
+} ForXmlChunk;
+
+/* How a column value is converted to text, decided once per result set */
+typedef struct ForXmlColumn
+{
+	Oid			typid;
+	bool		generic;		/* needs map_sql_value_to_xml_value */
+	bool		escape;			/* escape the output of outfunc */
+	FmgrInfo	outfunc;
+	char	   *open;			/* RAW: ' name="', PATH: '<name>' */
+	char	   *close;			/* RAW: '"', PATH: '</name>' */
+} ForXmlColumn;
+
+typedef struct ForXmlAggState
+{
+	MemoryContext context;		/* aggregate context, where chunks are kept */
+	int			mode;
+	bool		binary_base64;
+	char	   *element_name;
+	char	   *root_name;
+
+	ForXmlChunk *head;
+	ForXmlChunk *tail;
+	int64		len;
+	StringInfoData row;			/* the current row, before it is appended */
+
+	Oid			tupType;
+	int32		tupTypmod;
+	TupleDesc	tupdesc;
+	ForXmlColumn *columns;
+	Datum	   *values;
+	bool	   *nulls;
+} ForXmlAggState;
+
 static xmltype *stringinfo_to_xmltype(StringInfo buf);
 static void SPI_sql_row_to_xmlelement_raw(uint64 rownum, StringInfo result,
 						  const char *element_name, bool binary_base64);
@@ -25,8 +79,18 @@ static StringInfo tsql_query_to_xml_internal(const char *query, int mode,
 								const char *element_name, bool binary_base64,
 								const char *root_name);
 
+static void tsql_xml_check_binary_base64(TupleDesc tupdesc, bool binary_base64);
+static void for_xml_agg_append(ForXmlAggState *state, const char *data, int len);
+static void for_xml_agg_setup_columns(ForXmlAggState *state, MemoryContext aggcontext,
+									  HeapTupleHeader td);
+static void for_xml_agg_row(ForXmlAggState *state);
+static text *for_xml_agg_result(FunctionCallInfo fcinfo);
+
 PG_FUNCTION_INFO_V1(tsql_query_to_xml);
 PG_FUNCTION_INFO_V1(tsql_query_to_xml_text);
+PG_FUNCTION_INFO_V1(tsql_select_for_xml_sfunc);
+PG_FUNCTION_INFO_V1(tsql_select_for_xml_finalfunc);
+PG_FUNCTION_INFO_V1(tsql_select_for_xml_text_finalfunc);
 
 static xmltype *
 stringinfo_to_xmltype(StringInfo buf)
@@ -72,26 +136,7 @@ SPI_sql_row_to_xmlelement_raw(uint64 rownum, StringInfo result,
 {
 	int			i;
 
-	if (binary_base64)
-	{
-		/*
-		 * TODO: encode binary/varbinary/image data values using base64 encoding.
-		 * Refer to how BYTEA type is handed in map_sql_value_to_xml_value().
-		 * Also, pg_b64_encode function might be useful.
-		 * For now report an ERROR if any attribute is binary data type since base64
-		 * encoding is not implemented yet.
-		 */
-		for (i = 1; i <= SPI_tuptable->tupdesc->natts; i++)
-		{
-			char* typename = SPI_gettype(SPI_tuptable->tupdesc, i);
-			if (strcmp(typename, "binary") == 0 ||
-				strcmp(typename, "varbinary") == 0 ||
-				strcmp(typename, "image") == 0)
-				ereport(ERROR,
-						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-						 errmsg("option binary base64 is not supported")));
-		}
-	}
+	tsql_xml_check_binary_base64(SPI_tuptable->tupdesc, binary_base64);
 
 	appendStringInfo(result, "<%s", element_name);
 
@@ -130,26 +175,7 @@ SPI_sql_row_to_xmlelement_path(uint64 rownum, StringInfo result,
 	int i;
 	bool allnull = true;
 
-	if (binary_base64)
-	{
-		/*
-		 * TODO: encode binary/varbinary/image data values using base64 encoding.
-		 * Refer to how BYTEA type is handed in map_sql_value_to_xml_value().
-		 * Also, pg_b64_encode function might be useful.
-		 * For now report an ERROR if any attribute is binary data type since base64
-		 * encoding is not implemented yet.
-		 */
-		for (i = 1; i <= SPI_tuptable->tupdesc->natts; i++)
-		{
-			char* typename = SPI_gettype(SPI_tuptable->tupdesc, i);
-			if (strcmp(typename, "binary") == 0 ||
-				strcmp(typename, "varbinary") == 0 ||
-				strcmp(typename, "image") == 0)
-				ereport(ERROR,
-						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-						 errmsg("option binary base64 is not supported")));
-		}
-	}
+	tsql_xml_check_binary_base64(SPI_tuptable->tupdesc, binary_base64);
 
 	if (element_name[0] != '\0') // if "''" is the input path, ignore it per SQL Server behavior
 		appendStringInfo(result, "<%s>", element_name);
@@ -198,13 +224,26 @@ tsql_query_to_xml_internal(const char *query, int mode,
 	StringInfo	result;
 	uint64		i;
 
-	set_config_option("babelfishpg_tsql.sql_dialect", "tsql",
-					  (superuser() ? PGC_SUSET : PGC_USERSET),
-					  PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
+	int			saved_dialect;
+	int			rc;
+
 	result = makeStringInfo();
 
 	SPI_connect();
-	if (SPI_execute(query, true, 0) != SPI_OK_SELECT)
+
+	/* The query text is T-SQL, whatever the caller's dialect */
+	saved_dialect = pltsql_enter_dialect(SQL_DIALECT_TSQL);
+	PG_TRY();
+	{
+		rc = SPI_execute(query, true, 0);
+	}
+	PG_FINALLY();
+	{
+		pltsql_leave_dialect(saved_dialect);
+	}
+	PG_END_TRY();
+
+	if (rc != SPI_OK_SELECT)
 		ereport(ERROR,
 				(errcode(ERRCODE_DATA_EXCEPTION),
 				 errmsg("invalid query")));
@@ -259,3 +298,345 @@ tsql_query_to_xml_internal(const char *query, int mode,
 
 	return result;
 }
+
+static void
+tsql_xml_check_binary_base64(TupleDesc tupdesc, bool binary_base64)
+{
+	int			i;
+
+	if (binary_base64)
+	{
+		/*
+		 * TODO: encode binary/varbinary/image data values using base64 encoding.
+		 * Refer to how BYTEA type is handed in map_sql_value_to_xml_value().
+		 * Also, pg_b64_encode function might be useful.
+		 * For now report an ERROR if any attribute is binary data type since base64
+		 * encoding is not implemented yet.
+		 */
+		for (i = 1; i <= tupdesc->natts; i++)
+		{
+			char* typename = SPI_gettype(tupdesc, i);
+			if (strcmp(typename, "binary") == 0 ||
+				strcmp(typename, "varbinary") == 0 ||
+				strcmp(typename, "image") == 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("option binary base64 is not supported")));
+		}
+	}
+}
+
+/*
+ * FOR XML RAW and PATH as aggregates.
+ *
+ * Like FOR JSON PATH, the grammar turns
+ *     select a from t order by a for xml raw
+ * into
+ *     select sys.tsql_select_for_xml_text_agg(rows.*, ...) from (select a from t order by a) rows
+ * (or sys.tsql_select_for_xml_agg with the TYPE directive), so the rows are
+ * produced by the original plan and appended to the document one at a time.
+ * Element and attribute names are escaped, and output functions looked up,
+ * once per result set rather than once per value.
+ */
+Datum
+tsql_select_for_xml_sfunc(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	MemoryContext oldcontext;
+	ForXmlAggState *state;
+	HeapTupleHeader td;
+	HeapTupleData tuple;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "tsql_select_for_xml_sfunc called in non-aggregate context");
+
+	if (PG_ARGISNULL(0))
+	{
+		int			mode = PG_ARGISNULL(2) ? -1 : PG_GETARG_INT32(2);
+
+		if (mode != TSQL_FORXML_RAW && mode != TSQL_FORXML_PATH)
+			ereport(ERROR,
+						(errcode(ERRCODE_INTERNAL_ERROR),
+							errmsg("invalid FOR XML mode")));
+
+		oldcontext = MemoryContextSwitchTo(aggcontext);
+		state = (ForXmlAggState *) palloc0(sizeof(ForXmlAggState));
+		state->context = aggcontext;
+		state->mode = mode;
+		state->element_name = PG_ARGISNULL(3) ? "row" : text_to_cstring(PG_GETARG_TEXT_PP(3));
+		state->binary_base64 = !PG_ARGISNULL(4) && PG_GETARG_BOOL(4);
+		state->root_name = PG_ARGISNULL(5) ? "" : text_to_cstring(PG_GETARG_TEXT_PP(5));
+		initStringInfo(&state->row);
+		MemoryContextSwitchTo(oldcontext);
+
+		if (state->root_name[0] != '\0')
+		{
+			resetStringInfo(&state->row);
+			appendStringInfo(&state->row, "<%s>", state->root_name);
+			for_xml_agg_append(state, state->row.data, state->row.len);
+		}
+	}
+	else
+		state = (ForXmlAggState *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+		PG_RETURN_POINTER(state);
+
+	td = PG_GETARG_HEAPTUPLEHEADER(1);
+	if (state->tupdesc == NULL ||
+		HeapTupleHeaderGetTypeId(td) != state->tupType ||
+		HeapTupleHeaderGetTypMod(td) != state->tupTypmod)
+		for_xml_agg_setup_columns(state, aggcontext, td);
+
+	tuple.t_len = HeapTupleHeaderGetDatumLength(td);
+	ItemPointerSetInvalid(&(tuple.t_self));
+	tuple.t_tableOid = InvalidOid;
+	tuple.t_data = td;
+
+	heap_deform_tuple(&tuple, state->tupdesc, state->values, state->nulls);
+
+	for_xml_agg_row(state);
+
+	PG_RETURN_POINTER(state);
+}
+
+/* FOR XML with the TYPE directive */
+Datum
+tsql_select_for_xml_finalfunc(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_XML_P((xmltype *) for_xml_agg_result(fcinfo));
+}
+
+Datum
+tsql_select_for_xml_text_finalfunc(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_TEXT_P(for_xml_agg_result(fcinfo));
+}
+
+/*
+ * Append to the document, filling up the last chunk before starting a new
+ * one. Chunks live in the aggregate context, like the rest of the state.
+ */
+static void
+for_xml_agg_append(ForXmlAggState *state, const char *data, int len)
+{
+	while (len > 0)
+	{
+		int			n;
+
+		if (state->tail == NULL || state->tail->len == FOR_XML_CHUNK_SIZE)
+		{
+			ForXmlChunk *chunk;
+
+			chunk = (ForXmlChunk *) MemoryContextAlloc(state->context, sizeof(ForXmlChunk));
+			chunk->next = NULL;
+			chunk->len = 0;
+			if (state->tail)
+				state->tail->next = chunk;
+			else
+				state->head = chunk;
+			state->tail = chunk;
+		}
+
+		n = Min(len, FOR_XML_CHUNK_SIZE - state->tail->len);
+		memcpy(state->tail->data + state->tail->len, data, n);
+		state->tail->len += n;
+		state->len += n;
+		data += n;
+		len -= n;
+	}
+}
+
+/*
+ * Work out, once, how every column of the result is written out.
+ *
+ * map_sql_value_to_xml_value() looks up the output function on every call;
+ * we do that here instead, for every type it has no special formatting for.
+ * Those (booleans, dates, timestamps, bytea and arrays, including domains
+ * over them) still go through map_sql_value_to_xml_value().
+ */
+static void
+for_xml_agg_setup_columns(ForXmlAggState *state, MemoryContext aggcontext,
+						  HeapTupleHeader td)
+{
+	MemoryContext oldcontext;
+	TupleDesc	tupdesc;
+	int			natts;
+
+	state->tupType = HeapTupleHeaderGetTypeId(td);
+	state->tupTypmod = HeapTupleHeaderGetTypMod(td);
+
+	tupdesc = lookup_rowtype_tupdesc(state->tupType, state->tupTypmod);
+	tsql_xml_check_binary_base64(tupdesc, state->binary_base64);
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	natts = tupdesc->natts;
+	state->tupdesc = CreateTupleDescCopy(tupdesc);
+	state->columns = (ForXmlColumn *) palloc0(natts * sizeof(ForXmlColumn));
+	state->values = (Datum *) palloc(natts * sizeof(Datum));
+	state->nulls = (bool *) palloc(natts * sizeof(bool));
+	for (int i = 0; i < natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+		ForXmlColumn *col = &state->columns[i];
+		char	   *colname;
+		Oid			basetype;
+
+		colname = map_sql_identifier_to_xml_name(NameStr(attr->attname), true, false);
+		if (state->mode == TSQL_FORXML_RAW)
+		{
+			col->open = psprintf(" %s=\"", colname);
+			col->close = "\"";
+		}
+		else
+		{
+			col->open = psprintf("<%s>", colname);
+			col->close = psprintf("</%s>", colname);
+		}
+
+		col->typid = attr->atttypid;
+		basetype = getBaseType(attr->atttypid);
+		if (type_is_array_domain(attr->atttypid) ||
+			basetype == BOOLOID || basetype == DATEOID ||
+			basetype == TIMESTAMPOID || basetype == TIMESTAMPTZOID ||
+			basetype == BYTEAOID)
+			col->generic = true;
+		else
+		{
+			Oid			typoutput;
+			bool		typisvarlena;
+
+			getTypeOutputInfo(basetype, &typoutput, &typisvarlena);
+			fmgr_info_cxt(typoutput, &col->outfunc, aggcontext);
+			col->escape = (basetype != XMLOID);
+		}
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	ReleaseTupleDesc(tupdesc);
+}
+
+/*
+ * Write out the current row as one RAW or PATH element. Values are converted
+ * in the per-row memory context, which the executor resets between rows.
+ */
+static void
+for_xml_agg_row(ForXmlAggState *state)
+{
+	StringInfo	row = &state->row;
+	bool		path = (state->mode == TSQL_FORXML_PATH);
+	bool		allnull = true;
+
+	resetStringInfo(row);
+
+	/* if "''" is the input path, ignore it per SQL Server behavior */
+	if (!path)
+		appendStringInfo(row, "<%s", state->element_name);
+	else if (state->element_name[0] != '\0')
+		appendStringInfo(row, "<%s>", state->element_name);
+
+	for (int i = 0; i < state->tupdesc->natts; i++)
+	{
+		ForXmlColumn *col = &state->columns[i];
+		char	   *str;
+
+		if (state->nulls[i])
+			continue;
+		allnull = false;
+
+		if (col->generic)
+			str = map_sql_value_to_xml_value(state->values[i], col->typid, true);
+		else
+		{
+			str = OutputFunctionCall(&col->outfunc, state->values[i]);
+			if (col->escape)
+				str = escape_xml(str);
+		}
+
+		appendStringInfoString(row, col->open);
+		appendStringInfoString(row, str);
+		appendStringInfoString(row, col->close);
+	}
+
+	if (!path)
+		appendStringInfoString(row, "/>");
+	else if (allnull)
+	{
+		/*
+		 * If all the column values are nulls, this element should be
+		 * <element_name/>. With an empty element name there is nothing to
+		 * write at all.
+		 */
+		if (state->element_name[0] != '\0')
+		{
+			row->data[row->len - 1] = '/';
+			appendStringInfoChar(row, '>');
+		}
+	}
+	else if (state->element_name[0] != '\0')
+		appendStringInfo(row, "</%s>", state->element_name);
+
+	for_xml_agg_append(state, row->data, row->len);
+}
+
+/*
+ * Assemble the document. Without any rows the transition function never ran,
+ * so the ROOT directive is taken from the constant arguments of the call.
+ */
+static text *
+for_xml_agg_result(FunctionCallInfo fcinfo)
+{
+	ForXmlAggState *state;
+	text	   *result;
+	char	   *ptr;
+	char	   *root_name;
+	int64		len;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "FOR XML final function called in non-aggregate context");
+
+	if (PG_ARGISNULL(0))
+	{
+		Aggref	   *aggref = AggGetAggref(fcinfo);
+		TargetEntry *tle;
+		Const	   *root;
+
+		if (aggref == NULL || list_length(aggref->args) < 5)
+			elog(ERROR, "could not find FOR XML directives");
+		tle = list_nth_node(TargetEntry, aggref->args, 4);
+		if (!IsA(tle->expr, Const))
+			elog(ERROR, "FOR XML directives must be constants");
+		root = (Const *) tle->expr;
+
+		root_name = root->constisnull ? "" : TextDatumGetCString(root->constvalue);
+		if (root_name[0] == '\0')
+			return cstring_to_text("");
+		return cstring_to_text(psprintf("<%s></%s>", root_name, root_name));
+	}
+
+	state = (ForXmlAggState *) PG_GETARG_POINTER(0);
+	root_name = state->root_name;
+
+	len = state->len;
+	if (root_name[0] != '\0')
+		len += strlen(root_name) + 3;
+	if (len > MaxAllocSize - VARHDRSZ)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("FOR XML result exceeds the maximum allowed size of %d bytes",
+						(int) (MaxAllocSize - VARHDRSZ))));
+
+	/* one extra byte for the terminator sprintf() writes */
+	result = (text *) palloc(len + VARHDRSZ + 1);
+	SET_VARSIZE(result, len + VARHDRSZ);
+	ptr = VARDATA(result);
+	for (ForXmlChunk *chunk = state->head; chunk != NULL; chunk = chunk->next)
+	{
+		memcpy(ptr, chunk->data, chunk->len);
+		ptr += chunk->len;
+	}
+	if (root_name[0] != '\0')
+		sprintf(ptr, "</%s>", root_name);
+
+	return result;
+}
@@ -21,6 +21,9 @@ bool enable_metadata_inconsistency_check = true;
 bool pltsql_dump_antlr_query_graph = false;
 bool pltsql_enable_antlr_detailed_log = false;
 bool pltsql_allow_antlr_to_unsupported_grammar_for_testing = false;
+bool pltsql_enable_sll_parse_mode = true;
+bool pltsql_parser_warmup = false;
+char *pltsql_parser_warmup_file = NULL;
 char* pltsql_default_locale = NULL;
 char* pltsql_server_collation_name = NULL;
 bool  pltsql_ansi_defaults = true;
@@ -611,6 +614,35 @@ define_custom_variables(void)
 				 GUC_NO_SHOW_ALL,
 				 NULL, NULL, NULL);
 
+	DefineCustomBoolVariable("babelfishpg_tsql.enable_sll_parse_mode",
+				 gettext_noop("Parses batches with SLL prediction first, falling back to full LL on failure"),
+				 NULL,
+				 &pltsql_enable_sll_parse_mode,
+				 true,
+				 PGC_SUSET,
+				 GUC_NOT_IN_SAMPLE,
+				 NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("babelfishpg_tsql.parser_warmup",
+				 gettext_noop("Primes the ANTLR parser caches when the library is loaded"),
+				 gettext_noop("Parses a built-in set of typical batches, and those in "
+							  "babelfishpg_tsql.parser_warmup_file, so that the first batches "
+							  "of a new backend do not pay for building the parser's prediction caches."),
+				 &pltsql_parser_warmup,
+				 false,
+				 PGC_SUSET,
+				 GUC_NOT_IN_SAMPLE,
+				 NULL, NULL, NULL);
+
+	DefineCustomStringVariable("babelfishpg_tsql.parser_warmup_file",
+				   gettext_noop("File of additional batches for the parser warm-up, separated by GO lines"),
+				   NULL,
+				   &pltsql_parser_warmup_file,
+				   "",
+				   PGC_SUSET,
+				   GUC_NOT_IN_SAMPLE,
+				   NULL, NULL, NULL);
+
 	DefineCustomStringVariable("babelfishpg_tsql.server_collation_name",
 				   gettext_noop("Name of the default server collation."),
 				   NULL,
@@ -1109,6 +1141,90 @@ define_custom_variables(void)
 				GUC_NOT_IN_SAMPLE,
 				NULL, NULL, NULL);
 
+	DefineCustomIntVariable("babelfishpg_tsql.insert_bulk_rows_per_flush",
+				gettext_noop("Sets the number of rows Insert Bulk buffers before writing them to the table"),
+				NULL,
+				&insert_bulk_rows_per_flush,
+				DEFAULT_INSERT_BULK_ROWS_PER_FLUSH, 1, MAX_INSERT_BULK_ROWS_PER_FLUSH,
+				PGC_USERSET,
+				GUC_NOT_IN_SAMPLE,
+				NULL, NULL, NULL);
+
+	DefineCustomIntVariable("babelfishpg_tsql.insert_bulk_kilobytes_per_flush",
+				gettext_noop("Sets the amount of row data Insert Bulk buffers before writing it to the table"),
+				NULL,
+				&insert_bulk_kilobytes_per_flush,
+				DEFAULT_INSERT_BULK_KILOBYTES_PER_FLUSH, 1, MAX_INSERT_BULK_KILOBYTES_PER_FLUSH,
+				PGC_USERSET,
+				GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+				NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("babelfishpg_tsql.insert_bulk_streaming",
+				gettext_noop("Inserts Insert Bulk rows as they are decoded instead of collecting each batch first"),
+				NULL,
+				&insert_bulk_streaming,
+				true,
+				PGC_USERSET,
+				GUC_NOT_IN_SAMPLE,
+				NULL, NULL, NULL);
+
+
+	DefineCustomIntVariable("babelfishpg_tsql.executesql_cache_size",
+				gettext_noop("Sets the maximum number of compiled sp_executesql batches cached per session"),
+				gettext_noop("0 disables the cache."),
+				&pltsql_batch_cache_size,
+				DEFAULT_BATCH_CACHE_SIZE, 0, INT_MAX,
+				PGC_USERSET,
+				GUC_NOT_IN_SAMPLE,
+				NULL, NULL, NULL);
+
+	DefineCustomIntVariable("babelfishpg_tsql.executesql_cache_memory",
+				gettext_noop("Sets the maximum memory used by cached sp_executesql batches per session"),
+				NULL,
+				&pltsql_batch_cache_memory_kb,
+				DEFAULT_BATCH_CACHE_MEMORY_KB, 0, MAX_KILOBYTES,
+				PGC_USERSET,
+				GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+				NULL, NULL, NULL);
+
+	DefineCustomIntVariable("babelfishpg_tsql.prepared_batch_memory",
+				gettext_noop("Sets the maximum memory used by compiled sp_prepare batches per session"),
+				gettext_noop("Least recently executed batches are compiled again on their next execution."),
+				&pltsql_prepared_batch_memory_kb,
+				DEFAULT_PREPARED_BATCH_MEMORY_KB, 0, MAX_KILOBYTES,
+				PGC_USERSET,
+				GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+				NULL, NULL, NULL);
+
+	DefineCustomIntVariable("babelfishpg_tsql.prepared_statement_catalog_size",
+				gettext_noop("Sets the number of prepared statements recorded in shared memory across sessions"),
+				gettext_noop("0 disables the catalog.  The catalog is sized when it is first used; "
+							 "a larger size takes effect after a server restart."),
+				&pltsql_prepared_catalog_size,
+				0, 0, 1000000,
+				PGC_SIGHUP,
+				GUC_NOT_IN_SAMPLE,
+				NULL, NULL, NULL);
+
+	DefineCustomIntVariable("babelfishpg_tsql.prepared_statement_catalog_memory",
+				gettext_noop("Sets the shared memory used for the text of the statements in the prepared statement catalog"),
+				gettext_noop("Statements that don't fit any more are not recorded.  "
+							 "The catalog is sized when it is first used."),
+				&pltsql_prepared_catalog_memory_kb,
+				DEFAULT_PREPARED_CATALOG_MEMORY_KB, 64, MAX_PREPARED_CATALOG_MEMORY_KB,
+				PGC_SIGHUP,
+				GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+				NULL, NULL, NULL);
+
+	DefineCustomIntVariable("babelfishpg_tsql.statement_profiler_size",
+				gettext_noop("Sets the number of procedure lines whose execution statistics are kept in shared memory"),
+				gettext_noop("0 disables the statement profiler.  The table is sized when it is first used; "
+							 "a larger size takes effect after a server restart."),
+				&pltsql_statement_profiler_size,
+				0, 0, 1000000,
+				PGC_SIGHUP,
+				GUC_NOT_IN_SAMPLE,
+				NULL, NULL, NULL);
 
 	DefineCustomBoolVariable("babelfishpg_tsql.enable_metadata_inconsistency_check",
 				 gettext_noop("Enables babelfish_inconsistent_metadata"),
@@ -1,5 +1,6 @@
 #include "access/xact.h"
 #include "commands/explain.h"
+#include "portability/instr_time.h"
 #include "pltsql.h"
 #include "pltsql-2.h"
 #include "pl_explain.h"
@@ -327,8 +328,8 @@ static void restore_ctx_partial2(PLtsql_execstate *estate)
 typedef struct
 {
     DynaVec *counts;
-    DynaVec *durations;
-    uint64_t total_duration;
+    DynaVec *durations;         /* in us */
+    uint64_t total_duration;    /* in ms */
     uint64_t code_size;
 } ExecStat;
 
@@ -338,10 +339,12 @@ static inline bool trace_exec_counts_enabled(uint64_t trace_mode);
 static inline bool trace_exec_time_enabled(uint64_t trace_mode);
 
 /* measuring helpers */
-static inline void pre_exec_measure(uint64_t trace_mode, ExecStat *stat, struct timeval *stmt_begin, int pc);
-static inline void post_exec_measure(uint64_t trace_mode, ExecStat *stat, struct timeval *stmt_end, int pc);
-static inline void initialize_trace(uint64_t trace_mode, ExecStat **stat, struct timeval *proc_begin, size_t size);
-static inline void finalize_trace(uint64_t trace_mode, ExecCodes *exec_codes, ExecStat *stat, struct timeval *proc_begin);
+static inline void pre_exec_measure(uint64_t trace_mode, ExecStat *stat, StmtProfileCounters *profile,
+                                    PLtsql_execstate *estate, instr_time *stmt_begin, int pc);
+static inline void post_exec_measure(uint64_t trace_mode, ExecStat *stat, StmtProfileCounters *profile,
+                                     PLtsql_execstate *estate, instr_time *stmt_begin, int pc);
+static inline void initialize_trace(uint64_t trace_mode, ExecStat **stat, instr_time *proc_begin, size_t size);
+static inline void finalize_trace(uint64_t trace_mode, ExecCodes *exec_codes, ExecStat *stat, instr_time *proc_begin);
          
 ExecStat *create_stat(size_t code_size, uint64_t trace_mode);
 void      destroy_stat(ExecStat *stat);
@@ -375,57 +378,84 @@ static inline bool trace_exec_time_enabled(uint64_t trace_mode)
     return (trace_mode & TRACE_EXEC_TIME) == TRACE_EXEC_TIME;
 }
 
+/*
+ * The statement is timed when either the execution trace or the statement
+ * profiler wants it; both share the one monotonic clock reading.
+ *
+ * Only the statements that run a query set eval_processed, so the profiler
+ * clears it first; otherwise assignments, conditions and jumps would count
+ * the rows of the last query again.
+ */
 static inline void 
-pre_exec_measure(uint64_t trace_mode, ExecStat *stat, struct timeval *stmt_begin, int pc)
+pre_exec_measure(uint64_t trace_mode, ExecStat *stat, StmtProfileCounters *profile,
+                 PLtsql_execstate *estate, instr_time *stmt_begin, int pc)
 {
 	if (trace_exec_counts_enabled(trace_mode))
 	{
 		size_t *cur_cnt = (size_t *) vec_at(stat->counts, pc);
 		++(*cur_cnt);
 	}
-	if (trace_exec_time_enabled(trace_mode))
-		gettimeofday(stmt_begin, NULL);
+	if (profile)
+		estate->eval_processed = 0;
+	if (trace_exec_time_enabled(trace_mode) || profile)
+		INSTR_TIME_SET_CURRENT(*stmt_begin);
 }
 
 static inline void 
-post_exec_measure(uint64_t trace_mode, ExecStat *stat, struct timeval *stmt_begin, int pc)
+post_exec_measure(uint64_t trace_mode, ExecStat *stat, StmtProfileCounters *profile,
+                  PLtsql_execstate *estate, instr_time *stmt_begin, int pc)
 {
+	instr_time	duration;
+	uint64		us;
+
+	if (!trace_exec_time_enabled(trace_mode) && !profile)
+		return;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, *stmt_begin);
+	us = INSTR_TIME_GET_MICROSEC(duration);
+
 	if (trace_exec_time_enabled(trace_mode))
 	{
-		struct timeval stmt_end;
-		long seconds, microseconds;
 		size_t *cur_duration = (size_t *) vec_at(stat->durations, pc);
-		gettimeofday(&stmt_end, NULL);
-		seconds = stmt_end.tv_sec - stmt_begin->tv_sec;
-		microseconds = stmt_end.tv_usec - stmt_begin->tv_usec;
-		*(cur_duration) += seconds*1000 + microseconds/1000; /* in ms unit */
+		*(cur_duration) += us;
+	}
+	if (profile)
+	{
+		StmtProfileCounters *counters = &profile[pc];
+
+		if (counters->calls == 0 || us < counters->min_us)
+			counters->min_us = us;
+		if (us > counters->max_us)
+			counters->max_us = us;
+		counters->calls++;
+		counters->total_us += us;
+		counters->rows += estate->eval_processed;
 	}
 }
 
 static inline void 
-initialize_trace(uint64_t trace_mode, ExecStat **stat, struct timeval *proc_begin, size_t size)
+initialize_trace(uint64_t trace_mode, ExecStat **stat, instr_time *proc_begin, size_t size)
 {
     if (trace_exec_enabled(trace_mode))
     {
         *stat = create_stat(size, trace_mode);
-        gettimeofday(proc_begin, NULL);
+        INSTR_TIME_SET_CURRENT(*proc_begin);
     }
 }
 
 static inline void 
-finalize_trace(uint64_t trace_mode, ExecCodes *exec_codes, ExecStat *stat, struct timeval *proc_begin)
+finalize_trace(uint64_t trace_mode, ExecCodes *exec_codes, ExecStat *stat, instr_time *proc_begin)
 {
 	if (trace_exec_enabled(trace_mode))
     {
-        long seconds, microseconds;
         StringInfoData buf;
-        struct timeval proc_end; 
+        instr_time proc_end; 
 
-        gettimeofday(&proc_end, NULL);
-        seconds = proc_end.tv_sec - proc_begin->tv_sec;
-        microseconds = proc_end.tv_usec - proc_begin->tv_usec;
+        INSTR_TIME_SET_CURRENT(proc_end);
+        INSTR_TIME_SUBTRACT(proc_end, *proc_begin);
 
-        stat->total_duration = seconds*1000 + microseconds/1000;  /* in ms unit  */
+        stat->total_duration = (uint64_t) INSTR_TIME_GET_MILLISEC(proc_end);
         initStringInfo(&buf);
         get_stat_trace(exec_codes, stat, &buf);
         ereport(LOG, (errmsg("Execution Trace: \n%s", buf.data)));
@@ -541,7 +571,7 @@ static void get_stat_desc(ExecStat *stat, size_t index, StringInfo buf)
     {
         if (!first)
             appendStringInfoString(buf, ", ");
-        snprintf(local_buf, TRACE_LOCAL_BUF_SIZE, "T:%6zums", *(size_t *) vec_at(stat->durations, index));
+        snprintf(local_buf, TRACE_LOCAL_BUF_SIZE, "T:%6zums", *(size_t *) vec_at(stat->durations, index) / 1000);
         appendStringInfoString(buf, local_buf); 
         first = false;
     }
@@ -1310,7 +1340,9 @@ int exec_stmt_iterative(PLtsql_execstate *estate, ExecCodes *exec_codes, ExecCon
     size_t     size;
     int        rc = PLTSQL_RC_OK;
     ExecStat *stat = NULL;
-    struct timeval proc_begin, stmt_begin;
+    instr_time proc_begin, stmt_begin;
+    Oid        profile_oid = estate->func->fn_oid;
+    StmtProfileCounters *profile;
 	PLtsql_stmt *stmt = NULL;
 	bool		terminate_batch = false;
 	int			active_non_tsql_procs = pltsql_non_tsql_proc_entry_count;
@@ -1322,6 +1354,7 @@ int exec_stmt_iterative(PLtsql_execstate *estate, ExecCodes *exec_codes, ExecCon
 
     size = vec_size(exec_codes->codes);
     initialize_trace(config->trace_mode, &stat, &proc_begin, size);
+    profile = stmt_profiler_begin(profile_oid, exec_codes);
 
 	/* Guard against stack overflow due to complex, recursive statements */
 	check_stack_depth();
@@ -1339,7 +1372,7 @@ int exec_stmt_iterative(PLtsql_execstate *estate, ExecCodes *exec_codes, ExecCon
 			int cur_pc = *pc;
 			stmt = *(PLtsql_stmt **) vec_at(exec_codes->codes, cur_pc);
 
-			pre_exec_measure(config->trace_mode, stat, &stmt_begin, cur_pc);
+			pre_exec_measure(config->trace_mode, stat, profile, estate, &stmt_begin, cur_pc);
 
 			reset_exec_error_data(estate);
 
@@ -1436,7 +1469,7 @@ int exec_stmt_iterative(PLtsql_execstate *estate, ExecCodes *exec_codes, ExecCon
 			}
 
 			/* single statement execution ends here */
-			post_exec_measure(config->trace_mode, stat, &stmt_begin, cur_pc);
+			post_exec_measure(config->trace_mode, stat, profile, estate, &stmt_begin, cur_pc);
 
 			/*
 			 * We do not want to reset error code when
@@ -1486,6 +1519,8 @@ int exec_stmt_iterative(PLtsql_execstate *estate, ExecCodes *exec_codes, ExecCon
 		destroy_vector(estate->err_ctx_stack);
 		/* execution ends here */
 		finalize_trace(config->trace_mode, exec_codes, stat, &proc_begin);
+		if (profile)
+			stmt_profiler_flush(profile_oid, exec_codes);
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
@@ -1494,6 +1529,8 @@ int exec_stmt_iterative(PLtsql_execstate *estate, ExecCodes *exec_codes, ExecCon
 		destroy_vector(estate->err_ctx_stack);
 		/* execution ends here */
 		finalize_trace(config->trace_mode, exec_codes, stat, &proc_begin);
+		if (profile)
+			stmt_profiler_flush(profile_oid, exec_codes);
 	}
 
 	return rc;
@@ -1513,6 +1550,8 @@ void free_exec_codes(ExecCodes *exec_codes)
         pfree(exec_codes->proc_namespace);
     if (exec_codes->proc_name)
         pfree(exec_codes->proc_name);
+    if (exec_codes->profile)
+        pfree(exec_codes->profile);
     pfree(exec_codes);
 }
 
@@ -11,12 +11,28 @@
  *      exec_codes only reclaim space for the vector
  */
 
+/*
+ *  Statement profiler counters of one execution node, accumulated by
+ *  exec_stmt_iterative and moved to shared memory when it returns
+ *  (see stmt_profiler.c)
+ */
+typedef struct StmtProfileCounters
+{
+    int64    calls;
+    uint64   total_us;
+    uint64   min_us;
+    uint64   max_us;
+    uint64   rows;
+} StmtProfileCounters;
+
 typedef struct ExecCodes
 {
     DynaVec *codes;
 
     char * proc_namespace;
     char * proc_name;
+
+    StmtProfileCounters *profile;   /* one per node, NULL until profiled */
 } ExecCodes;
 
 #define TRACE_EXEC_CODES   0x0001
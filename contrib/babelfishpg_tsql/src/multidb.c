@@ -1139,32 +1139,21 @@ const char *get_guest_role_name(const char *dbname)
 static void
 truncate_tsql_identifier(char *ident)
 {
-	const char *saved_dialect;
+	int			saved_dialect;
 
 	if (!ident || (strlen(ident) < NAMEDATALEN))
 		return;
 
-	saved_dialect = GetConfigOption("babelfishpg_tsql.sql_dialect", true, true);
-
+	/* this is BBF help function. use BBF truncation logic */
+	saved_dialect = pltsql_enter_dialect(SQL_DIALECT_TSQL);
 	PG_TRY();
 	{
-		/* this is BBF help function. use BBF truncation logic */
-		set_config_option("babelfishpg_tsql.sql_dialect", "tsql",
-					(superuser() ? PGC_SUSET : PGC_USERSET),
-					PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
 		truncate_identifier(ident, strlen(ident), false);
 	}
-	PG_CATCH();
+	PG_FINALLY();
 	{
-		set_config_option("babelfishpg_tsql.sql_dialect", saved_dialect,
-					(superuser() ? PGC_SUSET : PGC_USERSET),
-					PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
-		PG_RE_THROW();
+		pltsql_leave_dialect(saved_dialect);
 	}
 	PG_END_TRY();
-	set_config_option("babelfishpg_tsql.sql_dialect", saved_dialect,
-				(superuser() ? PGC_SUSET : PGC_USERSET),
-				PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
-
 }
 
@@ -30,9 +30,8 @@ int pltsql_curr_compile_body_lineno; /* lineno of function/procedure body in CRE
  */
 bool pltsql_function_parse_error_transpose(const char *prosrc);
 
-void apply_post_compile_actions(PLtsql_function *func, InlineCodeBlockArgs *args);
+void apply_post_compile_actions(PLtsql_function *func, const char *source_text, InlineCodeBlockArgs *args);
 
-extern int cache_compiled_batch(PLtsql_function *func);
 extern void cache_inline_args(PLtsql_function *func, InlineCodeBlockArgs *args);
 extern SPIPlanPtr prepare_exec_codes(PLtsql_function *func, ExecCodes *exec_codes);
 extern void cleanup_temporal_plan(ExecCodes *exec_codes);
@@ -85,7 +84,7 @@ bool pltsql_function_parse_error_transpose(const char *prosrc)
 	return true;
 }
 
-void apply_post_compile_actions(PLtsql_function *func, InlineCodeBlockArgs *args)
+void apply_post_compile_actions(PLtsql_function *func, const char *source_text, InlineCodeBlockArgs *args)
 {
 	if (OPTION_ENABLED(args, PREPARE_PLAN))
 	{
@@ -119,6 +118,6 @@ void apply_post_compile_actions(PLtsql_function *func, InlineCodeBlockArgs *args
 	if (OPTION_ENABLED(args, CACHE_PLAN))
 	{
 		cache_inline_args(func, args);
-		args->handle = cache_compiled_batch(func);
+		args->handle = cache_compiled_batch(func, source_text);
 	}
 }
@@ -93,13 +93,6 @@ static const ExceptionLabelMap exception_label_map[] = {
 	{NULL, 0}
 };
 
-/* ----------
- * Current session's handler 
- * ----------
- */
-
-static int cur_handle_id = 1;
-
 /* ----------
  * static prototypes
  * ----------
@@ -3136,67 +3129,3 @@ pltsql_HashTableDelete(PLtsql_function *function)
 	/* remove back link, which no longer points to allocated storage */
 	function->fn_hashkey = NULL;
 }
-
-/* helper function for compiled batch */
-
-int 				cache_compiled_batch(PLtsql_function *func);
-PLtsql_function 	*find_cached_batch(int handle);
-void 				delete_cached_batch(int handle);
-
-/* helper function to reset cache incase reset connection takes place */
-void 				reset_cached_batch(void);
-
-PLtsql_function * find_cached_batch(int handle)
-{
-	PLtsql_func_hashkey hashkey;
-	PLtsql_function 	*func;
-
-	MemSet(&hashkey, 0, sizeof(PLtsql_func_hashkey));
-	/* use upper 32bit for funcOid */
-	hashkey.funcOid = ((long) handle) << 32;
-	hashkey.isTrigger = false;
-	hashkey.isEventTrigger = false;
-	hashkey.inputCollation = -1;
-
-	func = pltsql_HashTableLookup(&hashkey);
-
-	return func;
-}
-
-int cache_compiled_batch(PLtsql_function *func)
-{
-	PLtsql_func_hashkey hashkey;
-	int handle = cur_handle_id;
-
-	MemSet(&hashkey, 0, sizeof(PLtsql_func_hashkey));
-	hashkey.funcOid = ((long) handle) << 32;  /* use upper 32bit for funcOid */
-	hashkey.isTrigger = false;
-	hashkey.isEventTrigger = false;
-	hashkey.inputCollation = -1;
-
-  	/* avoid overflow when wraparound*/
-	cur_handle_id = (cur_handle_id % INT32_MAX) + 1;
-
-	pltsql_HashTableInsert(func, &hashkey);	
-	return handle;
-}
-
-void delete_cached_batch(int handle)
-{
-  	PLtsql_function		*func;
-
-	func = find_cached_batch(handle);
-  
-	if (func)
-	{
-		pltsql_HashTableDelete(func);
-		pltsql_free_function_memory(func);
-	}
-}
-
-void reset_cached_batch()
-{
-	while (cur_handle_id > 0)
-		delete_cached_batch(cur_handle_id--);
-	cur_handle_id = 1;
-}
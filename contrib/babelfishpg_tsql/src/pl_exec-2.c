@@ -85,8 +85,6 @@ extern void pltsql_commit_not_required_impl_txn(PLtsql_execstate *estate);
 
 int execute_batch(PLtsql_execstate *estate, char *batch, InlineCodeBlockArgs *args, List *params);
 
-extern PLtsql_function 	*find_cached_batch(int handle);
-
 extern SPIPlanPtr	prepare_stmt_exec(PLtsql_execstate *estate, PLtsql_function *func, PLtsql_stmt_exec *stmt, bool keepplan);
 
 extern int sp_prepare_count;
@@ -96,10 +94,20 @@ BulkCopyStmt *cstmt = NULL;
 int insert_bulk_rows_per_batch = DEFAULT_INSERT_BULK_ROWS_PER_BATCH;
 int insert_bulk_kilobytes_per_batch = DEFAULT_INSERT_BULK_PACKET_SIZE;
 bool insert_bulk_keep_nulls = false;
+bool insert_bulk_streaming = true;
+int insert_bulk_rows_per_flush = DEFAULT_INSERT_BULK_ROWS_PER_FLUSH;
+int insert_bulk_kilobytes_per_flush = DEFAULT_INSERT_BULK_KILOBYTES_PER_FLUSH;
+
+/* Snapshot of the implicit batch whose rows are being streamed in, if any. */
+static Snapshot bulk_load_snapshot = NULL;
 
 static int prev_insert_bulk_rows_per_batch = DEFAULT_INSERT_BULK_ROWS_PER_BATCH;
 static int prev_insert_bulk_kilobytes_per_batch = DEFAULT_INSERT_BULK_PACKET_SIZE;
 static bool prev_insert_bulk_keep_nulls = false;
+static int prev_insert_bulk_rows_per_flush = DEFAULT_INSERT_BULK_ROWS_PER_FLUSH;
+static int prev_insert_bulk_kilobytes_per_flush = DEFAULT_INSERT_BULK_KILOBYTES_PER_FLUSH;
+
+static void abort_bulk_load_batch(Snapshot snap);
 
 /* return a underlying node if n is implicit casting and underlying node is a certain type of node */
 static Node *get_underlying_node_from_implicit_casting(Node *n, NodeTag underlying_nodetype);
@@ -301,11 +309,13 @@ exec_stmt_query_set(PLtsql_execstate *estate,
 	/*
 	 * If we started an implicit_transaction for this statement but
 	 * the statement has a simple expression associated with them,
-	 * we no longer require an implicit transaction
+	 * we no longer require an implicit transaction.  A row of several
+	 * columns is only evaluated that way for a SELECT assignment.
 	 */
 	if (estate->impl_txn_type == PLTSQL_IMPL_TRAN_START)
 	{
-		if (stmt->sqlstmt->expr_simple_expr != NULL)
+		if (stmt->sqlstmt->expr_simple_expr != NULL &&
+			!stmt->sqlstmt->expr_simple_row)
 			pltsql_commit_not_required_impl_txn(estate);
 		else
 			estate->impl_txn_type = PLTSQL_IMPL_TRAN_ON;
@@ -656,18 +666,32 @@ exec_stmt_exec(PLtsql_execstate *estate, PLtsql_stmt_exec *stmt)
 	SimpleEcontextStackEntry *topEntry;
 	SPIExecuteOptions options;
 	bool		need_path_reset = false;
+	char	   *old_search_path = NULL;
 
 	Oid current_user_id = GetUserId();
 	char *cur_dbname = get_cur_db_name();
 
-	/* fetch current search_path */
-	List *path_oids = fetch_search_path(false);
-	char *old_search_path = flatten_search_path(path_oids);
-	char *new_search_path;
 	estate->db_name = NULL;
 	if (stmt->proc_name == NULL)
 		stmt->proc_name = "";
 
+ 	/* 
+	 * "sp_describe_first_result_set" needs special handling. It is a
+	 * sys function and satisfies the below condition and it appends "master_dbo"
+	 * to the search path which is not required for sys functions.
+	 */
+	if (strcmp(stmt->proc_name, "sp_describe_first_result_set") != 0 &&
+		strncmp(stmt->proc_name, "sp_", 3) == 0 && strcmp(cur_dbname, "master") != 0 &&
+		(stmt->schema_name == '\0' || strncmp(stmt->schema_name, "dbo", strlen(stmt->schema_name)) == 0))
+	{
+		/* fetch current search_path, as the current user */
+		List	   *path_oids = fetch_search_path(false);
+
+		old_search_path = flatten_search_path(path_oids);
+		list_free(path_oids);
+		need_path_reset = true;
+	}
+
 	if (stmt->is_cross_db)
 	{
 		char *login = GetUserNameFromId(GetSessionUserId(), false);
@@ -684,25 +708,15 @@ exec_stmt_exec(PLtsql_execstate *estate, PLtsql_stmt_exec *stmt)
 								login, stmt->db_name)));
 	}
 
- 	/* 
-	 * "sp_describe_first_result_set" needs special handling. It is a
-	 * sys function and satisfies the below condition and it appends "master_dbo"
-	 * to the search path which is not required for sys functions.
-	 */
-	if (strcmp(stmt->proc_name, "sp_describe_first_result_set") != 0)
+	if (need_path_reset)
 	{
-		if (strncmp(stmt->proc_name, "sp_", 3) == 0 && strcmp(cur_dbname, "master") != 0
-			&& (stmt->schema_name == '\0' || strncmp(stmt->schema_name, "dbo", strlen(stmt->schema_name)) == 0))
-			{
-				new_search_path = psprintf("%s, master_dbo", old_search_path);
-
-				/* Add master_dbo to the new search path */
-				(void) set_config_option("search_path", new_search_path,
-								PGC_USERSET, PGC_S_SESSION,
-								GUC_ACTION_SAVE, true, 0, false);
-				SetCurrentRoleId(GetSessionUserId(), false);
-				need_path_reset = true;
-			}
+		char	   *new_search_path = psprintf("%s, master_dbo", old_search_path);
+
+		/* Add master_dbo to the new search path */
+		(void) set_config_option("search_path", new_search_path,
+						PGC_USERSET, PGC_S_SESSION,
+						GUC_ACTION_SAVE, true, 0, false);
+		SetCurrentRoleId(GetSessionUserId(), false);
 	}
 	if (stmt->schema_name != '\0')
 	 	estate->schema_name = stmt->schema_name;
@@ -1084,7 +1098,6 @@ exec_stmt_exec(PLtsql_execstate *estate, PLtsql_stmt_exec *stmt)
 							GUC_ACTION_SAVE, true, 0, false);
 		SetCurrentRoleId(current_user_id, false);
 	}
-	list_free(path_oids);
 
 	if (expr->plan && !expr->plan->saved)
 	{
@@ -2834,6 +2847,35 @@ int exec_stmt_insert_bulk(PLtsql_execstate *estate, PLtsql_stmt_insert_bulk *stm
 		prev_insert_bulk_keep_nulls = insert_bulk_keep_nulls;
 		insert_bulk_keep_nulls = true;
 	}
+
+	/*
+	 * The flush thresholds are always saved, so that a session setting
+	 * survives an INSERT BULK that overrides it.
+	 */
+	prev_insert_bulk_rows_per_flush = insert_bulk_rows_per_flush;
+	prev_insert_bulk_kilobytes_per_flush = insert_bulk_kilobytes_per_flush;
+	if (stmt->rows_per_flush)
+	{
+		int rows_per_flush = atoi(stmt->rows_per_flush);
+
+		if (rows_per_flush < 1 || rows_per_flush > MAX_INSERT_BULK_ROWS_PER_FLUSH)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("insert bulk option rows_per_flush must be between 1 and %d",
+							MAX_INSERT_BULK_ROWS_PER_FLUSH)));
+		insert_bulk_rows_per_flush = rows_per_flush;
+	}
+	if (stmt->kilobytes_per_flush)
+	{
+		int kilobytes_per_flush = atoi(stmt->kilobytes_per_flush);
+
+		if (kilobytes_per_flush < 1 || kilobytes_per_flush > MAX_INSERT_BULK_KILOBYTES_PER_FLUSH)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("insert bulk option kilobytes_per_flush must be between 1 and %d",
+							MAX_INSERT_BULK_KILOBYTES_PER_FLUSH)));
+		insert_bulk_kilobytes_per_flush = kilobytes_per_flush;
+	}
 	return PLTSQL_RC_OK;
 }
 
@@ -2842,7 +2884,7 @@ execute_bulk_load_insert(int ncol, int nrow,
 				Datum *Values, bool *Nulls)
 {
 	uint64 retValue = -1;
-	Snapshot snap;
+	Snapshot snap = NULL;
 
 	/*
 	 * Bulk Copy can be triggered with 0 rows. We can also use this
@@ -2850,6 +2892,12 @@ execute_bulk_load_insert(int ncol, int nrow,
 	 */
 	if (nrow == 0 && ncol == 0)
 	{
+		if (bulk_load_snapshot)
+		{
+			UnregisterSnapshot(bulk_load_snapshot);
+			bulk_load_snapshot = NULL;
+		}
+
 		/* Cleanup all the pointers. */
 		if (cstmt)
 		{
@@ -2865,16 +2913,23 @@ execute_bulk_load_insert(int ncol, int nrow,
 				pfree(cstmt->relation);
 			}
 			pfree(cstmt);
+			cstmt = NULL;
 		}
 
 		/* Reset Insert-Bulk Options. */
 		insert_bulk_keep_nulls = prev_insert_bulk_keep_nulls;
 		insert_bulk_rows_per_batch = prev_insert_bulk_rows_per_batch;
 		insert_bulk_kilobytes_per_batch = prev_insert_bulk_kilobytes_per_batch;
+		insert_bulk_rows_per_flush = prev_insert_bulk_rows_per_flush;
+		insert_bulk_kilobytes_per_flush = prev_insert_bulk_kilobytes_per_flush;
 
 		return 0;
 	}
 
+	if (cstmt == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("Insert Bulk rows received outside of an Insert Bulk statement")));
 
 	PG_TRY();
 	{
@@ -2883,45 +2938,108 @@ execute_bulk_load_insert(int ncol, int nrow,
 		cstmt->Values 	= Values;
 		cstmt->Nulls 	= Nulls;
 
-		snap = GetTransactionSnapshot();
+		/*
+		 * Without Values the rows of this batch were already streamed in by
+		 * execute_bulk_load_insert_row, we only need to finish it.
+		 */
+		snap = bulk_load_snapshot ? bulk_load_snapshot : GetTransactionSnapshot();
 		PushActiveSnapshot(snap);
 
 		BulkCopy(cstmt, &retValue);
 
 		PopActiveSnapshot();
+		if (bulk_load_snapshot)
+		{
+			UnregisterSnapshot(bulk_load_snapshot);
+			bulk_load_snapshot = NULL;
+		}
 		cstmt->cur_batch_num++;
 	}
 	PG_CATCH();
 	{
-		/* In an error condition, the caller calls the function again to do the cleanup. */
-		MemoryContext oldcontext;
-		if (ActiveSnapshotSet() && GetActiveSnapshot() == snap)
-			PopActiveSnapshot();
-		oldcontext = CurrentMemoryContext;
+		abort_bulk_load_batch(snap);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
 
-		/*
-		 * If a transaction block is already in progress then abort it,
-		 * else rollback entire transaction.
-		 */
-		if (!IsTransactionBlockActive())
-		{
-			AbortCurrentTransaction();
-			StartTransactionCommand();
-		}
-		else
-			pltsql_rollback_txn();
-		MemoryContextSwitchTo(oldcontext);
+	return retValue;
+}
 
-		/* Reset Insert-Bulk Options. */
-		insert_bulk_keep_nulls = prev_insert_bulk_keep_nulls;
-		insert_bulk_rows_per_batch = prev_insert_bulk_rows_per_batch;
-		insert_bulk_kilobytes_per_batch = prev_insert_bulk_kilobytes_per_batch;
+/*
+ * execute_bulk_load_insert_row - Insert a single row of the current implicit
+ * batch as soon as it has been decoded.  The batch is finished by calling
+ * execute_bulk_load_insert without Values.
+ */
+void
+execute_bulk_load_insert_row(int ncol, Datum *Values, bool *Nulls)
+{
+	Snapshot snap = NULL;
+
+	if (cstmt == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("Insert Bulk row received outside of an Insert Bulk statement")));
+
+	PG_TRY();
+	{
+		cstmt->ncol = ncol;
+		cstmt->Values = NULL;
+		cstmt->Nulls = NULL;
+
+		/* All rows of a batch are inserted under the same snapshot. */
+		if (!bulk_load_snapshot)
+			bulk_load_snapshot = RegisterSnapshot(GetTransactionSnapshot());
+		snap = bulk_load_snapshot;
+		PushActiveSnapshot(snap);
 
+		BulkCopyRow(cstmt, Values, Nulls);
+
+		PopActiveSnapshot();
+	}
+	PG_CATCH();
+	{
+		abort_bulk_load_batch(snap);
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
+}
 
-	return retValue;
+/*
+ * abort_bulk_load_batch - Roll back after a failed implicit batch.
+ * In an error condition, the caller calls execute_bulk_load_insert
+ * again to do the cleanup.
+ */
+static void
+abort_bulk_load_batch(Snapshot snap)
+{
+	MemoryContext oldcontext;
+
+	if (snap && ActiveSnapshotSet() && GetActiveSnapshot() == snap)
+		PopActiveSnapshot();
+	oldcontext = CurrentMemoryContext;
+
+	/* The registration goes away with the resource owner on abort. */
+	bulk_load_snapshot = NULL;
+
+	/*
+	 * If a transaction block is already in progress then abort it,
+	 * else rollback entire transaction.
+	 */
+	if (!IsTransactionBlockActive())
+	{
+		AbortCurrentTransaction();
+		StartTransactionCommand();
+	}
+	else
+		pltsql_rollback_txn();
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Reset Insert-Bulk Options. */
+	insert_bulk_keep_nulls = prev_insert_bulk_keep_nulls;
+	insert_bulk_rows_per_batch = prev_insert_bulk_rows_per_batch;
+	insert_bulk_kilobytes_per_batch = prev_insert_bulk_kilobytes_per_batch;
+	insert_bulk_rows_per_flush = prev_insert_bulk_rows_per_flush;
+	insert_bulk_kilobytes_per_flush = prev_insert_bulk_kilobytes_per_flush;
 }
 
 int
@@ -3006,3 +3124,8 @@ int get_insert_bulk_kilobytes_per_batch()
 {
 	return insert_bulk_kilobytes_per_batch;
 }
+
+bool get_insert_bulk_streaming()
+{
+	return insert_bulk_streaming;
+}
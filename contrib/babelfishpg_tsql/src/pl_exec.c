@@ -341,6 +341,8 @@ static int exec_fmtonly(PLtsql_execstate *estate,
 
 static void exec_check_rw_parameter(PLtsql_expr *expr, int target_dno);
 static bool contains_target_param(Node *node, int *target_dno);
+static bool exec_eval_select_assign(PLtsql_execstate *estate,
+						PLtsql_stmt_execsql *stmt);
 static bool exec_eval_simple_expr(PLtsql_execstate *estate,
 					  PLtsql_expr *expr,
 					  Datum *result,
@@ -461,7 +463,7 @@ static void pltsql_clean_table_variables(PLtsql_execstate *estate, PLtsql_functi
 static void pltsql_init_exec_error_data(PLtsqlErrorData *error_data);
 static void pltsql_copy_exec_error_data(PLtsqlErrorData *src, PLtsqlErrorData *dst, MemoryContext dstCxt);
 PLtsql_estate_err *pltsql_clone_estate_err(PLtsql_estate_err *err);
-bool reset_search_path(PLtsql_stmt_execsql *stmt, char *old_search_path, bool* reset_session_properties, bool inside_trigger);
+bool reset_search_path(PLtsql_stmt_execsql *stmt, char **old_search_path, bool* reset_session_properties, bool inside_trigger);
 
 extern void pltsql_init_anonymous_cursors(PLtsql_execstate *estate);
 extern void pltsql_cleanup_local_cursors(PLtsql_execstate *estate);
@@ -4604,9 +4606,9 @@ exec_stmt_execsql(PLtsql_execstate *estate,
 	char		*cur_dbname = get_cur_db_name();
 	bool            reset_session_properties = false;
 	bool            inside_trigger = false;
-	/* fetch current search_path */
-	List 		*path_oids = fetch_search_path(false);
-	char 		*old_search_path = flatten_search_path(path_oids);
+	bool		simple_assign = false;
+	uint64		processed;
+	char		*old_search_path = NULL;
 
 	if (stmt->is_cross_db)
 	{
@@ -4636,7 +4638,7 @@ exec_stmt_execsql(PLtsql_execstate *estate,
 			estate->schema_name = NULL;
 		if (estate->trigdata)
 			inside_trigger = true;
-		need_path_reset = reset_search_path(stmt, old_search_path, &reset_session_properties, inside_trigger);
+		need_path_reset = reset_search_path(stmt, &old_search_path, &reset_session_properties, inside_trigger);
 	}
 
 	PG_TRY();
@@ -4792,10 +4794,21 @@ exec_stmt_execsql(PLtsql_execstate *estate,
 			 stmt->txn_data->stmt_kind == TRANS_STMT_ROLLBACK_TO))
 			restore_session_properties();
 	}
+	else if (stmt->is_tsql_select_assign_stmt &&
+			 exec_eval_select_assign(estate, stmt))
+	{
+		/* The targets are assigned already, as if from a single row */
+		simple_assign = true;
+		rc = SPI_OK_SELECT;
+	}
 	else
 		rc = SPI_execute_plan_with_paramlist(expr->plan, paramLI,
 												estate->readonly_func, tcount);
 
+	if (stmt->is_tsql_select_assign_stmt)
+		expr_stats_count(estate->func, simple_assign);
+	processed = simple_assign ? 1 : SPI_processed;
+
 	/*
 	 * Check for error, and set FOUND if appropriate (for historical reasons
 	 * we set FOUND only for certain query types).  Also Assert that we
@@ -4808,7 +4821,7 @@ exec_stmt_execsql(PLtsql_execstate *estate,
 			break;
 		case SPI_OK_SELECT:
 			Assert(!stmt->mod_stmt);
-			exec_set_found(estate, (SPI_processed != 0));
+			exec_set_found(estate, (processed != 0));
 			break;
 
 		case SPI_OK_INSERT:
@@ -4818,7 +4831,7 @@ exec_stmt_execsql(PLtsql_execstate *estate,
 		case SPI_OK_UPDATE_RETURNING:
 		case SPI_OK_DELETE_RETURNING:
 			Assert(stmt->mod_stmt);
-			exec_set_found(estate, (SPI_processed != 0));
+			exec_set_found(estate, (processed != 0));
 			break;
 
 		case SPI_OK_SELINTO:
@@ -4862,7 +4875,7 @@ exec_stmt_execsql(PLtsql_execstate *estate,
 	{
 		if (!stmt->need_to_push_result) // before trigger execution , set the rowcount
 		{
-			exec_set_rowcount(SPI_processed);
+			exec_set_rowcount(processed);
 		}
 		/* Close nesting level on engine side */
 		EndCompositeTriggers(false);
@@ -4883,12 +4896,12 @@ exec_stmt_execsql(PLtsql_execstate *estate,
 	if (!stmt->need_to_push_result) // already set in execute_plan_and_push_result
 	{
 		/* All variants should save result info for GET DIAGNOSTICS */
-		estate->eval_processed = SPI_processed;
-		exec_set_rowcount(SPI_processed);
+		estate->eval_processed = processed;
+		exec_set_rowcount(processed);
 	}
 
 	/* Process INTO if present */
-	if (stmt->into || stmt->is_tsql_select_assign_stmt)
+	if (!simple_assign && (stmt->into || stmt->is_tsql_select_assign_stmt))
 	{
 		SPITupleTable *tuptab = SPI_tuptable;
 		uint64		n = SPI_processed;
@@ -4981,7 +4994,7 @@ exec_stmt_execsql(PLtsql_execstate *estate,
 	pltsql_update_identity_insert_sequence(expr);
 
 	/* Expect SPI_tuptable to be NULL else complain */
-	if (SPI_tuptable != NULL)
+	if (!simple_assign && SPI_tuptable != NULL)
 		ereport(ERROR,
 				(errcode(ERRCODE_SYNTAX_ERROR),
 				 errmsg("query has no destination for result data"),
@@ -5012,9 +5025,9 @@ exec_stmt_execsql(PLtsql_execstate *estate,
 	PG_CATCH();
 	{
 		if (need_path_reset)
-	 		(void) set_config_option("search_path", old_search_path,
-	 					PGC_USERSET, PGC_S_SESSION,
-	 					GUC_ACTION_SAVE, true, 0, false);
+			(void) set_config_option("search_path", old_search_path,
+						PGC_USERSET, PGC_S_SESSION,
+						GUC_ACTION_SAVE, true, 0, false);
 		if(reset_session_properties)
 		{
 			set_session_properties(cur_dbname);
@@ -5026,15 +5039,14 @@ exec_stmt_execsql(PLtsql_execstate *estate,
 				set_session_properties(cur_dbname);
 			SetCurrentRoleId(current_user_id, false);
 		}
-		list_free(path_oids);
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
 
 	if (need_path_reset)
-	 	(void) set_config_option("search_path", old_search_path,
-	 				PGC_USERSET, PGC_S_SESSION,
-	 				GUC_ACTION_SAVE, true, 0, false);
+		(void) set_config_option("search_path", old_search_path,
+					PGC_USERSET, PGC_S_SESSION,
+					GUC_ACTION_SAVE, true, 0, false);
 	if(reset_session_properties)
 	{
 		set_session_properties(cur_dbname);
@@ -5046,7 +5058,6 @@ exec_stmt_execsql(PLtsql_execstate *estate,
 			set_session_properties(cur_dbname);
 		SetCurrentRoleId(current_user_id, false);
 	}
-	list_free(path_oids);
 
 	return PLTSQL_RC_OK;
 }
@@ -7138,11 +7149,17 @@ exec_eval_expr(PLtsql_execstate *estate,
 
 	/*
 	 * If this is a simple expression, bypass SPI and use the executor
-	 * directly
+	 * directly.  A row of several columns is only simple for a SELECT
+	 * assignment; here it has to reach the column check below.
 	 */
-	if (exec_eval_simple_expr(estate, expr,
+	if (!expr->expr_simple_row &&
+		exec_eval_simple_expr(estate, expr,
 							  &result, isNull, rettype, rettypmod))
+	{
+		expr_stats_count(estate->func, true);
 		return result;
+	}
+	expr_stats_count(estate->func, false);
 
 	/*
 	 * Else do it the hard way via exec_run_select
@@ -7223,11 +7240,12 @@ exec_run_select(PLtsql_execstate *estate,
 	/*
 	 * If we started an implicit_transaction for this statement but
 	 * the statement has a simple expression associated with them,
-	 * we no longer require an implicit transaction
+	 * we no longer require an implicit transaction.  A row of several
+	 * columns is only evaluated that way for a SELECT assignment.
 	 */
 	if (estate->impl_txn_type == PLTSQL_IMPL_TRAN_START)
 	{
-		if (expr->expr_simple_expr != NULL)
+		if (expr->expr_simple_expr != NULL && !expr->expr_simple_row)
 			pltsql_commit_not_required_impl_txn(estate);
 		else
 			estate->impl_txn_type = PLTSQL_IMPL_TRAN_ON;
@@ -7422,6 +7440,47 @@ loop_exit:
 }
 
 
+/* ----------
+ * exec_eval_select_assign		Evaluate a T-SQL SELECT assignment without
+ *					FROM (SELECT @a = x, @b = y) as a simple expression
+ *					and assign its target variables directly.
+ *
+ * Returns false if the statement has to be run through SPI.
+ * ----------
+ */
+static bool
+exec_eval_select_assign(PLtsql_execstate *estate, PLtsql_stmt_execsql *stmt)
+{
+	PLtsql_expr *expr = stmt->sqlstmt;
+	PLtsql_row *row = (PLtsql_row *) estate->datums[stmt->target->dno];
+	Datum		value;
+	bool		isnull;
+	Oid			valtype;
+	int32		valtypmod;
+
+	Assert(row->dtype == PLTSQL_DTYPE_ROW);
+
+	if (!exec_eval_simple_expr(estate, expr,
+							   &value, &isnull, &valtype, &valtypmod))
+		return false;
+
+	/* Like SET, ignore string truncation as the SPI path does */
+	suppress_string_truncation_error = true;
+	if (expr->expr_simple_row)
+		exec_move_row_from_datum(estate, (PLtsql_variable *) row, value);
+	else
+	{
+		Assert(row->nfields == 1);
+		exec_assign_value(estate, estate->datums[row->varnos[0]],
+						  value, isnull, valtype, valtypmod);
+	}
+	suppress_string_truncation_error = false;
+
+	exec_eval_cleanup(estate);
+
+	return true;
+}
+
 /* ----------
  * exec_eval_simple_expr -		Evaluate a simple expression returning
  *								a Datum by directly calling ExecEvalExpr().
@@ -9238,8 +9297,9 @@ exec_check_rw_parameter(PLtsql_expr *expr, int target_dno)
 	 * If the expression isn't simple, there's no point in trying to optimize
 	 * (because the exec_run_select code path will flatten any expanded result
 	 * anyway).  Even without that, this seems like a good safety restriction.
+	 * A row of several columns is only simple for a SELECT assignment.
 	 */
-	if (expr->expr_simple_expr == NULL)
+	if (expr->expr_simple_expr == NULL || expr->expr_simple_row)
 		return;
 
 	/*
@@ -10090,11 +10150,39 @@ pltsql_clone_estate_err(PLtsql_estate_err *err)
 	return clone;
 }
 
-bool reset_search_path(PLtsql_stmt_execsql *stmt, char *old_search_path, bool* reset_session_properties, bool inside_trigger)
+/*
+ * Put the schema where the object is referenced and its dbo schema in front
+ * of the search path, and hand back the old path for the caller to restore.
+ * The current path is only fetched here, so that statements which leave the
+ * search path alone don't pay for flattening it.
+ */
+static void
+prepend_search_path(char *physical_schema, char *dbo_schema, char **old_search_path)
+{
+	List	   *path_oids = fetch_search_path(false);
+	char	   *new_search_path;
+
+	*old_search_path = flatten_search_path(path_oids);
+	list_free(path_oids);
+
+	new_search_path = psprintf("%s, %s, %s", physical_schema, dbo_schema, *old_search_path);
+	(void) set_config_option("search_path", new_search_path,
+					PGC_USERSET, PGC_S_SESSION,
+					GUC_ACTION_SAVE, true, 0, false);
+	pfree(new_search_path);
+}
+
+/*
+ * Make unqualified names in the statement resolve against the schema of the
+ * calling procedure (or trigger, or referenced function) and its dbo schema,
+ * ahead of the session search path.  Returns true if the search path was
+ * changed, in which case *old_search_path is set to the setting the caller
+ * has to restore once the statement has run.
+ */
+bool reset_search_path(PLtsql_stmt_execsql *stmt, char **old_search_path, bool* reset_session_properties, bool inside_trigger)
 {
 	PLExecStateCallStack *top_es_entry;
 	char		*cur_dbname = get_cur_db_name();
-	char 		*new_search_path;
 	char 		*physical_schema;
 	char		*dbo_schema;
 	top_es_entry = exec_state_call_stack->next;
@@ -10138,11 +10226,8 @@ bool reset_search_path(PLtsql_stmt_execsql *stmt, char *old_search_path, bool* r
 						dbo_schema = get_dbo_schema_name(top_es_entry->estate->db_name);
 					}
 				}
-				new_search_path = psprintf("%s, %s, %s", physical_schema, dbo_schema, old_search_path);
 				/* Add the schema where the object is referenced and dbo schema to the new search path */
-				(void) set_config_option("search_path", new_search_path,
-								PGC_USERSET, PGC_S_SESSION,
-								GUC_ACTION_SAVE, true, 0, false);
+				prepend_search_path(physical_schema, dbo_schema, old_search_path);
 				return true;
 			}
 			else if(top_es_entry->estate->db_name != NULL && stmt->is_ddl)
@@ -10176,11 +10261,8 @@ bool reset_search_path(PLtsql_stmt_execsql *stmt, char *old_search_path, bool* r
 				{
 					physical_schema = get_physical_schema_name(cur_dbname, top_es_entry->estate->schema_name);
 					dbo_schema = get_dbo_schema_name(cur_dbname);
-					new_search_path = psprintf("%s, %s, %s", physical_schema, dbo_schema, old_search_path);
 					/* Add the schema where the object is referenced and dbo schema to the new search path */
-					(void) set_config_option("search_path", new_search_path,
-							PGC_USERSET, PGC_S_SESSION,
-							GUC_ACTION_SAVE, true, 0, false);
+					prepend_search_path(physical_schema, dbo_schema, old_search_path);
 					return true;
 				}
 			}
@@ -10198,11 +10280,8 @@ bool reset_search_path(PLtsql_stmt_execsql *stmt, char *old_search_path, bool* r
 		cur_dbname = get_cur_db_name();
 		physical_schema = get_physical_schema_name(cur_dbname, stmt->schema_name);
 		dbo_schema = get_dbo_schema_name(cur_dbname);
-		new_search_path = psprintf("%s, %s, %s", physical_schema, dbo_schema, old_search_path);
 		/* Add the schema where the object is referenced and dbo schema to the new search path */
-		(void) set_config_option("search_path", new_search_path,
-						PGC_USERSET, PGC_S_SESSION,
-						GUC_ACTION_SAVE, true, 0, false);
+		prepend_search_path(physical_schema, dbo_schema, old_search_path);
 		return true;
 	}
 	return false;
@@ -129,8 +129,8 @@ static bool is_identity_constraint(ColumnDef *column);
 static bool has_unique_nullable_constraint(ColumnDef *column);
 static bool is_nullable_constraint(Constraint *cst, Oid rel_oid);
 static bool is_nullable_index(IndexStmt *stmt);
-extern PLtsql_function * find_cached_batch(int handle);
-extern void apply_post_compile_actions(PLtsql_function *func, InlineCodeBlockArgs *args);
+extern void apply_post_compile_actions(PLtsql_function *func, const char *source_text,
+									   InlineCodeBlockArgs *args);
 Datum sp_prepare(PG_FUNCTION_ARGS);
 Datum sp_unprepare(PG_FUNCTION_ARGS);
 static List *transformReturningList(ParseState *pstate, List *returningList);
@@ -195,7 +195,21 @@ Portal					pltsql_snapshot_portal = NULL;
 int								pltsql_non_tsql_proc_entry_count = 0;
 int								pltsql_sys_func_entry_count = 0;
 static int                             PltsqlGUCNestLevel = 0;
-static bool                            pltsql_guc_dirty;
+
+/*
+ * GUCs that got a session_stack entry inside a procedure, in the order they
+ * were pushed, so that pltsql_revert_guc() only visits the ones the exiting
+ * nest level changed.  Inner levels are always at the end.
+ */
+typedef struct PltsqlGUCPushed
+{
+	struct config_generic *gconf;
+	int			nest_level;
+} PltsqlGUCPushed;
+
+static PltsqlGUCPushed *pltsql_guc_pushed = NULL;
+static int	pltsql_guc_npushed = 0;
+static int	pltsql_guc_maxpushed = 0;
 static guc_push_old_value_hook_type prev_guc_push_old_value_hook = NULL;
 static validate_set_config_function_hook_type prev_validate_set_config_function_hook = NULL;
 static void pltsql_guc_push_old_value(struct config_generic *gconf, GucAction action);
@@ -3316,27 +3330,19 @@ pltsql_truncate_identifier_func(PG_FUNCTION_ARGS)
 {
 	char *name = text_to_cstring(PG_GETARG_TEXT_PP(0));
 	int len = strlen(name);
-	const char *saved_dialect = GetConfigOption("babelfishpg_tsql.sql_dialect", true, true);
+	int saved_dialect;
 
+	/* this is BBF help function. use BBF truncation logic */
+	saved_dialect = pltsql_enter_dialect(SQL_DIALECT_TSQL);
 	PG_TRY();
 	{
-		/* this is BBF help function. use BBF truncation logic */
-		set_config_option("babelfishpg_tsql.sql_dialect", "tsql",
-					(superuser() ? PGC_SUSET : PGC_USERSET),
-					PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
 		truncate_identifier(name, len, false);
 	}
-	PG_CATCH();
+	PG_FINALLY();
 	{
-		set_config_option("babelfishpg_tsql.sql_dialect", saved_dialect,
-					(superuser() ? PGC_SUSET : PGC_USERSET),
-					PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
-		PG_RE_THROW();
+		pltsql_leave_dialect(saved_dialect);
 	}
 	PG_END_TRY();
-	set_config_option("babelfishpg_tsql.sql_dialect", saved_dialect,
-				(superuser() ? PGC_SUSET : PGC_USERSET),
-				PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
 
 	PG_RETURN_TEXT_P(cstring_to_text(name));
 }
@@ -3511,6 +3517,8 @@ _PG_init(void)
 		(*pltsql_protocol_plugin_ptr)->pltsql_get_user_for_database = &get_user_for_database;
 		(*pltsql_protocol_plugin_ptr)->get_insert_bulk_rows_per_batch = &get_insert_bulk_rows_per_batch;
 		(*pltsql_protocol_plugin_ptr)->get_insert_bulk_kilobytes_per_batch = &get_insert_bulk_kilobytes_per_batch;
+		(*pltsql_protocol_plugin_ptr)->get_insert_bulk_streaming = &get_insert_bulk_streaming;
+		(*pltsql_protocol_plugin_ptr)->bulk_load_row_callback = &execute_bulk_load_insert_row;
 		(*pltsql_protocol_plugin_ptr)->tsql_varchar_input = &tsql_varchar_input;
 		(*pltsql_protocol_plugin_ptr)->tsql_char_input = &tsql_bpchar_input;
 	}
@@ -3584,6 +3592,13 @@ _PG_init(void)
 	get_func_language_oids_hook = get_func_language_oids;
 	coalesce_typmod_hook = coalesce_typmod_hook_impl;
 
+	/*
+	 * The parser caches live for the whole process, prime them now rather
+	 * than during the first batches of the session.
+	 */
+	if (pltsql_parser_warmup)
+		pltsql_parser_warmup_run();
+
 	inited = true;
 }
 
@@ -3908,6 +3923,8 @@ pltsql_inline_handler(PG_FUNCTION_ARGS)
 	LOCAL_FCINFO(fake_fcinfo, FUNC_MAX_ARGS);
 	bool nonatomic;
 	bool support_tsql_trans = pltsql_support_tsql_transactions();
+	bool		batch_cached = false;
+	instr_time	exec_start;
 	ReturnSetInfo rsinfo; /* for INSERT ... EXECUTE */
 
 	/* 
@@ -3948,6 +3965,11 @@ pltsql_inline_handler(PG_FUNCTION_ARGS)
 
 	elog(DEBUG2, "TSQL TXN inline handler, nonatomic : %d Tsql transaction support %d", nonatomic, support_tsql_trans);
 
+	INSTR_TIME_SET_ZERO(exec_start);
+	if (OPTION_ENABLED(codeblock_args, EXEC_CACHED_PLAN) ||
+		OPTION_ENABLED(codeblock_args, CACHE_PLAN))
+		INSTR_TIME_SET_CURRENT(exec_start);
+
 	PG_TRY();
 	{
 		if (OPTION_ENABLED(codeblock_args, EXEC_CACHED_PLAN))
@@ -3959,15 +3981,39 @@ pltsql_inline_handler(PG_FUNCTION_ARGS)
 			/* Mark the function as busy, just pro forma */
 			func->use_count++;
 		}
+		else if (OPTION_ENABLED(codeblock_args, REUSE_BATCH) &&
+				 (func = batch_cache_lookup(codeblock->source_text, codeblock_args)) != NULL)
+		{
+			/* Reuse a batch compiled by an earlier sp_executesql */
+			func->use_count++;
+			batch_cached = true;
+			codeblock_args->options |= BATCH_OPTION_NO_FREE;
+		}
 		else
 		{
-			/* Compile the anonymous code block */
-			func = pltsql_compile_inline(codeblock->source_text, codeblock_args);
+			/*
+			 * Compile the anonymous code block, unless a batch being prepared
+			 * is in the sp_executesql cache already, e.g. after
+			 * sys.babelfish_prepared_statements_prewarm().  Not for sp_prepare
+			 * itself, which plans the statement right away.
+			 */
+			if (!OPTION_ENABLED(codeblock_args, CACHE_PLAN) ||
+				OPTION_ENABLED(codeblock_args, PREPARE_PLAN) ||
+				(func = batch_cache_take(codeblock->source_text, codeblock_args)) == NULL)
+				func = pltsql_compile_inline(codeblock->source_text, codeblock_args);
 
 			/* Mark the function as busy, just pro forma */
 			func->use_count++;
 
-			apply_post_compile_actions(func, codeblock_args);
+			apply_post_compile_actions(func, codeblock->source_text, codeblock_args);
+
+			if (OPTION_ENABLED(codeblock_args, REUSE_BATCH) &&
+				batch_cache_insert(codeblock->source_text, codeblock_args, func))
+			{
+				/* The cache owns the function now */
+				batch_cached = true;
+				codeblock_args->options |= BATCH_OPTION_NO_FREE;
+			}
 
 			if (OPTION_ENABLED(codeblock_args, NO_EXEC))
 			{
@@ -4077,9 +4123,13 @@ pltsql_inline_handler(PG_FUNCTION_ARGS)
 		 * inside pltsql_exec_function
 		 */
 
-		/* Function should now have no remaining use-counts ... */
+		/*
+		 * Function should now have no remaining use-counts, unless it is a
+		 * cached batch that sp_executesql is running further up the stack
+		 * as well ...
+		 */
 		func->use_count--;
-		Assert(func->use_count == 0);
+		Assert(func->use_count == 0 || OPTION_ENABLED(codeblock_args, NO_FREE));
 
 		/* ... so we can free subsidiary storage */
 		if (!OPTION_ENABLED(codeblock_args, NO_FREE))
@@ -4088,6 +4138,10 @@ pltsql_inline_handler(PG_FUNCTION_ARGS)
 			FreeExecutorState(simple_eval_estate);
 			pltsql_free_function_memory(func);
 		}
+		else if (batch_cached)
+			batch_cache_release(func);
+		else if (OPTION_ENABLED(codeblock_args, EXEC_CACHED_PLAN))
+			release_cached_batch(func);
 		sql_dialect = saved_dialect;
 
 		terminate_batch(true /* send_error */, false /* compile_error */);
@@ -4115,9 +4169,14 @@ pltsql_inline_handler(PG_FUNCTION_ARGS)
 		ExecDropSingleTupleTableSlot(slot);
 	}
 
-	/* Function should now have no remaining use-counts ... */
+	/*
+	 * Function should now have no remaining use-counts, unless it is a
+	 * cached batch that sp_executesql is running further up the stack as
+	 * well; batch_cache_release() and release_cached_batch() leave those
+	 * alone ...
+	 */
 	func->use_count--;
-	Assert(func->use_count == 0);
+	Assert(func->use_count == 0 || OPTION_ENABLED(codeblock_args, NO_FREE));
 
 	/* ... so we can free subsidiary storage */
 	if (!OPTION_ENABLED(codeblock_args, NO_FREE))
@@ -4125,6 +4184,14 @@ pltsql_inline_handler(PG_FUNCTION_ARGS)
 		FreeExecutorState(simple_eval_estate);
 		pltsql_free_function_memory(func);
 	}
+	else if (batch_cached)
+		batch_cache_release(func);
+	else if (OPTION_ENABLED(codeblock_args, EXEC_CACHED_PLAN))
+		release_cached_batch(func);
+
+	if (OPTION_ENABLED(codeblock_args, EXEC_CACHED_PLAN) ||
+		OPTION_ENABLED(codeblock_args, CACHE_PLAN))
+		record_cached_batch_execution(codeblock_args->handle, exec_start);
 	sql_dialect = saved_dialect;
 	
 	terminate_batch(false /* send_error */, false /* compile_error */);
@@ -4628,7 +4695,7 @@ pltsql_guc_push_old_value(struct config_generic *gconf, GucAction action)
                                                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
                                                 errmsg("Set action not supported")));
                }
-               Assert(pltsql_guc_dirty);
+               Assert(pltsql_guc_npushed > 0);
                return;
        }
 
@@ -4657,32 +4724,40 @@ pltsql_guc_push_old_value(struct config_generic *gconf, GucAction action)
        guc_set_stack_value(gconf, &stack->prior);
 
        gconf->session_stack = stack;
-       pltsql_guc_dirty = true;
+
+       /* Remember it for pltsql_revert_guc() */
+       if (pltsql_guc_npushed >= pltsql_guc_maxpushed)
+       {
+               if (pltsql_guc_pushed == NULL)
+               {
+                       pltsql_guc_maxpushed = 16;
+                       pltsql_guc_pushed = (PltsqlGUCPushed *)
+                               MemoryContextAlloc(TopMemoryContext,
+                                                  pltsql_guc_maxpushed * sizeof(PltsqlGUCPushed));
+               }
+               else
+               {
+                       pltsql_guc_maxpushed *= 2;
+                       pltsql_guc_pushed = (PltsqlGUCPushed *)
+                               repalloc(pltsql_guc_pushed,
+                                        pltsql_guc_maxpushed * sizeof(PltsqlGUCPushed));
+               }
+       }
+       pltsql_guc_pushed[pltsql_guc_npushed].gconf = gconf;
+       pltsql_guc_pushed[pltsql_guc_npushed].nest_level = PltsqlGUCNestLevel;
+       pltsql_guc_npushed++;
 }
 
 static void
 pltsql_revert_guc(int nest_level)
 {
-       bool            still_dirty;
-       int                     i;
-       int                     num_guc_variables;
-       struct config_generic **guc_variables;
-
        Assert(nest_level > 0 && nest_level == PltsqlGUCNestLevel);
 
-       /* Quick exit if nothing's changed in this procedure */
-       if (!pltsql_guc_dirty)
+       /* Undo the GUCs this nest level pushed, most recent first */
+       while (pltsql_guc_npushed > 0 &&
+              pltsql_guc_pushed[pltsql_guc_npushed - 1].nest_level == nest_level)
        {
-               PltsqlGUCNestLevel = nest_level - 1;
-               return;
-       }
-
-       still_dirty = false;
-       num_guc_variables = GetNumConfigOptions();
-       guc_variables = get_guc_variables();
-       for (i = 0; i < num_guc_variables; i++)
-       {
-               struct config_generic *gconf = guc_variables[i];
+               struct config_generic *gconf = pltsql_guc_pushed[--pltsql_guc_npushed].gconf;
                GucStack   *stack =  gconf->session_stack;
 
                if (stack != NULL && stack->nest_level == nest_level)
@@ -4805,15 +4880,9 @@ pltsql_revert_guc(int nest_level)
                        /* Finish popping the state stack */
                        gconf->session_stack = prev;
                        pfree(stack);
-               }                                               /* end of stack-popping loop */
-
-               if (stack != NULL)
-                       still_dirty = true;
+               }
        }
 
-       /* If there are no remaining stack entries, we can reset guc_dirty */
-       pltsql_guc_dirty = still_dirty;
-
        /* Update nesting level */
        PltsqlGUCNestLevel = nest_level - 1;
 
@@ -21,6 +21,7 @@
 #include "catalog/pg_collation.h"
 #include "commands/defrem.h"
 #include "parser/parse_func.h"
+#include "parser/parser.h"
 #include "commands/event_trigger.h"
 #include "commands/sequence.h"
 #include "commands/trigger.h"
@@ -307,6 +308,7 @@ typedef struct PLtsql_expr
 	Oid			expr_simple_type;	/* result type Oid, if simple */
 	int32		expr_simple_typmod; /* result typmod, if simple */
       bool            expr_simple_mutable;    /* true if simple expr is mutable */
+	bool		expr_simple_row;	/* true if a RowExpr of several columns */
 
 	/*
 	 * if expr is simple AND prepared in current transaction,
@@ -922,6 +924,8 @@ typedef struct PLtsql_stmt_insert_bulk
 	char *kilobytes_per_batch;
 	char *rows_per_batch;
 	bool keep_nulls;
+	char *kilobytes_per_flush;
+	char *rows_per_flush;
 } PLtsql_stmt_insert_bulk;
 
 /*
@@ -1120,6 +1124,7 @@ typedef enum PLtsql_trigtype
 #define BATCH_OPTION_NO_EXEC				0x8
 #define BATCH_OPTION_EXEC_CACHED_PLAN 		0x10
 #define BATCH_OPTION_NO_FREE 				0x20
+#define BATCH_OPTION_REUSE_BATCH			0x40
 
 typedef struct InlineCodeBlockArgs
 {
@@ -1201,6 +1206,9 @@ typedef struct PLtsql_function
 
 	/* arguments for inline code block */
 	InlineCodeBlockArgs *inline_args;
+
+	/* simple vs SPI evaluation counters, see expr_stats.c */
+	struct ExprStatsEntry *expr_stats;
 } PLtsql_function;
 
 /*
@@ -1623,6 +1631,10 @@ typedef struct PLtsql_protocol_plugin
 	
 	int (*get_insert_bulk_kilobytes_per_batch) ();
 
+	bool (*get_insert_bulk_streaming) ();
+
+	void (*bulk_load_row_callback) (int ncol, Datum *Values, bool *Nulls);
+
 	void* (*tsql_varchar_input) (const char *s, size_t len, int32 atttypmod);
 
 	void* (*tsql_char_input) (const char *s, size_t len, int32 atttypmod);
@@ -1777,10 +1789,36 @@ extern char *bulk_load_table_name;
 /* Insert Bulk Options */
 #define DEFAULT_INSERT_BULK_ROWS_PER_BATCH 1000
 #define DEFAULT_INSERT_BULK_PACKET_SIZE 8
+#define DEFAULT_INSERT_BULK_ROWS_PER_FLUSH 1000
+#define DEFAULT_INSERT_BULK_KILOBYTES_PER_FLUSH 64
+#define MAX_INSERT_BULK_ROWS_PER_FLUSH 10000
+#define MAX_INSERT_BULK_KILOBYTES_PER_FLUSH (1024 * 1024)
 
 extern int insert_bulk_rows_per_batch;
 extern int insert_bulk_kilobytes_per_batch;
 extern bool insert_bulk_keep_nulls;
+extern int insert_bulk_rows_per_flush;
+extern int insert_bulk_kilobytes_per_flush;
+extern bool insert_bulk_streaming;
+
+/* sp_executesql batch cache */
+#define DEFAULT_BATCH_CACHE_SIZE 100
+#define DEFAULT_BATCH_CACHE_MEMORY_KB 8192
+
+extern int pltsql_batch_cache_size;
+extern int pltsql_batch_cache_memory_kb;
+
+/* sp_prepare handles */
+#define DEFAULT_PREPARED_BATCH_MEMORY_KB 16384
+
+/* prepared statement catalog */
+#define DEFAULT_PREPARED_CATALOG_MEMORY_KB 16384
+#define MAX_PREPARED_CATALOG_MEMORY_KB 1048576
+
+extern int pltsql_prepared_batch_memory_kb;
+extern int pltsql_prepared_catalog_size;
+extern int pltsql_prepared_catalog_memory_kb;
+extern int pltsql_statement_profiler_size;
 
 /**********************************************************************
  * Function declarations
@@ -1837,6 +1875,7 @@ extern bool pltsql_support_tsql_transactions(void);
 extern bool pltsql_sys_function_pop(void);
 extern uint64 execute_bulk_load_insert(int ncol, int nrow,
 				Datum *Values, bool *Nulls);
+extern void execute_bulk_load_insert_row(int ncol, Datum *Values, bool *Nulls);
 /*
  * Functions in pl_exec.c
  */
@@ -1859,6 +1898,57 @@ extern void pltsql_exec_get_datum_type_info(PLtsql_execstate *estate,
 								 
 extern int get_insert_bulk_rows_per_batch();
 extern int get_insert_bulk_kilobytes_per_batch();
+extern bool get_insert_bulk_streaming();
+
+/*
+ * Functions in batch_cache.c
+ */
+extern bool batch_cache_enabled(void);
+extern PLtsql_function *batch_cache_lookup(const char *source_text,
+										   InlineCodeBlockArgs *args);
+extern bool batch_cache_insert(const char *source_text, InlineCodeBlockArgs *args,
+							   PLtsql_function *func);
+extern bool batch_cache_contains(const char *source_text, InlineCodeBlockArgs *args);
+extern PLtsql_function *batch_cache_take(const char *source_text,
+										 InlineCodeBlockArgs *args);
+extern void batch_cache_release(PLtsql_function *func);
+extern void batch_cache_reset(void);
+
+/*
+ * Functions in prepared_batch.c
+ */
+extern int cache_compiled_batch(PLtsql_function *func, const char *source_text);
+extern PLtsql_function *find_cached_batch(int handle);
+extern void release_cached_batch(PLtsql_function *func);
+extern void record_cached_batch_execution(int handle, instr_time start);
+extern void delete_cached_batch(int handle);
+extern void reset_cached_batch(void);
+
+/*
+ * Functions in expr_stats.c
+ */
+extern void expr_stats_count(PLtsql_function *func, bool simple);
+
+/*
+ * Functions in prepared_catalog.c
+ */
+typedef struct PreparedCatalogKey
+{
+	Oid			userid;
+	int16		dbid;
+	uint64		queryid;		/* normalized text and parameter signature */
+} PreparedCatalogKey;
+
+extern bool prepared_catalog_enabled(void);
+extern void prepared_catalog_store(const char *source_text, InlineCodeBlockArgs *args,
+								   PreparedCatalogKey *key);
+extern void prepared_catalog_record(PreparedCatalogKey *key, double elapsed_ms);
+
+/*
+ * Functions in stmt_profiler.c
+ */
+extern struct StmtProfileCounters *stmt_profiler_begin(Oid fn_oid, struct ExecCodes *exec_codes);
+extern void stmt_profiler_flush(Oid fn_oid, struct ExecCodes *exec_codes);
 
 /*
  * Functions for namespace handling in pl_funcs.c
@@ -1913,6 +2003,22 @@ extern void pltsql_scanner_finish(void);
  */
 extern int	pltsql_yyparse(void);
 
+/*
+ * A fixed-size hash table in a shared segment, see shared_hash_init().  The
+ * slots and entries follow at offsets from this struct, since every backend
+ * maps the segment at its own address.
+ */
+typedef struct SharedHashTable
+{
+	int			capacity;
+	int			nentries;
+	uint32		nslots;			/* power of 2, at least twice capacity */
+	Size		keysize;
+	Size		entrysize;
+	Size		slotsoff;
+	Size		entriesoff;
+} SharedHashTable;
+
 /* functions in pltsql_utils.c */
 extern int TsqlUTF8LengthInUTF16(const void *vin, int len);
 extern void TsqlCheckUTF16Length_bpchar(const char *s, int32 len, int32 maxlen, int charlen, bool isExplicit);
@@ -1941,6 +2047,16 @@ extern bool is_sysname_column(ColumnDef *coldef);
 extern bool have_null_constr(List *constr_list);
 extern Node *parsetree_nth_stmt(List *parsetree, int n);
 extern void update_AlterTableStmt(Node *n, const char *tbl_schema, const char *newowner);
+extern void *pltsql_shared_segment(const char *name, Size size, bool create,
+								   void (*init) (void *address));
+extern Size shared_hash_memsize(int capacity, Size entrysize);
+extern void shared_hash_init(SharedHashTable *table, void *area, int capacity,
+							 Size keysize, Size entrysize);
+extern void *shared_hash_entry(SharedHashTable *table, int i);
+extern void *shared_hash_find(SharedHashTable *table, const void *key, uint32 **slot);
+extern void *shared_hash_insert(SharedHashTable *table, const void *key, uint32 *slot);
+extern void shared_hash_remove_if(SharedHashTable *table,
+								  bool (*remove) (void *entry, void *arg), void *arg);
 extern void update_CreateRoleStmt(Node *n, const char *role, const char *member, const char *addto);
 extern void update_AlterRoleStmt(Node *n, RoleSpec *role);
 extern void update_CreateSchemaStmt(Node *n, const char *schemaname, const char *authrole);
@@ -1959,6 +2075,39 @@ extern char *varchar_to_cstring(const VarChar *varchar);
 extern char *flatten_search_path(List *oid_list);
 extern const char *get_pltsql_function_signature_internal(const char *funcname, int nargs, const Oid *argtypes);
 
+/*
+ * Switch sql_dialect for a piece of internal work.  The variable is assigned
+ * directly rather than through set_config_option(), which pushes a GUC stack
+ * entry and copies strings on every switch.  Restore it in PG_FINALLY so that
+ * errors unwind it too:
+ *
+ *		int			saved_dialect = pltsql_enter_dialect(SQL_DIALECT_TSQL);
+ *
+ *		PG_TRY();
+ *		{
+ *			...
+ *		}
+ *		PG_FINALLY();
+ *		{
+ *			pltsql_leave_dialect(saved_dialect);
+ *		}
+ *		PG_END_TRY();
+ */
+static inline int
+pltsql_enter_dialect(int dialect)
+{
+	int			saved_dialect = sql_dialect;
+
+	sql_dialect = dialect;
+	return saved_dialect;
+}
+
+static inline void
+pltsql_leave_dialect(int saved_dialect)
+{
+	sql_dialect = saved_dialect;
+}
+
 typedef struct
 {
 	bool success;
@@ -1971,6 +2120,29 @@ typedef struct
 
 extern ANTLR_result antlr_parser_cpp(const char *sourceText);
 extern void report_antlr_error(ANTLR_result result);
+extern bool antlr_parser_warmup_batch(const char *sourceText);
+
+/*
+ * Parse times of this backend, reported by sys.babelfish_parser_stats().
+ * Only the ANTLR parse itself is timed, not the tree walks after it.
+ */
+typedef struct
+{
+	int64		warmup_batches;		/* batches parsed by the warm-up */
+	double		warmup_ms;			/* time the warm-up took */
+	int64		batches;			/* batches parsed since */
+	double		first_batch_ms;		/* parse time of the first of those */
+	double		last_batch_ms;
+	double		max_batch_ms;
+	double		total_batch_ms;
+	int64		sll_batches;		/* batches parsed in SLL mode */
+	int64		ll_fallbacks;		/* batches parsed again in LL mode */
+} ANTLR_parser_stats;
+
+extern ANTLR_parser_stats pltsql_parser_stats;
+extern bool pltsql_parser_warmup;
+extern char *pltsql_parser_warmup_file;
+extern void pltsql_parser_warmup_run(void);
 
 /*
  *  Configurations for iterative executor
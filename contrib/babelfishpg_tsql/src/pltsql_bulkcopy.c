@@ -19,10 +19,13 @@
 #include <unistd.h>
 #include <sys/stat.h>
 
+#include "access/genam.h"
 #include "access/heapam.h"
+#include "access/htup_details.h"
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/dependency.h"
+#include "catalog/index.h"
 #include "catalog/namespace.h"
 #include "commands/sequence.h"
 #include "commands/copy.h"
@@ -41,13 +44,11 @@
 #include "pltsql.h"
 
 /*
- * No more than this many tuples per CopyMultiInsertBuffer
- *
- * Caution: Don't make this too big, as we could end up with this many
- * CopyMultiInsertBuffer items stored in CopyMultiInsertInfo's
- * multiInsertBuffers list.
+ * The buffers are flushed once they hold insert_bulk_rows_per_flush tuples
+ * or insert_bulk_kilobytes_per_flush worth of tuple data, whichever comes
+ * first, so that neither very narrow rows flush too often nor very wide rows
+ * pile up in memory.  Both can be set per session or per INSERT BULK.
  */
-#define MAX_BUFFERED_TUPLES		1000
 
 /* Trim the list of buffers back down to this number after flushing */
 #define MAX_PARTITION_BUFFERS	32
@@ -55,12 +56,11 @@
 /* Stores multi-insert data related to a single relation. */
 typedef struct CopyMultiInsertBuffer
 {
-	TupleTableSlot *slots[MAX_BUFFERED_TUPLES]; /* Array to store tuples */
+	TupleTableSlot **slots;		/* Array of maxBufferedTuples tuples */
 	ResultRelInfo *resultRelInfo;	/* ResultRelInfo for 'relid' */
 	BulkInsertState bistate;	/* BulkInsertState for this rel */
 	int			nused;			/* number of 'slots' containing tuples */
-	uint64		linenos[MAX_BUFFERED_TUPLES];	/* Line # of tuple in bulk copy
-												 * stream */
+	uint64	   *linenos;		/* Line # of tuple in bulk copy stream */
 } CopyMultiInsertBuffer;
 
 /*
@@ -72,19 +72,44 @@ typedef struct CopyMultiInsertInfo
 {
 	List	   *multiInsertBuffers; /* List of tracked CopyMultiInsertBuffers */
 	int			bufferedTuples; /* number of tuples buffered over all buffers */
+	Size		bufferedBytes;	/* number of bytes from all buffered tuples */
+	int			maxBufferedTuples;	/* flush once this many tuples are buffered */
+	Size		maxBufferedBytes;	/* flush once this many bytes are buffered */
 	BulkCopyState cstate;		/* Bulk Copy state for this CopyMultiInsertInfo */
 	EState	   *estate;			/* Executor state used for BULK COPY */
 	CommandId	mycid;			/* Command Id used for BULK COPY */
 	int			ti_options;		/* table insert options */
 } CopyMultiInsertInfo;
 
+/*
+ * Executor state of the implicit batch being inserted.  It is kept across
+ * calls so that rows can also be streamed in one at a time by BulkCopyRow.
+ */
+typedef struct BulkCopyBatchStateData
+{
+	Relation	rel;			/* relation opened for this batch */
+	EState	   *estate;			/* Executor state used for this batch */
+	ResultRelInfo *resultRelInfo;
+	CopyMultiInsertInfo multiInsertInfo;
+	CommandId	mycid;			/* Command Id used for this batch */
+	uint64		processed;		/* number of rows inserted so far */
+} BulkCopyBatchStateData;
+
 static BulkCopyState
 BeginBulkCopy(Relation rel,
 			  List *attnamelist);
 
+static void
+BeginBulkCopyBatch(BulkCopyState cstate, Relation rel);
+
+static void
+BulkCopyInsertRow(BulkCopyState cstate, int colCount, Datum *Values, bool *Nulls);
+
 static uint64
-ExecuteBulkCopy(BulkCopyState cstate, int rowCount, int colCount,
-				Datum *Values, bool *Nulls);
+EndBulkCopyBatch(BulkCopyState cstate);
+
+static void
+BulkCopyAbortBatch(BulkCopyStmt *stmt, Relation rel);
 
 static List *
 BulkCopyGetAttnums(TupleDesc tupDesc, Relation rel, List *attnamelist);
@@ -100,36 +125,50 @@ void BulkCopyErrorCallback(void *arg);
 void
 BulkCopy(BulkCopyStmt *stmt, uint64 *processed)
 {
-	Relation	rel;
+	Relation	rel = NULL;
 	TupleDesc	tupDesc;
-	List	   *attnums;
+	List	   *attnums = NIL;
 
 	Assert (stmt && stmt->relation);
 
-	/* Open and lock the relation, using the appropriate lock type. */
-	rel = table_openrv(stmt->relation, RowExclusiveLock);
+	if (stmt->Values != NULL)
+	{
+		/* Open and lock the relation, using the appropriate lock type. */
+		rel = table_openrv(stmt->relation, RowExclusiveLock);
 
-	tupDesc = RelationGetDescr(rel);
+		tupDesc = RelationGetDescr(rel);
 
-	/* Generate or convert list of columns to process. */
-	attnums = BulkCopyGetAttnums(tupDesc, rel, stmt->attlist);
+		/* Generate or convert list of columns to process, for the first batch. */
+		if (!stmt->cstate)
+			attnums = BulkCopyGetAttnums(tupDesc, rel, stmt->attlist);
+	}
+	else if (stmt->cstate && stmt->cstate->batch)
+	{
+		/* The rows were streamed in by BulkCopyRow already. */
+		rel = stmt->cstate->batch->rel;
+	}
 
 	/* Execute Bulk Copy within try-catch block. */
 	PG_TRY();
 	{
-		if (!stmt->cstate)
-			stmt->cstate = BeginBulkCopy(rel, attnums);
-		
-		*processed = ExecuteBulkCopy(stmt->cstate, stmt->nrow, stmt->ncol, stmt->Values, stmt->Nulls);
+		if (stmt->Values != NULL)
+		{
+			if (!stmt->cstate)
+				stmt->cstate = BeginBulkCopy(rel, attnums);
+
+			BeginBulkCopyBatch(stmt->cstate, rel);
+			for (int row = 0; row < stmt->nrow; row++)
+				BulkCopyInsertRow(stmt->cstate, stmt->ncol,
+								  &stmt->Values[row * stmt->ncol],
+								  &stmt->Nulls[row * stmt->ncol]);
+		}
+
+		*processed = rel != NULL ? EndBulkCopyBatch(stmt->cstate) : 0;
 		stmt->rows_processed += *processed;
 	}
 	PG_CATCH();
 	{
-		/* For exact row which caused error, we have BulkCopyErrorCallback. */
-		elog(WARNING, "Error while executing Bulk Copy. Error occured while processing at "
-			"implicit Batch number: %d, Rows inserted in total: %ld", stmt->cur_batch_num, stmt->rows_processed);
-		if (rel != NULL)
-			table_close(rel, NoLock);
+		BulkCopyAbortBatch(stmt, rel);
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
@@ -143,6 +182,70 @@ BulkCopy(BulkCopyStmt *stmt, uint64 *processed)
 		table_close(rel, NoLock);
 }
 
+/*
+ *	 BulkCopyRow - inserts a single row of the current implicit batch
+ *
+ * This is the streaming counterpart of BulkCopy: the protocol layer hands
+ * over each row as soon as it is decoded, and the row goes straight into the
+ * multi-insert buffers, which are flushed to the table as they fill up.  So
+ * memory stays bounded by the buffers however large the batch is.  The batch
+ * is finished by calling BulkCopy without Values.
+ */
+void
+BulkCopyRow(BulkCopyStmt *stmt, Datum *values, bool *nulls)
+{
+	Relation	rel = NULL;
+	List	   *attnums = NIL;
+
+	Assert (stmt && stmt->relation);
+
+	if (!stmt->cstate || !stmt->cstate->batch)
+	{
+		/* First row of the batch, open and lock the relation. */
+		rel = table_openrv(stmt->relation, RowExclusiveLock);
+
+		/* Generate or convert list of columns to process, for the first batch. */
+		if (!stmt->cstate)
+			attnums = BulkCopyGetAttnums(RelationGetDescr(rel), rel, stmt->attlist);
+	}
+	else
+		rel = stmt->cstate->batch->rel;
+
+	PG_TRY();
+	{
+		if (!stmt->cstate)
+			stmt->cstate = BeginBulkCopy(rel, attnums);
+		if (!stmt->cstate->batch)
+			BeginBulkCopyBatch(stmt->cstate, rel);
+
+		BulkCopyInsertRow(stmt->cstate, stmt->ncol, values, nulls);
+	}
+	PG_CATCH();
+	{
+		BulkCopyAbortBatch(stmt, rel);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+}
+
+/*
+ * BulkCopyAbortBatch - Report the failed batch and close its relation.
+ *
+ * Everything else held by the batch is released by the transaction abort,
+ * and its memory with the copy context.
+ */
+static void
+BulkCopyAbortBatch(BulkCopyStmt *stmt, Relation rel)
+{
+	/* For exact row which caused error, we have BulkCopyErrorCallback. */
+	elog(WARNING, "Error while executing Bulk Copy. Error occured while processing at "
+		"implicit Batch number: %d, Rows inserted in total: %ld", stmt->cur_batch_num, stmt->rows_processed);
+	if (rel != NULL)
+		table_close(rel, NoLock);
+	if (stmt->cstate)
+		stmt->cstate->batch = NULL;
+}
+
 
 /*
  * BulkCopyGetAttnums - build an integer list of attnums to be copied
@@ -258,12 +361,13 @@ BulkCopyErrorCallback(void *arg)
  * ResultRelInfo.
  */
 static CopyMultiInsertBuffer *
-CopyMultiInsertBufferInit(ResultRelInfo *rri)
+CopyMultiInsertBufferInit(CopyMultiInsertInfo *miinfo, ResultRelInfo *rri)
 {
 	CopyMultiInsertBuffer *buffer;
 
 	buffer = (CopyMultiInsertBuffer *) palloc(sizeof(CopyMultiInsertBuffer));
-	memset(buffer->slots, 0, sizeof(TupleTableSlot *) * MAX_BUFFERED_TUPLES);
+	buffer->slots = palloc0(sizeof(TupleTableSlot *) * miinfo->maxBufferedTuples);
+	buffer->linenos = palloc(sizeof(uint64) * miinfo->maxBufferedTuples);
 	buffer->resultRelInfo = rri;
 	buffer->bistate = GetBulkInsertState();
 	buffer->nused = 0;
@@ -281,7 +385,7 @@ CopyMultiInsertInfoSetupBuffer(CopyMultiInsertInfo *miinfo,
 {
 	CopyMultiInsertBuffer *buffer;
 
-	buffer = CopyMultiInsertBufferInit(rri);
+	buffer = CopyMultiInsertBufferInit(miinfo, rri);
 
 	/* Setup back-link so we can easily find this buffer again. */
 	rri->ri_CopyMultiInsertBuffer = buffer;
@@ -302,6 +406,9 @@ CopyMultiInsertInfoInit(CopyMultiInsertInfo *miinfo, ResultRelInfo *rri,
 {
 	miinfo->multiInsertBuffers = NIL;
 	miinfo->bufferedTuples = 0;
+	miinfo->bufferedBytes = 0;
+	miinfo->maxBufferedTuples = insert_bulk_rows_per_flush;
+	miinfo->maxBufferedBytes = (Size) insert_bulk_kilobytes_per_flush * 1024;
 	miinfo->cstate = cstate;
 	miinfo->estate = estate;
 	miinfo->mycid = mycid;
@@ -323,7 +430,8 @@ CopyMultiInsertInfoInit(CopyMultiInsertInfo *miinfo, ResultRelInfo *rri,
 static inline bool
 CopyMultiInsertInfoIsFull(CopyMultiInsertInfo *miinfo)
 {
-	if (miinfo->bufferedTuples >= MAX_BUFFERED_TUPLES)
+	if (miinfo->bufferedTuples >= miinfo->maxBufferedTuples ||
+		miinfo->bufferedBytes >= miinfo->maxBufferedBytes)
 		return true;
 	return false;
 }
@@ -338,6 +446,101 @@ CopyMultiInsertInfoIsEmpty(CopyMultiInsertInfo *miinfo)
 	return miinfo->bufferedTuples == 0;
 }
 
+/*
+ * Can the index entries of 'rri' be inserted an index at a time?
+ *
+ * This is the case unless some index needs more than a plain index_insert()
+ * per tuple, that is exclusion constraints and deferred uniqueness checks.
+ * Those are left to ExecInsertIndexTuples.
+ */
+static bool
+CopyMultiInsertCanBatchIndexes(ResultRelInfo *rri)
+{
+	for (int i = 0; i < rri->ri_NumIndices; i++)
+	{
+		Relation	indexRelation = rri->ri_IndexRelationDescs[i];
+
+		if (indexRelation == NULL)
+			continue;
+		if (rri->ri_IndexRelationInfo[i]->ii_ExclusionOps != NULL)
+			return false;
+		if (indexRelation->rd_index->indisunique &&
+			!indexRelation->rd_index->indimmediate)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Insert the index entries for all the tuples in 'buffer', which have just
+ * been written to the table.
+ *
+ * We go over the buffered tuples once per index rather than over the indexes
+ * once per tuple, so that each index is descended repeatedly while its upper
+ * pages are still hot in cache.
+ */
+static void
+CopyMultiInsertBufferInsertIndexes(CopyMultiInsertInfo *miinfo,
+								   CopyMultiInsertBuffer *buffer)
+{
+	BulkCopyState cstate = miinfo->cstate;
+	EState	   *estate = miinfo->estate;
+	ExprContext *econtext = GetPerTupleExprContext(estate);
+	ResultRelInfo *resultRelInfo = buffer->resultRelInfo;
+	Relation	heapRelation = resultRelInfo->ri_RelationDesc;
+	MemoryContext oldcontext;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+
+	for (int i = 0; i < resultRelInfo->ri_NumIndices; i++)
+	{
+		Relation	indexRelation = resultRelInfo->ri_IndexRelationDescs[i];
+		IndexInfo  *indexInfo = resultRelInfo->ri_IndexRelationInfo[i];
+		IndexUniqueCheck checkUnique;
+
+		if (indexRelation == NULL)
+			continue;
+
+		/* If the index is marked as read-only, ignore it */
+		if (!indexInfo->ii_ReadyForInserts)
+			continue;
+
+		/* The predicate state must live as long as the executor state. */
+		if (indexInfo->ii_Predicate != NIL && indexInfo->ii_PredicateState == NULL)
+		{
+			oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+			indexInfo->ii_PredicateState = ExecPrepareQual(indexInfo->ii_Predicate, estate);
+			MemoryContextSwitchTo(oldcontext);
+		}
+
+		checkUnique = indexRelation->rd_index->indisunique ? UNIQUE_CHECK_YES : UNIQUE_CHECK_NO;
+
+		for (int j = 0; j < buffer->nused; j++)
+		{
+			TupleTableSlot *slot = buffer->slots[j];
+
+			cstate->cur_rowno = buffer->linenos[j];
+
+			ResetExprContext(econtext);
+			oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+			econtext->ecxt_scantuple = slot;
+
+			/* Skip this index-update if the predicate isn't satisfied */
+			if (indexInfo->ii_Predicate == NIL ||
+				ExecQual(indexInfo->ii_PredicateState, econtext))
+			{
+				FormIndexDatum(indexInfo, slot, estate, values, isnull);
+				index_insert(indexRelation, values, isnull, &(slot->tts_tid),
+							 heapRelation, checkUnique, false, indexInfo);
+			}
+
+			MemoryContextSwitchTo(oldcontext);
+		}
+	}
+
+	ResetExprContext(econtext);
+}
+
 /*
  * Write the tuples stored in 'buffer' out to the table.
  */
@@ -355,6 +558,7 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 	int			nused = buffer->nused;
 	ResultRelInfo *resultRelInfo = buffer->resultRelInfo;
 	TupleTableSlot **slots = buffer->slots;
+	bool		batched = false;
 
 	/*
 	 * Print error context information correctly, if one of the operations
@@ -375,12 +579,20 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 					   buffer->bistate);
 	MemoryContextSwitchTo(oldcontext);
 
+	/*
+	 * If there are any indexes, update them for all the inserted tuples,
+	 * an index at a time when we can.
+	 */
+	if (resultRelInfo->ri_NumIndices > 0 &&
+		CopyMultiInsertCanBatchIndexes(resultRelInfo))
+	{
+		CopyMultiInsertBufferInsertIndexes(miinfo, buffer);
+		batched = true;
+	}
+
 	for (i = 0; i < nused; i++)
 	{
-		/*
-		 * If there are any indexes, update them for all the inserted tuples.
-		 */
-		if (resultRelInfo->ri_NumIndices > 0)
+		if (resultRelInfo->ri_NumIndices > 0 && !batched)
 		{
 			List	   *recheckIndexes;
 
@@ -423,12 +635,14 @@ CopyMultiInsertBufferCleanup(CopyMultiInsertInfo *miinfo,
 	FreeBulkInsertState(buffer->bistate);
 
 	/* Since we only create slots on demand, just drop the non-null ones. */
-	for (i = 0; i < MAX_BUFFERED_TUPLES && buffer->slots[i] != NULL; i++)
+	for (i = 0; i < miinfo->maxBufferedTuples && buffer->slots[i] != NULL; i++)
 		ExecDropSingleTupleTableSlot(buffer->slots[i]);
 
 	table_finish_bulk_insert(buffer->resultRelInfo->ri_RelationDesc,
 							 miinfo->ti_options);
 
+	pfree(buffer->slots);
+	pfree(buffer->linenos);
 	pfree(buffer);
 }
 
@@ -456,6 +670,7 @@ CopyMultiInsertInfoFlush(CopyMultiInsertInfo *miinfo, ResultRelInfo *curr_rri)
 	}
 
 	miinfo->bufferedTuples = 0;
+	miinfo->bufferedBytes = 0;
 
 	/*
 	 * Trim the list of tracked buffers down if it exceeds the limit.  Here we
@@ -516,7 +731,7 @@ CopyMultiInsertInfoNextFreeSlot(CopyMultiInsertInfo *miinfo,
 	int			nused = buffer->nused;
 
 	Assert(buffer != NULL);
-	Assert(nused < MAX_BUFFERED_TUPLES);
+	Assert(nused < miinfo->maxBufferedTuples);
 
 	if (buffer->slots[nused] == NULL)
 		buffer->slots[nused] = table_slot_create(rri->ri_RelationDesc, NULL);
@@ -530,7 +745,7 @@ CopyMultiInsertInfoNextFreeSlot(CopyMultiInsertInfo *miinfo,
  */
 static inline void
 CopyMultiInsertInfoStore(CopyMultiInsertInfo *miinfo, ResultRelInfo *rri,
-						 TupleTableSlot *slot, uint64 lineno)
+						 TupleTableSlot *slot, int tuplen, uint64 lineno)
 {
 	CopyMultiInsertBuffer *buffer = rri->ri_CopyMultiInsertBuffer;
 
@@ -545,33 +760,25 @@ CopyMultiInsertInfoStore(CopyMultiInsertInfo *miinfo, ResultRelInfo *rri,
 
 	/* Update how many tuples are stored and their size */
 	miinfo->bufferedTuples++;
+	miinfo->bufferedBytes += tuplen;
 }
 
 /*
- * ExecuteBulkCopy - Carry out the insertion for the rows provided.
+ * BeginBulkCopyBatch - Set up the executor state for an implicit batch.
+ *
+ * The state lives in the copy context until EndBulkCopyBatch, so that rows
+ * can be fed in one at a time by BulkCopyInsertRow.
  */
-static uint64
-ExecuteBulkCopy(BulkCopyState cstate, int rowCount, int colCount,
-				Datum *Values, bool *Nulls)
+static void
+BeginBulkCopyBatch(BulkCopyState cstate, Relation rel)
 {
-	int cur_index = 0;
-	int cur_row_in_batch = 0;
-	ResultRelInfo *resultRelInfo;
-	ResultRelInfo *target_resultRelInfo;
-	EState	   *estate = CreateExecutorState(); /* for ExecConstraints() */
-	ExprContext *econtext;
-	MemoryContext oldcontext = CurrentMemoryContext;
-
-	ErrorContextCallback errcallback;
-	CommandId	mycid = GetCurrentCommandId(true);
+	BulkCopyBatchState batch;
+	EState	   *estate;
+	MemoryContext oldcontext;
 	int			ti_options = 0; /* start with default options for insert */
-	BulkInsertState bistate = NULL;
-	CopyMultiInsertInfo multiInsertInfo = {0};	/* pacify compiler */
-	int64		processed = 0;
-	int		   *defmap = cstate->defmap;
-	ExprState **defexprs = cstate->defexprs;
 
 	Assert(cstate->rel);
+	Assert(cstate->batch == NULL);
 	Assert(list_length(cstate->range_table) == 1);
 
 	/*
@@ -616,25 +823,56 @@ ExecuteBulkCopy(BulkCopyState cstate, int rowCount, int colCount,
 		 cstate->rel->rd_firstRelfilenodeSubid != InvalidSubTransactionId))
 		ti_options |= TABLE_INSERT_SKIP_FSM;
 
+	oldcontext = MemoryContextSwitchTo(cstate->copycontext);
+	estate = CreateExecutorState(); /* for ExecConstraints() */
+	MemoryContextSwitchTo(estate->es_query_cxt);
+
+	batch = (BulkCopyBatchState) palloc0(sizeof(BulkCopyBatchStateData));
+	batch->rel = rel;
+	batch->estate = estate;
+	batch->mycid = GetCurrentCommandId(true);
+
 	/*
 	 * We need a ResultRelInfo so we can use the regular executor's
 	 * index-entry-making machinery.  (There used to be a huge amount of code
 	 * here that basically duplicated execUtils.c ...).
 	 */
 	ExecInitRangeTable(estate, cstate->range_table);
-	resultRelInfo = target_resultRelInfo = makeNode(ResultRelInfo);
-	ExecInitResultRelation(estate, resultRelInfo, 1);
+	batch->resultRelInfo = makeNode(ResultRelInfo);
+	ExecInitResultRelation(estate, batch->resultRelInfo, 1);
 
 	/* Verify the named relation is a valid target for INSERT. */
-	CheckValidResultRel(resultRelInfo, CMD_INSERT);
+	CheckValidResultRel(batch->resultRelInfo, CMD_INSERT);
+
+	ExecOpenIndices(batch->resultRelInfo, false);
 
-	ExecOpenIndices(resultRelInfo, false);
+	CopyMultiInsertInfoInit(&batch->multiInsertInfo, batch->resultRelInfo, cstate,
+							estate, batch->mycid, ti_options);
 
-	CopyMultiInsertInfoInit(&multiInsertInfo, resultRelInfo, cstate,
-							estate, mycid, ti_options);
+	MemoryContextSwitchTo(oldcontext);
+
+	cstate->batch = batch;
+}
 
+/*
+ * BulkCopyInsertRow - Add one row to the multi-insert buffers of the current
+ * batch, flushing them out to the table when they are full.
+ */
+static void
+BulkCopyInsertRow(BulkCopyState cstate, int colCount, Datum *Values, bool *Nulls)
+{
+	BulkCopyBatchState batch = cstate->batch;
+	EState	   *estate = batch->estate;
+	ResultRelInfo *resultRelInfo = batch->resultRelInfo;
+	ExprContext *econtext = GetPerTupleExprContext(estate);
+	MemoryContext oldcontext;
+	ErrorContextCallback errcallback;
+	TupleTableSlot *myslot;
+	int		   *defmap = cstate->defmap;
+	ExprState **defexprs = cstate->defexprs;
+	int			tuplen;
 
-	econtext = GetPerTupleExprContext(estate);
+	CHECK_FOR_INTERRUPTS();
 
 	/* Set up callback to identify error line number. */
 	errcallback.callback = BulkCopyErrorCallback;
@@ -642,172 +880,171 @@ ExecuteBulkCopy(BulkCopyState cstate, int rowCount, int colCount,
 	errcallback.previous = error_context_stack;
 	error_context_stack = &errcallback;
 
-	for (;;)
-	{
-		TupleTableSlot *myslot;
-
-		CHECK_FOR_INTERRUPTS();
+	/* Slots must outlive the caller's context, they are kept in the batch. */
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
 
-		/*
-		 * Reset the per-tuple exprcontext. We do this after every tuple, to
-		 * clean-up after expression evaluations etc.
-		 */
-		ResetPerTupleExprContext(estate);
+	/*
+	 * Reset the per-tuple exprcontext. We do this after every tuple, to
+	 * clean-up after expression evaluations etc.
+	 */
+	ResetPerTupleExprContext(estate);
 
-		Assert(resultRelInfo == target_resultRelInfo);
+	myslot = CopyMultiInsertInfoNextFreeSlot(&batch->multiInsertInfo,
+											 resultRelInfo);
 
-		myslot = CopyMultiInsertInfoNextFreeSlot(&multiInsertInfo,
-													resultRelInfo);
+	/*
+	 * Switch to per-tuple context before building the TupleTableSlot, which does
+	 * evaluate default expressions etc. and requires per-tuple context.
+	 */
+	MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
 
-		/*
-		 * Switch to per-tuple context before building the TupleTableSlot, which does
-		 * evaluate default expressions etc. and requires per-tuple context.
-		 */
-		MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+	ExecClearTuple(myslot);
 
-		ExecClearTuple(myslot);
+	/* Initialize all values for row to NULL. */
+	MemSet(myslot->tts_values, 0, myslot->tts_tupleDescriptor->natts * sizeof(Datum));
+	MemSet(myslot->tts_isnull, false, myslot->tts_tupleDescriptor->natts * sizeof(bool));
 
-		/*
-		 * Directly store the Values/Nulls array in the slot.
-		 * Since Values/Nulls are flattened arrays, we extract only the next row's
-		 * values and store it in the slot.
-		 */
-		if (cur_index < rowCount * colCount)
+	/* colCount could be less than natts if user wants to insert only in a subset of columns. */
+	for (int i = 0, j = 0; i < myslot->tts_tupleDescriptor->natts && j <= colCount; i++)
+	{
+		if (!list_member_int(cstate->attnumlist, i + 1))
 		{
-			/* Initialize all values for row to NULL. */
-			MemSet(myslot->tts_values, 0, myslot->tts_tupleDescriptor->natts * sizeof(Datum));
-			MemSet(myslot->tts_isnull, false, myslot->tts_tupleDescriptor->natts * sizeof(bool));
-
-			/* colCount could be less than natts if user wants to insert only in a subset of columns. */
-			for (int i = 0, j = 0; i < myslot->tts_tupleDescriptor->natts && j <= colCount; i++)
-			{
-				if (!list_member_int(cstate->attnumlist, i + 1))
-				{
-					/*
-					 * If there is an identity column then we should insert the value for seuqence.
-					 * This is to be done only when we do not receive any data for this column,
-					 * otherwise we insert the data we receive.
-					 */
-					if (cstate->seq_index == i)
-					{
-						myslot->tts_values[i] = Int64GetDatum(nextval_internal(cstate->seqid, true));
-					}
-					else
-						myslot->tts_isnull[i] = true;
-				}
-				else
-				{
-					/* j will never be >= colCount since that is handled by protocol. */
-					if (Nulls[cur_row_in_batch * colCount + j])
-						myslot->tts_isnull[i] = Nulls[cur_row_in_batch * colCount + j];
-					else
-					{
-						myslot->tts_values[i] = Values[cur_row_in_batch * colCount + j];
-					}
-					j++;
-					/*
-					 * We increment cur_index only for the columns we received data for.
-					 * We need not check for overflow (cur_index < rowCount * colCount)
-					 * for each loop since that is handled by the protocol.
-					 */
-					cur_index++;
-				}
-			}
-			cur_row_in_batch++;
-			cstate->cur_rowno++;
-
 			/*
-			 * Now compute and insert any defaults available for the columns not
-			 * provided by the input data.  Anything not processed here or above will
-			 * remain NULL.
+			 * If there is an identity column then we should insert the value for seuqence.
+			 * This is to be done only when we do not receive any data for this column,
+			 * otherwise we insert the data we receive.
 			 */
-			for (int i = 0; i < cstate->num_defaults; i++)
+			if (cstate->seq_index == i)
 			{
-				/*
-				 * The caller must supply econtext and have switched into the
-				 * per-tuple memory context in it.
-				 */
-				Assert(econtext != NULL);
-				Assert(CurrentMemoryContext == econtext->ecxt_per_tuple_memory);
-
-				if (myslot->tts_isnull[defmap[i]] && (!insert_bulk_keep_nulls || cstate->rv_index == defmap[i]))
-					myslot->tts_values[defmap[i]] = ExecEvalExpr(defexprs[i], econtext,
-													&myslot->tts_isnull[defmap[i]]);
+				myslot->tts_values[i] = Int64GetDatum(nextval_internal(cstate->seqid, true));
 			}
+			else
+				myslot->tts_isnull[i] = true;
 		}
 		else
-			break;
-
-		ExecStoreVirtualTuple(myslot);
+		{
+			/* j will never be >= colCount since that is handled by protocol. */
+			if (Nulls[j])
+				myslot->tts_isnull[i] = Nulls[j];
+			else
+			{
+				myslot->tts_values[i] = Values[j];
+			}
+			j++;
+		}
+	}
+	cstate->cur_rowno++;
 
+	/*
+	 * Now compute and insert any defaults available for the columns not
+	 * provided by the input data.  Anything not processed here or above will
+	 * remain NULL.
+	 */
+	for (int i = 0; i < cstate->num_defaults; i++)
+	{
 		/*
-		 * Constraints and where clause might reference the tableoid column,
-		 * so (re-)initialize tts_tableOid before evaluating them.
+		 * The caller must supply econtext and have switched into the
+		 * per-tuple memory context in it.
 		 */
-		myslot->tts_tableOid = RelationGetRelid(target_resultRelInfo->ri_RelationDesc);
+		Assert(econtext != NULL);
+		Assert(CurrentMemoryContext == econtext->ecxt_per_tuple_memory);
 
-		MemoryContextSwitchTo(oldcontext);
+		if (myslot->tts_isnull[defmap[i]] && (!insert_bulk_keep_nulls || cstate->rv_index == defmap[i]))
+			myslot->tts_values[defmap[i]] = ExecEvalExpr(defexprs[i], econtext,
+											&myslot->tts_isnull[defmap[i]]);
+	}
 
-		/* Compute stored generated columns */
-		if (resultRelInfo->ri_RelationDesc->rd_att->constr &&
-			resultRelInfo->ri_RelationDesc->rd_att->constr->has_generated_stored)
-			ExecComputeStoredGenerated(resultRelInfo, estate, myslot,
-										CMD_INSERT);
+	ExecStoreVirtualTuple(myslot);
 
-		/*
-		 * If the target is a plain table, check the constraints of
-		 * the tuple.
-		 */
-		if (resultRelInfo->ri_RelationDesc->rd_att->constr)
-			ExecConstraints(resultRelInfo, myslot, estate);
+	/*
+	 * Constraints and where clause might reference the tableoid column,
+	 * so (re-)initialize tts_tableOid before evaluating them.
+	 */
+	myslot->tts_tableOid = RelationGetRelid(resultRelInfo->ri_RelationDesc);
 
-		/*
-		 * The slot previously might point into the per-tuple
-		 * context. For batching it needs to be longer lived.
-		 */
-		ExecMaterializeSlot(myslot);	
+	MemoryContextSwitchTo(estate->es_query_cxt);
 
-		/*
-		 * Store the slot in the multi-insert buffer.
-		 * Add this tuple to the tuple buffer.
-		 */
-		CopyMultiInsertInfoStore(&multiInsertInfo,
-									resultRelInfo, myslot,
-									cstate->cur_rowno);
+	/* Compute stored generated columns */
+	if (resultRelInfo->ri_RelationDesc->rd_att->constr &&
+		resultRelInfo->ri_RelationDesc->rd_att->constr->has_generated_stored)
+		ExecComputeStoredGenerated(resultRelInfo, estate, myslot,
+									CMD_INSERT);
 
-		/* Update the number of rows processed. */
-		processed++;
+	/*
+	 * If the target is a plain table, check the constraints of
+	 * the tuple.
+	 */
+	if (resultRelInfo->ri_RelationDesc->rd_att->constr)
+		ExecConstraints(resultRelInfo, myslot, estate);
 
-		/*
-		 * If enough inserts have queued up, then flush all
-		 * buffers out to the table.
-		 */
-		if (CopyMultiInsertInfoIsFull(&multiInsertInfo))
-			CopyMultiInsertInfoFlush(&multiInsertInfo, resultRelInfo);
-	}
+	/* Size of the tuple data, while the values are still in the slot. */
+	tuplen = heap_compute_data_size(myslot->tts_tupleDescriptor,
+									myslot->tts_values, myslot->tts_isnull);
 
+	/*
+	 * The slot previously might point into the per-tuple
+	 * context. For batching it needs to be longer lived.
+	 */
+	ExecMaterializeSlot(myslot);
 
-	/* Flush any remaining bufferes out to the table. */
-	if (!CopyMultiInsertInfoIsEmpty(&multiInsertInfo))
-		CopyMultiInsertInfoFlush(&multiInsertInfo, NULL);
+	/*
+	 * Store the slot in the multi-insert buffer.
+	 * Add this tuple to the tuple buffer.
+	 */
+	CopyMultiInsertInfoStore(&batch->multiInsertInfo,
+								resultRelInfo, myslot, tuplen,
+								cstate->cur_rowno);
 
-	/* Done, clean up. */
-	error_context_stack = errcallback.previous;
+	/* Update the number of rows processed. */
+	batch->processed++;
 
-	if (bistate != NULL)
-		FreeBulkInsertState(bistate);
+	/*
+	 * If enough inserts have queued up, then flush all
+	 * buffers out to the table.
+	 */
+	if (CopyMultiInsertInfoIsFull(&batch->multiInsertInfo))
+		CopyMultiInsertInfoFlush(&batch->multiInsertInfo, resultRelInfo);
 
 	MemoryContextSwitchTo(oldcontext);
 
+	error_context_stack = errcallback.previous;
+}
+
+/*
+ * EndBulkCopyBatch - Flush the rows still buffered for the current batch and
+ * release its executor state.  Returns the number of rows inserted.
+ */
+static uint64
+EndBulkCopyBatch(BulkCopyState cstate)
+{
+	BulkCopyBatchState batch = cstate->batch;
+	EState	   *estate = batch->estate;
+	uint64		processed = batch->processed;
+	ErrorContextCallback errcallback;
+
+	/* Set up callback to identify error line number. */
+	errcallback.callback = BulkCopyErrorCallback;
+	errcallback.arg = (void *) cstate;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/* Flush any remaining bufferes out to the table. */
+	if (!CopyMultiInsertInfoIsEmpty(&batch->multiInsertInfo))
+		CopyMultiInsertInfoFlush(&batch->multiInsertInfo, NULL);
+
+	/* Done, clean up. */
+	error_context_stack = errcallback.previous;
+
 	ExecResetTupleTable(estate->es_tupleTable, false);
 
 	/* Tear down the multi-insert buffer data. */
-	CopyMultiInsertInfoCleanup(&multiInsertInfo);
+	CopyMultiInsertInfoCleanup(&batch->multiInsertInfo);
 
 	/* Close the result relations, */
 	ExecCloseResultRelations(estate);
 	ExecCloseRangeTableRelations(estate);
 
+	cstate->batch = NULL;
 	FreeExecutorState(estate);
 
 	return processed;
@@ -819,7 +1056,7 @@ ExecuteBulkCopy(BulkCopyState cstate, int rowCount, int colCount,
  * 'rel': Used as a template for the tuples
  * 'attnums': Integer list of attnums.
  *
- * Returns a BulkCopyState, to be passed to ExecuteBulkCopy and related functions.
+ * Returns a BulkCopyState, to be passed to BeginBulkCopyBatch and related functions.
  */
 static BulkCopyState
 BeginBulkCopy(Relation rel,
@@ -954,6 +1191,13 @@ EndBulkCopy(BulkCopyState cstate)
 {
 	if (cstate)
 	{
+		/*
+		 * A batch is still open if the protocol layer failed while streaming
+		 * its rows in.  The executor state goes away with the copy context,
+		 * the rest is left to the transaction abort that follows.
+		 */
+		if (cstate->batch)
+			table_close(cstate->batch->rel, NoLock);
 		MemoryContextDelete(cstate->copycontext);
 		pfree(cstate);
 	}
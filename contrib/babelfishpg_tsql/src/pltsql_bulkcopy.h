@@ -1,3 +1,6 @@
+/* Executor state of the implicit batch in progress, see pltsql_bulkcopy.c */
+typedef struct BulkCopyBatchStateData *BulkCopyBatchState;
+
 /*
  * This struct contains all the state variables used throughout a BULK COPY
  * operation.
@@ -24,6 +27,7 @@ typedef struct BulkCopyStateData
 	int 		seq_index; 		/* index for an identity column */
 	Oid			seqid; 			/* oid of the sequence for an identity column */
 	int			rv_index;		/* index for a rowversion datatype column */
+	BulkCopyBatchState batch;	/* implicit batch in progress, if any */
 
 } BulkCopyStateData;
 typedef struct BulkCopyStateData *BulkCopyState;
@@ -45,11 +49,13 @@ typedef struct BulkCopyStmt
 	int 		ncol;			/* Holds the number of columns */
 	int 		nrow;			/* Holds the number of rows for the current batch */
 	Datum	   *Values;			/* List of Values (as Datums) that need to be inserted
-								 * for the current batch */
+								 * for the current batch, NULL if they were
+								 * streamed in by BulkCopyRow */
 	bool 	   *Nulls;			/* List of Nulls (as Datums) that need to be inserted
 								 * for the current batch */
 	BulkCopyState cstate;   /* Contains all the state variables used throughout a BULK COPY */
 } BulkCopyStmt;
 
 extern void BulkCopy(BulkCopyStmt *stmt, uint64 *processed);
+extern void BulkCopyRow(BulkCopyStmt *stmt, Datum *values, bool *nulls);
 extern void EndBulkCopy(BulkCopyState cstate);
\ No newline at end of file
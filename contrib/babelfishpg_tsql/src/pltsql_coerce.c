@@ -1295,7 +1295,6 @@ pltsql_text_name(PG_FUNCTION_ARGS)
 	text *s = PG_GETARG_TEXT_PP(0);
 	Name result;
 	int len;
-	const char *saved_dialect = GetConfigOption("babelfishpg_tsql.sql_dialect", true, true);
 
 	len = VARSIZE_ANY_EXHDR(s);
 
@@ -1305,25 +1304,19 @@ pltsql_text_name(PG_FUNCTION_ARGS)
 		if (cstr_to_name_hook) /* to apply special truncation logic */
 		{
 			Name n;
+			int saved_dialect;
+
+			/* T-SQL casting. follow T-SQL truncation rule */
+			saved_dialect = pltsql_enter_dialect(SQL_DIALECT_TSQL);
 			PG_TRY();
 			{
-				/* T-SQL casting. follow T-SQL truncation rule */
-				set_config_option("babelfishpg_tsql.sql_dialect", "tsql",
-							(superuser() ? PGC_SUSET : PGC_USERSET),
-							PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
 				n = (*cstr_to_name_hook)(VARDATA_ANY(s), len);
 			}
-			PG_CATCH();
+			PG_FINALLY();
 			{
-				set_config_option("babelfishpg_tsql.sql_dialect", saved_dialect,
-							(superuser() ? PGC_SUSET : PGC_USERSET),
-							PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
-				PG_RE_THROW();
+				pltsql_leave_dialect(saved_dialect);
 			}
 			PG_END_TRY();
-			set_config_option("babelfishpg_tsql.sql_dialect", saved_dialect,
-						(superuser() ? PGC_SUSET : PGC_USERSET),
-						PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
 
 			PG_RETURN_NAME(n);
 		}
@@ -1346,7 +1339,6 @@ pltsql_bpchar_name(PG_FUNCTION_ARGS)
 	char *s_data;
 	Name result;
 	int len;
-	const char *saved_dialect = GetConfigOption("babelfishpg_tsql.sql_dialect", true, true);
 
 	len = VARSIZE_ANY_EXHDR(s);
 	s_data = VARDATA_ANY(s);
@@ -1357,6 +1349,7 @@ pltsql_bpchar_name(PG_FUNCTION_ARGS)
 		if (cstr_to_name_hook) /* to apply special truncation logic */
 		{
 			Name n;
+			int saved_dialect;
 
 			/* Remove trailing blanks */
 			while (len > 0)
@@ -1366,25 +1359,17 @@ pltsql_bpchar_name(PG_FUNCTION_ARGS)
 				len--;
 			}
 
+			/* T-SQL casting. follow T-SQL truncation rule */
+			saved_dialect = pltsql_enter_dialect(SQL_DIALECT_TSQL);
 			PG_TRY();
 			{
-				/* T-SQL casting. follow T-SQL truncation rule */
-				set_config_option("babelfishpg_tsql.sql_dialect", "tsql",
-							(superuser() ? PGC_SUSET : PGC_USERSET),
-							PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
 				n = (*cstr_to_name_hook)(VARDATA_ANY(s), len);
 			}
-			PG_CATCH();
+			PG_FINALLY();
 			{
-				set_config_option("babelfishpg_tsql.sql_dialect", saved_dialect,
-							(superuser() ? PGC_SUSET : PGC_USERSET),
-							PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
-				PG_RE_THROW();
+				pltsql_leave_dialect(saved_dialect);
 			}
 			PG_END_TRY();
-			set_config_option("babelfishpg_tsql.sql_dialect", saved_dialect,
-						(superuser() ? PGC_SUSET : PGC_USERSET),
-						PGC_S_SESSION, GUC_ACTION_SAVE, true, 0, false);
 
 			PG_RETURN_NAME(n);
 		}
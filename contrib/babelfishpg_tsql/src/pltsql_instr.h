@@ -639,6 +639,9 @@ typedef enum PgTsqlInstrMetricType {
 	INSTR_UNSUPPORTED_TSQL_SELECT_COL_ALIAS,
 	INSTR_UNSUPPORTED_TSQL_SERVERNAME_IN_NAME,
 	INSTR_UNSUPPORTED_TSQL_OPTION_NO_BROWSETABLE,
+
+	INSTR_TSQL_SORTKEY_CACHE_HIT,
+	INSTR_TSQL_SORTKEY_CACHE_MISS,
 	
 	INSTR_TSQL_COUNT
 } PgTsqlInstrMetricType;
@@ -3,12 +3,16 @@
 #include "catalog/namespace.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
+#include "common/hashfn.h"
 #include "parser/parser.h"      /* only needed for GUC variables */
 #include "parser/parse_type.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "pltsql.h"
+#include "storage/dsm.h"
 #include "storage/lock.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
 #include "utils/builtins.h"
 #include "utils/elog.h"
 #include "utils/guc.h"
@@ -889,3 +893,195 @@ get_pltsql_function_signature(PG_FUNCTION_ARGS)
 	ReleaseSysCache(proctup);
 	PG_RETURN_TEXT_P(cstring_to_text(func_signature));
 }
+
+/*
+ * pltsql_shared_segment - find or create a server-wide shared memory segment
+ *
+ * babelfishpg_tsql is loaded by the backends that use it rather than through
+ * shared_preload_libraries, so structures sized by a GUC can't be reserved in
+ * the main shared memory segment at startup.  They live in a dynamic shared
+ * memory segment instead, created and pinned by the first backend that needs
+ * it, whose handle is kept in a small named struct of the main segment (which
+ * has the room for it, see initApplockCache()).  init is called on a new
+ * segment before any other backend can see it.
+ *
+ * Returns NULL if the segment doesn't exist and create is false, or if no
+ * more dynamic shared memory segments can be created.  A backend must call
+ * this at most once per name.
+ */
+void *
+pltsql_shared_segment(const char *name, Size size, bool create,
+					  void (*init) (void *address))
+{
+	dsm_handle *handle;
+	dsm_segment *seg = NULL;
+	bool		found;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	handle = (dsm_handle *) ShmemInitStruct(name, sizeof(dsm_handle), &found);
+	if (!found)
+		*handle = DSM_HANDLE_INVALID;
+
+	if (*handle != DSM_HANDLE_INVALID)
+		seg = dsm_attach(*handle);
+	else if (create)
+	{
+		seg = dsm_create(size, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+		if (seg)
+		{
+			init(dsm_segment_address(seg));
+			dsm_pin_segment(seg);
+			*handle = dsm_segment_handle(seg);
+		}
+	}
+
+	/* Stay attached for the rest of the session */
+	if (seg)
+		dsm_pin_mapping(seg);
+
+	LWLockRelease(AddinShmemInitLock);
+
+	return seg ? dsm_segment_address(seg) : NULL;
+}
+
+/*
+ * Fixed-size hash tables in shared segments
+ *
+ * The slots hold zero or one more than the index of an entry and are probed
+ * linearly from the hash of the key; there are at least twice as many as
+ * entries, so a probe always ends at a free slot.  Entries start with their
+ * key and are handed out in order.  Keys are hashed and compared as bytes,
+ * so callers zero them before filling in the fields.  Nothing is removed
+ * one at a time; shared_hash_remove_if() rebuilds the table instead.  The
+ * caller does all the locking.
+ */
+static uint32
+shared_hash_nslots(int capacity)
+{
+	uint32		nslots = 1;
+
+	while (nslots < 2 * (uint32) capacity)
+		nslots <<= 1;
+	return nslots;
+}
+
+/*
+ * shared_hash_memsize - room for the slots and entries of a table
+ */
+Size
+shared_hash_memsize(int capacity, Size entrysize)
+{
+	return add_size(MAXALIGN(mul_size(shared_hash_nslots(capacity), sizeof(uint32))),
+					MAXALIGN(mul_size(capacity, entrysize)));
+}
+
+/*
+ * shared_hash_init - set up an empty table whose slots and entries go to
+ * area, which has room for shared_hash_memsize() bytes
+ */
+void
+shared_hash_init(SharedHashTable *table, void *area, int capacity,
+				 Size keysize, Size entrysize)
+{
+	table->capacity = capacity;
+	table->nentries = 0;
+	table->nslots = shared_hash_nslots(capacity);
+	table->keysize = keysize;
+	table->entrysize = entrysize;
+	table->slotsoff = (char *) area - (char *) table;
+	table->entriesoff = table->slotsoff +
+		MAXALIGN(mul_size(table->nslots, sizeof(uint32)));
+	MemSet(area, 0, table->nslots * sizeof(uint32));
+}
+
+void *
+shared_hash_entry(SharedHashTable *table, int i)
+{
+	return (char *) table + table->entriesoff + i * table->entrysize;
+}
+
+/*
+ * shared_hash_find - look a key up
+ *
+ * If it isn't there and slot is given, *slot is set to the free slot where
+ * it goes, for shared_hash_insert().
+ */
+void *
+shared_hash_find(SharedHashTable *table, const void *key, uint32 **slot)
+{
+	uint32	   *slots = (uint32 *) ((char *) table + table->slotsoff);
+	uint32		mask = table->nslots - 1;
+	uint32		i;
+
+	i = hash_bytes((const unsigned char *) key, (int) table->keysize) & mask;
+	for (;;)
+	{
+		void	   *entry;
+
+		if (slots[i] == 0)
+		{
+			if (slot)
+				*slot = &slots[i];
+			return NULL;
+		}
+
+		entry = shared_hash_entry(table, slots[i] - 1);
+		if (memcmp(entry, key, table->keysize) == 0)
+			return entry;
+
+		i = (i + 1) & mask;
+	}
+}
+
+/*
+ * shared_hash_insert - add a key at the slot shared_hash_find() returned
+ *
+ * Returns the new entry, with the rest of it for the caller to fill in, or
+ * NULL if the table is full.
+ */
+void *
+shared_hash_insert(SharedHashTable *table, const void *key, uint32 *slot)
+{
+	void	   *entry;
+
+	if (table->nentries >= table->capacity)
+		return NULL;
+
+	entry = shared_hash_entry(table, table->nentries);
+	memcpy(entry, key, table->keysize);
+	*slot = ++table->nentries;
+
+	return entry;
+}
+
+/*
+ * shared_hash_remove_if - drop the entries remove() picks
+ *
+ * The entries that stay are moved down over the dropped ones, and the slots
+ * are filled in again from them.
+ */
+void
+shared_hash_remove_if(SharedHashTable *table,
+					  bool (*remove) (void *entry, void *arg), void *arg)
+{
+	int			n = table->nentries;
+	int			i;
+
+	MemSet((char *) table + table->slotsoff, 0, table->nslots * sizeof(uint32));
+	table->nentries = 0;
+	for (i = 0; i < n; i++)
+	{
+		void	   *entry = shared_hash_entry(table, i);
+		void	   *kept = shared_hash_entry(table, table->nentries);
+		uint32	   *slot;
+
+		if (remove(entry, arg))
+			continue;
+
+		if (kept != entry)
+			memcpy(kept, entry, table->entrysize);
+		(void) shared_hash_find(table, kept, &slot);
+		*slot = ++table->nentries;
+	}
+}
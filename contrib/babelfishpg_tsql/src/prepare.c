@@ -416,11 +416,13 @@ exec_simple_check_plan(PLtsql_execstate *estate, PLtsql_expr *expr)
 	Query	   *query;
 	CachedPlan *cplan;
 	MemoryContext oldcontext;
+	ListCell   *lc;
 
 	/*
 	 * Initialize to "not simple".
 	 */
 	expr->expr_simple_expr = NULL;
+	expr->expr_simple_row = false;
 
 	/*
 	 * Check the analyzed-and-rewritten form of the query to see if we will be
@@ -479,10 +481,19 @@ exec_simple_check_plan(PLtsql_execstate *estate, PLtsql_expr *expr)
 		return;
 
 	/*
-	 * 4. The query must have a single attribute as result
+	 * 4. The query must have a single attribute as result.  Several are
+	 * accepted too, so that a T-SQL SELECT assignment to more than one
+	 * variable (SELECT @a = x, @b = y) can be evaluated as a row; see
+	 * exec_save_simple_expr.  The other users of expr_simple_expr check
+	 * expr_simple_row and still treat those as not simple.
 	 */
-	if (list_length(query->targetList) != 1)
+	if (query->targetList == NIL)
 		return;
+	foreach(lc, query->targetList)
+	{
+		if (lfirst_node(TargetEntry, lc)->resjunk)
+			return;
+	}
 
 	/*
 	 * OK, we can treat it as a simple plan.
@@ -535,9 +546,11 @@ exec_save_simple_expr(PLtsql_expr *expr, CachedPlan *cplan)
 	plan = stmt->planTree;
 	for (;;)
 	{
-		/* Extract the single tlist expression */
-		Assert(list_length(plan->targetlist) == 1);
-		tle_expr = castNode(TargetEntry, linitial(plan->targetlist))->expr;
+		/* Extract the single tlist expression, if there is just one */
+		if (list_length(plan->targetlist) == 1)
+			tle_expr = castNode(TargetEntry, linitial(plan->targetlist))->expr;
+		else
+			tle_expr = NULL;
 
 		if (IsA(plan, Result))
 		{
@@ -555,11 +568,11 @@ exec_save_simple_expr(PLtsql_expr *expr, CachedPlan *cplan)
 				   plan->initPlan == NULL &&
 				   plan->qual == NULL);
 			/* If setrefs.c copied up a Const, no need to look further */
-			if (IsA(tle_expr, Const))
+			if (tle_expr != NULL && IsA(tle_expr, Const))
 				break;
 			/* Otherwise, it had better be a Param or an outer Var */
-			Assert(IsA(tle_expr, Param) ||(IsA(tle_expr, Var) &&
-										   ((Var *) tle_expr)->varno == OUTER_VAR));
+			Assert(tle_expr == NULL || IsA(tle_expr, Param) ||
+				   (IsA(tle_expr, Var) && ((Var *) tle_expr)->varno == OUTER_VAR));
 			/* Descend to the child node */
 			plan = plan->lefttree;
 		}
@@ -568,6 +581,33 @@ exec_save_simple_expr(PLtsql_expr *expr, CachedPlan *cplan)
 				 (int) nodeTag(plan));
 	}
 
+	/*
+	 * Several columns are combined into an anonymous row, built in the
+	 * plan's context so that it lives as long as the rest of the tree.
+	 */
+	expr->expr_simple_row = (tle_expr == NULL);
+	if (expr->expr_simple_row)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(cplan->context);
+		RowExpr    *row = makeNode(RowExpr);
+		ListCell   *lc;
+
+		foreach(lc, plan->targetlist)
+		{
+			TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+			row->args = lappend(row->args, tle->expr);
+			row->colnames = lappend(row->colnames,
+									makeString(pstrdup(tle->resname ? tle->resname : "?column?")));
+		}
+		row->row_typeid = RECORDOID;
+		row->row_format = COERCE_IMPLICIT_CAST;
+		row->location = -1;
+		MemoryContextSwitchTo(oldcontext);
+
+		tle_expr = (Expr *) row;
+	}
+
 	/*
 	 * Save the simple expression, and initialize state to "not valid in
 	 * current transaction".
@@ -0,0 +1,376 @@
+/*-------------------------------------------------------------------------
+ *
+ * prepared_batch.c	- Per-session table of sp_prepare handles
+ *
+ * Every sp_prepare (and prepared RPC) hands out an integer handle that the
+ * client later passes to sp_execute and sp_unprepare.  The table below keeps
+ * only the handles that are currently live, so that sp_reset_connection costs
+ * time proportional to what the session holds rather than to the number of
+ * handles ever issued.
+ *
+ * Each handle remembers its statement text and parameter definitions next to
+ * the compiled PLtsql_function.  Compiled functions count against
+ * babelfishpg_tsql.prepared_batch_memory and the least recently executed ones
+ * are dropped when the session goes over it; the handle itself stays valid,
+ * and the batch is compiled again the next time it is executed.
+ *
+ * IDENTIFICATION
+ *	  contrib/babelfishpg_tsql/src/prepared_batch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "funcapi.h"
+#include "lib/ilist.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+#include "pltsql.h"
+
+extern void cache_inline_args(PLtsql_function *func, InlineCodeBlockArgs *args);
+extern InlineCodeBlockArgs *clone_inline_args(InlineCodeBlockArgs *args);
+
+int			pltsql_prepared_batch_memory_kb = DEFAULT_PREPARED_BATCH_MEMORY_KB;
+
+typedef struct PreparedBatchEntry
+{
+	int			handle;			/* hash key */
+	PLtsql_function *func;		/* NULL while evicted */
+	char	   *source_text;	/* kept to compile the batch again */
+	InlineCodeBlockArgs *args;	/* parameter definitions, ditto */
+	Size		bytes;			/* memory held by the compiled function */
+	dlist_node	lru_node;		/* compiled entries only, most recent at the head */
+	PreparedCatalogKey catalog_key;	/* entry in the shared statement catalog */
+} PreparedBatchEntry;
+
+static HTAB *prepared_batch_htab = NULL;
+static MemoryContext PreparedBatchContext = NULL;
+static dlist_head prepared_batch_lru = DLIST_STATIC_INIT(prepared_batch_lru);
+static int	next_handle = 1;
+static int	prepared_batch_handles = 0;
+static int	prepared_batch_compiled = 0;
+static Size prepared_batch_bytes = 0;
+
+/*
+ * Functions that were unprepared while they were still executing.  They are
+ * freed by release_cached_batch() once their use count drops to zero.
+ */
+static List *prepared_batch_orphans = NIL;
+
+/* Counters reported by sys.babelfish_prepared_batch_stats() */
+static uint64 prepared_batch_evictions = 0;
+static uint64 prepared_batch_reprepares = 0;
+
+static void prepared_batch_init(void);
+static InlineCodeBlockArgs *prepared_batch_copy_args(InlineCodeBlockArgs *args);
+static void prepared_batch_attach(PreparedBatchEntry *entry, PLtsql_function *func);
+static void prepared_batch_detach(PreparedBatchEntry *entry);
+static void prepared_batch_enforce_limits(PreparedBatchEntry *keep);
+
+PG_FUNCTION_INFO_V1(babelfish_prepared_batch_stats);
+
+static void
+prepared_batch_init(void)
+{
+	HASHCTL		ctl;
+
+	if (prepared_batch_htab)
+		return;
+
+	PreparedBatchContext = AllocSetContextCreate(TopMemoryContext,
+												 "PL/tsql prepared batches",
+												 ALLOCSET_DEFAULT_SIZES);
+
+	MemSet(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(int);
+	ctl.entrysize = sizeof(PreparedBatchEntry);
+	ctl.hcxt = PreparedBatchContext;
+	prepared_batch_htab = hash_create("PL/tsql prepared batches", 64, &ctl,
+									  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+/*
+ * Deep copy of the parameter definitions into PreparedBatchContext;
+ * clone_inline_args() shares the argument names with the original.
+ */
+static InlineCodeBlockArgs *
+prepared_batch_copy_args(InlineCodeBlockArgs *args)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(PreparedBatchContext);
+	InlineCodeBlockArgs *copy;
+	int			i;
+
+	copy = clone_inline_args(args);
+	for (i = 0; i < copy->numargs; i++)
+	{
+		if (copy->argnames[i])
+			copy->argnames[i] = pstrdup(copy->argnames[i]);
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	return copy;
+}
+
+static void
+prepared_batch_attach(PreparedBatchEntry *entry, PLtsql_function *func)
+{
+	Assert(entry->func == NULL);
+
+	MemoryContextSetParent(func->fn_cxt, PreparedBatchContext);
+
+	entry->func = func;
+	entry->bytes = MemoryContextMemAllocated(func->fn_cxt, true);
+	dlist_push_head(&prepared_batch_lru, &entry->lru_node);
+	prepared_batch_compiled++;
+	prepared_batch_bytes += entry->bytes;
+}
+
+/*
+ * Take the compiled function away from a handle.  A function that is still
+ * executing is freed later by release_cached_batch().
+ */
+static void
+prepared_batch_detach(PreparedBatchEntry *entry)
+{
+	PLtsql_function *func = entry->func;
+
+	if (func == NULL)
+		return;
+
+	dlist_delete(&entry->lru_node);
+	prepared_batch_compiled--;
+	prepared_batch_bytes -= entry->bytes;
+	entry->func = NULL;
+	entry->bytes = 0;
+
+	if (func->use_count == 0)
+		pltsql_free_function_memory(func);
+	else
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(PreparedBatchContext);
+
+		prepared_batch_orphans = lappend(prepared_batch_orphans, func);
+		MemoryContextSwitchTo(oldcontext);
+	}
+}
+
+/*
+ * Drop compiled functions, least recently executed first, until the session
+ * is back under its budget.  Batches that are running and the one the caller
+ * is about to use are left alone.
+ */
+static void
+prepared_batch_enforce_limits(PreparedBatchEntry *keep)
+{
+	Size		max_bytes = (Size) pltsql_prepared_batch_memory_kb * 1024;
+	dlist_node *cur = prepared_batch_lru.head.prev;
+
+	while (cur != &prepared_batch_lru.head && prepared_batch_bytes > max_bytes)
+	{
+		PreparedBatchEntry *victim = dlist_container(PreparedBatchEntry, lru_node, cur);
+
+		cur = cur->prev;
+		if (victim == keep || victim->func->use_count > 0)
+			continue;
+
+		prepared_batch_detach(victim);
+		prepared_batch_evictions++;
+	}
+}
+
+/*
+ * cache_compiled_batch - give a freshly compiled batch a handle
+ *
+ * The handle owns the function from now on.
+ */
+int
+cache_compiled_batch(PLtsql_function *func, const char *source_text)
+{
+	PreparedBatchEntry *entry;
+	bool		found;
+	int			handle;
+
+	prepared_batch_init();
+
+	/* Skip over handles that are still live after a wraparound */
+	do
+	{
+		handle = next_handle;
+		next_handle = (next_handle % INT32_MAX) + 1;
+		entry = (PreparedBatchEntry *) hash_search(prepared_batch_htab, &handle,
+												   HASH_ENTER, &found);
+	} while (found);
+
+	entry->func = NULL;
+	entry->bytes = 0;
+	entry->source_text = MemoryContextStrdup(PreparedBatchContext, source_text);
+	entry->args = prepared_batch_copy_args(func->inline_args);
+	prepared_catalog_store(source_text, entry->args, &entry->catalog_key);
+	prepared_batch_handles++;
+
+	prepared_batch_attach(entry, func);
+	prepared_batch_enforce_limits(entry);
+
+	return handle;
+}
+
+/*
+ * find_cached_batch - look up a live handle
+ *
+ * Compiles the batch again if it was evicted.  Returns NULL for a handle that
+ * was never issued or has been unprepared.
+ */
+PLtsql_function *
+find_cached_batch(int handle)
+{
+	PreparedBatchEntry *entry;
+	InlineCodeBlockArgs *args;
+	PLtsql_function *func;
+
+	if (prepared_batch_htab == NULL)
+		return NULL;
+
+	entry = (PreparedBatchEntry *) hash_search(prepared_batch_htab, &handle,
+											   HASH_FIND, NULL);
+	if (entry == NULL)
+		return NULL;
+
+	if (entry->func)
+	{
+		dlist_move_head(&prepared_batch_lru, &entry->lru_node);
+		return entry->func;
+	}
+
+	/*
+	 * Compile it again the way sp_prepare did.  With CACHE_PLAN,
+	 * pltsql_compile_inline() puts the function in its own context under
+	 * TopMemoryContext, which prepared_batch_attach() then moves under
+	 * PreparedBatchContext; the cloned arguments are only needed for the
+	 * compile.
+	 */
+	args = clone_inline_args(entry->args);
+	args->options = BATCH_OPTION_CACHE_PLAN;
+	func = pltsql_compile_inline(entry->source_text, args);
+	cache_inline_args(func, entry->args);
+
+	prepared_batch_reprepares++;
+	prepared_batch_attach(entry, func);
+	prepared_batch_enforce_limits(entry);
+
+	return func;
+}
+
+/*
+ * release_cached_batch - called when the caller is done executing a function
+ * obtained by find_cached_batch().  Frees it if it was unprepared meanwhile.
+ */
+void
+release_cached_batch(PLtsql_function *func)
+{
+	if (func->use_count == 0 && list_member_ptr(prepared_batch_orphans, func))
+	{
+		prepared_batch_orphans = list_delete_ptr(prepared_batch_orphans, func);
+		pltsql_free_function_memory(func);
+	}
+}
+
+/*
+ * record_cached_batch_execution - account an execution of a prepared batch
+ * that started at the given time in the shared statement catalog
+ */
+void
+record_cached_batch_execution(int handle, instr_time start)
+{
+	PreparedBatchEntry *entry;
+	instr_time	duration;
+
+	if (!prepared_catalog_enabled() || prepared_batch_htab == NULL)
+		return;
+
+	entry = (PreparedBatchEntry *) hash_search(prepared_batch_htab, &handle,
+											   HASH_FIND, NULL);
+	if (entry == NULL)
+		return;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	prepared_catalog_record(&entry->catalog_key, INSTR_TIME_GET_MILLISEC(duration));
+}
+
+void
+delete_cached_batch(int handle)
+{
+	PreparedBatchEntry *entry;
+	int			i;
+
+	if (prepared_batch_htab == NULL)
+		return;
+
+	entry = (PreparedBatchEntry *) hash_search(prepared_batch_htab, &handle,
+											   HASH_FIND, NULL);
+	if (entry == NULL)
+		return;
+
+	prepared_batch_detach(entry);
+	pfree(entry->source_text);
+	/* the names are our own copies, see prepared_batch_copy_args() */
+	for (i = 0; i < entry->args->numargs; i++)
+	{
+		if (entry->args->argnames[i])
+			pfree(entry->args->argnames[i]);
+	}
+	pfree(entry->args->argtypes);
+	pfree(entry->args->argtypmods);
+	pfree(entry->args->argnames);
+	pfree(entry->args->argmodes);
+	pfree(entry->args);
+	prepared_batch_handles--;
+
+	hash_search(prepared_batch_htab, &handle, HASH_REMOVE, NULL);
+}
+
+/*
+ * reset_cached_batch - drop every handle, e.g. on sp_reset_connection
+ *
+ * The sp_executesql batch cache goes too.
+ */
+void
+reset_cached_batch(void)
+{
+	if (prepared_batch_htab != NULL && prepared_batch_handles > 0)
+	{
+		HASH_SEQ_STATUS status;
+		PreparedBatchEntry *entry;
+
+		hash_seq_init(&status, prepared_batch_htab);
+		while ((entry = (PreparedBatchEntry *) hash_seq_search(&status)) != NULL)
+			delete_cached_batch(entry->handle);
+	}
+	next_handle = 1;
+
+	batch_cache_reset();
+}
+
+Datum
+babelfish_prepared_batch_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[5];
+	bool		nulls[5];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int32GetDatum(prepared_batch_handles);
+	values[1] = Int32GetDatum(prepared_batch_compiled);
+	values[2] = Int64GetDatum((int64) prepared_batch_bytes);
+	values[3] = Int64GetDatum((int64) prepared_batch_evictions);
+	values[4] = Int64GetDatum((int64) prepared_batch_reprepares);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
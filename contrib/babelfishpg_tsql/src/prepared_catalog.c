@@ -0,0 +1,687 @@
+/*-------------------------------------------------------------------------
+ *
+ * prepared_catalog.c	- Shared catalog of prepared T-SQL statements
+ *
+ * Pooled connections prepare the same few statements over and over, each
+ * in its own backend.  When babelfishpg_tsql.prepared_statement_catalog_size
+ * is set, every statement prepared through sp_prepare or sp_prepexec is
+ * recorded in shared memory, keyed on its normalized text, its parameter
+ * signature, the database and the user, together with execution statistics.
+ *
+ * sys.dm_exec_prepared_statements reports how often each statement was
+ * prepared and executed and how long the executions took, across sessions.
+ * sys.babelfish_prepared_statements_prewarm() compiles the statements the
+ * current database and user run most into the session's sp_executesql batch
+ * cache, where the next sp_prepexec of the same text picks them up instead
+ * of compiling again.
+ *
+ * Compiled functions and plans only make sense in the backend that built
+ * them, so only the text and the signature are shared.  The catalog lives in
+ * a dynamic shared memory segment that the first session to record a
+ * statement creates and that stays until the server stops; its number of
+ * entries and the room for their text (prepared_statement_catalog_memory)
+ * are fixed at that point.  Entries are never evicted: new statements are
+ * simply not recorded once either runs out.
+ *
+ * IDENTIFICATION
+ *	  contrib/babelfishpg_tsql/src/prepared_catalog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <ctype.h>
+
+#include "access/htup_details.h"
+#include "access/xact.h"
+#include "catalog/pg_authid.h"
+#include "catalog/pg_proc.h"
+#include "common/hashfn.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/format_type.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+
+#include "pltsql.h"
+#include "session.h"
+
+extern InlineCodeBlockArgs *create_args(int numargs);
+
+int			pltsql_prepared_catalog_size = 0;
+int			pltsql_prepared_catalog_memory_kb = DEFAULT_PREPARED_CATALOG_MEMORY_KB;
+
+#define PREPARED_CATALOG_SEGMENT	"Babelfish prepared statements"
+#define PREPARED_CATALOG_TRANCHE	"babelfish_prepared_statements"
+
+typedef struct PreparedCatalogEntry
+{
+	PreparedCatalogKey key;			/* hash key, must be first */
+	slock_t		mutex;			/* protects the counters below */
+	int64		prepares;
+	int64		executions;
+	double		total_ms;
+	double		min_ms;
+	double		max_ms;
+	int			numargs;
+	int			textlen;		/* text is followed by '\0' and the signature */
+	int			datalen;
+	Size		dataoff;		/* where the text starts in the text area */
+} PreparedCatalogEntry;
+
+/*
+ * The segment starts with this header, followed by the slots and entries of
+ * the hash table, then textsize bytes of text handed out in order.  The
+ * text is found through an offset rather than a pointer, since every
+ * backend maps the segment at its own address.
+ */
+typedef struct PreparedCatalogShared
+{
+	int			tranche_id;
+	LWLock		lock;			/* protects everything but entry counters */
+	SharedHashTable table;
+	Size		textoff;
+	Size		textsize;
+	Size		textused;
+} PreparedCatalogShared;
+
+/* What prewarm needs from an entry, copied out of shared memory */
+typedef struct PreparedCatalogCopy
+{
+	int64		executions;
+	int			numargs;
+	int			textlen;
+	int			datalen;
+	char	   *data;
+} PreparedCatalogCopy;
+
+static PreparedCatalogShared *prepared_catalog = NULL;
+static char *prepared_catalog_text = NULL;
+static bool prepared_catalog_failed = false;
+
+/* Layout of a segment about to be created */
+static PreparedCatalogShared prepared_catalog_layout;
+
+static Size prepared_catalog_memsize(void);
+static void prepared_catalog_init_segment(void *address);
+static bool prepared_catalog_attach(bool create);
+static void prepared_catalog_signature(InlineCodeBlockArgs *args, StringInfo buf);
+static void prepared_catalog_normalize(const char *source_text, StringInfo buf);
+static bool prepared_catalog_matches(PreparedCatalogEntry *entry, const char *source_text,
+									 const char *normalized, const char *sig, int siglen);
+static InlineCodeBlockArgs *prepared_catalog_args(int numargs, const char *sig);
+static char *prepared_catalog_describe_args(int numargs, const char *sig);
+static int	prepared_catalog_copy_cmp(const void *a, const void *b);
+
+PG_FUNCTION_INFO_V1(babelfish_prepared_statements);
+PG_FUNCTION_INFO_V1(babelfish_prepared_statements_prewarm);
+
+/*
+ * Lay out a new segment from the current settings and return its size.
+ */
+static Size
+prepared_catalog_memsize(void)
+{
+	PreparedCatalogShared *layout = &prepared_catalog_layout;
+	Size		size;
+
+	MemSet(layout, 0, sizeof(PreparedCatalogShared));
+	layout->table.capacity = pltsql_prepared_catalog_size;
+	layout->textsize = (Size) pltsql_prepared_catalog_memory_kb * 1024;
+
+	size = add_size(MAXALIGN(sizeof(PreparedCatalogShared)),
+					shared_hash_memsize(layout->table.capacity,
+										sizeof(PreparedCatalogEntry)));
+	layout->textoff = size;
+
+	return add_size(size, layout->textsize);
+}
+
+static void
+prepared_catalog_init_segment(void *address)
+{
+	PreparedCatalogShared *shared = (PreparedCatalogShared *) address;
+
+	memcpy(shared, &prepared_catalog_layout, sizeof(PreparedCatalogShared));
+	shared->tranche_id = LWLockNewTrancheId();
+	LWLockInitialize(&shared->lock, shared->tranche_id);
+	shared_hash_init(&shared->table,
+					 (char *) shared + MAXALIGN(sizeof(PreparedCatalogShared)),
+					 prepared_catalog_layout.table.capacity,
+					 sizeof(PreparedCatalogKey), sizeof(PreparedCatalogEntry));
+}
+
+/*
+ * Attach to the catalog, creating it first if create is set.
+ */
+static bool
+prepared_catalog_attach(bool create)
+{
+	PreparedCatalogShared *shared;
+	Size		size = 0;
+
+	if (prepared_catalog)
+		return true;
+	if (prepared_catalog_failed)
+		return false;
+
+	if (create)
+		size = prepared_catalog_memsize();
+	shared = pltsql_shared_segment(PREPARED_CATALOG_SEGMENT, size, create,
+								   prepared_catalog_init_segment);
+	if (shared == NULL)
+	{
+		if (create)
+		{
+			ereport(LOG,
+					(errmsg("could not create the prepared statement catalog: "
+							"too many dynamic shared memory segments")));
+			prepared_catalog_failed = true;
+		}
+		return false;
+	}
+
+	LWLockRegisterTranche(shared->tranche_id, PREPARED_CATALOG_TRANCHE);
+	prepared_catalog_text = (char *) shared + shared->textoff;
+	prepared_catalog = shared;
+
+	return true;
+}
+
+bool
+prepared_catalog_enabled(void)
+{
+	return pltsql_prepared_catalog_size > 0 && prepared_catalog_attach(true);
+}
+
+static void
+prepared_catalog_signature(InlineCodeBlockArgs *args, StringInfo buf)
+{
+	int			i;
+
+	for (i = 0; args && i < args->numargs; i++)
+	{
+		appendBinaryStringInfo(buf, (char *) &args->argtypes[i], sizeof(Oid));
+		appendBinaryStringInfo(buf, (char *) &args->argtypmods[i], sizeof(int32));
+		appendBinaryStringInfo(buf, &args->argmodes[i], sizeof(char));
+		if (args->argnames && args->argnames[i])
+			appendBinaryStringInfo(buf, args->argnames[i], strlen(args->argnames[i]) + 1);
+		else
+			appendStringInfoChar(buf, '\0');
+	}
+}
+
+/*
+ * Fold runs of white space into one blank, so that the same statement
+ * formatted by different drivers shares an entry.  Literals, quoted
+ * identifiers and comments are copied as they are, since statements that
+ * differ there are different statements; so is the newline that ends a "--"
+ * comment.
+ */
+static void
+prepared_catalog_normalize(const char *source_text, StringInfo buf)
+{
+	const char *cp = source_text;
+	bool		space = false;
+
+	while (*cp)
+	{
+		const char *start = cp;
+
+		if (isspace((unsigned char) *cp))
+		{
+			space = true;
+			cp++;
+			continue;
+		}
+		if (space && buf->len > 0 && buf->data[buf->len - 1] != '\n')
+			appendStringInfoChar(buf, ' ');
+		space = false;
+
+		if (*cp == '\'' || *cp == '"' || *cp == '[')
+		{
+			char		quote = (*cp == '[') ? ']' : *cp;
+
+			/* a doubled quote just starts the next literal */
+			for (cp++; *cp && *cp != quote; cp++)
+				;
+			if (*cp)
+				cp++;
+		}
+		else if (cp[0] == '-' && cp[1] == '-')
+		{
+			while (*cp && *cp != '\n')
+				cp++;
+			if (*cp)
+				cp++;
+		}
+		else if (cp[0] == '/' && cp[1] == '*')
+		{
+			int			depth = 0;	/* T-SQL block comments nest */
+
+			while (*cp)
+			{
+				if (cp[0] == '/' && cp[1] == '*')
+				{
+					depth++;
+					cp += 2;
+				}
+				else if (cp[0] == '*' && cp[1] == '/')
+				{
+					cp += 2;
+					if (--depth == 0)
+						break;
+				}
+				else
+					cp++;
+			}
+		}
+		else
+			cp++;
+
+		appendBinaryStringInfo(buf, start, cp - start);
+	}
+}
+
+/*
+ * Whether the entry found under a statement's key holds that statement, and
+ * not another one whose normalized text and signature hash the same.  The
+ * caller holds the lock.
+ */
+static bool
+prepared_catalog_matches(PreparedCatalogEntry *entry, const char *source_text,
+						 const char *normalized, const char *sig, int siglen)
+{
+	const char *text = prepared_catalog_text + entry->dataoff;
+	StringInfoData buf;
+	bool		result;
+
+	if (entry->datalen - entry->textlen - 1 != siglen ||
+		memcmp(text + entry->textlen + 1, sig, siglen) != 0)
+		return false;
+
+	if (strcmp(text, source_text) == 0)
+		return true;
+
+	initStringInfo(&buf);
+	prepared_catalog_normalize(text, &buf);
+	result = (strcmp(buf.data, normalized) == 0);
+	pfree(buf.data);
+
+	return result;
+}
+
+/*
+ * prepared_catalog_store - record that a statement was prepared
+ *
+ * Fills in the key to pass to prepared_catalog_record() for its executions;
+ * key->queryid is zero if the statement was not recorded.
+ */
+void
+prepared_catalog_store(const char *source_text, InlineCodeBlockArgs *args,
+					   PreparedCatalogKey *key)
+{
+	PreparedCatalogEntry *entry;
+	StringInfoData sig;
+	StringInfoData normalized;
+	uint32	   *slot = NULL;
+	int			textlen;
+	int			datalen;
+	bool		same = false;
+
+	MemSet(key, 0, sizeof(PreparedCatalogKey));
+	if (!prepared_catalog_enabled())
+		return;
+
+	initStringInfo(&sig);
+	prepared_catalog_signature(args, &sig);
+	initStringInfo(&normalized);
+	prepared_catalog_normalize(source_text, &normalized);
+
+	key->userid = GetUserId();
+	key->dbid = get_cur_db_id();
+	key->queryid = hash_combine64(hash_bytes_extended((const unsigned char *) normalized.data,
+													  normalized.len, 0),
+								  hash_bytes_extended((const unsigned char *) sig.data,
+													  sig.len, 0));
+
+	/* Usually the statement is known already */
+	LWLockAcquire(&prepared_catalog->lock, LW_SHARED);
+	entry = (PreparedCatalogEntry *) shared_hash_find(&prepared_catalog->table, key, NULL);
+	if (entry)
+	{
+		same = prepared_catalog_matches(entry, source_text, normalized.data,
+										sig.data, sig.len);
+		if (same)
+		{
+			SpinLockAcquire(&entry->mutex);
+			entry->prepares++;
+			SpinLockRelease(&entry->mutex);
+		}
+	}
+	LWLockRelease(&prepared_catalog->lock);
+
+	if (entry == NULL)
+	{
+		textlen = strlen(source_text);
+		datalen = textlen + 1 + sig.len;
+
+		LWLockAcquire(&prepared_catalog->lock, LW_EXCLUSIVE);
+		entry = (PreparedCatalogEntry *) shared_hash_find(&prepared_catalog->table, key, &slot);
+		if (entry)
+			same = prepared_catalog_matches(entry, source_text, normalized.data,
+											sig.data, sig.len);
+		else if (prepared_catalog->textused + datalen <= prepared_catalog->textsize &&
+				 (entry = (PreparedCatalogEntry *) shared_hash_insert(&prepared_catalog->table,
+																	   key, slot)) != NULL)
+		{
+			SpinLockInit(&entry->mutex);
+			entry->prepares = 0;
+			entry->executions = 0;
+			entry->total_ms = 0;
+			entry->min_ms = 0;
+			entry->max_ms = 0;
+			entry->numargs = args ? args->numargs : 0;
+			entry->textlen = textlen;
+			entry->datalen = datalen;
+			entry->dataoff = prepared_catalog->textused;
+			memcpy(prepared_catalog_text + entry->dataoff, source_text, textlen + 1);
+			memcpy(prepared_catalog_text + entry->dataoff + textlen + 1, sig.data, sig.len);
+
+			prepared_catalog->textused += datalen;
+			same = true;
+		}
+
+		/* We hold the lock exclusively, so nobody else is looking at the counters */
+		if (same)
+			entry->prepares++;
+		LWLockRelease(&prepared_catalog->lock);
+	}
+
+	/* A different statement under the same key is not recorded at all */
+	if (!same)
+		key->queryid = 0;
+
+	pfree(normalized.data);
+	pfree(sig.data);
+}
+
+/*
+ * prepared_catalog_record - account one execution of a recorded statement
+ */
+void
+prepared_catalog_record(PreparedCatalogKey *key, double elapsed_ms)
+{
+	PreparedCatalogEntry *entry;
+
+	if (!prepared_catalog_enabled() || key->queryid == 0)
+		return;
+
+	LWLockAcquire(&prepared_catalog->lock, LW_SHARED);
+	entry = (PreparedCatalogEntry *) shared_hash_find(&prepared_catalog->table, key, NULL);
+	if (entry)
+	{
+		SpinLockAcquire(&entry->mutex);
+		entry->executions++;
+		entry->total_ms += elapsed_ms;
+		if (entry->executions == 1 || elapsed_ms < entry->min_ms)
+			entry->min_ms = elapsed_ms;
+		if (elapsed_ms > entry->max_ms)
+			entry->max_ms = elapsed_ms;
+		SpinLockRelease(&entry->mutex);
+	}
+	LWLockRelease(&prepared_catalog->lock);
+}
+
+/*
+ * Rebuild parameter definitions from a serialized signature.
+ */
+static InlineCodeBlockArgs *
+prepared_catalog_args(int numargs, const char *sig)
+{
+	InlineCodeBlockArgs *args = create_args(numargs);
+	const char *cp = sig;
+	int			i;
+
+	for (i = 0; i < numargs; i++)
+	{
+		memcpy(&args->argtypes[i], cp, sizeof(Oid));
+		cp += sizeof(Oid);
+		memcpy(&args->argtypmods[i], cp, sizeof(int32));
+		cp += sizeof(int32);
+		args->argmodes[i] = *cp++;
+		args->argnames[i] = *cp ? pstrdup(cp) : NULL;
+		cp += strlen(cp) + 1;
+	}
+
+	return args;
+}
+
+/*
+ * Parameter signature in T-SQL's "@name type [OUTPUT], ..." form.
+ */
+static char *
+prepared_catalog_describe_args(int numargs, const char *sig)
+{
+	InlineCodeBlockArgs *args = prepared_catalog_args(numargs, sig);
+	StringInfoData buf;
+	int			i;
+
+	initStringInfo(&buf);
+	for (i = 0; i < numargs; i++)
+	{
+		if (i > 0)
+			appendStringInfoString(&buf, ", ");
+		if (args->argnames[i])
+			appendStringInfo(&buf, "%s ", args->argnames[i]);
+		appendStringInfoString(&buf, format_type_with_typemod(args->argtypes[i],
+															  args->argtypmods[i]));
+		if (args->argmodes[i] != FUNC_PARAM_IN)
+			appendStringInfoString(&buf, " OUTPUT");
+	}
+
+	return buf.data;
+}
+
+/*
+ * babelfish_prepared_statements - contents of the catalog
+ *
+ * Like pg_stat_statements, the text of other users' statements is only shown
+ * to members of pg_read_all_stats.
+ */
+Datum
+babelfish_prepared_statements(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	MemoryContext oldcontext;
+	Oid			userid = GetUserId();
+	int			i;
+	bool		read_all = is_member_of_role(userid, ROLE_PG_READ_ALL_STATS);
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Show what was recorded even after the catalog was switched off */
+	if (!prepared_catalog_attach(false))
+		return (Datum) 0;
+
+	LWLockAcquire(&prepared_catalog->lock, LW_SHARED);
+
+	for (i = 0; i < prepared_catalog->table.nentries; i++)
+	{
+		PreparedCatalogEntry *entry = shared_hash_entry(&prepared_catalog->table, i);
+		const char *text = prepared_catalog_text + entry->dataoff;
+		Datum		values[10];
+		bool		nulls[10];
+		int64		prepares;
+		int64		executions;
+		double		total_ms;
+		double		min_ms;
+		double		max_ms;
+
+		SpinLockAcquire(&entry->mutex);
+		prepares = entry->prepares;
+		executions = entry->executions;
+		total_ms = entry->total_ms;
+		min_ms = entry->min_ms;
+		max_ms = entry->max_ms;
+		SpinLockRelease(&entry->mutex);
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = Int16GetDatum(entry->key.dbid);
+		values[1] = ObjectIdGetDatum(entry->key.userid);
+		values[2] = Int64GetDatum((int64) entry->key.queryid);
+		if (read_all || entry->key.userid == userid)
+		{
+			values[3] = CStringGetTextDatum(text);
+			values[4] = CStringGetTextDatum(prepared_catalog_describe_args(entry->numargs,
+																		   text + entry->textlen + 1));
+		}
+		else
+		{
+			nulls[3] = true;
+			nulls[4] = true;
+		}
+		values[5] = Int64GetDatum(prepares);
+		values[6] = Int64GetDatum(executions);
+		values[7] = Float8GetDatum(total_ms);
+		values[8] = Float8GetDatum(min_ms);
+		values[9] = Float8GetDatum(max_ms);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	LWLockRelease(&prepared_catalog->lock);
+
+	return (Datum) 0;
+}
+
+static int
+prepared_catalog_copy_cmp(const void *a, const void *b)
+{
+	int64		ea = ((const PreparedCatalogCopy *) a)->executions;
+	int64		eb = ((const PreparedCatalogCopy *) b)->executions;
+
+	if (ea > eb)
+		return -1;
+	if (ea < eb)
+		return 1;
+	return 0;
+}
+
+/*
+ * babelfish_prepared_statements_prewarm - compile the most executed
+ * statements of the current database and user into the batch cache
+ *
+ * Returns the number of statements compiled.  Statements that are cached
+ * already are skipped, and so are statements that no longer compile.
+ */
+Datum
+babelfish_prepared_statements_prewarm(PG_FUNCTION_ARGS)
+{
+	int			max_statements = PG_ARGISNULL(0) ? pltsql_batch_cache_size : PG_GETARG_INT32(0);
+	Oid			userid = GetUserId();
+	int16		dbid = get_cur_db_id();
+	PreparedCatalogCopy *copies;
+	int			ncopies = 0;
+	int			compiled = 0;
+	int			i;
+
+	if (!prepared_catalog_enabled() || !batch_cache_enabled() || max_statements <= 0)
+		PG_RETURN_INT32(0);
+
+	LWLockAcquire(&prepared_catalog->lock, LW_SHARED);
+
+	copies = palloc(sizeof(PreparedCatalogCopy) * Max(prepared_catalog->table.nentries, 1));
+	for (i = 0; i < prepared_catalog->table.nentries; i++)
+	{
+		PreparedCatalogEntry *entry = shared_hash_entry(&prepared_catalog->table, i);
+		PreparedCatalogCopy *copy;
+
+		if (entry->key.userid != userid || entry->key.dbid != dbid)
+			continue;
+
+		copy = &copies[ncopies++];
+		SpinLockAcquire(&entry->mutex);
+		copy->executions = entry->executions;
+		SpinLockRelease(&entry->mutex);
+		copy->numargs = entry->numargs;
+		copy->textlen = entry->textlen;
+		copy->datalen = entry->datalen;
+		copy->data = palloc(entry->datalen);
+		memcpy(copy->data, prepared_catalog_text + entry->dataoff, entry->datalen);
+	}
+
+	LWLockRelease(&prepared_catalog->lock);
+
+	qsort(copies, ncopies, sizeof(PreparedCatalogCopy), prepared_catalog_copy_cmp);
+
+	for (i = 0; i < ncopies && compiled < max_statements; i++)
+	{
+		PreparedCatalogCopy *copy = &copies[i];
+		InlineCodeBlockArgs *args = prepared_catalog_args(copy->numargs,
+														  copy->data + copy->textlen + 1);
+		MemoryContext oldcontext = CurrentMemoryContext;
+		ResourceOwner oldowner = CurrentResourceOwner;
+
+		if (batch_cache_contains(copy->data, args))
+			continue;
+
+		/* A statement that fails to compile must not take the others down */
+		BeginInternalSubTransaction(NULL);
+		MemoryContextSwitchTo(oldcontext);
+
+		PG_TRY();
+		{
+			PLtsql_function *func = pltsql_compile_inline(copy->data, args);
+
+			if (batch_cache_insert(copy->data, args, func))
+				compiled++;
+			else
+				pltsql_free_function_memory(func);
+
+			ReleaseCurrentSubTransaction();
+			MemoryContextSwitchTo(oldcontext);
+			CurrentResourceOwner = oldowner;
+		}
+		PG_CATCH();
+		{
+			MemoryContextSwitchTo(oldcontext);
+			FlushErrorState();
+
+			RollbackAndReleaseCurrentSubTransaction();
+			MemoryContextSwitchTo(oldcontext);
+			CurrentResourceOwner = oldowner;
+		}
+		PG_END_TRY();
+	}
+
+	PG_RETURN_INT32(compiled);
+}
@@ -19,7 +19,6 @@ static int16 current_db_id = 0;
 static char current_db_name[MAX_BBF_NAMEDATALEND+1] = {'\0'};
 static Oid current_user_id = InvalidOid;
 static void set_search_path_for_user_schema(const char* db_name, const char* user);
-void reset_cached_batch(void);
 
 int16
 get_cur_db_id(void)
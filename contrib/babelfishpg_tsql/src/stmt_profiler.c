@@ -0,0 +1,396 @@
+/*-------------------------------------------------------------------------
+ *
+ * stmt_profiler.c	- Per-line execution statistics of T-SQL procedures
+ *
+ * When babelfishpg_tsql.statement_profiler_size is set, every statement that
+ * a procedure, function or trigger executes is counted and timed, and the
+ * numbers are summed up in shared memory per (database, object, line) across
+ * sessions.  sys.dm_exec_statement_stats reports those of the current
+ * database, so that slow lines can be found without turning on the execution
+ * trace and reading the server log.
+ *
+ * Statements are timed with the monotonic clock behind instr_time.  The
+ * time of a statement includes the procedures it calls.  exec_stmt_iterative
+ * keeps the counters of the running function in its ExecCodes, one set per
+ * execution node, and stmt_profiler_flush() adds them to the shared entries
+ * when the function returns, so shared memory is touched once per line and
+ * call rather than once per statement.
+ *
+ * The entries live in a dynamic shared memory segment that the first session
+ * to run a procedure with the profiler on creates, and whose number of
+ * entries is fixed at that point.  Batches have no object to attribute their
+ * lines to and are not profiled.  Entries are never evicted: once the table
+ * is full, new lines are simply not recorded until
+ * sys.babelfish_statement_stats_reset() clears those of a database.
+ *
+ * IDENTIFICATION
+ *	  contrib/babelfishpg_tsql/src/stmt_profiler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "catalog/pg_authid.h"
+#include "catalog/pg_proc.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/acl.h"
+#include "utils/memutils.h"
+#include "utils/syscache.h"
+#include "utils/tuplestore.h"
+
+#include "pltsql.h"
+#include "iterative_exec.h"
+#include "session.h"
+
+int			pltsql_statement_profiler_size = 0;
+
+#define STMT_PROFILER_SEGMENT	"Babelfish statement profiler"
+#define STMT_PROFILER_TRANCHE	"babelfish_statement_profiler"
+
+typedef struct StmtProfileKey
+{
+	int16		dbid;
+	Oid			fn_oid;
+	int32		lineno;
+} StmtProfileKey;
+
+typedef struct StmtProfileEntry
+{
+	StmtProfileKey key;			/* hash key, must be first */
+	slock_t		mutex;			/* protects the counters below */
+	int64		calls;
+	uint64		total_us;
+	uint64		min_us;
+	uint64		max_us;
+	uint64		rows;
+} StmtProfileEntry;
+
+/* The segment starts with this header, followed by the slots and entries */
+typedef struct StmtProfilerShared
+{
+	int			tranche_id;
+	LWLock		lock;			/* protects everything but entry counters */
+	SharedHashTable table;
+} StmtProfilerShared;
+
+static StmtProfilerShared *stmt_profiler = NULL;
+static bool stmt_profiler_failed = false;
+
+/* Size of a segment about to be created */
+static int	stmt_profiler_capacity;
+
+static void stmt_profiler_init_segment(void *address);
+static bool stmt_profiler_attach(bool create);
+static bool stmt_profiler_skip(PLtsql_stmt *stmt);
+static void stmt_profiler_add(StmtProfileKey *key, StmtProfileCounters *counters);
+static bool stmt_profiler_visible(Oid fn_oid, Oid userid);
+static bool stmt_profiler_in_db(void *entry, void *arg);
+
+PG_FUNCTION_INFO_V1(babelfish_statement_stats);
+PG_FUNCTION_INFO_V1(babelfish_statement_stats_reset);
+
+static void
+stmt_profiler_init_segment(void *address)
+{
+	StmtProfilerShared *shared = (StmtProfilerShared *) address;
+
+	shared->tranche_id = LWLockNewTrancheId();
+	LWLockInitialize(&shared->lock, shared->tranche_id);
+	shared_hash_init(&shared->table,
+					 (char *) shared + MAXALIGN(sizeof(StmtProfilerShared)),
+					 stmt_profiler_capacity,
+					 sizeof(StmtProfileKey), sizeof(StmtProfileEntry));
+}
+
+/*
+ * Attach to the profiler's table, creating it first if create is set.
+ */
+static bool
+stmt_profiler_attach(bool create)
+{
+	StmtProfilerShared *shared;
+	Size		size = 0;
+
+	if (stmt_profiler)
+		return true;
+	if (stmt_profiler_failed)
+		return false;
+
+	if (create)
+	{
+		stmt_profiler_capacity = pltsql_statement_profiler_size;
+		size = add_size(MAXALIGN(sizeof(StmtProfilerShared)),
+						shared_hash_memsize(stmt_profiler_capacity,
+											sizeof(StmtProfileEntry)));
+	}
+	shared = pltsql_shared_segment(STMT_PROFILER_SEGMENT, size, create,
+								   stmt_profiler_init_segment);
+	if (shared == NULL)
+	{
+		if (create)
+		{
+			ereport(LOG,
+					(errmsg("could not create the statement profiler: "
+							"too many dynamic shared memory segments")));
+			stmt_profiler_failed = true;
+		}
+		return false;
+	}
+
+	LWLockRegisterTranche(shared->tranche_id, STMT_PROFILER_TRANCHE);
+	stmt_profiler = shared;
+
+	return true;
+}
+
+/*
+ * stmt_profiler_begin - counters for an execution of the given function,
+ * or NULL if it is not to be profiled
+ *
+ * The counters live as long as the compiled function.
+ */
+StmtProfileCounters *
+stmt_profiler_begin(Oid fn_oid, ExecCodes *exec_codes)
+{
+	if (pltsql_statement_profiler_size <= 0 || !OidIsValid(fn_oid) ||
+		!stmt_profiler_attach(true))
+		return NULL;
+
+	if (exec_codes->profile == NULL)
+		exec_codes->profile = (StmtProfileCounters *)
+			MemoryContextAllocZero(GetMemoryChunkContext(exec_codes),
+								   vec_size(exec_codes->codes) * sizeof(StmtProfileCounters));
+
+	return exec_codes->profile;
+}
+
+/*
+ * Jumps and context switches that codegen adds around blocks and loops have
+ * no cost of their own worth reporting.  Conditional jumps stay: their time
+ * is that of evaluating the IF or WHILE condition.
+ */
+static bool
+stmt_profiler_skip(PLtsql_stmt *stmt)
+{
+	switch (stmt->cmd_type)
+	{
+		case PLTSQL_STMT_GOTO:
+			return ((PLtsql_stmt_goto *) stmt)->cond == NULL;
+		case PLTSQL_STMT_SAVE_CTX:
+		case PLTSQL_STMT_RESTORE_CTX_FULL:
+		case PLTSQL_STMT_RESTORE_CTX_PARTIAL:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static void
+stmt_profiler_add(StmtProfileKey *key, StmtProfileCounters *counters)
+{
+	StmtProfileEntry *entry;
+	uint32	   *slot;
+
+	/* Usually the line is known already */
+	LWLockAcquire(&stmt_profiler->lock, LW_SHARED);
+	entry = (StmtProfileEntry *) shared_hash_find(&stmt_profiler->table, key, NULL);
+	if (entry == NULL)
+	{
+		LWLockRelease(&stmt_profiler->lock);
+		LWLockAcquire(&stmt_profiler->lock, LW_EXCLUSIVE);
+
+		entry = (StmtProfileEntry *) shared_hash_find(&stmt_profiler->table, key, &slot);
+		if (entry == NULL &&
+			(entry = (StmtProfileEntry *) shared_hash_insert(&stmt_profiler->table,
+															 key, slot)) != NULL)
+		{
+			SpinLockInit(&entry->mutex);
+			entry->calls = 0;
+			entry->total_us = 0;
+			entry->min_us = 0;
+			entry->max_us = 0;
+			entry->rows = 0;
+		}
+	}
+
+	if (entry)
+	{
+		SpinLockAcquire(&entry->mutex);
+		if (entry->calls == 0 || counters->min_us < entry->min_us)
+			entry->min_us = counters->min_us;
+		if (counters->max_us > entry->max_us)
+			entry->max_us = counters->max_us;
+		entry->calls += counters->calls;
+		entry->total_us += counters->total_us;
+		entry->rows += counters->rows;
+		SpinLockRelease(&entry->mutex);
+	}
+
+	LWLockRelease(&stmt_profiler->lock);
+}
+
+/*
+ * stmt_profiler_flush - add what the function executed since the last flush
+ * to the shared table, and start over
+ *
+ * Recursive calls share the counters; whichever returns first flushes what
+ * all of them have done so far.
+ */
+void
+stmt_profiler_flush(Oid fn_oid, ExecCodes *exec_codes)
+{
+	StmtProfileKey key;
+	size_t		size = vec_size(exec_codes->codes);
+	size_t		pc;
+
+	if (stmt_profiler == NULL || exec_codes->profile == NULL)
+		return;
+
+	MemSet(&key, 0, sizeof(key));
+	key.dbid = get_cur_db_id();
+	key.fn_oid = fn_oid;
+
+	for (pc = 0; pc < size; pc++)
+	{
+		StmtProfileCounters *counters = &exec_codes->profile[pc];
+		PLtsql_stmt *stmt;
+
+		if (counters->calls == 0)
+			continue;
+
+		stmt = *(PLtsql_stmt **) vec_at(exec_codes->codes, pc);
+		if (!stmt_profiler_skip(stmt))
+		{
+			key.lineno = stmt->lineno;
+			stmt_profiler_add(&key, counters);
+		}
+
+		MemSet(counters, 0, sizeof(StmtProfileCounters));
+	}
+}
+
+/*
+ * Lines of other users' objects are only shown to those who may read all
+ * statistics, like pg_stat_statements does with other users' queries.
+ */
+static bool
+stmt_profiler_visible(Oid fn_oid, Oid userid)
+{
+	HeapTuple	tuple;
+	bool		visible;
+
+	tuple = SearchSysCache1(PROCOID, ObjectIdGetDatum(fn_oid));
+	if (!HeapTupleIsValid(tuple))
+		return false;
+	visible = has_privs_of_role(userid, ((Form_pg_proc) GETSTRUCT(tuple))->proowner);
+	ReleaseSysCache(tuple);
+
+	return visible;
+}
+
+Datum
+babelfish_statement_stats(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	MemoryContext oldcontext;
+	Oid			userid = GetUserId();
+	int16		dbid = get_cur_db_id();
+	int			i;
+	bool		read_all = is_member_of_role(userid, ROLE_PG_READ_ALL_STATS);
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Show what was recorded even after the profiler was switched off */
+	if (!stmt_profiler_attach(false))
+		return (Datum) 0;
+
+	LWLockAcquire(&stmt_profiler->lock, LW_SHARED);
+
+	for (i = 0; i < stmt_profiler->table.nentries; i++)
+	{
+		StmtProfileEntry *entry = shared_hash_entry(&stmt_profiler->table, i);
+		Datum		values[7];
+		bool		nulls[7];
+
+		if (entry->key.dbid != dbid)
+			continue;
+		if (!read_all && !stmt_profiler_visible(entry->key.fn_oid, userid))
+			continue;
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = ObjectIdGetDatum(entry->key.fn_oid);
+		values[1] = Int32GetDatum(entry->key.lineno);
+
+		SpinLockAcquire(&entry->mutex);
+		values[2] = Int64GetDatum(entry->calls);
+		values[3] = Int64GetDatum((int64) entry->total_us);
+		values[4] = Int64GetDatum((int64) entry->min_us);
+		values[5] = Int64GetDatum((int64) entry->max_us);
+		values[6] = Int64GetDatum((int64) entry->rows);
+		SpinLockRelease(&entry->mutex);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	LWLockRelease(&stmt_profiler->lock);
+
+	return (Datum) 0;
+}
+
+static bool
+stmt_profiler_in_db(void *entry, void *arg)
+{
+	return ((StmtProfileEntry *) entry)->key.dbid == *(int16 *) arg;
+}
+
+/*
+ * babelfish_statement_stats_reset - forget the lines of the current database
+ */
+Datum
+babelfish_statement_stats_reset(PG_FUNCTION_ARGS)
+{
+	int16		dbid = get_cur_db_id();
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to reset statement statistics")));
+
+	if (!stmt_profiler_attach(false))
+		PG_RETURN_VOID();
+
+	/* Nobody else holds the lock, so the counters can be moved as they are */
+	LWLockAcquire(&stmt_profiler->lock, LW_EXCLUSIVE);
+	shared_hash_remove_if(&stmt_profiler->table, stmt_profiler_in_db, &dbid);
+	LWLockRelease(&stmt_profiler->lock);
+
+	PG_RETURN_VOID();
+}
@@ -1,6 +1,14 @@
 #include "postgres.h"
+
+#include <ctype.h>
+
+#include "access/htup_details.h"
+#include "common/string.h"
 #include "utils/builtins.h"
 #include "funcapi.h"
+#include "lib/stringinfo.h"
+#include "portability/instr_time.h"
+#include "storage/fd.h"
 #include "pltsql.h"
 #if 0
 PG_MODULE_MAGIC;
@@ -28,3 +36,183 @@ antlr_parser(PG_FUNCTION_ARGS)
 
   PG_RETURN_TEXT_P(cstring_to_text((result.success ? "success" : result.errfmt)));
 }
+
+ANTLR_parser_stats pltsql_parser_stats;
+
+/*
+ * Batches for the parser warm-up.  They should cover the statements clients
+ * send most, so that predicting them is cached before the first real batch.
+ */
+static const char *const parser_warmup_corpus[] = {
+	"SELECT 1",
+	"SELECT @@VERSION",
+	"SELECT @@SPID, @@TRANCOUNT, @@ROWCOUNT, @@ERROR",
+	"SET NOCOUNT ON; SET ANSI_NULLS ON; SET QUOTED_IDENTIFIER ON; SET TEXTSIZE 2147483647",
+	"SET TRANSACTION ISOLATION LEVEL READ COMMITTED",
+	"SELECT a.id, a.name, b.value FROM dbo.t1 a INNER JOIN dbo.t2 AS b ON a.id = b.id "
+	"WHERE a.created >= @p0 AND b.value IS NOT NULL ORDER BY a.id DESC",
+	"SELECT TOP (10) [id], [name] FROM [dbo].[t1] WITH (NOLOCK) WHERE [name] LIKE N'abc%'",
+	"SELECT COUNT(*), SUM(x), MAX(y) FROM t GROUP BY z HAVING COUNT(*) > 1",
+	"SELECT id, ROW_NUMBER() OVER (PARTITION BY grp ORDER BY id) AS rn FROM t "
+	"ORDER BY id OFFSET 10 ROWS FETCH NEXT 20 ROWS ONLY",
+	"WITH cte AS (SELECT id, parent FROM t WHERE parent IS NULL "
+	"UNION ALL SELECT t.id, t.parent FROM t JOIN cte ON t.parent = cte.id) SELECT * FROM cte",
+	"SELECT CASE WHEN x > 0 THEN 'pos' ELSE 'neg' END, CAST(y AS varchar(10)), "
+	"CONVERT(datetime, z, 121), ISNULL(w, 0), COALESCE(a, b) FROM t",
+	"SELECT * FROM t WHERE id IN (SELECT id FROM u) AND EXISTS (SELECT 1 FROM v WHERE v.id = t.id)",
+	"INSERT INTO dbo.t1 (id, name) VALUES (@p0, @p1)",
+	"INSERT INTO t (a, b) SELECT a, b FROM u; SELECT SCOPE_IDENTITY()",
+	"UPDATE dbo.t1 SET name = @p1, updated = GETDATE() WHERE id = @p0",
+	"UPDATE t SET t.x = u.x FROM t JOIN u ON t.id = u.id",
+	"DELETE FROM dbo.t1 WHERE id = @p0",
+	"DELETE t FROM t JOIN u ON t.id = u.id",
+	"DECLARE @i int = 0, @s nvarchar(max); SET @i = @i + 1; SELECT @s = name FROM t WHERE id = @i",
+	"IF @x IS NULL BEGIN SET @x = 1 END ELSE BEGIN SET @x = @x + 1 END",
+	"WHILE @i < 10 BEGIN SET @i += 1; IF @i = 5 BREAK; END",
+	"BEGIN TRY BEGIN TRANSACTION; UPDATE t SET x = 1; COMMIT TRANSACTION; END TRY "
+	"BEGIN CATCH IF @@TRANCOUNT > 0 ROLLBACK TRANSACTION; "
+	"SELECT ERROR_NUMBER(), ERROR_MESSAGE(); THROW; END CATCH",
+	"RAISERROR('message %s', 16, 1, @s)",
+	"EXEC dbo.proc1 @a = 1, @b = N'x', @c = @out OUTPUT",
+	"EXECUTE sp_executesql N'SELECT * FROM t WHERE id = @id', N'@id int', @id = 1",
+	"DECLARE c CURSOR FOR SELECT id FROM t; OPEN c; FETCH NEXT FROM c INTO @id; CLOSE c; DEALLOCATE c",
+	"CREATE TABLE #tmp (id int PRIMARY KEY, name nvarchar(100) NULL); DROP TABLE #tmp",
+	"DECLARE @tv TABLE (id int, v varchar(10)); INSERT INTO @tv VALUES (1, 'a'); SELECT * FROM @tv",
+	"MERGE INTO t USING u ON t.id = u.id WHEN MATCHED THEN UPDATE SET t.x = u.x "
+	"WHEN NOT MATCHED THEN INSERT (id, x) VALUES (u.id, u.x);",
+	"CREATE PROCEDURE dbo.p @a int, @b nvarchar(50) = NULL OUTPUT AS BEGIN SET NOCOUNT ON; "
+	"SELECT @b = name FROM t WHERE id = @a; RETURN 0; END",
+	"CREATE FUNCTION dbo.f (@a int) RETURNS int AS BEGIN RETURN @a + 1 END",
+	"CREATE VIEW dbo.v AS SELECT id, name FROM dbo.t1",
+	"SELECT name FROM sys.tables t JOIN sys.schemas s ON t.schema_id = s.schema_id WHERE s.name = 'dbo'",
+	"SELECT id, name FROM t FOR JSON PATH",
+	"SELECT id, name FROM t FOR XML RAW",
+	"USE master",
+};
+
+/*
+ * Add the batches of the warm-up file to 'batches', splitting on lines that
+ * only hold GO.
+ */
+static List *
+read_parser_warmup_file(const char *filename, List *batches)
+{
+	FILE	   *file;
+	StringInfoData batch;
+	StringInfoData line;
+
+	file = AllocateFile(filename, "r");
+	if (file == NULL)
+	{
+		ereport(WARNING,
+				(errcode_for_file_access(),
+				 errmsg("could not open parser warm-up file \"%s\": %m", filename)));
+		return batches;
+	}
+
+	initStringInfo(&batch);
+	initStringInfo(&line);
+
+	/* pg_get_line_buf() reads whole lines, however long they are */
+	while (pg_get_line_buf(file, &line))
+	{
+		char	   *word = line.data;
+		size_t		len;
+
+		while (isspace((unsigned char) *word))
+			word++;
+		len = strlen(word);
+		while (len > 0 && isspace((unsigned char) word[len - 1]))
+			len--;
+
+		if (len == 2 && pg_strncasecmp(word, "GO", 2) == 0)
+		{
+			if (batch.len > 0)
+				batches = lappend(batches, pstrdup(batch.data));
+			resetStringInfo(&batch);
+		}
+		else
+			appendBinaryStringInfo(&batch, line.data, line.len);
+	}
+	if (batch.len > 0)
+		batches = lappend(batches, pstrdup(batch.data));
+
+	FreeFile(file);
+	pfree(line.data);
+	pfree(batch.data);
+
+	return batches;
+}
+
+/*
+ * pltsql_parser_warmup_run - prime the parser caches of this backend
+ *
+ * Called when the library is loaded.  The time it takes is reported by
+ * sys.babelfish_parser_stats(), next to the parse times of the batches that
+ * follow, so that its effect on the first batches can be measured.
+ */
+void
+pltsql_parser_warmup_run(void)
+{
+	List	   *batches = NIL;
+	ListCell   *lc;
+	instr_time	start;
+	instr_time	duration;
+	int			failed = 0;
+
+	for (int i = 0; i < lengthof(parser_warmup_corpus); i++)
+		batches = lappend(batches, (char *) parser_warmup_corpus[i]);
+	if (pltsql_parser_warmup_file && pltsql_parser_warmup_file[0] != '\0')
+		batches = read_parser_warmup_file(pltsql_parser_warmup_file, batches);
+
+	INSTR_TIME_SET_CURRENT(start);
+	foreach(lc, batches)
+	{
+		if (!antlr_parser_warmup_batch((const char *) lfirst(lc)))
+			failed++;
+	}
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	pltsql_parser_stats.warmup_batches += list_length(batches);
+	pltsql_parser_stats.warmup_ms += INSTR_TIME_GET_MILLISEC(duration);
+
+	elog(DEBUG1, "parser warm-up parsed %d batches (%d with errors) in %.3f ms",
+		 list_length(batches), failed, INSTR_TIME_GET_MILLISEC(duration));
+
+	list_free(batches);
+}
+
+PG_FUNCTION_INFO_V1(babelfish_parser_stats);
+
+Datum
+babelfish_parser_stats(PG_FUNCTION_ARGS)
+{
+	ANTLR_parser_stats *stats = &pltsql_parser_stats;
+	TupleDesc	tupdesc;
+	Datum		values[9];
+	bool		nulls[9];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum(stats->warmup_batches);
+	values[1] = Float8GetDatum(stats->warmup_ms);
+	values[2] = Int64GetDatum(stats->batches);
+	values[3] = Float8GetDatum(stats->first_batch_ms);
+	values[4] = Float8GetDatum(stats->last_batch_ms);
+	values[5] = Float8GetDatum(stats->max_batch_ms);
+
+	/* The average after the first batch, i.e. once the caches are warm */
+	if (stats->batches > 1)
+		values[6] = Float8GetDatum((stats->total_batch_ms - stats->first_batch_ms) /
+								   (stats->batches - 1));
+	else
+		nulls[6] = true;
+
+	values[7] = Int64GetDatum(stats->sll_batches);
+	values[8] = Int64GetDatum(stats->ll_fallbacks);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
@@ -38,6 +38,7 @@ extern "C" {
 #include "catalog/namespace.h"
 #include "catalog/pg_proc.h"
 #include "parser/scansup.h"
+#include "portability/instr_time.h"
 
 #include "guc.h"
 
@@ -55,6 +56,7 @@ using namespace tree;
 extern "C"
 {
 	ANTLR_result antlr_parser_cpp(const char *sourceText);
+	bool antlr_parser_warmup_batch(const char *sourceText);
 
 	void report_antlr_error(ANTLR_result result);
 
@@ -69,6 +71,7 @@ extern "C"
 
 	extern bool pltsql_dump_antlr_query_graph;
 	extern bool pltsql_enable_antlr_detailed_log;
+	extern bool pltsql_enable_sll_parse_mode;
 
 	extern bool pltsql_enable_tsql_information_schema;
 
@@ -1972,10 +1975,19 @@ public:
 	std::vector<int> double_quota_places;
 	int parameterIndex = 0;
 
+	/* if set, each node is checked for unsupported features before it is entered */
+	TsqlUnsupportedFeatureHandler *unsupportedFeatureHandler = nullptr;
+
     explicit tsqlMutator(MyInputStream &s)
         : stream(s)
     {
     }
+
+	void enterEveryRule(ParserRuleContext *ctx) override
+	{
+		if (unsupportedFeatureHandler)
+			unsupportedFeatureHandler->visitNode(ctx);
+	}
     
 private:
     // getIDName() - returns the name found in one of the given TerminalNodes
@@ -2424,6 +2436,59 @@ static void process_select_statement(
 	}
 }
 
+static void
+record_parse_time(double ms)
+{
+	ANTLR_parser_stats *stats = &pltsql_parser_stats;
+
+	if (stats->batches++ == 0)
+		stats->first_batch_ms = ms;
+	stats->last_batch_ms = ms;
+	stats->max_batch_ms = std::max(stats->max_batch_ms, ms);
+	stats->total_batch_ms += ms;
+}
+
+static tree::ParseTree *
+parse_batch(TSqlParser &parser, bool is_itvf)
+{
+	if (is_itvf) /* special path to itvf */
+		return parser.func_body_return_select_body();
+	else /* normal path */
+		return parser.tsql_file();
+}
+
+/*
+ * Parse a batch only to prime the lexer and parser caches.
+ *
+ * The DFA the ANTLR runtime builds up while predicting is shared by all
+ * lexer and parser instances of the process, so parsing typical batches
+ * once makes the following parses of similar ones much cheaper.  Nothing is
+ * built from the tree and errors are ignored.  Returns whether the batch
+ * parsed cleanly.
+ */
+bool
+antlr_parser_warmup_batch(const char *sourceText)
+{
+	try
+	{
+		MyInputStream sourceStream(sourceText);
+		TSqlLexer lexer(&sourceStream);
+		CommonTokenStream tokens(&lexer);
+		TSqlParser parser(&tokens);
+
+		lexer.removeErrorListeners();
+		parser.removeErrorListeners();
+
+		parser.tsql_file();
+
+		return parser.getNumberOfSyntaxErrors() == 0;
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Entry point for ANTLR parser
 ////////////////////////////////////////////////////////////////////////////////
@@ -2468,6 +2533,10 @@ antlr_parser_cpp(const char *sourceText)
 	{
 		// TSqlParser::Tsql_fileContext *tree = parser.tsql_file();
 		tree::ParseTree *tree = nullptr;
+		instr_time	parse_start;
+		instr_time	parse_time;
+
+		INSTR_TIME_SET_CURRENT(parse_start);
 
 		/*
 		 * The sematnic of "RETURN SELECT ..." depends on whether it is used in Inlined Table Value Function or not.
@@ -2477,30 +2546,79 @@ antlr_parser_cpp(const char *sourceText)
 		 * Currently, we have only proc_body in input so accessing pltsql_curr_compile to check this is a body of ITVF or not.
 		 * If if it is ITVF, we parsed it with func_body_return_select_body grammar.
 		 */
-		if (pltsql_curr_compile && pltsql_curr_compile->is_itvf) /* special path to itvf */
-			tree = parser.func_body_return_select_body();
-		else /* normal path */
-			tree = parser.tsql_file();
+		bool is_itvf = pltsql_curr_compile && pltsql_curr_compile->is_itvf;
+
+		/*
+		 * Try the cheaper SLL prediction first, bailing out on the first
+		 * error instead of recovering from it. Most batches parse fine this
+		 * way. Only if it fails, which may be a real syntax error or a
+		 * decision that needs the full context, parse again in full LL mode
+		 * and with the error listener, so that syntax errors are reported
+		 * exactly as before.
+		 */
+		if (pltsql_enable_sll_parse_mode)
+		{
+			auto interpreter = parser.getInterpreter<atn::ParserATNSimulator>();
+
+			interpreter->setPredictionMode(atn::PredictionMode::SLL);
+			parser.removeErrorListeners();
+			parser.setErrorHandler(std::make_shared<BailErrorStrategy>());
+
+			try
+			{
+				tree = parse_batch(parser, is_itvf);
+				pltsql_parser_stats.sll_batches++;
+			}
+			catch (ParseCancellationException &)
+			{
+				tree = nullptr;
+				pltsql_parser_stats.ll_fallbacks++;
+
+				parser.reset();
+				parser.setErrorHandler(std::make_shared<DefaultErrorStrategy>());
+				parser.addErrorListener(&errorListner);
+				interpreter->setPredictionMode(atn::PredictionMode::LL);
+			}
+		}
+
+		if (tree == nullptr)
+			tree = parse_batch(parser, is_itvf);
+
+		INSTR_TIME_SET_CURRENT(parse_time);
+		INSTR_TIME_SUBTRACT(parse_time, parse_start);
+		record_parse_time(INSTR_TIME_GET_MILLISEC(parse_time));
 
 		if (pltsql_enable_antlr_detailed_log)
 			std::cout << tree->toStringTree(&parser, true) << std::endl;
 
-		/* visit all the node and publish instrumentation for unsupported feature */
+		/*
+		 * The mutator's walk also checks every node for unsupported features
+		 * and publishes instrumentation for them. Errors for those are only
+		 * thrown once the walk is done, for the first one found. As when the
+		 * whole tree was checked before the mutator ran, an unsupported
+		 * feature anywhere in the batch is reported rather than an error of
+		 * the mutator itself, so the part of the tree the mutator did not
+		 * reach is checked before its error is rethrown.
+		 */
 		std::unique_ptr<TsqlUnsupportedFeatureHandler> unsupportedFeatureHandler = TsqlUnsupportedFeatureHandler::create();
 		unsupportedFeatureHandler->setPublishInstr(true);
-		unsupportedFeatureHandler->visit(tree);
 
-		if (unsupportedFeatureHandler->hasUnsupportedFeature())
+		std::unique_ptr<tsqlMutator> mutator = std::make_unique<tsqlMutator>(sourceStream);
+		mutator->unsupportedFeatureHandler = unsupportedFeatureHandler.get();
+		antlr4::tree::ParseTreeWalker firstPass;
+		try
+		{
+			firstPass.walk(mutator.get(), tree);
+		}
+		catch (PGErrorWrapperException &)
 		{
-			/* revisit the parsed tree and throw an error when we meet the first unsupported feature */
+			unsupportedFeatureHandler->throwDeferredError();
 			unsupportedFeatureHandler->setPublishInstr(false);
-			unsupportedFeatureHandler->setThrowError(true);
 			unsupportedFeatureHandler->visit(tree);
+			unsupportedFeatureHandler->throwDeferredError();
+			throw;
 		}
-
-		std::unique_ptr<tsqlMutator> mutator = std::make_unique<tsqlMutator>(sourceStream);
-		antlr4::tree::ParseTreeWalker firstPass;
-		firstPass.walk(mutator.get(), tree);
+		unsupportedFeatureHandler->throwDeferredError();
 
 		// for batch-level statement (i.e. create procedure), we don't need to create actual PLtsql_stmt* by tsqlBuilder.
 		// We can just relay the query string to backend parser via one PLtsql_stmt_execsql.
@@ -4491,6 +4609,25 @@ makeInsertBulkStatement(TSqlParser::Dml_statementContext *ctx)
 				else if (pg_strcasecmp("KEEP_NULLS", ::getFullText(option_list[i]->id()).c_str()) == 0)
 					stmt->keep_nulls = true;
 
+				else if (pg_strcasecmp("ROWS_PER_FLUSH", ::getFullText(option_list[i]->id()).c_str()) == 0)
+				{
+					if (option_list[i]->expression())
+						stmt->rows_per_flush = pstrdup(::getFullText(option_list[i]->expression()).c_str());
+					else
+						throw PGErrorWrapperException(ERROR, ERRCODE_SYNTAX_ERROR, format_errmsg("incorrect syntax near %s",
+													::getFullText(option_list[i]->id()).c_str()),
+													getLineAndPos(option_list[i]->expression()));
+				}
+				else if (pg_strcasecmp("KILOBYTES_PER_FLUSH", ::getFullText(option_list[i]->id()).c_str()) == 0)
+				{
+					if (option_list[i]->expression())
+						stmt->kilobytes_per_flush = pstrdup(::getFullText(option_list[i]->expression()).c_str());
+					else
+						throw PGErrorWrapperException(ERROR, ERRCODE_SYNTAX_ERROR, format_errmsg("incorrect syntax near %s",
+													::getFullText(option_list[i]->id()).c_str()),
+													getLineAndPos(option_list[i]->expression()));
+				}
+
 				else if (pg_strcasecmp("CHECK_CONSTRAINTS", ::getFullText(option_list[i]->id()).c_str()) == 0)
 					throw PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, "insert bulk option check_constraints is not yet supported in babelfish", getLineAndPos(bulk_ctx->WITH()));
 
@@ -18,6 +18,9 @@ public:
 		virtual void setPublishInstr(bool) = 0;
 		virtual void setThrowError(bool) = 0;
 
+		virtual void visitNode(antlr4::ParserRuleContext *ctx) = 0;
+		virtual void throwDeferredError() = 0;
+
 		//void walk(antlr4::tree::ParseTree *tree);
 };
 
@@ -81,11 +81,19 @@ public:
 		void setPublishInstr(bool b) override { publish_instr = b; }
 		void setThrowError(bool b) override{ throw_error = b; }
 
+		void visitNode(antlr4::ParserRuleContext *ctx) override;
+		void throwDeferredError() override;
+
+		antlrcpp::Any visitChildren(antlr4::tree::ParseTree *node) override;
+
 protected:
 		bool publish_instr = false;
 		bool throw_error = false;
+		bool node_only = false; /* visit a single node, see visitNode() */
 		int count = 0; /* record count to skip unnecessary visiting */
-		bool is_inside_trigger = false;
+		std::unique_ptr<PGErrorWrapperException> deferred_error; /* first error found when not throwing */
+
+		void raise(PGErrorWrapperException &&e);
 
 		/* handler */
 		void handle(PgTsqlInstrMetricType tm_type, antlr4::tree::TerminalNode *node, escape_hatch_t* eh);
@@ -238,6 +246,52 @@ std::unique_ptr<TsqlUnsupportedFeatureHandler> TsqlUnsupportedFeatureHandler::cr
 	return std::make_unique<TsqlUnsupportedFeatureHandlerImpl>();
 }
 
+/*
+ * Run the checks of a single node, without descending into its children.
+ * This lets a ParseTreeWalker that visits every node anyway (tsqlMutator)
+ * do the checks on the way, instead of visiting the whole tree for them.
+ */
+void TsqlUnsupportedFeatureHandlerImpl::visitNode(antlr4::ParserRuleContext *ctx)
+{
+	node_only = true;
+	try
+	{
+		ctx->accept(this);
+	}
+	catch (...)
+	{
+		node_only = false;
+		throw;
+	}
+	node_only = false;
+}
+
+antlrcpp::Any TsqlUnsupportedFeatureHandlerImpl::visitChildren(antlr4::tree::ParseTree *node)
+{
+	if (node_only)
+		return defaultResult();
+	return TSqlParserBaseVisitor::visitChildren(node);
+}
+
+/*
+ * Throw the error for the first unsupported feature found, if any. Nodes are
+ * checked in the same order by visit() and visitNode(), so this is the error
+ * a visit with setThrowError(true) would have thrown.
+ */
+void TsqlUnsupportedFeatureHandlerImpl::throwDeferredError()
+{
+	if (count > 0 && deferred_error)
+		throw *deferred_error;
+}
+
+void TsqlUnsupportedFeatureHandlerImpl::raise(PGErrorWrapperException &&e)
+{
+	if (throw_error)
+		throw e;
+	if (!deferred_error)
+		deferred_error = std::make_unique<PGErrorWrapperException>(std::move(e));
+}
+
 void TsqlUnsupportedFeatureHandlerImpl::handle(PgTsqlInstrMetricType tm_type, antlr4::tree::TerminalNode *node, escape_hatch_t* eh)
 {
 	handle(tm_type, (node ? node->getText().c_str() : ""), eh, getLineAndPos(node));
@@ -252,12 +306,12 @@ void TsqlUnsupportedFeatureHandlerImpl::handle(PgTsqlInstrMetricType tm_type, co
 		TSQLInstrumentation(tm_type);
 	}
 
-	if (throw_error && (!eh || (*eh->val) != EH_IGNORE)) // if escape hatch is given, check the current value is 'ignore'
+	if ((throw_error || !deferred_error) && (!eh || (*eh->val) != EH_IGNORE)) // if escape hatch is given, check the current value is 'ignore'
 	{
 		if (eh)
-			throw PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'%s\' is not currently supported in Babelfish. please use babelfishpg_tsql.%s to ignore", featureName, eh->name), line_and_pos);
+			raise(PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'%s\' is not currently supported in Babelfish. please use babelfishpg_tsql.%s to ignore", featureName, eh->name), line_and_pos));
 		else
-			throw PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'%s\' is not currently supported in Babelfish", featureName), line_and_pos);
+			raise(PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'%s\' is not currently supported in Babelfish", featureName), line_and_pos));
 	}
 }
 
@@ -287,10 +341,8 @@ antlrcpp::Any TsqlUnsupportedFeatureHandlerImpl::visitCreate_or_alter_function(T
 		if (!found)
 		{
 			/* SCHEMABINDING is different from other case because it should throw an error when it is *NOT* given. handle an error manually */
-			if (throw_error)
-				throw PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'SCHEMABINDING\' option should be given to create a %s in Babelfish", "function"), getLineAndPos(ctx));
-			else
-				++count;
+			++count;
+			raise(PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'SCHEMABINDING\' option should be given to create a %s in Babelfish", "function"), getLineAndPos(ctx)));
 		}
 	}
 
@@ -328,10 +380,8 @@ antlrcpp::Any TsqlUnsupportedFeatureHandlerImpl::visitCreate_or_alter_procedure(
 		if (!found)
 		{
 			/* SCHEMABINDING is different from other case because it should throw an error when it is *NOT* given. handle an error manually */
-			if (throw_error)
-				throw PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'SCHEMABINDING\' option should be given to create a %s in Babelfish", "procedure"), getLineAndPos(ctx));
-			else
-				++count;
+			++count;
+			raise(PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'SCHEMABINDING\' option should be given to create a %s in Babelfish", "procedure"), getLineAndPos(ctx)));
 		}
 	}
 
@@ -384,10 +434,8 @@ antlrcpp::Any TsqlUnsupportedFeatureHandlerImpl::visitCreate_or_alter_trigger(TS
 		if (!found)
 		{
 			/* SCHEMABINDING is different from other case because it should throw an error when it is *NOT* given. handle an error manually */
-			if (throw_error)
-				throw PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'SCHEMABINDING\' option should be given to create a %s in Babelfish", "trigger"), getLineAndPos(ctx));
-			else
-				++count;
+			++count;
+			raise(PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'SCHEMABINDING\' option should be given to create a %s in Babelfish", "trigger"), getLineAndPos(ctx)));
 		}
 	}
 
@@ -431,10 +479,7 @@ antlrcpp::Any TsqlUnsupportedFeatureHandlerImpl::visitCreate_or_alter_trigger(TS
 			handle(INSTR_UNSUPPORTED_TSQL_DDL_TRIGGER_EXTERNAL_NAME_OPTION, "EXERNAL NAME", getLineAndPos(dctx->external_name()));
 	}
 
-	is_inside_trigger = true;
-	auto ret = visitChildren(ctx);
-	is_inside_trigger = false;
-	return ret;
+	return visitChildren(ctx);
 }
 
 antlrcpp::Any TsqlUnsupportedFeatureHandlerImpl::visitCreate_or_alter_view(TSqlParser::Create_or_alter_viewContext *ctx)
@@ -453,10 +498,8 @@ antlrcpp::Any TsqlUnsupportedFeatureHandlerImpl::visitCreate_or_alter_view(TSqlP
 		if (!found)
 		{
 			/* SCHEMABINDING is different from other case because it should throw an error when it is *NOT* given. handle an error manually */
-			if (throw_error)
-				throw PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'SCHEMABINDING\' option should be given to create a %s in Babelfish", "view"), getLineAndPos(ctx));
-			else
-				++count;
+			++count;
+			raise(PGErrorWrapperException(ERROR, ERRCODE_FEATURE_NOT_SUPPORTED, format_errmsg("\'SCHEMABINDING\' option should be given to create a %s in Babelfish", "view"), getLineAndPos(ctx)));
 		}
 	}
 
@@ -619,8 +662,7 @@ antlrcpp::Any TsqlUnsupportedFeatureHandlerImpl::visitIndex_option(TSqlParser::I
 			handle(INSTR_UNSUPPORTED_TSQL_INDEX_OPTION_MISC, "DATA_COMPRESSION", &st_escape_hatch_storage_options, getLineAndPos(ctx->id()[0]));
 		else
 		{
-			if (throw_error)
-				throw PGErrorWrapperException(ERROR, ERRCODE_SYNTAX_ERROR, format_errmsg("unknown index option: %s", id_str.c_str()), getLineAndPos(ctx->id()[0]));
+			raise(PGErrorWrapperException(ERROR, ERRCODE_SYNTAX_ERROR, format_errmsg("unknown index option: %s", id_str.c_str()), getLineAndPos(ctx->id()[0])));
 		}
 	}
 
@@ -1314,6 +1356,17 @@ antlrcpp::Any TsqlUnsupportedFeatureHandlerImpl::visitExecute_parameter(TSqlPars
 
 antlrcpp::Any TsqlUnsupportedFeatureHandlerImpl::visitTrigger_column_updated(TSqlParser::Trigger_column_updatedContext *ctx)
 {
+	bool is_inside_trigger = false;
+
+	for (antlr4::tree::ParseTree *parent = ctx->parent; parent; parent = parent->parent)
+	{
+		if (dynamic_cast<TSqlParser::Create_or_alter_triggerContext *>(parent))
+		{
+			is_inside_trigger = true;
+			break;
+		}
+	}
+
 	if (!is_inside_trigger && pltsql_curr_compile->fn_is_trigger == PLTSQL_NOT_TRIGGER){
 		/* trigger column updated is different from other case because it should throw an error when it is OUTSIDE of trigger. handle an error manually */
  		throw PGErrorWrapperException(ERROR, ERRCODE_SYNTAX_ERROR, "Can only use IF UPDATE within a CREATE TRIGGER statement", getLineAndPos(ctx));
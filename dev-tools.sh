@@ -35,6 +35,10 @@ if [ ! $1 ]; then
     echo "  test INPUT_DIR [MIGRATION_MODE]"
     echo "      run JDBC test, default migration_mode is single-db"
     echo ""
+    echo "  bench_insert_bulk [MAVEN_OPTIONS]"
+    echo "      load a fixed dataset through INSERT BULK and report rows/s and peak backend memory"
+    echo "      e.g. -Drows=1000000 -Diterations=3 -DrowsPerFlush=1000 -DkilobytesPerFlush=64 -Dindexed=true"
+    echo ""
     echo "  minor_version_upgrade SOURCE_WS [TARGET_WS]"
     echo "      upgrade minor version using ALTER EXTENSION ... UPDATE"
     exit 0
@@ -55,6 +59,8 @@ elif [ "$1" == "test" ]; then
     if [ ! $MIGRATION_MODE ]; then
         MIGRATION_MODE="single-db"
     fi
+elif [ "$1" == "bench_insert_bulk" ]; then
+    TARGET_WS=$CUR_WS
 fi
 if [ ! $TARGET_WS ]; then
     TARGET_WS=$CUR_WS
@@ -212,6 +218,11 @@ elif [ "$1" == "test" ]; then
     export inputFilesPath=$INPUT_DIR
     mvn test
     exit 0
+elif [ "$1" == "bench_insert_bulk" ]; then
+    shift
+    cd $CUR_WS/babelfish_extensions/test/JDBC
+    mvn -q compile exec:java -Dexec.mainClass=com.sqlsamples.InsertBulkBenchmark "$@"
+    exit 0
 elif [ "$1" == "minor_version_upgrade" ]; then
     echo "Building from $SOURCE_WS..."
     SOURCE_WS=$2
@@ -0,0 +1,63 @@
+CREATE TABLE for_json_t1 (id int, a varchar(10))
+GO
+CREATE TABLE for_json_t2 (id int, b varchar(10))
+GO
+INSERT INTO for_json_t1 VALUES (1, 'a1'), (2, 'a2'), (3, NULL)
+GO
+INSERT INTO for_json_t2 VALUES (1, 'b1'), (1, 'b11'), (2, NULL)
+GO
+
+-- variables in the query
+DECLARE @id int = 2
+SELECT id, a FROM for_json_t1 WHERE id >= @id FOR JSON PATH
+GO
+
+CREATE PROCEDURE for_json_p @id int AS SELECT id, a FROM for_json_t1 WHERE id = @id FOR JSON PATH
+GO
+EXEC for_json_p 1
+GO
+EXEC for_json_p 3
+GO
+
+-- ORDER BY
+SELECT id, a FROM for_json_t1 ORDER BY id DESC FOR JSON PATH
+GO
+SELECT id, b FROM for_json_t2 ORDER BY b FOR JSON PATH, INCLUDE_NULL_VALUES
+GO
+
+-- correlated subqueries
+SELECT id, (SELECT b FROM for_json_t2 WHERE for_json_t2.id = for_json_t1.id ORDER BY b FOR JSON PATH) AS j FROM for_json_t1 ORDER BY id
+GO
+
+-- empty results
+SELECT id, a FROM for_json_t1 WHERE id > 10 FOR JSON PATH
+GO
+SELECT id, a FROM for_json_t1 WHERE id > 10 FOR JSON PATH, ROOT
+GO
+SELECT id, a FROM for_json_t1 WHERE id > 10 FOR JSON PATH, ROOT('r')
+GO
+SELECT id, a FROM for_json_t1 WHERE id > 10 FOR JSON PATH, WITHOUT_ARRAY_WRAPPER
+GO
+SELECT id, a FROM for_json_t1 WHERE id > 10 FOR JSON PATH, ROOT, WITHOUT_ARRAY_WRAPPER
+GO
+
+-- unnamed columns
+SELECT id + 1 FROM for_json_t1 FOR JSON PATH
+GO
+SELECT id + 1 AS id FROM for_json_t1 WHERE id = 1 FOR JSON PATH
+GO
+
+-- the result column keeps its name
+CREATE VIEW for_json_v AS SELECT id, a FROM for_json_t1 FOR JSON PATH
+GO
+SELECT name FROM sys.columns WHERE object_id = OBJECT_ID('for_json_v')
+GO
+
+DROP VIEW for_json_v
+GO
+DROP PROCEDURE for_json_p
+GO
+DROP TABLE for_json_t1
+GO
+DROP TABLE for_json_t2
+GO
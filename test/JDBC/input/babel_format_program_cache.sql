@@ -0,0 +1,39 @@
+CREATE TABLE format_cache_dates(d DATE)
+GO
+
+INSERT INTO format_cache_dates VALUES ('1753-01-01'), ('1992-05-23'), ('9999-12-31')
+GO
+
+CREATE TABLE format_cache_numbers(i INT, r REAL)
+GO
+
+INSERT INTO format_cache_numbers VALUES (31, 3.312346E+38), (255, 3.4E+38)
+GO
+
+-- the same pattern over many rows, and twice in one select list
+SELECT FORMAT(d, 'd', 'en-us'), FORMAT(d, 'D', 'en-us'), FORMAT(d, 'd', 'en-us') FROM format_cache_dates ORDER BY d
+GO
+
+SELECT FORMAT(d, 'yyyy-MM-dd', 'en-us'), FORMAT(d, 'dddd, MMMM', 'en-us'), FORMAT(d, 'yyyy-MM-dd', 'en-us') FROM format_cache_dates ORDER BY d
+GO
+
+-- different cultures in one statement
+SELECT FORMAT(d, 'd', 'en-US'), FORMAT(d, 'd', 'en-GB'), FORMAT(d, 'D', 'en-US'), FORMAT(d, 'd', 'en-GB') FROM format_cache_dates ORDER BY d
+GO
+
+SELECT FORMAT(i, 'N', 'en-us'), FORMAT(i, 'X', 'en-GB'), FORMAT(i, 'N', 'en-us') FROM format_cache_numbers ORDER BY i
+GO
+
+-- a culture that is not supported is still reported once the pattern is cached
+SELECT FORMAT(d, 'd', 'dz-BT') FROM format_cache_dates
+GO
+
+-- R and E on real values, where the mantissa of R loses its trailing zeros
+SELECT FORMAT(r, 'R', 'en-us'), FORMAT(r, 'E', 'en-us'), FORMAT(r, 'E9', 'en-us'), FORMAT(r, 'R', 'en-us') FROM format_cache_numbers ORDER BY r
+GO
+
+DROP TABLE format_cache_dates
+GO
+
+DROP TABLE format_cache_numbers
+GO
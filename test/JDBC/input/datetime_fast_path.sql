@@ -0,0 +1,63 @@
+-- ISO layout, with blank and T separators
+SELECT CAST('2020-01-02 03:04:05.123' AS datetime)
+GO
+SELECT CAST('2020-01-02T03:04:05.123' AS datetime)
+GO
+SELECT CAST('2020-01-02 03:04' AS datetime2)
+GO
+SELECT CAST('2020-01-02 03:04:29  ' AS smalldatetime)
+GO
+SELECT CAST('2020-01-02 03:04:30' AS smalldatetime)
+GO
+
+-- yyyymmdd layout
+SELECT CAST('20200102' AS datetime)
+GO
+SELECT CAST('20200102 03:04:05' AS datetime2)
+GO
+SELECT CAST('20200102 03:04:05.5' AS datetimeoffset)
+GO
+
+-- fractional seconds beyond microseconds are rounded like the general decoder
+SELECT CAST('2020-01-02 03:04:05.1234567' AS datetime2(7))
+GO
+SELECT CAST('2020-01-02 03:04:05.1234564' AS datetime2(7))
+GO
+SELECT CASE WHEN CAST('2020-01-02 03:04:05.1234567' AS datetime2) = CAST('2020-1-2 3:04:05.1234567' AS datetime2) THEN 'same' ELSE 'different' END
+GO
+
+-- time zone offsets
+SELECT CAST('2020-01-02 03:04:05 +05:30' AS datetimeoffset)
+GO
+SELECT CAST('2020-01-02T03:04:05-0800' AS datetimeoffset)
+GO
+SELECT CAST('2020-01-02 03:04:05 +05' AS datetimeoffset)
+GO
+SELECT CAST('2020-01-02 03:04:05.123 -9:30' AS datetimeoffset)
+GO
+SELECT CAST('2020-01-02 03:04:05 +05:30' AS datetime2)
+GO
+SELECT CASE WHEN CAST('2020-01-02 03:04:05 +05:30' AS datetimeoffset) = CAST('2020-1-2 3:04:05 +05:30' AS datetimeoffset) THEN 'same' ELSE 'different' END
+GO
+
+-- datetimeoffset without an offset
+SELECT CAST('2020-01-02 03:04:05' AS datetimeoffset)
+GO
+SELECT CAST('20200102' AS datetimeoffset)
+GO
+
+-- 24:00 and leap seconds are left to the general decoder
+SELECT CAST('2020-01-02 24:00:00' AS datetime2)
+GO
+SELECT CAST('2020-12-31 23:59:60' AS datetime2)
+GO
+SELECT CAST('2020-12-31 23:59:60' AS datetime)
+GO
+SELECT CAST('2020-01-02 24:01:00' AS datetime2)
+GO
+
+-- out of range fields report the same error as before
+SELECT CAST('2020-02-30 03:04:05' AS datetime)
+GO
+SELECT CAST('20201301' AS datetime2)
+GO
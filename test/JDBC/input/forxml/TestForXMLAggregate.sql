@@ -0,0 +1,60 @@
+CREATE TABLE for_xml_agg_t (id int, a varchar(10))
+GO
+INSERT INTO for_xml_agg_t VALUES (1, 'a1'), (2, NULL), (3, 'x<y')
+GO
+
+-- RAW and PATH
+SELECT id, a FROM for_xml_agg_t ORDER BY id FOR XML RAW
+GO
+SELECT id, a FROM for_xml_agg_t ORDER BY id DESC FOR XML RAW('r')
+GO
+SELECT id, a FROM for_xml_agg_t ORDER BY id FOR XML PATH
+GO
+SELECT id, a FROM for_xml_agg_t ORDER BY id FOR XML PATH('p')
+GO
+
+-- rows with only NULLs
+SELECT a FROM for_xml_agg_t WHERE id = 2 FOR XML PATH('p')
+GO
+SELECT a FROM for_xml_agg_t WHERE id = 2 FOR XML PATH('')
+GO
+SELECT a FROM for_xml_agg_t ORDER BY id FOR XML PATH('')
+GO
+
+-- ROOT
+SELECT id FROM for_xml_agg_t ORDER BY id FOR XML RAW, ROOT('doc')
+GO
+SELECT id FROM for_xml_agg_t ORDER BY id FOR XML PATH(''), ROOT('doc')
+GO
+SELECT id FROM for_xml_agg_t WHERE id > 10 FOR XML PATH, ROOT('doc')
+GO
+
+-- TYPE returns xml, otherwise text
+SELECT id FROM for_xml_agg_t WHERE id = 1 FOR XML PATH
+GO
+SELECT id FROM for_xml_agg_t WHERE id = 1 FOR XML PATH, TYPE
+GO
+CREATE VIEW for_xml_agg_v1 AS SELECT id FROM for_xml_agg_t FOR XML RAW
+GO
+CREATE VIEW for_xml_agg_v2 AS SELECT id FROM for_xml_agg_t FOR XML RAW, TYPE
+GO
+SELECT name FROM sys.columns WHERE object_id IN (OBJECT_ID('for_xml_agg_v1'), OBJECT_ID('for_xml_agg_v2')) ORDER BY name
+GO
+
+-- BINARY BASE64 is not supported for binary columns
+SELECT id, CAST(0x01 AS varbinary(4)) AS b FROM for_xml_agg_t WHERE id = 1 FOR XML RAW, BINARY BASE64
+GO
+SELECT id FROM for_xml_agg_t WHERE id = 1 FOR XML RAW, BINARY BASE64
+GO
+
+-- nested subqueries
+SELECT o.id, (SELECT i.a FROM for_xml_agg_t i WHERE i.id = o.id FOR XML PATH, TYPE) AS x
+FROM for_xml_agg_t o ORDER BY o.id FOR XML PATH('o'), ROOT('doc')
+GO
+SELECT o.id, (SELECT i.a FROM for_xml_agg_t i WHERE i.id <= o.id ORDER BY i.id FOR XML RAW) AS x FROM for_xml_agg_t o ORDER BY o.id
+GO
+
+DROP VIEW for_xml_agg_v1, for_xml_agg_v2
+GO
+DROP TABLE for_xml_agg_t
+GO
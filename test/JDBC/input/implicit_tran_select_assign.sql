@@ -0,0 +1,52 @@
+CREATE TABLE implicit_tran_select_assign_t (a INT, b VARCHAR(10))
+INSERT INTO implicit_tran_select_assign_t VALUES (1, 'one')
+GO
+
+CREATE PROCEDURE implicit_tran_select_assign_proc
+AS
+BEGIN
+	DECLARE @a INT, @b VARCHAR(10), @i INT = 0
+	WHILE @i < 3
+	BEGIN
+		SELECT @a = @i, @b = 'x' + CAST(@i AS VARCHAR(10))
+		SET @i = @i + 1
+	END
+	SELECT @a, @b, @@TRANCOUNT
+END
+GO
+
+SET IMPLICIT_TRANSACTIONS ON
+GO
+
+-- selects of several columns without FROM don't start an implicit transaction
+SELECT @@TRANCOUNT
+SELECT 1, 2
+SELECT @@TRANCOUNT
+IF @@TRANCOUNT > 0 COMMIT
+GO
+
+DECLARE @a INT, @b VARCHAR(10)
+SELECT @a = 1, @b = 'two'
+SELECT @a, @b, @@TRANCOUNT
+IF @@TRANCOUNT > 0 COMMIT
+GO
+
+EXEC implicit_tran_select_assign_proc
+IF @@TRANCOUNT > 0 COMMIT
+GO
+
+-- with FROM they do
+DECLARE @a INT, @b VARCHAR(10)
+SELECT @a = a, @b = b FROM implicit_tran_select_assign_t
+SELECT @a, @b, @@TRANCOUNT
+IF @@TRANCOUNT > 0 COMMIT
+GO
+
+SET IMPLICIT_TRANSACTIONS OFF
+GO
+
+DROP PROCEDURE implicit_tran_select_assign_proc
+GO
+
+DROP TABLE implicit_tran_select_assign_t
+GO
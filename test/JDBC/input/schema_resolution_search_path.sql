@@ -0,0 +1,102 @@
+CREATE DATABASE schema_res_db1
+GO
+CREATE DATABASE schema_res_db2
+GO
+
+-- an sp_ procedure in master is found from any database
+CREATE PROCEDURE sp_schema_res_proc AS SELECT CAST('master.dbo' AS varchar(40))
+GO
+
+USE schema_res_db1
+GO
+CREATE SCHEMA schema_res_s1
+GO
+CREATE TABLE schema_res_s1.schema_res_tag (a varchar(40))
+GO
+CREATE TABLE dbo.schema_res_tag (a varchar(40))
+GO
+INSERT INTO schema_res_s1.schema_res_tag VALUES ('schema_res_db1.schema_res_s1')
+GO
+INSERT INTO dbo.schema_res_tag VALUES ('schema_res_db1.dbo')
+GO
+CREATE TABLE schema_res_s1.schema_res_t (a int)
+GO
+
+-- unqualified names in a trigger resolve in the schema of the statement that fired it
+CREATE TRIGGER schema_res_s1.schema_res_trig ON schema_res_s1.schema_res_t AFTER INSERT AS SELECT a FROM schema_res_tag
+GO
+
+-- unqualified names in a procedure resolve in the procedure's schema first
+CREATE PROCEDURE schema_res_s1.schema_res_p_select AS SELECT a FROM schema_res_tag
+GO
+CREATE PROCEDURE schema_res_s1.schema_res_p_insert AS INSERT INTO schema_res_s1.schema_res_t VALUES (1)
+GO
+CREATE PROCEDURE schema_res_s1.schema_res_p_sp AS
+BEGIN
+	EXEC sp_schema_res_proc
+	SELECT a FROM schema_res_tag
+END
+GO
+
+USE schema_res_db2
+GO
+CREATE SCHEMA schema_res_s2
+GO
+CREATE TABLE schema_res_s2.schema_res_tag (a varchar(40))
+GO
+CREATE TABLE dbo.schema_res_tag (a varchar(40))
+GO
+INSERT INTO schema_res_s2.schema_res_tag VALUES ('schema_res_db2.schema_res_s2')
+GO
+INSERT INTO dbo.schema_res_tag VALUES ('schema_res_db2.dbo')
+GO
+CREATE PROCEDURE schema_res_s2.schema_res_p_select AS SELECT a FROM schema_res_tag
+GO
+
+-- a nested cross-db call must not leave its search path behind
+CREATE PROCEDURE schema_res_s2.schema_res_p_nested AS
+BEGIN
+	EXEC schema_res_db1.schema_res_s1.schema_res_p_select
+	SELECT a FROM schema_res_tag
+	EXEC schema_res_db1.schema_res_s1.schema_res_p_insert
+	SELECT a FROM schema_res_tag
+END
+GO
+
+USE schema_res_db1
+GO
+
+EXEC schema_res_s1.schema_res_p_select
+GO
+EXEC schema_res_s1.schema_res_p_insert
+GO
+EXEC schema_res_db2.schema_res_s2.schema_res_p_select
+GO
+EXEC schema_res_db2.schema_res_s2.schema_res_p_nested
+GO
+EXEC sp_schema_res_proc
+GO
+EXEC schema_res_s1.schema_res_p_sp
+GO
+
+-- and afterwards the session resolves names in dbo again
+SELECT a FROM schema_res_tag
+GO
+
+USE schema_res_db2
+GO
+EXEC sp_schema_res_proc
+GO
+EXEC schema_res_db1.schema_res_s1.schema_res_p_sp
+GO
+SELECT a FROM schema_res_tag
+GO
+
+USE master
+GO
+DROP PROCEDURE sp_schema_res_proc
+GO
+DROP DATABASE schema_res_db1
+GO
+DROP DATABASE schema_res_db2
+GO
@@ -0,0 +1,49 @@
+CREATE TABLE sp_cursor_refresh_t (i INT, c VARCHAR(10));
+INSERT INTO sp_cursor_refresh_t VALUES (1, 'a'), (2, 'bb'), (3, 'ccc'), (4, 'dddd');
+GO
+
+-- scrollable cursor: REFRESH resends the last fetched block
+DECLARE @cursor_handle int;
+EXEC sp_cursoropen @cursor_handle OUTPUT, 'select i, c from sp_cursor_refresh_t order by i', 2, 1;
+-- NEXT 2
+EXEC sp_cursorfetch @cursor_handle, 2, 0, 2;
+EXEC sp_cursor @cursor_handle, 8, 0, '';
+-- NEXT 1
+EXEC sp_cursorfetch @cursor_handle, 2, 0, 1;
+EXEC sp_cursor @cursor_handle, 8, 0, '';
+-- PREV 2
+EXEC sp_cursorfetch @cursor_handle, 4, 0, 2;
+EXEC sp_cursor @cursor_handle, 8, 0, '';
+-- LAST 2
+EXEC sp_cursorfetch @cursor_handle, 8, 0, 2;
+EXEC sp_cursor @cursor_handle, 8, 0, '';
+EXEC sp_cursor @cursor_handle, 8, 0, '';
+EXEC sp_cursorclose @cursor_handle;
+GO
+
+-- forward-only cursor: fetches still stream, but there is nothing to refresh
+DECLARE @cursor_handle int;
+EXEC sp_cursoropen @cursor_handle OUTPUT, 'select i, c from sp_cursor_refresh_t order by i', 4, 1;
+-- NEXT 2
+EXEC sp_cursorfetch @cursor_handle, 2, 0, 2;
+-- NEXT 2
+EXEC sp_cursorfetch @cursor_handle, 2, 0, 2;
+EXEC sp_cursor @cursor_handle, 8, 0, '';
+GO
+DECLARE @cursor_handle int;
+SET @cursor_handle = sys.babelfish_pltsql_get_last_cursor_handle();
+EXEC sp_cursorclose @cursor_handle;
+GO
+
+-- scrollable cursor refreshed before its first fetch
+DECLARE @cursor_handle int;
+EXEC sp_cursoropen @cursor_handle OUTPUT, 'select i, c from sp_cursor_refresh_t order by i', 2, 1;
+EXEC sp_cursor @cursor_handle, 8, 0, '';
+GO
+DECLARE @cursor_handle int;
+SET @cursor_handle = sys.babelfish_pltsql_get_last_cursor_handle();
+EXEC sp_cursorclose @cursor_handle;
+GO
+
+DROP TABLE sp_cursor_refresh_t;
+GO
@@ -0,0 +1,19 @@
+SET QUOTED_IDENTIFIER OFF
+GO
+
+-- the error of the tsql mutator alone
+SELECT "f'oo"
+GO
+
+-- an unsupported feature later in the batch is reported instead
+SELECT "f'oo"
+DECLARE @h HIERARCHYID
+GO
+
+-- and so is one earlier in the batch
+DECLARE @h HIERARCHYID
+SELECT "f'oo"
+GO
+
+SET QUOTED_IDENTIFIER ON
+GO
@@ -0,0 +1,55 @@
+-- the default collation is case insensitive, and trailing blanks are not significant
+CREATE TABLE varchar_sort_t (id INT, v VARCHAR(20), c CHAR(10))
+INSERT INTO varchar_sort_t VALUES (1, 'abc', 'abc'), (2, 'ABC  ', 'ABC'), (3, 'abc ', 'abc  '), (4, 'abd', 'abd'),
+    (5, 'Abb', 'Abb'), (6, '', ''), (7, 'ab', 'ab'), (8, 'AB ', 'AB ')
+GO
+
+-- ties are broken by id
+SELECT id FROM varchar_sort_t ORDER BY v, id
+GO
+SELECT id FROM varchar_sort_t ORDER BY c, id
+GO
+SELECT id FROM varchar_sort_t ORDER BY v DESC, id
+GO
+SELECT id FROM varchar_sort_t ORDER BY c DESC, id
+GO
+SELECT id FROM varchar_sort_t ORDER BY v COLLATE latin1_general_bin2, id
+GO
+SELECT id FROM varchar_sort_t ORDER BY c COLLATE latin1_general_bin2, id
+GO
+
+-- the same order, and the same matches, from indexes built with sort support
+CREATE INDEX varchar_sort_t_v ON varchar_sort_t (v, id)
+CREATE INDEX varchar_sort_t_c ON varchar_sort_t (c, id)
+GO
+SELECT set_config('enable_seqscan', 'off', false)
+GO
+SELECT id FROM varchar_sort_t ORDER BY v, id
+GO
+SELECT id FROM varchar_sort_t ORDER BY c, id
+GO
+SELECT id FROM varchar_sort_t WHERE v = 'ABC' ORDER BY v, id
+GO
+SELECT id FROM varchar_sort_t WHERE c = 'aBc   ' ORDER BY c, id
+GO
+SELECT id FROM varchar_sort_t WHERE v > 'ab' AND v <= 'ABC ' ORDER BY v, id
+GO
+SELECT id FROM varchar_sort_t WHERE c >= 'AB' AND c < 'abc' ORDER BY c, id
+GO
+SELECT set_config('enable_seqscan', 'on', false)
+GO
+
+-- a larger sort agrees with the comparison operators
+CREATE TABLE varchar_sort_big (v VARCHAR(20), c CHAR(10))
+INSERT INTO varchar_sort_big SELECT a.s + b.s + c.s, a.s + b.s + c.s
+FROM (VALUES ('a'), ('A'), ('b'), ('B '), ('c'), ('')) a(s)
+CROSS JOIN (VALUES ('a'), ('A'), ('b'), ('B '), ('c'), ('')) b(s)
+CROSS JOIN (VALUES ('a'), ('A'), ('b'), ('B '), ('c'), ('')) c(s)
+GO
+SELECT COUNT(*) FROM (SELECT v, LAG(v) OVER (ORDER BY v) AS prev FROM varchar_sort_big) s WHERE prev > v
+SELECT COUNT(*) FROM (SELECT c, LAG(c) OVER (ORDER BY c) AS prev FROM varchar_sort_big) s WHERE prev > c
+GO
+
+DROP TABLE varchar_sort_big
+DROP TABLE varchar_sort_t
+GO
@@ -0,0 +1,50 @@
+-- values equal under the default case insensitive collation, including ones
+-- too long to be cached and ones whose sort key does not fit the stack buffer
+CREATE TABLE varchar_ci_t (id INT, v VARCHAR(2000))
+INSERT INTO varchar_ci_t VALUES (1, 'abc'), (2, 'ABC'), (3, 'aBc  '), (4, 'abd'), (5, 'ABD'), (6, 'x'),
+    (7, REPLICATE('a', 300)), (8, REPLICATE('A', 300)), (9, REPLICATE('xY', 700)), (10, REPLICATE('Xy', 700))
+GO
+
+-- equality, run twice so that the second run uses cached sort keys
+SELECT id FROM varchar_ci_t WHERE v = 'ABC' ORDER BY id
+SELECT id FROM varchar_ci_t WHERE v = 'ABC' ORDER BY id
+GO
+SELECT COUNT(*) FROM varchar_ci_t WHERE v <> 'abc'
+GO
+SELECT id FROM varchar_ci_t WHERE v = REPLICATE('XY', 700) ORDER BY id
+GO
+SELECT COUNT(DISTINCT v) FROM varchar_ci_t
+GO
+
+-- hash, merge and nested loop joins find the same matches
+SELECT set_config('enable_mergejoin', 'off', false), set_config('enable_nestloop', 'off', false)
+GO
+SELECT COUNT(*) FROM varchar_ci_t a JOIN varchar_ci_t b ON a.v = b.v
+SELECT COUNT(*) FROM varchar_ci_t a JOIN varchar_ci_t b ON a.v = b.v
+GO
+SELECT set_config('enable_mergejoin', 'on', false), set_config('enable_hashjoin', 'off', false)
+GO
+SELECT COUNT(*) FROM varchar_ci_t a JOIN varchar_ci_t b ON a.v = b.v
+GO
+SELECT set_config('enable_nestloop', 'on', false), set_config('enable_mergejoin', 'off', false)
+GO
+SELECT COUNT(*) FROM varchar_ci_t a JOIN varchar_ci_t b ON a.v = b.v
+GO
+SELECT set_config('enable_hashjoin', 'on', false), set_config('enable_mergejoin', 'on', false)
+GO
+
+-- hashed and sorted grouping find the same groups
+SELECT set_config('enable_sort', 'off', false)
+GO
+SELECT COUNT(*) AS n FROM varchar_ci_t GROUP BY v ORDER BY n
+SELECT COUNT(*) AS n FROM varchar_ci_t GROUP BY v ORDER BY n
+GO
+SELECT set_config('enable_sort', 'on', false), set_config('enable_hashagg', 'off', false)
+GO
+SELECT COUNT(*) AS n FROM varchar_ci_t GROUP BY v ORDER BY n
+GO
+SELECT set_config('enable_hashagg', 'on', false)
+GO
+
+DROP TABLE varchar_ci_t
+GO
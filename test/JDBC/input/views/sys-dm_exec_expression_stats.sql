@@ -0,0 +1,26 @@
+CREATE PROCEDURE sys_dm_exec_expression_stats_proc
+AS
+BEGIN
+	DECLARE @i INT = 0, @a INT, @b VARCHAR(3), @c DATETIME
+	WHILE @i < 10
+	BEGIN
+		SET @i = @i + 1
+		SELECT @a = @i * 2, @b = 'abcdef', @c = '2020-01-02'
+	END
+	SELECT @a = 100 WHERE 1 = 0
+	SELECT @a, @b, @c
+END
+GO
+
+EXEC sys_dm_exec_expression_stats_proc
+GO
+
+-- counters are per session, so only check that the procedure got some simple evaluations
+SELECT CASE WHEN simple_evals > 0 AND spi_evals >= 0 AND simple_ratio > 0 AND simple_ratio <= 1
+	THEN 1 ELSE 0 END
+FROM sys.dm_exec_expression_stats
+WHERE object_name = 'sys_dm_exec_expression_stats_proc'
+GO
+
+DROP PROCEDURE sys_dm_exec_expression_stats_proc
+GO
@@ -0,0 +1,26 @@
+-- timings are per session and vary, so only check that the view is there and sane
+SELECT COUNT(*) FROM sys.dm_exec_parser_stats
+GO
+
+SELECT CASE WHEN warmup_batches >= 0 AND warmup_ms >= 0 AND batches >= 1
+	AND first_batch_ms >= 0 AND last_batch_ms >= 0 AND max_batch_ms >= last_batch_ms
+	AND sll_batches >= 0 AND ll_fallbacks >= 0
+	THEN 1 ELSE 0 END
+FROM sys.dm_exec_parser_stats
+GO
+
+-- a syntax error fails the SLL parse, which is then retried in full LL mode
+CREATE TABLE #parser_stats_before (sll_batches BIGINT, ll_fallbacks BIGINT)
+INSERT INTO #parser_stats_before SELECT sll_batches, ll_fallbacks FROM sys.dm_exec_parser_stats
+GO
+
+DROP TABLE @parser_stats_t
+GO
+
+SELECT CASE WHEN s.ll_fallbacks > b.ll_fallbacks THEN 'increased' ELSE 'unchanged' END AS ll_fallbacks,
+	CASE WHEN s.sll_batches > b.sll_batches THEN 'increased' ELSE 'unchanged' END AS sll_batches
+FROM sys.dm_exec_parser_stats s, #parser_stats_before b
+GO
+
+DROP TABLE #parser_stats_before
+GO
@@ -0,0 +1,45 @@
+-- counters are per session, so only check that the view is there and sane
+SELECT COUNT(*) FROM sys.dm_exec_prepared_batch_stats
+GO
+
+SELECT CASE WHEN handles >= 0 AND compiled >= 0 AND compiled <= handles AND bytes >= 0 AND evictions >= 0 AND reprepares >= 0
+	THEN 1 ELSE 0 END
+FROM sys.dm_exec_prepared_batch_stats
+GO
+
+-- counters are per session, so compare them with a snapshot
+CREATE TABLE prepared_batch_memory_t (a INT)
+CREATE TABLE #prepared_batch_before (evictions BIGINT, reprepares BIGINT)
+INSERT INTO #prepared_batch_before SELECT evictions, reprepares FROM sys.dm_exec_prepared_batch_stats
+GO
+
+-- with a 1kB budget only the batch in use stays compiled
+SELECT set_config('babelfishpg_tsql.prepared_batch_memory', '1', false)
+GO
+
+-- preparing @h2 evicts @h1, executing @h1 compiles it again and evicts @h2,
+-- the second execution of @h1 uses the compiled batch, then @h2 is compiled
+-- again and evicts @h1
+DECLARE @h1 INT, @h2 INT
+EXEC sp_prepare @h1 OUT, N'@p INT', N'INSERT INTO prepared_batch_memory_t VALUES (@p)'
+EXEC sp_prepare @h2 OUT, N'@p INT', N'INSERT INTO prepared_batch_memory_t VALUES (@p + 10)'
+EXEC sp_execute @h1, 1
+EXEC sp_execute @h1, 2
+EXEC sp_execute @h2, 3
+EXEC sp_unprepare @h1
+EXEC sp_unprepare @h2
+GO
+
+SELECT a FROM prepared_batch_memory_t ORDER BY a
+GO
+
+SELECT s.evictions - b.evictions AS evictions, s.reprepares - b.reprepares AS reprepares
+FROM sys.dm_exec_prepared_batch_stats s, #prepared_batch_before b
+GO
+
+SELECT set_config('babelfishpg_tsql.prepared_batch_memory', '16MB', false)
+GO
+
+DROP TABLE #prepared_batch_before
+DROP TABLE prepared_batch_memory_t
+GO
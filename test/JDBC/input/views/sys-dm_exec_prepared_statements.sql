@@ -0,0 +1,7 @@
+-- the catalog is only there with prepared_statement_catalog_size set, so only
+-- check that the view and the prewarm function can be called
+SELECT COUNT(*) FROM sys.dm_exec_prepared_statements WHERE executions < 0 OR prepares < 0
+GO
+
+SELECT CASE WHEN sys.babelfish_prepared_statements_prewarm(10) >= 0 THEN 1 ELSE 0 END
+GO
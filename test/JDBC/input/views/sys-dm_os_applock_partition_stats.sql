@@ -0,0 +1,12 @@
+exec sp_getapplock @Resource = 'sys_dm_os_applock_partition_stats_lock', @LockMode = 'Exclusive', @LockOwner = 'Session';
+GO
+
+-- other sessions may hold applocks too, so only check what this one adds
+SELECT CASE WHEN COUNT(*) = 16 AND SUM(resource_count) >= 1 AND SUM(acquisitions) >= 1
+	AND SUM(contended) <= SUM(acquisitions) AND MAX(contended_ratio) <= 1
+	THEN 1 ELSE 0 END
+FROM sys.dm_os_applock_partition_stats
+GO
+
+exec sp_releaseapplock @Resource = 'sys_dm_os_applock_partition_stats_lock', @LockOwner = 'Session';
+GO
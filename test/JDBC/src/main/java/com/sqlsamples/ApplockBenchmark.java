@@ -0,0 +1,105 @@
+package com.sqlsamples;
+
+import java.sql.Connection;
+import java.sql.DriverManager;
+import java.sql.ResultSet;
+import java.sql.SQLException;
+import java.sql.Statement;
+import java.util.ArrayList;
+import java.util.List;
+
+import static com.sqlsamples.Config.connectionString;
+
+/*
+ * Runs sp_getapplock / sp_releaseapplock pairs from many sessions at once,
+ * each session cycling through its own slice of a set of resource names, and
+ * reports the pairs per second together with how often the sessions had to
+ * wait for a partition of the shared applock table
+ * (sys.dm_os_applock_partition_stats).
+ *
+ * Run with:
+ *   mvn compile exec:java -Dexec.mainClass=com.sqlsamples.ApplockBenchmark
+ *
+ * Options (system properties):
+ *   sessions      number of concurrent sessions (default 64)
+ *   calls         lock/release pairs per session and run (default 2000)
+ *   resources     number of distinct resource names (default 1000)
+ *   iterations    number of timed runs (default 3)
+ */
+public class ApplockBenchmark {
+
+    static final String resourcePrefix = "applock_benchmark_";
+
+    public static void main(String[] args) throws Exception {
+        int sessions = Integer.getInteger("sessions", 64);
+        int calls = Integer.getInteger("calls", 2000);
+        int resources = Integer.getInteger("resources", 1000);
+        int iterations = Integer.getInteger("iterations", 3);
+
+        System.out.println("sessions: " + sessions + ", calls: " + calls
+                + ", resources: " + resources + ", iterations: " + iterations);
+
+        List<Connection> connections = new ArrayList<>();
+        try (Connection con = DriverManager.getConnection(connectionString);
+             Statement stmt = con.createStatement()) {
+            for (int s = 0; s < sessions; s++)
+                connections.add(DriverManager.getConnection(connectionString));
+
+            for (int i = 1; i <= iterations; i++) {
+                long[] before = contention(stmt);
+                long start = System.nanoTime();
+                run(connections, calls, resources);
+                double seconds = (System.nanoTime() - start) / 1e9;
+                long[] after = contention(stmt);
+
+                System.out.println(String.format("run %d: %.3f s, %.0f lock/release pairs/s, %d of %d partition locks contended",
+                        i, seconds, (double) sessions * calls / seconds,
+                        after[1] - before[1], after[0] - before[0]));
+            }
+        } finally {
+            for (Connection c : connections)
+                c.close();
+        }
+    }
+
+    /* One thread per session, each running its whole loop in a single batch */
+    static void run(List<Connection> connections, int calls, int resources) throws Exception {
+        List<Thread> threads = new ArrayList<>();
+        List<Exception> errors = new ArrayList<>();
+        int sessions = connections.size();
+
+        for (int s = 0; s < sessions; s++) {
+            Connection c = connections.get(s);
+            String batch = "DECLARE @i INT = 0, @r VARCHAR(64); WHILE @i < " + calls + " BEGIN "
+                    + "SET @r = '" + resourcePrefix + "' + CAST((@i * " + sessions + " + " + s + ") % " + resources + " AS VARCHAR(16)); "
+                    + "EXEC sp_getapplock @Resource = @r, @LockMode = 'Shared', @LockOwner = 'Session'; "
+                    + "EXEC sp_releaseapplock @Resource = @r, @LockOwner = 'Session'; "
+                    + "SET @i = @i + 1; END";
+
+            Thread t = new Thread(() -> {
+                try (Statement stmt = c.createStatement()) {
+                    stmt.execute(batch);
+                } catch (SQLException e) {
+                    synchronized (errors) {
+                        errors.add(e);
+                    }
+                }
+            });
+            threads.add(t);
+            t.start();
+        }
+
+        for (Thread t : threads)
+            t.join();
+        if (!errors.isEmpty())
+            throw errors.get(0);
+    }
+
+    /* Total partition lock acquisitions and contended acquisitions so far */
+    static long[] contention(Statement stmt) throws SQLException {
+        try (ResultSet rs = stmt.executeQuery("SELECT SUM(acquisitions), SUM(contended) FROM sys.dm_os_applock_partition_stats")) {
+            rs.next();
+            return new long[] {rs.getLong(1), rs.getLong(2)};
+        }
+    }
+}
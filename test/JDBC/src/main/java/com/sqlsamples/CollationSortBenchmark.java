@@ -0,0 +1,104 @@
+package com.sqlsamples;
+
+import java.sql.Connection;
+import java.sql.DriverManager;
+import java.sql.SQLException;
+import java.sql.Statement;
+
+import static com.sqlsamples.Config.connectionString;
+
+/*
+ * Sorts and indexes a varchar column under the common Babelfish collations
+ * and reports the time taken by each.
+ *
+ * Run with:
+ *   mvn compile exec:java -Dexec.mainClass=com.sqlsamples.CollationSortBenchmark
+ *
+ * Options (system properties):
+ *   rows          number of rows to load, a power of ten (default 10000000)
+ *   iterations    number of timed runs per collation (default 3)
+ *   collations    comma separated list of collations to test
+ *   workMem       work_mem for the session, so that sorts can stay in memory
+ */
+public class CollationSortBenchmark {
+
+    static final String tablePrefix = "collation_sort_benchmark";
+
+    static final String defaultCollations = "SQL_Latin1_General_CP1_CI_AS,"
+            + "SQL_Latin1_General_CP1_CS_AS,"
+            + "Latin1_General_CI_AI,"
+            + "Latin1_General_BIN2";
+
+    public static void main(String[] args) throws Exception {
+        int rows = Integer.getInteger("rows", 10000000);
+        int iterations = Integer.getInteger("iterations", 3);
+        String[] collations = System.getProperty("collations", defaultCollations).split(",");
+        String workMem = System.getProperty("workMem");
+
+        System.out.println("rows: " + rows + ", iterations: " + iterations
+                + ", work_mem: " + (workMem != null ? workMem : "default"));
+
+        try (Connection con = DriverManager.getConnection(connectionString);
+             Statement stmt = con.createStatement()) {
+            if (workMem != null)
+                stmt.execute("SELECT set_config('work_mem', '" + workMem + "', false)");
+
+            for (String name : collations) {
+                String collation = name.trim();
+                String table = tablePrefix + "_" + collation.toLowerCase();
+
+                loadDataset(stmt, table, collation, rows);
+
+                for (int i = 1; i <= iterations; i++) {
+                    double sortSeconds = timed(stmt, "SELECT COUNT(*) FROM (SELECT ROW_NUMBER() OVER (ORDER BY name) AS rn FROM "
+                            + table + ") s");
+                    double indexSeconds = timed(stmt, "CREATE INDEX " + table + "_idx ON " + table + " (name)");
+
+                    System.out.println(String.format("%s run %d: sort %.3f s, create index %.3f s",
+                            collation, i, sortSeconds, indexSeconds));
+
+                    stmt.execute("DROP INDEX " + table + "_idx ON " + table);
+                }
+
+                stmt.execute("DROP TABLE " + table);
+            }
+        }
+    }
+
+    /*
+     * The same rows on every run: mixed case, accented and trailing blank
+     * variants of a few million distinct keys, so that case and accent
+     * insensitive collations see plenty of ties.
+     */
+    static void loadDataset(Statement stmt, String table, String collation, int rows) throws SQLException {
+        int digits = (int) Math.round(Math.log10(rows));
+        StringBuilder from = new StringBuilder();
+        StringBuilder id = new StringBuilder();
+
+        stmt.execute("DROP TABLE IF EXISTS " + table);
+        stmt.execute("DROP TABLE IF EXISTS " + tablePrefix + "_digits");
+        stmt.execute("CREATE TABLE " + tablePrefix + "_digits (n int)");
+        stmt.execute("INSERT INTO " + tablePrefix + "_digits VALUES (0), (1), (2), (3), (4), (5), (6), (7), (8), (9)");
+        stmt.execute("CREATE TABLE " + table + " (id int, name varchar(64) COLLATE " + collation + ")");
+
+        for (int i = 0; i < digits; i++) {
+            from.append(i == 0 ? " FROM " : " CROSS JOIN ").append(tablePrefix).append("_digits d").append(i);
+            id.append(i == 0 ? "" : " + ").append("d").append(i).append(".n * ").append((int) Math.pow(10, i));
+        }
+
+        stmt.execute("INSERT INTO " + table + " SELECT id, CASE id % 4"
+                + " WHEN 0 THEN 'customer_' + k"
+                + " WHEN 1 THEN 'CUSTOMER_' + k"
+                + " WHEN 2 THEN 'Cústomer_' + k + '   '"
+                + " ELSE 'cUSTOMEr_' + k END"
+                + " FROM (SELECT id, CAST(CAST(id AS bigint) * 7919 % 3000017 AS varchar(16)) AS k"
+                + " FROM (SELECT " + id + " AS id" + from + ") ids) keys");
+        stmt.execute("DROP TABLE " + tablePrefix + "_digits");
+    }
+
+    static double timed(Statement stmt, String sql) throws SQLException {
+        long start = System.nanoTime();
+        stmt.execute(sql);
+        return (System.nanoTime() - start) / 1e9;
+    }
+}
@@ -0,0 +1,123 @@
+package com.sqlsamples;
+
+import java.sql.Connection;
+import java.sql.DriverManager;
+import java.sql.PreparedStatement;
+import java.sql.SQLException;
+import java.sql.Statement;
+import java.time.LocalDateTime;
+import java.time.format.DateTimeFormatter;
+import java.util.Locale;
+import java.util.Random;
+
+import static com.sqlsamples.Config.connectionString;
+
+/*
+ * Converts a table of datetime strings in the layouts seen in ETL and bulk
+ * loads to datetime, smalldatetime, datetime2 and datetimeoffset, and reports
+ * the throughput for each layout.  The ISO 8601 and yyyymmdd layouts take the
+ * fixed-format fast path, the others go through the general date/time decoder.
+ *
+ * Run with:
+ *   mvn compile exec:java -Dexec.mainClass=com.sqlsamples.DatetimeParseBenchmark
+ *
+ * Options (system properties):
+ *   rows          number of strings per layout (default 1000000)
+ *   iterations    number of timed runs per conversion (default 3)
+ */
+public class DatetimeParseBenchmark {
+
+    static final String table = "datetime_parse_benchmark";
+
+    /* column name, formatter used to generate it */
+    static final String[][] layouts = {
+        {"iso",         "yyyy-MM-dd HH:mm:ss.SSS"},
+        {"iso_t",       "yyyy-MM-dd'T'HH:mm:ss.SSS"},
+        {"iso_minutes", "yyyy-MM-dd HH:mm"},
+        {"compact",     "yyyyMMdd HH:mm:ss.SSS"},
+        {"date_only",   "yyyyMMdd"},
+        {"us",          "MM/dd/yyyy HH:mm:ss"},
+        {"text_month",  "MMM d yyyy h:mma"},
+    };
+
+    static final String[] types = {"datetime", "smalldatetime", "datetime2", "datetimeoffset"};
+
+    public static void main(String[] args) throws Exception {
+        int rows = Integer.getInteger("rows", 1000000);
+        int iterations = Integer.getInteger("iterations", 3);
+
+        System.out.println("rows: " + rows + ", iterations: " + iterations);
+
+        try (Connection con = DriverManager.getConnection(connectionString);
+             Statement stmt = con.createStatement()) {
+            loadDataset(con, stmt, rows);
+
+            for (String type : types) {
+                for (String[] layout : layouts)
+                    run(stmt, type, layout[0], rows, iterations);
+                if (type.equals("datetimeoffset"))
+                    run(stmt, type, "iso_offset", rows, iterations);
+            }
+
+            stmt.execute("DROP TABLE " + table);
+        }
+    }
+
+    static void run(Statement stmt, String type, String column, int rows, int iterations) throws SQLException {
+        String sql = "SELECT COUNT(CAST(" + column + " AS " + type + ")) FROM " + table;
+
+        for (int i = 1; i <= iterations; i++) {
+            long start = System.nanoTime();
+            stmt.execute(sql);
+            double seconds = (System.nanoTime() - start) / 1e9;
+
+            System.out.println(String.format("%s from %s run %d: %.3f s, %.0f rows/s",
+                    type, column, i, seconds, rows / seconds));
+        }
+    }
+
+    /*
+     * The same timestamps on every run, spread over the smalldatetime range
+     * with millisecond precision, so that every layout converts to every type.
+     */
+    static void loadDataset(Connection con, Statement stmt, int rows) throws SQLException {
+        StringBuilder create = new StringBuilder("CREATE TABLE " + table + " (");
+        StringBuilder insert = new StringBuilder("INSERT INTO " + table + " VALUES (");
+        DateTimeFormatter[] formatters = new DateTimeFormatter[layouts.length];
+        DateTimeFormatter offset = DateTimeFormatter.ofPattern("yyyy-MM-dd HH:mm:ss.SSSSSSS", Locale.US);
+        LocalDateTime base = LocalDateTime.of(1990, 1, 1, 0, 0);
+        Random random = new Random(42);
+
+        for (int i = 0; i < layouts.length; i++) {
+            create.append(layouts[i][0]).append(" varchar(40), ");
+            insert.append("?, ");
+            formatters[i] = DateTimeFormatter.ofPattern(layouts[i][1], Locale.US);
+        }
+        create.append("iso_offset varchar(40))");
+        insert.append("?)");
+
+        stmt.execute("DROP TABLE IF EXISTS " + table);
+        stmt.execute(create.toString());
+
+        con.setAutoCommit(false);
+        try (PreparedStatement pstmt = con.prepareStatement(insert.toString())) {
+            for (int r = 1; r <= rows; r++) {
+                LocalDateTime ts = base.plusSeconds((long) (random.nextDouble() * 40 * 365 * 86400L))
+                        .plusNanos(random.nextInt(1000) * 1000000L);
+                int tzMinutes = (random.nextInt(57) - 28) * 30;
+
+                for (int i = 0; i < layouts.length; i++)
+                    pstmt.setString(i + 1, ts.format(formatters[i]));
+                pstmt.setString(layouts.length + 1, ts.format(offset)
+                        + String.format(" %s%02d:%02d", tzMinutes < 0 ? "-" : "+", Math.abs(tzMinutes) / 60, Math.abs(tzMinutes) % 60));
+                pstmt.addBatch();
+
+                if (r % 10000 == 0)
+                    pstmt.executeBatch();
+            }
+            pstmt.executeBatch();
+        }
+        con.commit();
+        con.setAutoCommit(true);
+    }
+}
@@ -0,0 +1,111 @@
+package com.sqlsamples;
+
+import java.sql.Connection;
+import java.sql.DriverManager;
+import java.sql.ResultSet;
+import java.sql.SQLException;
+import java.sql.Statement;
+
+import static com.sqlsamples.Config.connectionString;
+
+/*
+ * Runs FOR XML and FOR JSON over a wide table and reports the size of the
+ * document, the throughput and the peak memory of the server backend.
+ *
+ * Run with:
+ *   mvn compile exec:java -Dexec.mainClass=com.sqlsamples.ForClauseBenchmark
+ *
+ * Options (system properties):
+ *   rows          number of rows in the table, a power of ten (default 1000000)
+ *   columns       number of varchar columns besides the key (default 20)
+ *   iterations    number of timed runs per query (default 3)
+ *
+ * Peak memory is read from /proc, so it is only reported when the server runs
+ * on the same host as the benchmark.
+ */
+public class ForClauseBenchmark {
+
+    static final String table = "for_clause_benchmark";
+
+    static final String[] forClauses = {
+        "FOR XML RAW",
+        "FOR XML PATH",
+        "FOR XML PATH, ROOT('rows'), TYPE",
+        "FOR JSON PATH",
+    };
+
+    public static void main(String[] args) throws Exception {
+        int rows = Integer.getInteger("rows", 1000000);
+        int columns = Integer.getInteger("columns", 20);
+        int iterations = Integer.getInteger("iterations", 3);
+
+        System.out.println("rows: " + rows + ", columns: " + columns + ", iterations: " + iterations);
+
+        try (Connection con = DriverManager.getConnection(connectionString);
+             Statement stmt = con.createStatement()) {
+            loadDataset(stmt, rows, columns);
+        }
+
+        for (String forClause : forClauses) {
+            for (int i = 1; i <= iterations; i++) {
+                /* A new connection each time, so that every run gets a fresh backend. */
+                try (Connection con = DriverManager.getConnection(connectionString);
+                     Statement stmt = con.createStatement()) {
+                    int spid = InsertBulkBenchmark.backendPid(stmt);
+                    long hwmBefore = InsertBulkBenchmark.peakMemoryKB(spid);
+                    long length;
+
+                    long start = System.nanoTime();
+                    try (ResultSet rs = stmt.executeQuery("SELECT * FROM " + table + " ORDER BY id " + forClause)) {
+                        rs.next();
+                        length = rs.getString(1).length();
+                    }
+                    long elapsed = System.nanoTime() - start;
+
+                    long hwmAfter = InsertBulkBenchmark.peakMemoryKB(spid);
+                    double seconds = elapsed / 1e9;
+
+                    System.out.println(String.format("%s run %d: %.3f s, %.0f rows/s, %.1f MB/s, %d chars, backend peak memory: %s",
+                            forClause, i, seconds, rows / seconds, length / seconds / 1e6, length,
+                            hwmAfter < 0 ? "n/a" : (hwmAfter + " kB (+" + (hwmAfter - hwmBefore) + " kB)")));
+                }
+            }
+        }
+
+        try (Connection con = DriverManager.getConnection(connectionString);
+             Statement stmt = con.createStatement()) {
+            stmt.execute("DROP TABLE " + table);
+        }
+    }
+
+    /* The same rows on every run, with a mix of plain and escaped text. */
+    static void loadDataset(Statement stmt, int rows, int columns) throws SQLException {
+        int digits = (int) Math.round(Math.log10(rows));
+        StringBuilder create = new StringBuilder("CREATE TABLE " + table + " (id int");
+        StringBuilder select = new StringBuilder("SELECT id");
+        StringBuilder from = new StringBuilder();
+        StringBuilder id = new StringBuilder();
+
+        for (int c = 1; c <= columns; c++) {
+            create.append(", col").append(c).append(" varchar(40)");
+            if (c % 5 == 0)
+                select.append(", CASE WHEN id % 7 = 0 THEN NULL ELSE 'a < b & c' + CAST(id AS varchar(10)) END");
+            else
+                select.append(", 'value_").append(c).append("_' + CAST(id AS varchar(10))");
+        }
+        create.append(")");
+
+        for (int i = 0; i < digits; i++) {
+            from.append(i == 0 ? " FROM " : " CROSS JOIN ").append(table).append("_digits d").append(i);
+            id.append(i == 0 ? "" : " + ").append("d").append(i).append(".n * ").append((int) Math.pow(10, i));
+        }
+
+        stmt.execute("DROP TABLE IF EXISTS " + table);
+        stmt.execute("DROP TABLE IF EXISTS " + table + "_digits");
+        stmt.execute("CREATE TABLE " + table + "_digits (n int)");
+        stmt.execute("INSERT INTO " + table + "_digits VALUES (0), (1), (2), (3), (4), (5), (6), (7), (8), (9)");
+        stmt.execute(create.toString());
+        stmt.execute("INSERT INTO " + table + " " + select + " FROM (SELECT " + id + " AS id" + from + ") ids");
+        stmt.execute("DROP TABLE " + table + "_digits");
+    }
+}
@@ -0,0 +1,146 @@
+package com.sqlsamples;
+
+import com.microsoft.sqlserver.jdbc.SQLServerBulkCSVFileRecord;
+import com.microsoft.sqlserver.jdbc.SQLServerBulkCopy;
+import com.microsoft.sqlserver.jdbc.SQLServerBulkCopyOptions;
+
+import java.io.BufferedReader;
+import java.io.BufferedWriter;
+import java.io.File;
+import java.io.FileReader;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.sql.Connection;
+import java.sql.DriverManager;
+import java.sql.ResultSet;
+import java.sql.SQLException;
+import java.sql.Statement;
+import java.sql.Types;
+
+import static com.sqlsamples.Config.connectionString;
+
+/*
+ * Loads a fixed dataset through INSERT BULK and reports rows/s and the peak
+ * memory of the server backend.
+ *
+ * Run with:
+ *   mvn compile exec:java -Dexec.mainClass=com.sqlsamples.InsertBulkBenchmark
+ *
+ * Options (system properties):
+ *   rows                 number of rows to load (default 1000000)
+ *   iterations           number of timed loads (default 3)
+ *   rowsPerFlush         babelfishpg_tsql.insert_bulk_rows_per_flush for the session
+ *   kilobytesPerFlush    babelfishpg_tsql.insert_bulk_kilobytes_per_flush for the session
+ *   indexed              also create an index on the destination table (default false)
+ *
+ * Peak memory is read from /proc, so it is only reported when the server runs
+ * on the same host as the benchmark.
+ */
+public class InsertBulkBenchmark {
+
+    static final String destinationTable = "insert_bulk_benchmark";
+
+    public static void main(String[] args) throws Exception {
+        int rows = Integer.getInteger("rows", 1000000);
+        int iterations = Integer.getInteger("iterations", 3);
+        String rowsPerFlush = System.getProperty("rowsPerFlush");
+        String kilobytesPerFlush = System.getProperty("kilobytesPerFlush");
+        boolean indexed = Boolean.getBoolean("indexed");
+
+        File dataFile = File.createTempFile("insert_bulk_benchmark", ".csv");
+        dataFile.deleteOnExit();
+        writeDataset(dataFile, rows);
+
+        System.out.println("rows: " + rows + ", iterations: " + iterations
+                + ", rows_per_flush: " + (rowsPerFlush != null ? rowsPerFlush : "default")
+                + ", kilobytes_per_flush: " + (kilobytesPerFlush != null ? kilobytesPerFlush : "default")
+                + ", indexed: " + indexed);
+
+        for (int i = 1; i <= iterations; i++) {
+            /* A new connection each time, so that every load gets a fresh backend. */
+            try (Connection con = DriverManager.getConnection(connectionString);
+                 Statement stmt = con.createStatement()) {
+                stmt.execute("DROP TABLE IF EXISTS " + destinationTable);
+                stmt.execute("CREATE TABLE " + destinationTable
+                        + " (id int not null, grp bigint, amount numeric(18, 4), name varchar(100), created datetime2)");
+                if (indexed)
+                    stmt.execute("CREATE INDEX " + destinationTable + "_idx ON " + destinationTable + " (grp, id)");
+                if (rowsPerFlush != null)
+                    stmt.execute("SELECT set_config('babelfishpg_tsql.insert_bulk_rows_per_flush', '" + rowsPerFlush + "', false)");
+                if (kilobytesPerFlush != null)
+                    stmt.execute("SELECT set_config('babelfishpg_tsql.insert_bulk_kilobytes_per_flush', '" + kilobytesPerFlush + "', false)");
+
+                int spid = backendPid(stmt);
+                long hwmBefore = peakMemoryKB(spid);
+
+                long start = System.nanoTime();
+                loadDataset(con, dataFile);
+                long elapsed = System.nanoTime() - start;
+
+                long hwmAfter = peakMemoryKB(spid);
+                double seconds = elapsed / 1e9;
+
+                System.out.println(String.format("run %d: %.3f s, %.0f rows/s, backend peak memory: %s",
+                        i, seconds, rows / seconds,
+                        hwmAfter < 0 ? "n/a" : (hwmAfter + " kB (+" + (hwmAfter - hwmBefore) + " kB)")));
+
+                stmt.execute("DROP TABLE " + destinationTable);
+            }
+        }
+    }
+
+    /* The same rows on every run, so that results can be compared. */
+    static void writeDataset(File dataFile, int rows) throws IOException {
+        try (BufferedWriter bw = new BufferedWriter(new FileWriter(dataFile))) {
+            for (int i = 0; i < rows; i++) {
+                bw.write(i + "," + (i % 1000) + "," + (i % 100000) + "." + (i % 10000) + ",name_"
+                        + Integer.toHexString(i * 0x9E3779B1) + ",2022-01-01 "
+                        + String.format("%02d:%02d:%02d", (i / 3600) % 24, (i / 60) % 60, i % 60));
+                bw.newLine();
+            }
+        }
+    }
+
+    static void loadDataset(Connection con, File dataFile) throws SQLException {
+        SQLServerBulkCSVFileRecord record = new SQLServerBulkCSVFileRecord(dataFile.getAbsolutePath(), "UTF-8", ",", false);
+        record.addColumnMetadata(1, "id", Types.INTEGER, 0, 0);
+        record.addColumnMetadata(2, "grp", Types.BIGINT, 0, 0);
+        record.addColumnMetadata(3, "amount", Types.NUMERIC, 18, 4);
+        record.addColumnMetadata(4, "name", Types.VARCHAR, 100, 0);
+        record.addColumnMetadata(5, "created", Types.TIMESTAMP, 0, 0);
+
+        SQLServerBulkCopyOptions options = new SQLServerBulkCopyOptions();
+        options.setBulkCopyTimeout(0);
+
+        SQLServerBulkCopy bulkCopy = new SQLServerBulkCopy(con);
+        bulkCopy.setBulkCopyOptions(options);
+        bulkCopy.setDestinationTableName(destinationTable);
+        bulkCopy.writeToServer(record);
+        bulkCopy.close();
+    }
+
+    static int backendPid(Statement stmt) throws SQLException {
+        try (ResultSet rs = stmt.executeQuery("SELECT @@SPID")) {
+            rs.next();
+            return rs.getInt(1);
+        }
+    }
+
+    /* VmHWM of the backend in kB, or -1 if it is not running on this host. */
+    static long peakMemoryKB(int pid) {
+        File status = new File("/proc/" + pid + "/status");
+
+        if (!status.isFile())
+            return -1;
+        try (BufferedReader br = new BufferedReader(new FileReader(status))) {
+            String line;
+            while ((line = br.readLine()) != null) {
+                if (line.startsWith("VmHWM:"))
+                    return Long.parseLong(line.replaceAll("[^0-9]", ""));
+            }
+        } catch (IOException e) {
+            return -1;
+        }
+        return -1;
+    }
+}
@@ -0,0 +1,75 @@
+package com.sqlsamples;
+
+import java.sql.Connection;
+import java.sql.DriverManager;
+import java.sql.SQLException;
+import java.sql.Statement;
+
+import static com.sqlsamples.Config.connectionString;
+
+/*
+ * Calls a chain of nested procedures that each begin with the usual SET
+ * NOCOUNT / ANSI_WARNINGS / ... preamble, and reports the procedure calls
+ * per second.  Every procedure exit restores the settings its body changed.
+ *
+ * Run with:
+ *   mvn compile exec:java -Dexec.mainClass=com.sqlsamples.NestedSetBenchmark
+ *
+ * Options (system properties):
+ *   depth         number of procedures in the call chain (default 8)
+ *   calls         number of times the outermost procedure is called (default 20000)
+ *   iterations    number of timed runs (default 3)
+ */
+public class NestedSetBenchmark {
+
+    static final String procPrefix = "nested_set_benchmark";
+
+    static final String preamble = "SET NOCOUNT ON; SET ANSI_WARNINGS ON; SET ANSI_NULLS ON; "
+            + "SET QUOTED_IDENTIFIER ON; SET ARITHABORT ON; SET XACT_ABORT ON; "
+            + "SET CONCAT_NULL_YIELDS_NULL ON; SET ANSI_PADDING ON; ";
+
+    public static void main(String[] args) throws Exception {
+        int depth = Integer.getInteger("depth", 8);
+        int calls = Integer.getInteger("calls", 20000);
+        int iterations = Integer.getInteger("iterations", 3);
+
+        System.out.println("depth: " + depth + ", calls: " + calls + ", iterations: " + iterations);
+
+        try (Connection con = DriverManager.getConnection(connectionString);
+             Statement stmt = con.createStatement()) {
+            createProcedures(stmt, depth);
+
+            String batch = "DECLARE @i INT = 0; WHILE @i < " + calls
+                    + " BEGIN EXEC " + procPrefix + "_1; SET @i = @i + 1; END";
+
+            for (int i = 1; i <= iterations; i++) {
+                long start = System.nanoTime();
+                stmt.execute(batch);
+                double seconds = (System.nanoTime() - start) / 1e9;
+
+                System.out.println(String.format("run %d: %.3f s, %.0f procedure calls/s",
+                        i, seconds, (double) calls * depth / seconds));
+            }
+
+            dropProcedures(stmt, depth);
+        }
+    }
+
+    /* proc_1 calls proc_2 and so on; the innermost one just does some arithmetic. */
+    static void createProcedures(Statement stmt, int depth) throws SQLException {
+        dropProcedures(stmt, depth);
+
+        for (int d = depth; d >= 1; d--) {
+            String body = d == depth
+                    ? "DECLARE @x INT = " + d + "; SET @x = @x * 2;"
+                    : "EXEC " + procPrefix + "_" + (d + 1) + ";";
+
+            stmt.execute("CREATE PROCEDURE " + procPrefix + "_" + d + " AS BEGIN " + preamble + body + " END");
+        }
+    }
+
+    static void dropProcedures(Statement stmt, int depth) throws SQLException {
+        for (int d = 1; d <= depth; d++)
+            stmt.execute("DROP PROCEDURE IF EXISTS " + procPrefix + "_" + d);
+    }
+}